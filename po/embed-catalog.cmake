@@ -0,0 +1,30 @@
+# Generates C source with compiled-in message catalogs
+#
+# Usage:
+#   cmake -DLANGUAGES="ru;..." -DMO_DIR=<dir> -DOUTPUT=<file.c> \
+#         -P embed-catalog.cmake
+
+SET(content "/* Generated by embed-catalog.cmake, do not edit */\n\n")
+SET(content "${content}#include <ovpn-i18n.h>\n\n")
+
+SET(catalogs)
+FOREACH(language ${LANGUAGES})
+	FILE(READ "${MO_DIR}/${language}.mo" hex HEX)
+	STRING(LENGTH "${hex}" hex_length)
+	MATH(EXPR size "${hex_length} / 2")
+
+	STRING(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${hex}")
+	SET(row "")
+	FOREACH(i RANGE 11)
+		SET(row "${row}0x[0-9a-f][0-9a-f],")
+	ENDFOREACH(i)
+	STRING(REGEX REPLACE "(${row})" "\\1\n\t" bytes "${bytes}")
+
+	SET(content "${content}static const unsigned char catalog_${language}[] =\n{\n\t${bytes}\n};\n\n")
+	SET(catalogs "${catalogs}\t{ \"${language}\", catalog_${language}, ${size} },\n")
+ENDFOREACH(language)
+
+SET(content "${content}const ovpn_i18n_catalog_t ovpn_i18n_catalogs[] =\n{\n")
+SET(content "${content}${catalogs}\t{ NULL, NULL, 0 }\n};\n")
+
+FILE(WRITE "${OUTPUT}" "${content}")
@@ -16,10 +16,23 @@
 
 #include <getopt.h>
 #include <limits.h> /* PATH_MAX */
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>
 #include <ovpn.h>
+#include <ovpn-watch.h>
+#include <ovpn-ccd.h>
+#include <ovpn-ipp.h>
+#include <ovpn-generate.h>
+#include <ovpn-stream.h>
+#include <ovpn-schema.h>
 
 /* ----------------------------------------------------------------------- */
 
+/** Maximum count of --merge layers */
+#define MERGE_MAX_LAYERS  16
+
 /**
  * @brief Configuration data structure
  */
@@ -31,12 +44,133 @@ typedef struct config
 	/** Output formatted JSON */
 	int is_pretty;
 
+	/** Do not escape '/' characters in JSON strings */
+	int no_slash_escape;
+
 	/** Include status information into main JSON object
 	 *  By default, status information dumper separately in stderr */
 	int include_status;
 
-	/** Input file name */
-	const char *input_filename;
+	/** Add effective option sets of connection profiles */
+	int flatten_connections;
+
+	/** Parse files included with 'config' option */
+	int follow_includes;
+	int check_push;
+
+	/** Check configurations against cross-option rules */
+	int check_rules;
+
+	/** Rules file (NULL - built-in rules) */
+	const char *rules_filename;
+
+	/** Target OpenVPN version (any - all known options are accepted) */
+	ovpn_version_t target_version;
+
+	/** Binary options schema file to use instead of the built-in
+	 *  options table (NULL - built-in table is used) */
+	const char *schema_filename;
+
+	/** Binary options schema file to compile from text options
+	 *  specification or options table (NULL if disabled) */
+	const char *schema_compile;
+
+	/** Write options table as text options specification */
+	int schema_dump;
+
+	/** Maximum count of stored status messages (0 - not limited) */
+	unsigned int max_messages;
+
+	/** Parsing budgets */
+	ovpn_limits_t limits;
+
+	/** Write status messages as they occur */
+	int stream_status;
+
+	/** File descriptor for streamed status messages (-1 - stderr) */
+	int status_fd;
+
+	/** Input file names */
+	char **input_filenames;
+
+	/** Count of input file names */
+	int input_count;
+
+	/** Directory to watch (NULL if watch mode is disabled) */
+	const char *watch_dir;
+
+	/** Client config directory (NULL if ccd mode is disabled) */
+	const char *ccd_dir;
+
+	/** Input files are OpenVPN status files */
+	int status_log;
+
+	/** Status file re-read interval in milliseconds (0 - read once) */
+	unsigned int status_log_interval;
+
+	/** Input files are ifconfig-pool-persist files */
+	int ipp;
+
+	/** ifconfig-pool-persist index file to write (NULL - output JSON) */
+	const char *ipp_index;
+
+	/** ifconfig-pool-persist index file for lookups
+	 *  (NULL if lookup mode is disabled) */
+	const char *ipp_lookup;
+
+	/** UCI section name (NULL - from input file name) */
+	const char *uci_section;
+
+	/** Directory for UCI inline data files (NULL - current directory) */
+	const char *uci_inline_dir;
+
+	/** Input files are configurations in JSON format to be converted
+	 *  back to OVPN format */
+	int to_ovpn;
+
+	/** Directory for OVPN files (NULL - write to stdout) */
+	const char *to_ovpn_dir;
+
+	/** Template file for client profiles generation
+	 *  (NULL if generator mode is disabled) */
+	const char *generate;
+
+	/** Directory for generated client profiles
+	 *  (NULL - current directory) */
+	const char *generate_dir;
+
+	/** Add fingerprint of the canonical configuration form */
+	int fingerprint;
+
+	/** Compare two configuration files */
+	int diff;
+
+	/** Configuration layers (base configuration and overlays)
+	 *  to merge input files into */
+	const char *merge[MERGE_MAX_LAYERS];
+
+	/** Count of configuration layers (0 - merge mode is disabled) */
+	unsigned int merge_count;
+
+	/** Directory for merged configurations in OVPN format
+	 *  (NULL - write to stdout) */
+	const char *merge_dir;
+
+	/** Count of worker threads (0 - count of online CPUs) */
+	unsigned int jobs;
+
+	/** Watch mode debounce interval in milliseconds */
+	unsigned int debounce_ms;
+
+	/** Output format */
+	ovpn_format_t format;
+
+	/** Output compression */
+	ovpn_stream_compress_t compress;
+
+	/** Blob store file name for inline data deduplication
+	 *  ("-" is for stdout, NULL if deduplication is disabled) */
+	const char *blobs_filename;
 
 	/** Base path for locale files */
 	char locale_path[PATH_MAX];
@@ -51,20 +185,106 @@ typedef struct config
  */
 static config_t config =
 {
-	.is_stdin       =  0,
-	.is_pretty      =  0,
-	.include_status =  0,
-	.input_filename =  NULL,
-	.locale_path    =  GETTEXT_LOCALEDIR,
-	.language       = "",
+	.is_stdin            = 0,
+	.is_pretty           = 0,
+	.no_slash_escape     = 0,
+	.include_status      = 0,
+	.flatten_connections = 0,
+	.follow_includes     = 0,
+	.check_push          = 0,
+	.check_rules         = 0,
+	.rules_filename      = NULL,
+	.target_version      = OVPN_VERSION_ANY,
+	.schema_filename     = NULL,
+	.schema_compile      = NULL,
+	.schema_dump         = 0,
+	.max_messages        = OVPN_STATUS_MAX_MESSAGES,
+	.limits              = { 0 },
+	.stream_status       = 0,
+	.status_fd           = -1,
+	.input_filenames     = NULL,
+	.input_count         = 0,
+	.format              = OVPN_FORMAT_JSON,
+	.compress            = OVPN_STREAM_COMPRESS_NONE,
+	.blobs_filename      = NULL,
+	.watch_dir           = NULL,
+	.ccd_dir             = NULL,
+	.status_log          = 0,
+	.status_log_interval = 0,
+	.ipp                 = 0,
+	.ipp_index           = NULL,
+	.ipp_lookup          = NULL,
+	.uci_section         = NULL,
+	.uci_inline_dir      = NULL,
+	.to_ovpn             = 0,
+	.to_ovpn_dir         = NULL,
+	.generate            = NULL,
+	.generate_dir        = NULL,
+	.fingerprint         = 0,
+	.diff                = 0,
+	.merge               = { NULL },
+	.merge_count         = 0,
+	.merge_dir           = NULL,
+	.jobs                = 0,
+	.debounce_ms         = OVPN_WATCH_DEBOUNCE_MS,
+	.locale_path         = GETTEXT_LOCALEDIR,
+	.language            = "",
 };
 
+/** Stream for status messages written as they occur
+ *  (NULL - status is dumped after parsing) */
+static FILE *status_stream = NULL;
+
+/** Cross-option rules (NULL - configurations are not checked) */
+static ovpn_rules_t *rules = NULL;
+
 /* ----------------------------------------------------------------------- */
 
+/**
+ * @brief Values for command line options without short form
+ */
+enum
+{
+	OPT_DEBOUNCE = 0x100,
+	OPT_NO_SLASH_ESCAPE,
+	OPT_MAX_MESSAGES,
+	OPT_STATUS_STREAM,
+	OPT_STATUS_FD,
+	OPT_MAX_ERRORS,
+	OPT_MAX_WARNINGS,
+	OPT_MAX_LINES,
+	OPT_MAX_BYTES,
+	OPT_FLATTEN_CONNECTIONS,
+	OPT_FOLLOW_INCLUDES,
+	OPT_CHECK_PUSH,
+	OPT_CCD,
+	OPT_STATUS_LOG,
+	OPT_STATUS_LOG_INTERVAL,
+	OPT_IPP,
+	OPT_IPP_INDEX,
+	OPT_IPP_LOOKUP,
+	OPT_UCI_SECTION,
+	OPT_UCI_INLINE_DIR,
+	OPT_TO_OVPN,
+	OPT_TO_OVPN_DIR,
+	OPT_GENERATE,
+	OPT_GENERATE_DIR,
+	OPT_FINGERPRINT,
+	OPT_DIFF,
+	OPT_MERGE,
+	OPT_MERGE_DIR,
+	OPT_CHECK,
+	OPT_RULES,
+	OPT_TARGET_VERSION,
+	OPT_SCHEMA,
+	OPT_SCHEMA_COMPILE,
+	OPT_SCHEMA_DUMP,
+};
+
 /**
  * @brief Short command line options list
  */
-static const char *opts_str = "hspil:L:";
+static const char *opts_str = "hspil:L:d:w:j:z:f:";
 
 /**
  * @brief Long command line options list
@@ -77,6 +297,45 @@ static const struct option opts[] =
 	{ .name = "include-status", .has_arg = no_argument,       .val = 'i' },
 	{ .name = "locale-path",    .has_arg = required_argument, .val = 'l' },
 	{ .name = "language",       .has_arg = required_argument, .val = 'L' },
+	{ .name = "dedup-inlines",  .has_arg = required_argument, .val = 'd' },
+	{ .name = "watch",          .has_arg = required_argument, .val = 'w' },
+	{ .name = "jobs",           .has_arg = required_argument, .val = 'j' },
+	{ .name = "debounce",       .has_arg = required_argument, .val = OPT_DEBOUNCE },
+	{ .name = "compress",       .has_arg = required_argument, .val = 'z' },
+	{ .name = "format",         .has_arg = required_argument, .val = 'f' },
+	{ .name = "no-slash-escape", .has_arg = no_argument,      .val = OPT_NO_SLASH_ESCAPE },
+	{ .name = "max-messages",   .has_arg = required_argument, .val = OPT_MAX_MESSAGES },
+	{ .name = "status-stream",  .has_arg = no_argument,       .val = OPT_STATUS_STREAM },
+	{ .name = "status-fd",      .has_arg = required_argument, .val = OPT_STATUS_FD },
+	{ .name = "max-errors",     .has_arg = required_argument, .val = OPT_MAX_ERRORS },
+	{ .name = "max-warnings",   .has_arg = required_argument, .val = OPT_MAX_WARNINGS },
+	{ .name = "max-lines",      .has_arg = required_argument, .val = OPT_MAX_LINES },
+	{ .name = "max-bytes",      .has_arg = required_argument, .val = OPT_MAX_BYTES },
+	{ .name = "flatten-connections", .has_arg = no_argument,  .val = OPT_FLATTEN_CONNECTIONS },
+	{ .name = "follow-includes", .has_arg = no_argument,      .val = OPT_FOLLOW_INCLUDES },
+	{ .name = "check-push",     .has_arg = no_argument,       .val = OPT_CHECK_PUSH },
+	{ .name = "ccd",            .has_arg = required_argument, .val = OPT_CCD },
+	{ .name = "status-log",     .has_arg = no_argument,       .val = OPT_STATUS_LOG },
+	{ .name = "status-log-interval", .has_arg = required_argument, .val = OPT_STATUS_LOG_INTERVAL },
+	{ .name = "ipp",            .has_arg = no_argument,       .val = OPT_IPP },
+	{ .name = "ipp-index",      .has_arg = required_argument, .val = OPT_IPP_INDEX },
+	{ .name = "ipp-lookup",     .has_arg = required_argument, .val = OPT_IPP_LOOKUP },
+	{ .name = "uci-section",    .has_arg = required_argument, .val = OPT_UCI_SECTION },
+	{ .name = "uci-inline-dir", .has_arg = required_argument, .val = OPT_UCI_INLINE_DIR },
+	{ .name = "to-ovpn",        .has_arg = no_argument,       .val = OPT_TO_OVPN },
+	{ .name = "to-ovpn-dir",    .has_arg = required_argument, .val = OPT_TO_OVPN_DIR },
+	{ .name = "generate",       .has_arg = required_argument, .val = OPT_GENERATE },
+	{ .name = "generate-dir",   .has_arg = required_argument, .val = OPT_GENERATE_DIR },
+	{ .name = "fingerprint",    .has_arg = no_argument,       .val = OPT_FINGERPRINT },
+	{ .name = "diff",           .has_arg = no_argument,       .val = OPT_DIFF },
+	{ .name = "merge",          .has_arg = required_argument, .val = OPT_MERGE },
+	{ .name = "merge-dir",      .has_arg = required_argument, .val = OPT_MERGE_DIR },
+	{ .name = "check",          .has_arg = no_argument,       .val = OPT_CHECK },
+	{ .name = "rules",          .has_arg = required_argument, .val = OPT_RULES },
+	{ .name = "target-version", .has_arg = required_argument, .val = OPT_TARGET_VERSION },
+	{ .name = "schema",         .has_arg = required_argument, .val = OPT_SCHEMA },
+	{ .name = "schema-compile", .has_arg = required_argument, .val = OPT_SCHEMA_COMPILE },
+	{ .name = "schema-dump",    .has_arg = no_argument,       .val = OPT_SCHEMA_DUMP },
 	{ 0 }
 };
 
@@ -90,7 +349,13 @@ static void display_usage(void)
 		"OpenVPN Configuration Files Converter version " OVPN_CONVERT_VERSION "\n"
 		"Copyright (c) 2020 Anton Kikin <a.kikin@tano-systems.com>\n"
 		"\n"
-		"Usage: ovpn-convert [options] <input-file>\n"
+		"Usage: ovpn-convert [options] <input-file> [<input-file>...]\n"
+		"       ovpn-convert [options] --watch <dir>\n"
+		"       ovpn-convert [options] --ccd <dir>\n"
+		"       ovpn-convert [options] --ipp-lookup <index> <key> [<key>...]\n"
+		"       ovpn-convert [options] --diff <file-a> <file-b>\n"
+		"       ovpn-convert [options] --merge <base> [--merge <overlay>...] <input-file> [<input-file>...]\n"
+		"       ovpn-convert [options] --schema-compile <schema> [<spec-file>]\n"
 		"\n"
 		"Options:\n"
 		"  -h, --help\n"
@@ -102,11 +367,102 @@ static void display_usage(void)
 		"  -p, --pretty\n"
 		"        Output formatted JSON.\n"
 		"\n"
+		"  --no-slash-escape\n"
+		"        Do not escape '/' characters in JSON strings.\n"
+		"\n"
+		"  -f, --format <json|cbor|msgpack|uci|uci-batch|canonical>\n"
+		"        Output format (default: json). 'uci' and\n"
+		"        'uci-batch' formats write OpenWrt UCI 'openvpn'\n"
+		"        section as config file or 'uci batch' commands.\n"
+		"        'canonical' format writes configuration in\n"
+		"        normalized OVPN form.\n"
+		"\n"
+		"  --uci-section <name>\n"
+		"        UCI section name (default: input file name\n"
+		"        without extension).\n"
+		"\n"
+		"  --uci-inline-dir <dir>\n"
+		"        Directory to write inline data files referenced\n"
+		"        from UCI options (default: current directory).\n"
+		"\n"
+		"  -z, --compress <none|gzip|zstd>\n"
+		"        Compress output (default: none). Compressed input\n"
+		"        is detected and decompressed automatically.\n"
+		"\n"
 		"  -i, --include-status\n"
 		"        Include parse status information to main JSON.\n"
 		"        By default status information is dumped separately\n"
 		"        to stderr stream.\n"
 		"\n"
+		"  --fingerprint\n"
+		"        Add 128-bit fingerprint of the canonical\n"
+		"        configuration form to main JSON (as a comment\n"
+		"        line for 'canonical' output format).\n"
+		"\n"
+		"  --flatten-connections\n"
+		"        Add effective option sets of all connection\n"
+		"        profiles (global options overridden by\n"
+		"        <connection> block options) to main JSON.\n"
+		"\n"
+		"  --follow-includes\n"
+		"        Parse files included with 'config' option and\n"
+		"        merge their options into configuration. Relative\n"
+		"        paths are resolved against the including file\n"
+		"        directory. Each included file is parsed only once.\n"
+		"\n"
+		"  --check-push\n"
+		"        Validate options pushed with 'push' option and\n"
+		"        report options that can not be pushed.\n"
+		"\n"
+		"  --check\n"
+		"        Check configurations against built-in cross-option\n"
+		"        rules (client and server options, certificates and\n"
+		"        keys, device type, etc.).\n"
+		"\n"
+		"  --rules <file>\n"
+		"        Same as --check, but rules are loaded from <file>.\n"
+		"\n"
+		"  --target-version <2.4|2.5|2.6>\n"
+		"        Accept only options available in the given OpenVPN\n"
+		"        version (default: all known options).\n"
+		"\n"
+		"  --schema <file>\n"
+		"        Use options table from binary options schema\n"
+		"        <file> instead of the built-in table.\n"
+		"\n"
+		"  --schema-compile <file>\n"
+		"        Compile binary options schema <file> from text\n"
+		"        options specification input file (or from the\n"
+		"        options table in use if input file is not given).\n"
+		"\n"
+		"  --schema-dump\n"
+		"        Write options table in use as text options\n"
+		"        specification.\n"
+		"\n"
+		"  --max-messages <count>\n"
+		"        Maximum count of stored status messages, identical\n"
+		"        messages are aggregated (default: 0 - not\n"
+		"        limited).\n"
+		"\n"
+		"  --status-stream\n"
+		"        Write each status message to stderr as a separate\n"
+		"        JSON record as soon as it occurs, followed by\n"
+		"        the final counts record. Messages are not stored.\n"
+		"\n"
+		"  --status-fd <fd>\n"
+		"        Same as --status-stream, but records are written\n"
+		"        to the file descriptor <fd>.\n"
+		"\n"
+		"  --max-errors <count>\n"
+		"  --max-warnings <count>\n"
+		"        Abort parsing when count of errors (warnings)\n"
+		"        reaches <count> (default: 0 - not limited).\n"
+		"\n"
+		"  --max-lines <count>\n"
+		"  --max-bytes <count>\n"
+		"        Abort parsing when input exceeds <count> lines\n"
+		"        (bytes) (default: 0 - not limited).\n"
+		"\n"
 		"  -l, --locale-path <path>\n"
 		"        Path to directory with locale (mo) files\n"
 		"        (default: %s).\n"
@@ -114,8 +470,88 @@ static void display_usage(void)
 		"  -L, --language <language>\n"
 		"        Manually specify language\n"
 		"        (default: <from environment>).\n"
+		"\n"
+		"  -d, --dedup-inlines <file>\n"
+		"        Store each unique plain inline data only once in\n"
+		"        the blob records file (\"-\" for stdout) and\n"
+		"        reference it from configurations by digest.\n"
+		"\n"
+		"  -w, --watch <dir>\n"
+		"        Convert all *" OVPN_WATCH_SRC_SUFFIX " files in directory tree <dir>\n"
+		"        to *" OVPN_WATCH_DST_SUFFIX " files next to them and then\n"
+		"        reconvert changed files until interrupted.\n"
+		"\n"
+		"  --ccd <dir>\n"
+		"        Convert all client config files in client-config-dir\n"
+		"        <dir> into single JSON object keyed by client common\n"
+		"        name. Only options allowed in client config files\n"
+		"        are accepted.\n"
+		"\n"
+		"  --status-log\n"
+		"        Input files are OpenVPN status files (status-version\n"
+		"        1, 2 or 3). Each row is written as a separate record.\n"
+		"\n"
+		"  --status-log-interval <ms>\n"
+		"        Check status file for changes every <ms> milliseconds\n"
+		"        and convert it again when changed, until interrupted.\n"
+		"\n"
+		"  --ipp\n"
+		"        Input files are ifconfig-pool-persist files. Entries\n"
+		"        of all files are converted into single JSON object\n"
+		"        keyed by client common name.\n"
+		"\n"
+		"  --ipp-index <file>\n"
+		"        Same as --ipp, but write binary index of entries\n"
+		"        sorted by common name and by address to <file>.\n"
+		"\n"
+		"  --ipp-lookup <index>\n"
+		"        Look up keys (common names or IP addresses) given\n"
+		"        as arguments (or lines of stdin) in binary index\n"
+		"        <index> and output a record for each key.\n"
+		"\n"
+		"  --to-ovpn\n"
+		"        Input files are configurations in JSON format\n"
+		"        (NDJSON or concatenated values) to be converted\n"
+		"        back to OVPN format.\n"
+		"\n"
+		"  --to-ovpn-dir <dir>\n"
+		"        Same as --to-ovpn, but write each configuration\n"
+		"        to a separate file in directory <dir>.\n"
+		"\n"
+		"  --generate <template>\n"
+		"        Generate client profiles from template configuration\n"
+		"        and manifest input files (JSON records with client\n"
+		"        name, options and inline files).\n"
+		"\n"
+		"  --generate-dir <dir>\n"
+		"        Directory for generated client profiles\n"
+		"        (default: current directory).\n"
+		"\n"
+		"  --diff\n"
+		"        Compare two configuration files and output added,\n"
+		"        removed and changed options and inline blocks.\n"
+		"\n"
+		"  --merge <file>\n"
+		"        Merge each input file into configuration layer\n"
+		"        <file>. Can be specified several times, layers are\n"
+		"        merged in the order given (at most %u layers).\n"
+		"\n"
+		"  --merge-dir <dir>\n"
+		"        Write merged configurations in canonical OVPN\n"
+		"        format to separate files in directory <dir>.\n"
+		"\n"
+		"  -j, --jobs <count>\n"
+		"        Count of parallel conversion jobs\n"
+		"        (default: count of CPUs).\n"
+		"\n"
+		"  --debounce <ms>\n"
+		"        Delay conversion of changed files in watch mode\n"
+		"        until no changes for <ms> milliseconds\n"
+		"        (default: %u).\n"
 		"\n",
-		config.locale_path
+		config.locale_path,
+		MERGE_MAX_LAYERS,
+		config.debounce_ms
 	);
 }
 
@@ -180,148 +616,2152 @@ static int parse_cli_args(int argc, char *argv[])
 				break;
 			}
 
-			default:
+			case 'd': /* --dedup-inlines */
+			{
+				config.blobs_filename = optarg;
 				break;
-		}
-	}
+			}
 
-	if ((argc == optind) && !config.is_stdin)
-	{
-		fprintf(stderr, "Input file is not specified\n");
-		return -EINVAL;
-	}
-	else
-	{
-		if (!config.is_stdin)
-		{
-			config.input_filename = argv[optind];
-		}
-		else if (argc > optind)
-		{
-			fprintf(stderr,
-				"Can't specify both stdin and input file\n");
+			case 'w': /* --watch */
+			{
+				config.watch_dir = optarg;
+				break;
+			}
 
-			return -EINVAL;
-		}
-	}
+			case 'j': /* --jobs */
+			{
+				config.jobs = (unsigned int)strtoul(optarg, NULL, 10);
+				break;
+			}
 
-	return 0;
-}
+			case OPT_NO_SLASH_ESCAPE: /* --no-slash-escape */
+			{
+				config.no_slash_escape = 1;
+				break;
+			}
 
-/* ----------------------------------------------------------------------- */
+			case 'f': /* --format */
+			{
+				if (ovpn_format_by_name(optarg, &config.format))
+				{
+					fprintf(stderr,
+						"Unknown output format '%s'\n", optarg);
 
-static int setup_i18n(void)
-{
-#ifndef NDEBUG
-	char locale_dir[PATH_MAX];
-	strcpy(locale_dir, getenv("PWD"));
-	strcat(locale_dir, "/po");
-#else
-	char *locale_dir = config.locale_path;
-#endif
+					return -EINVAL;
+				}
 
-	if (config.language[0])
-	{
-		setenv("LANGUAGE", config.language, 1);
-		setenv("LANG", config.language, 1);
-	}
+				break;
+			}
 
-	/* Setting the i18n environment */
-	setlocale(LC_ALL, "");
+			case 'z': /* --compress */
+			{
+				int ret = ovpn_stream_compress_by_name(optarg, &config.compress);
+				if (ret)
+				{
+					fprintf(stderr,
+						(ret == -ENOTSUP)
+							? "Compression type '%s' is not supported by this build\n"
+							: "Unknown compression type '%s'\n",
+						optarg);
 
-	bindtextdomain(GETTEXT_PACKAGE, locale_dir);
-	textdomain(GETTEXT_PACKAGE);
+					return ret;
+				}
 
-	return 0;
-}
+				break;
+			}
 
-/* ----------------------------------------------------------------------- */
+			case OPT_DEBOUNCE: /* --debounce */
+			{
+				config.debounce_ms = (unsigned int)strtoul(optarg, NULL, 10);
+				break;
+			}
 
-int ovpn_parse_and_dump(FILE *input)
-{
-	int ret;
-	ovpn_t *ovpn;
+			case OPT_MAX_MESSAGES: /* --max-messages */
+			{
+				config.max_messages = (unsigned int)strtoul(optarg, NULL, 10);
+				break;
+			}
 
-	ovpn = ovpn_new(
-		config.include_status ? OVPN_FLAG_INCLUDE_STATUS : 0
-	);
+			case OPT_STATUS_STREAM: /* --status-stream */
+			{
+				config.stream_status = 1;
+				break;
+			}
 
-	if (!ovpn)
-	{
-		fprintf(stderr,
-			"Failed to allocate memory for OVPN object\n");
+			case OPT_FLATTEN_CONNECTIONS: /* --flatten-connections */
+			{
+				config.flatten_connections = 1;
+				break;
+			}
 
-		return -ENOMEM;
-	}
+			case OPT_FINGERPRINT: /* --fingerprint */
+			{
+				config.fingerprint = 1;
+				break;
+			}
 
-	ret = ovpn_parse(ovpn, input);
-	if (!ret)
-	{
-		ovpn_dump_json(
-			ovpn,
-			config.is_pretty ? OVPN_DUMP_FLAG_PRETTY : 0,
-			stdout
-		);
+			case OPT_DIFF: /* --diff */
+			{
+				config.diff = 1;
+				break;
+			}
 
-		if (!config.include_status)
-		{
-			/* If include_status is enabled, status object included in main JSON
-			 * and dumped by ovpn_dump_json() function */
-			ovpn_dump_json_status(
-				ovpn,
-				config.is_pretty ? OVPN_DUMP_FLAG_PRETTY : 0,
-				stderr
-			);
-		}
-	}
+			case OPT_MERGE: /* --merge */
+			{
+				if (config.merge_count >= MERGE_MAX_LAYERS)
+				{
+					fprintf(stderr,
+						"Too many configuration layers to merge (maximum %u)\n",
+						MERGE_MAX_LAYERS);
 
-	ovpn_delete(ovpn);
-	return ret;
-}
+					return -EINVAL;
+				}
 
-/**
- * Program start point
- *
- * @param[in] argc  Number of arguments
- * @param[in] argv  Array of the pointers to the arguments
- *
- * @return 0 on success
- * @return <0 on error
- */
-int main(int argc, char *argv[])
-{
-	int ret;
-	FILE *input;
+				config.merge[config.merge_count++] = optarg;
+				break;
+			}
 
-	ret = parse_cli_args(argc, argv);
-	if (ret)
-	{
-		display_usage();
-		return ret;
-	}
+			case OPT_MERGE_DIR: /* --merge-dir */
+			{
+				config.merge_dir = optarg;
+				break;
+			}
 
-	ret = setup_i18n();
-	if (ret)
-		return ret;
+			case OPT_STATUS_LOG: /* --status-log */
+			{
+				config.status_log = 1;
+				break;
+			}
 
-	if (config.is_stdin)
-		input = stdin;
-	else
-	{
-		input = fopen(config.input_filename, "rb");
-		if (!input)
-		{
-			fprintf(stderr,
-				"Could not open file '%s'\n",
-				config.input_filename);
+			case OPT_STATUS_LOG_INTERVAL: /* --status-log-interval */
+			{
+				config.status_log = 1;
+				config.status_log_interval = (unsigned int)strtoul(optarg, NULL, 10);
+				break;
+			}
 
-			return -ENODEV;
-		}
-	}
+			case OPT_IPP: /* --ipp */
+			{
+				config.ipp = 1;
+				break;
+			}
 
-	ret = ovpn_parse_and_dump(input);
-	if (!config.is_stdin)
-		fclose(input);
+			case OPT_IPP_INDEX: /* --ipp-index */
+			{
+				config.ipp = 1;
+				config.ipp_index = optarg;
+				break;
+			}
+
+			case OPT_IPP_LOOKUP: /* --ipp-lookup */
+			{
+				config.ipp_lookup = optarg;
+				break;
+			}
+
+			case OPT_UCI_SECTION: /* --uci-section */
+			{
+				if (!*optarg || (strspn(optarg,
+						"abcdefghijklmnopqrstuvwxyz"
+						"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+						"0123456789_") != strlen(optarg)))
+				{
+					fprintf(stderr,
+						"Invalid UCI section name '%s'\n", optarg);
+
+					return -EINVAL;
+				}
+
+				config.uci_section = optarg;
+				break;
+			}
+
+			case OPT_UCI_INLINE_DIR: /* --uci-inline-dir */
+			{
+				config.uci_inline_dir = optarg;
+				break;
+			}
+
+			case OPT_TO_OVPN: /* --to-ovpn */
+			{
+				config.to_ovpn = 1;
+				break;
+			}
+
+			case OPT_TO_OVPN_DIR: /* --to-ovpn-dir */
+			{
+				config.to_ovpn = 1;
+				config.to_ovpn_dir = optarg;
+				break;
+			}
+
+			case OPT_GENERATE: /* --generate */
+			{
+				config.generate = optarg;
+				break;
+			}
+
+			case OPT_GENERATE_DIR: /* --generate-dir */
+			{
+				config.generate_dir = optarg;
+				break;
+			}
+
+			case OPT_CCD: /* --ccd */
+			{
+				config.ccd_dir = optarg;
+				break;
+			}
+
+			case OPT_FOLLOW_INCLUDES: /* --follow-includes */
+			{
+				config.follow_includes = 1;
+				break;
+			}
+
+			case OPT_CHECK_PUSH: /* --check-push */
+			{
+				config.check_push = 1;
+				break;
+			}
+
+			case OPT_CHECK: /* --check */
+			{
+				config.check_rules = 1;
+				break;
+			}
+
+			case OPT_RULES: /* --rules */
+			{
+				config.check_rules = 1;
+				config.rules_filename = optarg;
+				break;
+			}
+
+			case OPT_TARGET_VERSION: /* --target-version */
+			{
+				config.target_version = ovpn_version_find(optarg);
+				if (config.target_version == OVPN_VERSION_ANY)
+				{
+					fprintf(stderr,
+						"Unknown OpenVPN version '%s'\n", optarg);
+
+					return -EINVAL;
+				}
+
+				break;
+			}
+
+			case OPT_SCHEMA: /* --schema */
+			{
+				config.schema_filename = optarg;
+				break;
+			}
+
+			case OPT_SCHEMA_COMPILE: /* --schema-compile */
+			{
+				config.schema_compile = optarg;
+				break;
+			}
+
+			case OPT_SCHEMA_DUMP: /* --schema-dump */
+			{
+				config.schema_dump = 1;
+				break;
+			}
+
+			case OPT_MAX_ERRORS: /* --max-errors */
+			{
+				config.limits.max_errors = (unsigned int)strtoul(optarg, NULL, 10);
+				break;
+			}
+
+			case OPT_MAX_WARNINGS: /* --max-warnings */
+			{
+				config.limits.max_warnings = (unsigned int)strtoul(optarg, NULL, 10);
+				break;
+			}
+
+			case OPT_MAX_LINES: /* --max-lines */
+			{
+				config.limits.max_lines = (unsigned int)strtoul(optarg, NULL, 10);
+				break;
+			}
+
+			case OPT_MAX_BYTES: /* --max-bytes */
+			{
+				config.limits.max_bytes = (size_t)strtoull(optarg, NULL, 10);
+				break;
+			}
+
+			case OPT_STATUS_FD: /* --status-fd */
+			{
+				config.stream_status = 1;
+				config.status_fd = (int)strtol(optarg, NULL, 10);
+				break;
+			}
+
+			default:
+				break;
+		}
+	}
+
+	if (config.stream_status && config.include_status)
+	{
+		fprintf(stderr,
+			"Can't include streamed status information to main JSON\n");
+
+		return -EINVAL;
+	}
+
+	if (config.status_log)
+	{
+		if (config.watch_dir || config.ccd_dir)
+		{
+			fprintf(stderr,
+				"Status files can't be converted in watch or ccd mode\n");
+
+			return -EINVAL;
+		}
+
+		if (config.status_log_interval &&
+		    (config.is_stdin || ((argc - optind) != 1)))
+		{
+			fprintf(stderr,
+				"Only one status file can be converted periodically\n");
+
+			return -EINVAL;
+		}
+	}
+
+	if (config.diff)
+	{
+		if (config.watch_dir || config.ccd_dir || config.status_log ||
+		    config.ipp || config.ipp_lookup || config.to_ovpn ||
+		    config.generate || config.blobs_filename || config.fingerprint ||
+		    config.include_status ||
+		    !((config.format == OVPN_FORMAT_JSON) ||
+		      OVPN_FORMAT_IS_BINARY(config.format)))
+		{
+			fprintf(stderr,
+				"Configuration files comparison can't be combined with "
+				"other conversion modes, output formats, included status, "
+				"fingerprints or inline data deduplication\n");
+
+			return -EINVAL;
+		}
+
+		if (config.is_stdin || ((argc - optind) != 2))
+		{
+			fprintf(stderr,
+				"Exactly two configuration files must be specified "
+				"for comparison\n");
+
+			return -EINVAL;
+		}
+	}
+
+	if (config.schema_compile || config.schema_dump)
+	{
+		if (config.watch_dir || config.ccd_dir || config.status_log ||
+		    config.ipp || config.ipp_lookup || config.to_ovpn ||
+		    config.generate || config.diff || config.merge_count ||
+		    config.check_rules || config.blobs_filename ||
+		    (config.schema_compile && config.schema_dump))
+		{
+			fprintf(stderr,
+				"Options schema compilation and dump can't be combined "
+				"with other modes or inline data deduplication\n");
+
+			return -EINVAL;
+		}
+
+		if (config.schema_dump ? (config.is_stdin || (argc > optind))
+		                       : ((argc - optind) > 1))
+		{
+			fprintf(stderr,
+				"At most one text options specification can be compiled "
+				"and no input files are read in dump mode\n");
+
+			return -EINVAL;
+		}
+	}
+
+	if (config.merge_dir && !config.merge_count)
+	{
+		fprintf(stderr,
+			"Directory for merged configurations is specified "
+			"without configuration layers\n");
+
+		return -EINVAL;
+	}
+
+	if (config.check_rules &&
+	    (config.ccd_dir || config.status_log || config.ipp ||
+	     config.ipp_lookup || config.to_ovpn || config.generate ||
+	     config.diff || config.merge_count))
+	{
+		fprintf(stderr,
+			"Cross-option rules are checked only for converted "
+			"configuration files\n");
+
+		return -EINVAL;
+	}
+
+	if (config.merge_count)
+	{
+		if (config.watch_dir || config.ccd_dir || config.status_log ||
+		    config.ipp || config.ipp_lookup || config.to_ovpn ||
+		    config.generate || config.diff || config.blobs_filename ||
+		    config.include_status || config.flatten_connections ||
+		    OVPN_FORMAT_IS_UCI(config.format))
+		{
+			fprintf(stderr,
+				"Configurations merge can't be combined with other "
+				"conversion modes, UCI output formats, included status, "
+				"flattened connections or inline data deduplication\n");
+
+			return -EINVAL;
+		}
+
+		if (config.merge_dir &&
+		    (config.is_stdin || ((config.format != OVPN_FORMAT_JSON) &&
+		                         (config.format != OVPN_FORMAT_CANONICAL))))
+		{
+			fprintf(stderr,
+				"Merged configurations are written to directory only "
+				"in canonical OVPN format and only for input files\n");
+
+			return -EINVAL;
+		}
+	}
+
+	if (config.generate)
+	{
+		if (config.watch_dir || config.ccd_dir || config.status_log ||
+		    config.ipp || config.ipp_lookup || config.to_ovpn ||
+		    config.blobs_filename || (config.format != OVPN_FORMAT_JSON))
+		{
+			fprintf(stderr,
+				"Client profiles generation can't be combined with "
+				"other conversion modes, output formats or inline "
+				"data deduplication\n");
+
+			return -EINVAL;
+		}
+	}
+
+	if (config.to_ovpn)
+	{
+		if (config.watch_dir || config.ccd_dir || config.status_log ||
+		    config.ipp || config.ipp_lookup || config.blobs_filename ||
+		    (config.format != OVPN_FORMAT_JSON))
+		{
+			fprintf(stderr,
+				"Conversion to OVPN format can't be combined with "
+				"other conversion modes, output formats or inline "
+				"data deduplication\n");
+
+			return -EINVAL;
+		}
+	}
+
+	if (OVPN_FORMAT_IS_UCI(config.format))
+	{
+		if (config.ccd_dir || config.status_log ||
+		    config.ipp || config.ipp_lookup)
+		{
+			fprintf(stderr,
+				"UCI output format is supported only for configuration files\n");
+
+			return -EINVAL;
+		}
+
+		if (config.blobs_filename || config.include_status ||
+		    config.flatten_connections)
+		{
+			fprintf(stderr,
+				"Inline data deduplication, included status and flattened "
+				"connections are not supported in UCI output format\n");
+
+			return -EINVAL;
+		}
+	}
+
+	if (config.format == OVPN_FORMAT_CANONICAL)
+	{
+		if (config.ccd_dir || config.status_log ||
+		    config.ipp || config.ipp_lookup)
+		{
+			fprintf(stderr,
+				"Canonical output format is supported only for configuration files\n");
+
+			return -EINVAL;
+		}
+
+		if (config.blobs_filename || config.include_status ||
+		    config.flatten_connections)
+		{
+			fprintf(stderr,
+				"Inline data deduplication, included status and flattened "
+				"connections are not supported in canonical output format\n");
+
+			return -EINVAL;
+		}
+	}
+
+	if (config.fingerprint)
+	{
+		if (config.status_log || config.ipp || config.ipp_lookup ||
+		    config.to_ovpn || config.generate ||
+		    OVPN_FORMAT_IS_UCI(config.format))
+		{
+			fprintf(stderr,
+				"Fingerprints are supported only for configuration files "
+				"in JSON, binary or canonical output format\n");
+
+			return -EINVAL;
+		}
+
+		if (config.blobs_filename)
+		{
+			fprintf(stderr,
+				"Fingerprints can't be combined with inline data deduplication\n");
+
+			return -EINVAL;
+		}
+	}
+
+	if (config.ipp || config.ipp_lookup)
+	{
+		if (config.watch_dir || config.ccd_dir || config.status_log ||
+		    (config.ipp && config.ipp_lookup))
+		{
+			fprintf(stderr,
+				"ifconfig-pool-persist files can't be converted "
+				"in watch, ccd, status file or lookup mode\n");
+
+			return -EINVAL;
+		}
+	}
+
+	if (config.ccd_dir)
+	{
+		if (config.watch_dir || config.is_stdin || (argc > optind))
+		{
+			fprintf(stderr,
+				"Can't specify input files in ccd mode\n");
+
+			return -EINVAL;
+		}
+
+		if (config.blobs_filename)
+		{
+			fprintf(stderr,
+				"Inline data deduplication is not supported in ccd mode\n");
+
+			return -EINVAL;
+		}
+
+		if (config.stream_status)
+		{
+			fprintf(stderr,
+				"Status streaming is not supported in ccd mode\n");
+
+			return -EINVAL;
+		}
+	}
+	else if (config.watch_dir)
+	{
+		if (config.is_stdin || (argc > optind))
+		{
+			fprintf(stderr,
+				"Can't specify input files in watch mode\n");
+
+			return -EINVAL;
+		}
+
+		if (config.blobs_filename)
+		{
+			fprintf(stderr,
+				"Inline data deduplication is not supported in watch mode\n");
+
+			return -EINVAL;
+		}
+
+		if (config.compress != OVPN_STREAM_COMPRESS_NONE)
+		{
+			fprintf(stderr,
+				"Output compression is not supported in watch mode\n");
+
+			return -EINVAL;
+		}
+
+		if (config.format != OVPN_FORMAT_JSON)
+		{
+			fprintf(stderr,
+				"Only JSON output format is supported in watch mode\n");
+
+			return -EINVAL;
+		}
+	}
+	else if ((argc == optind) && !config.is_stdin &&
+	         !config.schema_compile && !config.schema_dump)
+	{
+		fprintf(stderr, "Input file is not specified\n");
+		return -EINVAL;
+	}
+	else
+	{
+		if (!config.is_stdin)
+		{
+			config.input_filenames = &argv[optind];
+			config.input_count = argc - optind;
+		}
+		else if (argc > optind)
+		{
+			fprintf(stderr,
+				"Can't specify both stdin and input file\n");
+
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static int setup_i18n(void)
+{
+#ifndef NDEBUG
+	char locale_dir[PATH_MAX];
+	strcpy(locale_dir, getenv("PWD"));
+	strcat(locale_dir, "/po");
+#else
+	char *locale_dir = config.locale_path;
+#endif
+
+	/* Locale is set here (before any threads are started),
+	 * translations are loaded on the first translated message */
+	ovpn_i18n_setup(locale_dir, config.language);
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Get JSON dump flags (OVPN_DUMP_FLAG_*) from configuration
+ */
+static unsigned int dump_flags(void)
+{
+	unsigned int flags = 0;
+
+	if (config.is_pretty)
+		flags |= OVPN_DUMP_FLAG_PRETTY;
+
+	if (config.no_slash_escape)
+		flags |= OVPN_DUMP_FLAG_NO_SLASH_ESCAPE;
+
+	return flags;
+}
+
+/**
+ * Parse configuration from input stream
+ *
+ * @param[in]  raw_input  Input stream (possibly compressed)
+ * @param[in]  path       Input file path (NULL for stdin)
+ * @param[in]  blobs      Blob store (optional)
+ * @param[in]  flags      Additional OVPN object flags (OVPN_FLAG_*)
+ * @param[out] result     Parsed configuration (must be deleted by caller
+ *                        even if parsing is failed, NULL if
+ *                        configuration could not be created)
+ *
+ * @return Result of @ref ovpn_parse()
+ */
+static int parse_input(
+	FILE *raw_input,
+	const char *path,
+	ovpn_blobs_t *blobs,
+	unsigned int flags,
+	ovpn_t **result
+)
+{
+	int ret;
+	ovpn_t *ovpn;
+	FILE *input;
+	struct stat st;
+
+	*result = NULL;
+
+	ovpn = ovpn_new(
+		(config.include_status ? OVPN_FLAG_INCLUDE_STATUS : 0) |
+		(config.flatten_connections ? OVPN_FLAG_FLATTEN_CONNECTIONS : 0) |
+		(config.follow_includes ? OVPN_FLAG_FOLLOW_INCLUDES : 0) |
+		(config.check_push ? OVPN_FLAG_CHECK_PUSH : 0) |
+		flags
+	);
+
+	if (!ovpn)
+	{
+		fprintf(stderr,
+			"Failed to allocate memory for OVPN object\n");
+
+		return -ENOMEM;
+	}
+
+	/* Transparently decompress input */
+	input = ovpn_stream_open_input(raw_input);
+	if (!input)
+	{
+		fprintf(stderr,
+			"Failed to open input stream\n");
+
+		ovpn_delete(ovpn);
+		return -EIO;
+	}
+
+	*result = ovpn;
+
+	ovpn->blobs = blobs;
+	ovpn->rules = rules;
+	ovpn->version = config.target_version;
+	ovpn->max_messages = config.max_messages;
+	ovpn->status_stream = status_stream;
+	ovpn->status_stream_flags = dump_flags();
+	ovpn->limits = config.limits;
+	ovpn->path = path;
+
+	/* File identity is used for include cycle detection */
+	if (!fstat(fileno(raw_input), &st))
+	{
+		ovpn->dev = st.st_dev;
+		ovpn->ino = st.st_ino;
+	}
+
+	ret = ovpn_parse(ovpn, input);
+
+	/* Path is valid only while parsing */
+	ovpn->path = NULL;
+
+	ovpn_stream_close(input, raw_input);
+	return ret;
+}
+
+/**
+ * Dump configuration as UCI section named by --uci-section option
+ * or by input file name
+ */
+static int dump_uci(ovpn_t *ovpn, const char *path, FILE *output)
+{
+	char *p;
+	char section[NAME_MAX + 1];
+	const char *name = path ? strrchr(path, '/') : NULL;
+
+	ovpn_uci_opts_t uci_opts = {
+		.section    = config.uci_section,
+		.inline_dir = config.uci_inline_dir,
+	};
+
+	if (!uci_opts.section)
+	{
+		name = name ? (name + 1) : path;
+		snprintf(section, sizeof(section), "%s", name ? name : "ovpn");
+
+		/* Strip extension */
+		p = strrchr(section, '.');
+		if (p && (p != section))
+			*p = '\0';
+
+		for (p = section; *p; p++)
+		{
+			if (!(((*p >= 'a') && (*p <= 'z')) ||
+			      ((*p >= 'A') && (*p <= 'Z')) ||
+			      ((*p >= '0') && (*p <= '9'))))
+				*p = '_';
+		}
+
+		uci_opts.section = section;
+	}
+
+	return ovpn_dump_uci(ovpn, config.format, &uci_opts, output);
+}
+
+/**
+ * Add fingerprint of the canonical configuration form to main JSON
+ */
+static int add_fingerprint(json_object *json)
+{
+	int ret;
+	json_object *json_fingerprint;
+	char fingerprint[OVPN_FINGERPRINT_SIZE];
+
+	/* Canonical text is only hashed */
+	ret = ovpn_write_canonical(json, NULL, NULL, fingerprint);
+	if (ret)
+		return ret;
+
+	json_fingerprint = json_object_new_string(fingerprint);
+	if (!json_fingerprint)
+		return -ENOMEM;
+
+	json_object_object_add(json, "fingerprint", json_fingerprint);
+	return 0;
+}
+
+/**
+ * Dump configuration in canonical OVPN format
+ */
+static int dump_canonical(json_object *json, FILE *output)
+{
+	int ret;
+	char fingerprint[OVPN_FINGERPRINT_SIZE];
+
+	ret = ovpn_write_canonical(json, NULL, output,
+		config.fingerprint ? fingerprint : NULL);
+
+	if (!ret && config.fingerprint)
+		fprintf(output, "# %s\n", fingerprint);
+
+	return ret;
+}
+
+int ovpn_parse_and_dump(
+	FILE *raw_input,
+	const char *path,
+	FILE *output,
+	ovpn_blobs_t *blobs
+)
+{
+	int ret;
+	ovpn_t *ovpn;
+
+	ret = parse_input(raw_input, path, blobs, 0, &ovpn);
+	if (!ovpn)
+		return ret;
+
+	/* Data parsed before aborting is dumped as well */
+	if (!ret || (ret == -ECANCELED))
+	{
+		if (config.fingerprint && (config.format != OVPN_FORMAT_CANONICAL))
+		{
+			int fp_ret = add_fingerprint(ovpn->json);
+			if (fp_ret)
+				ret = fp_ret;
+		}
+
+		if (config.format == OVPN_FORMAT_JSON)
+		{
+			ovpn_dump_json(
+				ovpn,
+				dump_flags(),
+				output
+			);
+		}
+		else if (OVPN_FORMAT_IS_UCI(config.format))
+		{
+			int dump_ret = dump_uci(ovpn, path, output);
+			if (dump_ret)
+				ret = dump_ret;
+		}
+		else if (config.format == OVPN_FORMAT_CANONICAL)
+		{
+			int dump_ret = dump_canonical(ovpn->json, output);
+			if (dump_ret)
+				ret = dump_ret;
+		}
+		else
+			ovpn_dump_binary(ovpn, config.format, output);
+
+		if (!config.include_status && !status_stream)
+		{
+			/* If include_status is enabled, status object included in main JSON
+			 * and dumped by ovpn_dump_json() function */
+			ovpn_dump_json_status(
+				ovpn,
+				dump_flags(),
+				stderr
+			);
+		}
+	}
+
+	/* Streamed status ends with the final counts record */
+	if (status_stream)
+	{
+		ovpn_dump_json_status(
+			ovpn,
+			dump_flags() & ~OVPN_DUMP_FLAG_PRETTY,
+			status_stream
+		);
+
+		fflush(status_stream);
+	}
+
+	ovpn_delete(ovpn);
+	return ret;
+}
+
+/**
+ * Client config file parsing handler
+ */
+static int parse_ccd_file(const char *path, FILE *input, ovpn_t **ovpn)
+{
+	int ret = parse_input(input, path, NULL, OVPN_FLAG_CCD, ovpn);
+
+	/* Data parsed before aborting (or before an error in
+	 * configuration) is converted as well, errors are reported
+	 * in the client status */
+	if ((ret == -ECANCELED) || (ret == -1))
+		ret = 0;
+
+	if (!ret && config.fingerprint)
+		ret = add_fingerprint((*ovpn)->json);
+
+	return ret;
+}
+
+/**
+ * Convert client config directory into single object
+ * keyed by client common name
+ */
+static int convert_ccd(FILE *output)
+{
+	int ret;
+	json_object *clients;
+	json_object *status;
+
+	ovpn_ccd_opts_t ccd_opts = {
+		.threads = config.jobs,
+		.parse   = parse_ccd_file,
+	};
+
+	ret = ovpn_ccd(config.ccd_dir, &ccd_opts, &clients, &status);
+	if (ret)
+		return ret;
+
+	if (config.format == OVPN_FORMAT_JSON)
+		ret = ovpn_json_write(clients, dump_flags(), output);
+	else
+		ret = ovpn_dump_binary_map(clients, config.format, output);
+
+	/* Status of clients with errors or warnings */
+	if (!ret && json_object_object_length(status))
+		ret = ovpn_json_write(status, dump_flags(), stderr);
+
+	json_object_put(clients);
+	json_object_put(status);
+	return ret;
+}
+
+/**
+ * Convert OpenVPN status files
+ */
+static int convert_status_logs(FILE *output)
+{
+	int i;
+	int ret = 0;
+	FILE *input;
+	FILE *raw_input;
+	ovpn_status_log_t *log = ovpn_status_log_new(config.format, dump_flags());
+
+	if (!log)
+	{
+		fprintf(stderr,
+			"Failed to allocate memory for status file converter\n");
+
+		return -ENOMEM;
+	}
+
+	if (config.status_log_interval)
+	{
+		ret = ovpn_status_log_follow(log, config.input_filenames[0],
+			config.status_log_interval, output);
+
+		ovpn_status_log_delete(log);
+		return ret;
+	}
+
+	for (i = 0; !ret && (config.is_stdin || (i < config.input_count)); i++)
+	{
+		raw_input = config.is_stdin
+			? stdin : fopen(config.input_filenames[i], "rb");
+
+		if (!raw_input)
+		{
+			fprintf(stderr,
+				"Could not open file '%s'\n",
+				config.input_filenames[i]);
+
+			ret = -ENODEV;
+			break;
+		}
+
+		/* Transparently decompress input */
+		input = ovpn_stream_open_input(raw_input);
+		if (input)
+		{
+			ret = ovpn_status_log_convert(log, input, output);
+			ovpn_stream_close(input, raw_input);
+		}
+		else
+			ret = -EIO;
+
+		if (raw_input != stdin)
+			fclose(raw_input);
+
+		if (config.is_stdin)
+			break;
+	}
+
+	ovpn_status_log_delete(log);
+	return ret;
+}
+
+/**
+ * Convert ifconfig-pool-persist files into single object
+ * or binary index
+ */
+static int convert_ipp(FILE *output)
+{
+	int i;
+	int ret = 0;
+	FILE *input;
+	FILE *raw_input;
+	json_object *json;
+	ovpn_ipp_t *ipp = ovpn_ipp_new();
+
+	if (!ipp)
+	{
+		fprintf(stderr,
+			"Failed to allocate memory for ifconfig-pool-persist entries\n");
+
+		return -ENOMEM;
+	}
+
+	for (i = 0; !ret && (config.is_stdin || (i < config.input_count)); i++)
+	{
+		raw_input = config.is_stdin
+			? stdin : fopen(config.input_filenames[i], "rb");
+
+		if (!raw_input)
+		{
+			fprintf(stderr,
+				"Could not open file '%s'\n",
+				config.input_filenames[i]);
+
+			ret = -ENODEV;
+			break;
+		}
+
+		/* Transparently decompress input */
+		input = ovpn_stream_open_input(raw_input);
+		if (input)
+		{
+			ret = ovpn_ipp_parse(ipp, input);
+			ovpn_stream_close(input, raw_input);
+		}
+		else
+			ret = -EIO;
+
+		if (raw_input != stdin)
+			fclose(raw_input);
+
+		if (config.is_stdin)
+			break;
+	}
+
+	if (ret)
+		goto out;
+
+	if (config.ipp_index)
+	{
+		ret = ovpn_ipp_write_index(ipp, config.ipp_index);
+		goto out;
+	}
+
+	json = ovpn_ipp_json(ipp);
+	if (!json)
+	{
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	if (config.format == OVPN_FORMAT_JSON)
+		ret = ovpn_json_write(json, dump_flags(), output);
+	else
+		ret = ovpn_encode_object(config.format, json, output);
+
+	json_object_put(json);
+
+out:
+	ovpn_ipp_delete(ipp);
+	return ret;
+}
+
+/**
+ * Look up key in ifconfig-pool-persist index and
+ * output record for it
+ */
+static int lookup_ipp_key(
+	const ovpn_ipp_index_t *index,
+	const char *key,
+	FILE *output
+)
+{
+	int ret;
+	ovpn_ipp_entry_t entry;
+	json_object *record = json_object_new_object();
+
+	if (!record)
+		return -ENOMEM;
+
+	/*
+	 * {
+	 *     "key": "<key>",
+	 *     "cn": "<common-name>",
+	 *     "ip": "<ipv4>",
+	 *     "ipv6": "<ipv6>"
+	 * }
+	 */
+	json_object_object_add(record, "key", json_object_new_string(key));
+
+	ret = ovpn_ipp_index_lookup(index, key, &entry);
+	if (!ret)
+	{
+		char addr[INET6_ADDRSTRLEN];
+
+		json_object_object_add(record, "cn",
+			json_object_new_string_len(entry.cn, (int)entry.cn_len));
+
+		if (entry.has_ipv4)
+		{
+			inet_ntop(AF_INET, entry.ipv4, addr, sizeof(addr));
+			json_object_object_add(record, "ip", json_object_new_string(addr));
+		}
+
+		if (entry.has_ipv6)
+		{
+			inet_ntop(AF_INET6, entry.ipv6, addr, sizeof(addr));
+			json_object_object_add(record, "ipv6", json_object_new_string(addr));
+		}
+	}
+	else if (ret != -ENOENT)
+	{
+		json_object_put(record);
+		return ret;
+	}
+
+	if (config.format == OVPN_FORMAT_JSON)
+		ret = ovpn_json_write(record, dump_flags(), output);
+	else
+		ret = ovpn_encode_object(config.format, record, output);
+
+	json_object_put(record);
+	return ret;
+}
+
+/**
+ * Look up keys in ifconfig-pool-persist index
+ */
+static int lookup_ipp(FILE *output)
+{
+	int i;
+	int ret = 0;
+	ovpn_ipp_index_t *index = ovpn_ipp_index_open(config.ipp_lookup);
+
+	if (!index)
+	{
+		fprintf(stderr,
+			"Could not open index file '%s'\n",
+			config.ipp_lookup);
+
+		return -ENODEV;
+	}
+
+	if (config.is_stdin)
+	{
+		unsigned int line_n = 0;
+		ovpn_line_reader_t reader;
+
+		ret = ovpn_line_reader_init(&reader);
+
+		while (!ret)
+		{
+			ssize_t len = ovpn_line_read(&reader, stdin, ++line_n);
+			if (len <= 0)
+			{
+				ret = (int)len;
+				break;
+			}
+
+			while ((len > 0) && ((reader.buffer[len - 1] == '\n') ||
+			                     (reader.buffer[len - 1] == '\r')))
+				reader.buffer[--len] = '\0';
+
+			if (len)
+				ret = lookup_ipp_key(index, reader.buffer, output);
+		}
+
+		ovpn_line_reader_free(&reader);
+	}
+	else
+	{
+		for (i = 0; !ret && (i < config.input_count); i++)
+			ret = lookup_ipp_key(index, config.input_filenames[i], output);
+	}
+
+	ovpn_ipp_index_close(index);
+	return ret;
+}
+
+/**
+ * @brief Conversion to OVPN format state
+ */
+typedef struct
+{
+	/** Output stream (if configurations are written to stdout) */
+	FILE *output;
+
+	/** Blob records data keyed by digest */
+	json_object *blobs;
+
+	/** Count of written configurations */
+	unsigned long count;
+
+} to_ovpn_t;
+
+/**
+ * Write single configuration to stdout or to "<name>.ovpn"
+ * file in the output directory
+ */
+static int write_ovpn(to_ovpn_t *t, json_object *json, const char *name)
+{
+	int fd;
+	int ret;
+	FILE *stream;
+	char number[32];
+	char path[PATH_MAX];
+
+	t->count++;
+
+	if (!config.to_ovpn_dir)
+		return ovpn_write(json, t->blobs, t->output);
+
+	if (!name)
+	{
+		snprintf(number, sizeof(number), "%lu", t->count);
+		name = number;
+	}
+	else if (!*name || (name[0] == '.') || strchr(name, '/'))
+	{
+		fprintf(stderr,
+			"Invalid configuration name '%s'\n", name);
+
+		return -EINVAL;
+	}
+
+	if (snprintf(path, sizeof(path), "%s/%s.ovpn",
+			config.to_ovpn_dir, name) >= (int)sizeof(path))
+		return -ENAMETOOLONG;
+
+	/* Configurations contain private keys */
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	if (fd < 0)
+	{
+		fprintf(stderr,
+			"Could not open file '%s'\n", path);
+
+		return -ENODEV;
+	}
+
+	stream = fdopen(fd, "w");
+	if (!stream)
+	{
+		close(fd);
+		return -ENOMEM;
+	}
+
+	/* Writer has its own buffer */
+	setvbuf(stream, NULL, _IONBF, 0);
+
+	ret = ovpn_write(json, t->blobs, stream);
+
+	if (fclose(stream) && !ret)
+		ret = -EIO;
+
+	return ret;
+}
+
+/**
+ * Handle JSON value of the input for conversion to OVPN format
+ *
+ * Values can be configuration objects, objects with configurations
+ * keyed by name (e.g. --ccd output) and blob records of the
+ * --dedup-inlines option.
+ */
+static int convert_to_ovpn_value(json_object *obj, void *arg)
+{
+	int ret;
+	to_ovpn_t *t = arg;
+	json_object *digest;
+	json_object *data;
+
+	if (!json_object_is_type(obj, json_type_object))
+		goto invalid;
+
+	/* Blob record */
+	if (json_object_object_get_ex(obj, "blob", &digest) &&
+	    json_object_object_get_ex(obj, "data", &data))
+	{
+		json_object_object_add(t->blobs,
+			json_object_get_string(digest), json_object_get(data));
+
+		return 0;
+	}
+
+	/* Configuration */
+	if (json_object_object_get_ex(obj, "options", NULL) ||
+	    json_object_object_get_ex(obj, "inlines", NULL))
+	{
+		ret = write_ovpn(t, obj, NULL);
+		goto out;
+	}
+
+	/* Configurations keyed by name */
+	json_object_object_foreach(obj, name, json)
+	{
+		if (!json_object_is_type(json, json_type_object))
+			goto invalid;
+
+		ret = write_ovpn(t, json, name);
+		if (ret)
+			goto out;
+	}
+
+	return 0;
+
+invalid:
+	fprintf(stderr,
+		"Input is not a configuration object\n");
+
+	return -EINVAL;
+
+out:
+	if (ret == -EINVAL)
+	{
+		fprintf(stderr,
+			"Invalid configuration object structure\n");
+	}
+
+	return ret;
+}
+
+/**
+ * Convert configurations in JSON format back to OVPN format
+ */
+static int convert_to_ovpn(FILE *output)
+{
+	int i;
+	int ret = 0;
+	FILE *input;
+	FILE *raw_input;
+	to_ovpn_t t = {
+		.output = output,
+		.blobs  = json_object_new_object(),
+		.count  = 0,
+	};
+
+	if (!t.blobs)
+		return -ENOMEM;
+
+	for (i = 0; !ret && (config.is_stdin || (i < config.input_count)); i++)
+	{
+		raw_input = config.is_stdin
+			? stdin : fopen(config.input_filenames[i], "rb");
+
+		if (!raw_input)
+		{
+			fprintf(stderr,
+				"Could not open file '%s'\n",
+				config.input_filenames[i]);
+
+			ret = -ENODEV;
+			break;
+		}
+
+		/* Transparently decompress input */
+		input = ovpn_stream_open_input(raw_input);
+		if (input)
+		{
+			ret = ovpn_json_read(input, convert_to_ovpn_value, &t);
+			ovpn_stream_close(input, raw_input);
+		}
+		else
+			ret = -EIO;
+
+		if (raw_input != stdin)
+			fclose(raw_input);
+
+		if (config.is_stdin)
+			break;
+	}
+
+	json_object_put(t.blobs);
+	return ret;
+}
+
+/**
+ * Generate client profile from manifest record
+ *
+ * {
+ *     "name": "<client-name>",
+ *     "options": { ... },
+ *     "inlines": { ... }
+ * }
+ */
+static int generate_profile(json_object *obj, void *arg)
+{
+	int fd;
+	int ret;
+	const char *name;
+	char path[PATH_MAX];
+	json_object *json_name;
+	ovpn_generator_t *g = arg;
+
+	if (!json_object_object_get_ex(obj, "name", &json_name) ||
+	    !json_object_is_type(json_name, json_type_string))
+	{
+		fprintf(stderr,
+			"Manifest record has no client name\n");
+
+		return -EINVAL;
+	}
+
+	name = json_object_get_string(json_name);
+	if (!*name || (name[0] == '.') || strchr(name, '/'))
+	{
+		fprintf(stderr,
+			"Invalid configuration name '%s'\n", name);
+
+		return -EINVAL;
+	}
+
+	if (snprintf(path, sizeof(path), "%s/%s.ovpn",
+			config.generate_dir ? config.generate_dir : ".",
+			name) >= (int)sizeof(path))
+		return -ENAMETOOLONG;
+
+	/* Profiles contain private keys */
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	if (fd < 0)
+	{
+		fprintf(stderr,
+			"Could not open file '%s'\n", path);
+
+		return -ENODEV;
+	}
+
+	ret = ovpn_generator_write(g, obj, fd);
+
+	if (close(fd) && !ret)
+		ret = -EIO;
+
+	if (ret == -EINVAL)
+	{
+		fprintf(stderr,
+			"Invalid manifest record for client '%s'\n", name);
+	}
+
+	return ret;
+}
+
+/**
+ * Generate client profiles from template and manifest files
+ */
+static int generate_profiles(void)
+{
+	int i;
+	int ret;
+	ovpn_t *ovpn;
+	FILE *input;
+	FILE *raw_input;
+	ovpn_generator_t *g;
+
+	raw_input = fopen(config.generate, "rb");
+	if (!raw_input)
+	{
+		fprintf(stderr,
+			"Could not open file '%s'\n",
+			config.generate);
+
+		return -ENODEV;
+	}
+
+	ret = parse_input(raw_input, config.generate, NULL, 0, &ovpn);
+	fclose(raw_input);
+
+	if (!ovpn)
+		return ret;
+
+	/* Template status */
+	if (!ret && !config.include_status && !status_stream)
+		ovpn_dump_json_status(ovpn, dump_flags(), stderr);
+
+	g = ret ? NULL : ovpn_generator_new(ovpn);
+	ovpn_delete(ovpn);
+
+	if (!g)
+		return ret ? ret : -ENOMEM;
+
+	for (i = 0; !ret && (config.is_stdin || (i < config.input_count)); i++)
+	{
+		raw_input = config.is_stdin
+			? stdin : fopen(config.input_filenames[i], "rb");
+
+		if (!raw_input)
+		{
+			fprintf(stderr,
+				"Could not open file '%s'\n",
+				config.input_filenames[i]);
+
+			ret = -ENODEV;
+			break;
+		}
+
+		/* Transparently decompress input */
+		input = ovpn_stream_open_input(raw_input);
+		if (input)
+		{
+			ret = ovpn_json_read(input, generate_profile, g);
+			ovpn_stream_close(input, raw_input);
+		}
+		else
+			ret = -EIO;
+
+		if (raw_input != stdin)
+			fclose(raw_input);
+
+		if (config.is_stdin)
+			break;
+	}
+
+	ovpn_generator_delete(g);
+	return ret;
+}
+
+/**
+ * Parse configuration file for comparison
+ *
+ * Status is dumped to stderr, configurations with errors
+ * or aborted parsing are not compared.
+ */
+static int parse_diff_file(const char *path, ovpn_t **ovpn)
+{
+	int ret;
+	FILE *raw_input = fopen(path, "rb");
+
+	*ovpn = NULL;
+
+	if (!raw_input)
+	{
+		fprintf(stderr, "Could not open file '%s'\n", path);
+		return -ENODEV;
+	}
+
+	ret = parse_input(raw_input, path, NULL, 0, ovpn);
+	fclose(raw_input);
+
+	if (!*ovpn)
+		return ret;
+
+	if (!config.include_status && !status_stream)
+		ovpn_dump_json_status(*ovpn, dump_flags(), stderr);
+
+	return ret;
+}
+
+/**
+ * Compare two configuration files
+ */
+static int diff_files(FILE *output)
+{
+	int ret;
+	ovpn_t *from;
+	ovpn_t *to = NULL;
+	json_object *diff;
+
+	ret = parse_diff_file(config.input_filenames[0], &from);
+	if (!ret)
+		ret = parse_diff_file(config.input_filenames[1], &to);
+
+	if (!ret)
+		ret = ovpn_diff(from->json, to->json, &diff);
+
+	if (!ret)
+	{
+		if (config.format == OVPN_FORMAT_JSON)
+			ret = ovpn_json_write(diff, dump_flags(), output);
+		else
+			ret = ovpn_encode_object(config.format, diff, output);
+
+		json_object_put(diff);
+	}
+
+	ovpn_delete(from);
+	ovpn_delete(to);
+	return ret;
+}
+
+/**
+ * Dump parse status of configuration that is not dumped itself
+ */
+static void dump_parse_status(ovpn_t *ovpn)
+{
+	if (status_stream)
+	{
+		/* Streamed status ends with the final counts record */
+		ovpn_dump_json_status(
+			ovpn,
+			dump_flags() & ~OVPN_DUMP_FLAG_PRETTY,
+			status_stream
+		);
+
+		fflush(status_stream);
+	}
+	else
+		ovpn_dump_json_status(ovpn, dump_flags(), stderr);
+}
+
+/**
+ * Merge configuration layers given by --merge options
+ *
+ * @param[out] result  Merged layers configuration object
+ */
+static int merge_layers(json_object **result)
+{
+	int ret = 0;
+	unsigned int i;
+	ovpn_t *ovpn;
+	FILE *raw_input;
+	json_object *merged;
+	json_object *layers = NULL;
+
+	for (i = 0; !ret && (i < config.merge_count); i++)
+	{
+		raw_input = fopen(config.merge[i], "rb");
+		if (!raw_input)
+		{
+			fprintf(stderr,
+				"Could not open file '%s'\n",
+				config.merge[i]);
+
+			ret = -ENODEV;
+			break;
+		}
+
+		ret = parse_input(raw_input, config.merge[i], NULL, 0, &ovpn);
+		fclose(raw_input);
+
+		if (!ovpn)
+			break;
+
+		dump_parse_status(ovpn);
+
+		/* Layers are shared by all merged configurations,
+		 * so they must be parsed completely */
+		if (!ret)
+		{
+			if (!layers)
+				layers = json_object_get(ovpn->json);
+			else
+			{
+				ret = ovpn_merge(layers, ovpn->json, &merged);
+				json_object_put(layers);
+				layers = merged;
+			}
+		}
+
+		ovpn_delete(ovpn);
+	}
+
+	if (ret)
+	{
+		json_object_put(layers);
+		return ret;
+	}
+
+	*result = layers;
+	return 0;
+}
+
+/**
+ * Write merged configuration to file in --merge-dir directory
+ * named by input file name
+ */
+static int write_merged_file(json_object *json, const char *src_path)
+{
+	int fd;
+	int ret;
+	char *p;
+	FILE *stream;
+	char name[NAME_MAX + 1];
+	char path[PATH_MAX];
+	const char *base = strrchr(src_path, '/');
+
+	snprintf(name, sizeof(name), "%s", base ? (base + 1) : src_path);
+
+	/* Strip extension */
+	p = strrchr(name, '.');
+	if (p && (p != name))
+		*p = '\0';
+
+	if (snprintf(path, sizeof(path), "%s/%s.ovpn",
+			config.merge_dir, name) >= (int)sizeof(path))
+		return -ENAMETOOLONG;
+
+	/* Configurations contain private keys */
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	if (fd < 0)
+	{
+		fprintf(stderr,
+			"Could not open file '%s'\n", path);
+
+		return -ENODEV;
+	}
+
+	stream = fdopen(fd, "w");
+	if (!stream)
+	{
+		close(fd);
+		return -ENOMEM;
+	}
+
+	/* Writer has its own buffer */
+	setvbuf(stream, NULL, _IONBF, 0);
+
+	ret = dump_canonical(json, stream);
+
+	if (fclose(stream) && !ret)
+		ret = -EIO;
+
+	return ret;
+}
+
+/**
+ * Merge input configuration into configuration layers and write result
+ */
+static int merge_input(
+	FILE *raw_input, const char *path, json_object *layers, FILE *output)
+{
+	int ret;
+	int merge_ret;
+	ovpn_t *ovpn;
+	json_object *merged;
+
+	ret = parse_input(raw_input, path, NULL, 0, &ovpn);
+	if (!ovpn)
+		return ret;
+
+	dump_parse_status(ovpn);
+
+	/* Data parsed before aborting is merged as well */
+	if (ret && (ret != -ECANCELED))
+	{
+		ovpn_delete(ovpn);
+		return ret;
+	}
+
+	merge_ret = ovpn_merge(layers, ovpn->json, &merged);
+	ovpn_delete(ovpn);
+
+	if (!merge_ret && config.merge_dir)
+		merge_ret = write_merged_file(merged, path);
+	else if (!merge_ret)
+	{
+		if (config.fingerprint && (config.format != OVPN_FORMAT_CANONICAL))
+			merge_ret = add_fingerprint(merged);
+
+		if (!merge_ret)
+		{
+			if (config.format == OVPN_FORMAT_JSON)
+				merge_ret = ovpn_json_write(merged, dump_flags(), output);
+			else if (config.format == OVPN_FORMAT_CANONICAL)
+				merge_ret = dump_canonical(merged, output);
+			else
+				merge_ret = ovpn_encode_config(config.format, merged, output);
+		}
+	}
+
+	json_object_put(merged);
+
+	return merge_ret ? merge_ret : ret;
+}
+
+/**
+ * Merge input files into configuration layers given by --merge options
+ */
+static int merge_files(FILE *output)
+{
+	int i;
+	int ret;
+	int aborted = 0;
+	FILE *raw_input;
+	json_object *layers;
+
+	ret = merge_layers(&layers);
+	if (ret)
+		return ret;
+
+	if (config.is_stdin)
+		ret = merge_input(stdin, NULL, layers, output);
+
+	for (i = 0; !config.is_stdin && (i < config.input_count); i++)
+	{
+		raw_input = fopen(config.input_filenames[i], "rb");
+		if (!raw_input)
+		{
+			fprintf(stderr,
+				"Could not open file '%s'\n",
+				config.input_filenames[i]);
+
+			ret = -ENODEV;
+			break;
+		}
+
+		ret = merge_input(raw_input, config.input_filenames[i], layers, output);
+		fclose(raw_input);
+
+		if (ret == -ECANCELED)
+			aborted = 1;
+		else if (ret)
+			break;
+	}
+
+	if (!ret && aborted)
+		ret = -ECANCELED;
+
+	json_object_put(layers);
+	return ret;
+}
+
+/**
+ * Compile options schema file given by --schema-compile option
+ */
+static int compile_schema(void)
+{
+	int ret;
+	FILE *input = NULL;
+	const char *name = "built-in";
+
+	if (config.is_stdin)
+	{
+		input = stdin;
+		name = "stdin";
+	}
+	else if (config.input_count)
+	{
+		name = config.input_filenames[0];
+
+		input = fopen(name, "r");
+		if (!input)
+		{
+			fprintf(stderr,
+				"Could not open file '%s'\n", name);
+
+			return -ENODEV;
+		}
+	}
+
+	ret = ovpn_schema_compile(input, name, config.schema_compile);
+	if (ret)
+	{
+		fprintf(stderr,
+			"Failed to compile options schema file '%s'\n",
+			config.schema_compile);
+	}
+
+	if (input && (input != stdin))
+		fclose(input);
+
+	return ret;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Watch mode conversion handler
+ */
+static int convert_file(const char *src_path, FILE *dst_stream)
+{
+	int ret;
+	FILE *input = fopen(src_path, "rb");
+
+	if (!input)
+	{
+		fprintf(stderr,
+			"Could not open file '%s'\n",
+			src_path);
+
+		return -ENODEV;
+	}
+
+	ret = ovpn_parse_and_dump(input, src_path, dst_stream, NULL);
+	fclose(input);
+	return ret;
+}
+
+/**
+ * Program start point
+ *
+ * @param[in] argc  Number of arguments
+ * @param[in] argv  Array of the pointers to the arguments
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int main(int argc, char *argv[])
+{
+	int i;
+	int ret;
+	int aborted = 0;
+	FILE *input;
+	FILE *output;
+	FILE *blobs_stream = NULL;
+	ovpn_blobs_t *blobs = NULL;
+
+	ret = parse_cli_args(argc, argv);
+	if (ret)
+	{
+		display_usage();
+		return ret;
+	}
+
+	ret = setup_i18n();
+	if (ret)
+		return ret;
+
+	if (config.schema_filename)
+	{
+		ret = ovpn_schema_load(config.schema_filename);
+		if (ret)
+		{
+			fprintf(stderr,
+				"Could not load options schema file '%s'\n",
+				config.schema_filename);
+
+			return ret;
+		}
+	}
+
+	if (config.check_rules)
+	{
+		FILE *rules_stream = NULL;
+
+		if (config.rules_filename)
+		{
+			rules_stream = fopen(config.rules_filename, "r");
+			if (!rules_stream)
+			{
+				fprintf(stderr,
+					"Could not open file '%s'\n",
+					config.rules_filename);
+
+				return -ENODEV;
+			}
+		}
+
+		rules = ovpn_rules_new(rules_stream, config.rules_filename);
+
+		if (rules_stream)
+			fclose(rules_stream);
+
+		if (!rules)
+		{
+			fprintf(stderr,
+				"Failed to load cross-option rules\n");
+
+			return -EINVAL;
+		}
+	}
+
+	if (config.stream_status)
+	{
+		if (config.status_fd >= 0)
+		{
+			status_stream = fdopen(config.status_fd, "w");
+			if (!status_stream)
+			{
+				fprintf(stderr,
+					"Could not open file descriptor %d\n",
+					config.status_fd);
+
+				ovpn_rules_delete(rules);
+				return -EBADF;
+			}
+		}
+		else
+			status_stream = stderr;
+	}
+
+	if (config.watch_dir)
+	{
+		ovpn_watch_opts_t watch_opts = {
+			.threads     = config.jobs,
+			.debounce_ms = config.debounce_ms,
+			.convert     = convert_file,
+		};
+
+		ret = ovpn_watch(config.watch_dir, &watch_opts);
+		ovpn_include_cleanup();
+		ovpn_rules_delete(rules);
+		return ret;
+	}
+
+	output = ovpn_stream_open_output(stdout, config.compress);
+	if (!output)
+	{
+		fprintf(stderr,
+			"Failed to open output stream\n");
+
+		return -EIO;
+	}
+
+	if (config.blobs_filename)
+	{
+		if (!strcmp(config.blobs_filename, "-"))
+			blobs_stream = output;
+		else
+		{
+			blobs_stream = fopen(config.blobs_filename, "w");
+			if (!blobs_stream)
+			{
+				fprintf(stderr,
+					"Could not open file '%s'\n",
+					config.blobs_filename);
+
+				ret = -ENODEV;
+				goto out;
+			}
+		}
+
+		blobs = ovpn_blobs_new(blobs_stream, config.format,
+			dump_flags() & OVPN_DUMP_FLAG_NO_SLASH_ESCAPE);
+		if (!blobs)
+		{
+			fprintf(stderr,
+				"Failed to allocate memory for blob store\n");
+
+			ret = -ENOMEM;
+			goto out;
+		}
+	}
+
+	if (config.schema_compile)
+	{
+		ret = compile_schema();
+		goto out;
+	}
+
+	if (config.schema_dump)
+	{
+		ret = ovpn_schema_dump(output);
+		goto out;
+	}
+
+	if (config.ccd_dir)
+	{
+		ret = convert_ccd(output);
+		goto out;
+	}
+
+	if (config.status_log)
+	{
+		ret = convert_status_logs(output);
+		goto out;
+	}
+
+	if (config.ipp)
+	{
+		ret = convert_ipp(output);
+		goto out;
+	}
+
+	if (config.to_ovpn)
+	{
+		ret = convert_to_ovpn(output);
+		goto out;
+	}
+
+	if (config.generate)
+	{
+		ret = generate_profiles();
+		goto out;
+	}
+
+	if (config.diff)
+	{
+		ret = diff_files(output);
+		goto out;
+	}
+
+	if (config.merge_count)
+	{
+		ret = merge_files(output);
+		goto out;
+	}
+
+	if (config.ipp_lookup)
+	{
+		ret = lookup_ipp(output);
+		goto out;
+	}
+
+	if (config.is_stdin)
+	{
+		ret = ovpn_parse_and_dump(stdin, NULL, output, blobs);
+		goto out;
+	}
+
+	for (i = 0; i < config.input_count; i++)
+	{
+		input = fopen(config.input_filenames[i], "rb");
+		if (!input)
+		{
+			fprintf(stderr,
+				"Could not open file '%s'\n",
+				config.input_filenames[i]);
+
+			ret = -ENODEV;
+			break;
+		}
+
+		ret = ovpn_parse_and_dump(input, config.input_filenames[i], output, blobs);
+		fclose(input);
+
+		/* Aborted file is reported in its status, next files are
+		 * converted as well */
+		if (ret == -ECANCELED)
+			aborted = 1;
+		else if (ret)
+			break;
+	}
+
+	if (!ret && aborted)
+		ret = -ECANCELED;
+
+out:
+	ovpn_include_cleanup();
+	ovpn_blobs_delete(blobs);
+	ovpn_rules_delete(rules);
+
+	if (blobs_stream && (blobs_stream != output))
+		fclose(blobs_stream);
+
+	if (ovpn_stream_close(output, stdout) && !ret)
+		ret = -EIO;
+
+	if (status_stream && (status_stream != stderr))
+		fclose(status_stream);
 
 	return ret;
 }
@@ -0,0 +1,245 @@
+/*
+ * OpenVPN Configuration Files Converter
+ * Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Deduplicating inline data (blob) store
+ *
+ * Blob store is shared between all parsed configurations. Every inline
+ * payload is stored (and emitted to the blob stream) only once and is
+ * referenced from the configurations by its digest.
+ */
+
+#include <inttypes.h>
+#include <ovpn.h>
+
+/* ----------------------------------------------------------------------- */
+
+/** Initial count of hash table slots (must be power of two) */
+#define OVPN_BLOBS_INITIAL_SIZE  64u
+
+/**
+ * @brief Blob store entry
+ */
+typedef struct
+{
+	/** Payload hash (0 - empty slot) */
+	uint64_t hash;
+
+	/** Payload length */
+	size_t len;
+
+	/** Payload data */
+	char *data;
+
+} ovpn_blob_t;
+
+/**
+ * @brief Blob store
+ */
+struct ovpn_blobs
+{
+	/** Stream for emitting blob records */
+	FILE *stream;
+
+	/** Blob records format */
+	ovpn_format_t format;
+
+	/** JSON blob records dump flags (OVPN_DUMP_FLAG_*) */
+	unsigned int dump_flags;
+
+	/** Hash table (open addressing, linear probing) */
+	ovpn_blob_t *table;
+
+	/** Count of allocated slots in @ref table */
+	size_t size;
+
+	/** Count of used slots in @ref table */
+	size_t count;
+};
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * 64-bit FNV-1a hash
+ */
+static uint64_t ovpn_blobs_hash(const char *data, size_t len)
+{
+	size_t i;
+	uint64_t hash = 0xcbf29ce484222325ull;
+
+	for (i = 0; i < len; i++)
+	{
+		hash ^= (unsigned char)data[i];
+		hash *= 0x100000001b3ull;
+	}
+
+	/* Zero hash is reserved for empty slots */
+	return hash ? hash : 1;
+}
+
+static ovpn_blob_t *ovpn_blobs_slot(
+	ovpn_blob_t *table, size_t size, uint64_t hash)
+{
+	size_t i = (size_t)hash & (size - 1);
+
+	while (table[i].hash && (table[i].hash != hash))
+		i = (i + 1) & (size - 1);
+
+	return &table[i];
+}
+
+static int ovpn_blobs_grow(ovpn_blobs_t *blobs)
+{
+	size_t i;
+	size_t new_size = blobs->size * 2;
+	ovpn_blob_t *new_table = calloc(new_size, sizeof(ovpn_blob_t));
+
+	if (!new_table)
+		return -ENOMEM;
+
+	for (i = 0; i < blobs->size; i++)
+	{
+		if (blobs->table[i].hash)
+		{
+			*ovpn_blobs_slot(new_table, new_size,
+				blobs->table[i].hash) = blobs->table[i];
+		}
+	}
+
+	free(blobs->table);
+
+	blobs->table = new_table;
+	blobs->size = new_size;
+	return 0;
+}
+
+static void ovpn_blobs_emit(
+	ovpn_blobs_t *blobs, const char *digest, const char *data, size_t len)
+{
+	json_object *record;
+
+	if (blobs->format != OVPN_FORMAT_JSON)
+	{
+		ovpn_encode_blob(blobs->format, digest, data, len, blobs->stream);
+		return;
+	}
+
+	record = json_object_new_object();
+	if (!record)
+		return;
+
+	/*
+	 * Blob record:
+	 * {
+	 *     "blob": "<digest>",
+	 *     "data": "<payload>"
+	 * }
+	 */
+	json_object_object_add(record, "blob",
+		json_object_new_string(digest));
+
+	json_object_object_add(record, "data",
+		json_object_new_string_len(data, (int)len));
+
+	ovpn_json_write(record, blobs->dump_flags, blobs->stream);
+
+	json_object_put(record);
+}
+
+/* ----------------------------------------------------------------------- */
+
+ovpn_blobs_t *ovpn_blobs_new(
+	FILE *stream, ovpn_format_t format, unsigned int dump_flags)
+{
+	ovpn_blobs_t *blobs = calloc(1, sizeof(ovpn_blobs_t));
+	if (!blobs)
+		return NULL;
+
+	blobs->stream = stream;
+	blobs->format = format;
+	blobs->dump_flags = dump_flags;
+	blobs->size = OVPN_BLOBS_INITIAL_SIZE;
+	blobs->table = calloc(blobs->size, sizeof(ovpn_blob_t));
+
+	if (!blobs->table)
+	{
+		free(blobs);
+		return NULL;
+	}
+
+	return blobs;
+}
+
+void ovpn_blobs_delete(ovpn_blobs_t *blobs)
+{
+	size_t i;
+
+	if (!blobs)
+		return;
+
+	for (i = 0; i < blobs->size; i++)
+		free(blobs->table[i].data);
+
+	free(blobs->table);
+	free(blobs);
+}
+
+int ovpn_blobs_put(
+	ovpn_blobs_t *blobs,
+	const char *data,
+	size_t len,
+	char digest[OVPN_BLOB_DIGEST_SIZE]
+)
+{
+	ovpn_blob_t *blob;
+	uint64_t hash;
+
+	assert(blobs);
+	assert(data);
+
+	hash = ovpn_blobs_hash(data, len);
+	snprintf(digest, OVPN_BLOB_DIGEST_SIZE,
+		"fnv1a64:%016" PRIx64, hash);
+
+	blob = ovpn_blobs_slot(blobs->table, blobs->size, hash);
+	if (blob->hash)
+	{
+		/* Digest collision with different payload */
+		if ((blob->len != len) || memcmp(blob->data, data, len))
+			return -EEXIST;
+
+		return 0;
+	}
+
+	/* Keep load factor below 3/4 */
+	if (((blobs->count + 1) * 4) > (blobs->size * 3))
+	{
+		int ret = ovpn_blobs_grow(blobs);
+		if (ret)
+			return ret;
+
+		blob = ovpn_blobs_slot(blobs->table, blobs->size, hash);
+	}
+
+	blob->data = malloc(len + 1);
+	if (!blob->data)
+		return -ENOMEM;
+
+	memcpy(blob->data, data, len);
+	blob->data[len] = '\0';
+	blob->len = len;
+	blob->hash = hash;
+	blobs->count++;
+
+	ovpn_blobs_emit(blobs, digest, data, len);
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
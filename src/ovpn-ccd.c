@@ -0,0 +1,348 @@
+/*
+ * OpenVPN Configuration Files Converter
+ * Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Client config directory (client-config-dir) conversion
+ *
+ * Directory is listed with a few getdents64() calls into a large buffer
+ * and files are opened relative to the directory descriptor, so no path
+ * lookups are made for tens of thousands of files. Every file is read
+ * with a single read() into a buffer of the file size.
+ */
+
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include <ovpn-ccd.h>
+#include <ovpn-workers.h>
+
+/* ----------------------------------------------------------------------- */
+
+/** Directory entries buffer size */
+#define OVPN_CCD_DENTS_BUFFER_SIZE  (1024u * 1024u)
+
+/** Initial size of the clients array */
+#define OVPN_CCD_INITIAL_SIZE  256u
+
+/**
+ * @brief Directory entry returned by getdents64()
+ */
+typedef struct
+{
+	uint64_t d_ino;
+	int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+
+} ovpn_ccd_dirent_t;
+
+/**
+ * @brief Client config file
+ */
+typedef struct
+{
+	/** Common name (file name) */
+	char *name;
+
+	/** Parsed configuration */
+	ovpn_t *ovpn;
+
+	/** Parsing result */
+	int ret;
+
+} ovpn_ccd_client_t;
+
+/**
+ * @brief Client config directory conversion state
+ */
+typedef struct
+{
+	/** Settings */
+	const ovpn_ccd_opts_t *opts;
+
+	/** Directory path */
+	const char *dir;
+
+	/** Directory descriptor */
+	int dir_fd;
+
+	/** Client config files */
+	ovpn_ccd_client_t *clients;
+	size_t count;
+	size_t size;
+
+} ovpn_ccd_t;
+
+/* ----------------------------------------------------------------------- */
+
+static int ovpn_ccd_add(ovpn_ccd_t *ccd, const char *name)
+{
+	if (ccd->count == ccd->size)
+	{
+		size_t new_size = ccd->size ? (ccd->size * 2) : OVPN_CCD_INITIAL_SIZE;
+		ovpn_ccd_client_t *new_clients = realloc(ccd->clients,
+			new_size * sizeof(ovpn_ccd_client_t));
+
+		if (!new_clients)
+			return -ENOMEM;
+
+		ccd->clients = new_clients;
+		ccd->size = new_size;
+	}
+
+	ccd->clients[ccd->count].name = strdup(name);
+	if (!ccd->clients[ccd->count].name)
+		return -ENOMEM;
+
+	ccd->clients[ccd->count].ovpn = NULL;
+	ccd->clients[ccd->count].ret = 0;
+	ccd->count++;
+	return 0;
+}
+
+/**
+ * Collect all client config files of the directory
+ */
+static int ovpn_ccd_scan(ovpn_ccd_t *ccd)
+{
+	int ret = 0;
+	char *buffer = malloc(OVPN_CCD_DENTS_BUFFER_SIZE);
+
+	if (!buffer)
+		return -ENOMEM;
+
+	while (!ret)
+	{
+		long offset;
+		long len = syscall(SYS_getdents64, ccd->dir_fd,
+			buffer, OVPN_CCD_DENTS_BUFFER_SIZE);
+
+		if (len <= 0)
+		{
+			if (len < 0)
+				ret = -errno;
+
+			break;
+		}
+
+		for (offset = 0; !ret && (offset < len);)
+		{
+			ovpn_ccd_dirent_t *entry =
+				(ovpn_ccd_dirent_t *)(buffer + offset);
+
+			int is_reg = (entry->d_type == DT_REG);
+
+			offset += entry->d_reclen;
+
+			if (entry->d_name[0] == '.')
+				continue;
+
+			/* Symbolic links are followed */
+			if ((entry->d_type == DT_UNKNOWN) || (entry->d_type == DT_LNK))
+			{
+				struct stat st;
+				is_reg = !fstatat(ccd->dir_fd, entry->d_name, &st, 0) &&
+					S_ISREG(st.st_mode);
+			}
+
+			if (is_reg)
+				ret = ovpn_ccd_add(ccd, entry->d_name);
+		}
+	}
+
+	free(buffer);
+	return ret;
+}
+
+static int ovpn_ccd_compare(const void *a, const void *b)
+{
+	return strcmp(((const ovpn_ccd_client_t *)a)->name,
+		((const ovpn_ccd_client_t *)b)->name);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static int ovpn_ccd_parse(ovpn_ccd_t *ccd, ovpn_ccd_client_t *client)
+{
+	int fd;
+	int ret;
+	char *path;
+	char *buffer;
+	FILE *input;
+	struct stat st;
+
+	fd = openat(ccd->dir_fd, client->name, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		fprintf(stderr, "Could not open file '%s/%s'\n",
+			ccd->dir, client->name);
+
+		return -ENODEV;
+	}
+
+	if (fstat(fd, &st))
+	{
+		ret = -errno;
+		close(fd);
+		return ret;
+	}
+
+	input = fdopen(fd, "rb");
+	if (!input)
+	{
+		ret = -errno;
+		close(fd);
+		return ret;
+	}
+
+	/* Buffer of the file size, so the whole file is read at once */
+	buffer = malloc((size_t)st.st_size + 1);
+	if (buffer)
+		setvbuf(input, buffer, _IOFBF, (size_t)st.st_size + 1);
+
+	path = malloc(strlen(ccd->dir) + strlen(client->name) + 2);
+	if (path)
+	{
+		sprintf(path, "%s/%s", ccd->dir, client->name);
+		ret = ccd->opts->parse(path, input, &client->ovpn);
+		free(path);
+	}
+	else
+		ret = -ENOMEM;
+
+	fclose(input);
+	free(buffer);
+	return ret;
+}
+
+static void ovpn_ccd_worker(size_t idx, void *arg)
+{
+	ovpn_ccd_t *ccd = arg;
+	ccd->clients[idx].ret = ovpn_ccd_parse(ccd, &ccd->clients[idx]);
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Build result objects from parsed client configurations
+ */
+static int ovpn_ccd_collect(
+	ovpn_ccd_t *ccd,
+	json_object *clients,
+	json_object *status
+)
+{
+	size_t i;
+
+	for (i = 0; i < ccd->count; i++)
+	{
+		int ret;
+		ovpn_t *ovpn = ccd->clients[i].ovpn;
+
+		/* Only system errors abort conversion, clients that could
+		 * not be parsed (reported to stderr) are skipped */
+		if ((ccd->clients[i].ret == -ENOMEM) || (ccd->clients[i].ret == -EIO))
+			return ccd->clients[i].ret;
+
+		if (ccd->clients[i].ret || !ovpn)
+			continue;
+
+		ret = ovpn_include_status(ovpn);
+		if (ret)
+			return ret;
+
+		json_object_object_add(clients, ccd->clients[i].name,
+			json_object_get(ovpn->json));
+
+		if (!(ovpn->flags & OVPN_FLAG_INCLUDE_STATUS) &&
+		    (ovpn->errors || ovpn->warnings || ovpn->abort_reason))
+		{
+			json_object *json_status = ovpn_status_json(ovpn);
+			if (!json_status)
+				return -ENOMEM;
+
+			json_object_object_add(status, ccd->clients[i].name,
+				json_object_get(json_status));
+		}
+	}
+
+	return 0;
+}
+
+int ovpn_ccd(
+	const char *dir,
+	const ovpn_ccd_opts_t *opts,
+	json_object **clients,
+	json_object **status
+)
+{
+	int ret;
+	size_t i;
+	ovpn_ccd_t ccd = {
+		.opts = opts,
+		.dir = dir,
+	};
+
+	ccd.dir_fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (ccd.dir_fd < 0)
+	{
+		fprintf(stderr, "Could not open directory '%s'\n", dir);
+		return -ENODEV;
+	}
+
+	ret = ovpn_ccd_scan(&ccd);
+	if (ret)
+		goto out;
+
+	/* Output is ordered by common name */
+	qsort(ccd.clients, ccd.count, sizeof(ovpn_ccd_client_t), ovpn_ccd_compare);
+
+	if (ovpn_workers_run(ccd.count, opts->threads, ovpn_ccd_worker, &ccd))
+	{
+		/* Fallback to sequential conversion */
+		for (i = 0; i < ccd.count; i++)
+			ovpn_ccd_worker(i, &ccd);
+	}
+
+	*clients = json_object_new_object();
+	*status = json_object_new_object();
+
+	if (!*clients || !*status)
+		ret = -ENOMEM;
+	else
+		ret = ovpn_ccd_collect(&ccd, *clients, *status);
+
+	if (ret)
+	{
+		json_object_put(*clients);
+		json_object_put(*status);
+
+		*clients = NULL;
+		*status = NULL;
+	}
+
+out:
+	for (i = 0; i < ccd.count; i++)
+	{
+		ovpn_delete(ccd.clients[i].ovpn);
+		free(ccd.clients[i].name);
+	}
+
+	free(ccd.clients);
+	close(ccd.dir_fd);
+	return ret;
+}
+
+/* ----------------------------------------------------------------------- */
@@ -0,0 +1,70 @@
+/*
+ * OpenVPN Configuration Files Converter
+ * Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+#ifndef OVPN_CCD_H
+#define OVPN_CCD_H
+
+#include <ovpn.h>
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Client config file parsing handler
+ *
+ * Handler is called from worker threads.
+ *
+ * @param[in]  path   Client config file path (valid only during the call)
+ * @param[in]  input  Client config file stream
+ * @param[out] ovpn   Parsed client configuration
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+typedef int (*ovpn_ccd_parse_fn_t)(
+	const char *path, FILE *input, ovpn_t **ovpn);
+
+/**
+ * @brief Client config directory conversion settings
+ */
+typedef struct
+{
+	/** Count of worker threads (0 - default) */
+	unsigned int threads;
+
+	/** Parsing handler */
+	ovpn_ccd_parse_fn_t parse;
+
+} ovpn_ccd_opts_t;
+
+/**
+ * Parse all client config files in client config directory @p dir
+ *
+ * Every regular file in the directory (except hidden files) is a client
+ * config file named by client common name. Files are parsed in parallel.
+ *
+ * @param[in]  dir      Client config directory
+ * @param[in]  opts     Conversion settings
+ * @param[out] clients  Parsed configurations keyed by common name
+ * @param[out] status   Status objects keyed by common name of clients
+ *                      with errors or warnings (only if status is not
+ *                      included into parsed configurations)
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int ovpn_ccd(
+	const char *dir,
+	const ovpn_ccd_opts_t *opts,
+	json_object **clients,
+	json_object **status
+);
+
+/* ----------------------------------------------------------------------- */
+
+#endif /* OVPN_CCD_H */
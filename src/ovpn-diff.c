@@ -0,0 +1,486 @@
+/*
+ * OpenVPN Configuration Files Converter
+ * Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Structural diff of two parsed configurations
+ *
+ * Options and inline blocks of both configurations are matched by their
+ * position in the options table. Occurrences of options that can be
+ * specified several times are matched with a hash table of occurrence
+ * arguments, so the whole diff takes linear time.
+ */
+
+#include <ovpn.h>
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * @brief Added, removed and changed entries (options or inline blocks)
+ */
+typedef struct
+{
+	json_object *added;
+	json_object *removed;
+	json_object *changed;
+
+} ovpn_diff_set_t;
+
+/**
+ * @brief Occurrences hash table slot
+ */
+typedef struct
+{
+	/** Hash of occurrence arguments (0 - empty slot) */
+	uint64_t hash;
+
+	/** Arguments of the first occurrence with this hash */
+	json_object *args;
+
+	/** Count of not matched occurrences */
+	size_t count;
+
+} ovpn_diff_slot_t;
+
+/**
+ * Entries comparison handler
+ *
+ * @param[in] set   Result set
+ * @param[in] opt   Option information (NULL - option is not in the table)
+ * @param[in] name  Option (inline block) name
+ * @param[in] from  Entry of the first configuration (NULL - missing)
+ * @param[in] to    Entry of the second configuration (NULL - missing)
+ */
+typedef int (*ovpn_diff_fn_t)(
+	ovpn_diff_set_t *set,
+	const ovpn_opt_info_t *opt,
+	const char *name,
+	json_object *from,
+	json_object *to
+);
+
+/* ----------------------------------------------------------------------- */
+
+static json_object *ovpn_diff_args(json_object *occurrence)
+{
+	json_object *args;
+
+	if (!json_object_object_get_ex(occurrence, "args", &args) ||
+	    !json_object_is_type(args, json_type_array))
+		return NULL;
+
+	return args;
+}
+
+/**
+ * Find slot for the arguments (empty slot if arguments are not found)
+ */
+static ovpn_diff_slot_t *ovpn_diff_slot(
+	ovpn_diff_slot_t *table, size_t size, json_object *args, uint64_t hash)
+{
+	size_t i = (size_t)hash & (size - 1);
+
+	while (table[i].hash &&
+	       ((table[i].hash != hash) || !ovpn_args_equal(table[i].args, args)))
+		i = (i + 1) & (size - 1);
+
+	return &table[i];
+}
+
+/**
+ * Add value to the result set object (value reference is taken over,
+ * NULL value is an allocation failure)
+ */
+static int ovpn_diff_add(
+	json_object *obj, const char *name, json_object *value)
+{
+	if (!value)
+		return -ENOMEM;
+
+	json_object_object_add(obj, name, value);
+	return 0;
+}
+
+static json_object *ovpn_diff_change(json_object *from, json_object *to)
+{
+	json_object *change = json_object_new_object();
+	if (!change)
+		return NULL;
+
+	json_object_object_add(change, "from", json_object_get(from));
+	json_object_object_add(change, "to", json_object_get(to));
+	return change;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Compare occurrences of the option that can be specified several times
+ *
+ * Occurrences are compared as multisets of argument lists: occurrences
+ * of @p from are counted in a hash table, then matched by occurrences
+ * of @p to. Not matched ones are added (removed).
+ */
+static int ovpn_diff_multiple(
+	ovpn_diff_set_t *set,
+	const char *name,
+	json_object *from,
+	json_object *to
+)
+{
+	int ret = 0;
+	size_t i;
+	size_t size = 8;
+	size_t from_count = json_object_array_length(from);
+	size_t to_count = json_object_array_length(to);
+	ovpn_diff_slot_t *table;
+	json_object *added;
+	json_object *removed;
+
+	while (size < (from_count * 2))
+		size <<= 1;
+
+	table = calloc(size, sizeof(ovpn_diff_slot_t));
+	if (!table)
+		return -ENOMEM;
+
+	added = json_object_new_array();
+	removed = json_object_new_array();
+
+	if (!added || !removed)
+	{
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	for (i = 0; i < from_count; i++)
+	{
+		json_object *args = ovpn_diff_args(json_object_array_get_idx(from, i));
+		uint64_t hash = ovpn_args_hash(args);
+		ovpn_diff_slot_t *slot = ovpn_diff_slot(table, size, args, hash);
+
+		if (!slot->hash)
+		{
+			slot->hash = hash;
+			slot->args = args;
+		}
+
+		slot->count++;
+	}
+
+	for (i = 0; i < to_count; i++)
+	{
+		json_object *occurrence = json_object_array_get_idx(to, i);
+		json_object *args = ovpn_diff_args(occurrence);
+		ovpn_diff_slot_t *slot = ovpn_diff_slot(
+			table, size, args, ovpn_args_hash(args));
+
+		if (slot->count)
+			slot->count--;
+		else
+			json_object_array_add(added, json_object_get(occurrence));
+	}
+
+	/* Not matched occurrences of the first configuration
+	 * are removed, their order is kept */
+	for (i = 0; i < from_count; i++)
+	{
+		json_object *occurrence = json_object_array_get_idx(from, i);
+		json_object *args = ovpn_diff_args(occurrence);
+		ovpn_diff_slot_t *slot = ovpn_diff_slot(
+			table, size, args, ovpn_args_hash(args));
+
+		if (slot->count)
+		{
+			slot->count--;
+			json_object_array_add(removed, json_object_get(occurrence));
+		}
+	}
+
+	if (json_object_array_length(added))
+	{
+		json_object_object_add(set->added, name, added);
+		added = NULL;
+	}
+
+	if (json_object_array_length(removed))
+	{
+		json_object_object_add(set->removed, name, removed);
+		removed = NULL;
+	}
+
+out:
+	json_object_put(added);
+	json_object_put(removed);
+	free(table);
+	return ret;
+}
+
+static int ovpn_diff_option(
+	ovpn_diff_set_t *set,
+	const ovpn_opt_info_t *opt,
+	const char *name,
+	json_object *from,
+	json_object *to
+)
+{
+	size_t from_count;
+	size_t to_count;
+	json_object *from_last;
+	json_object *to_last;
+
+	if (!from)
+		return ovpn_diff_add(set->added, name, json_object_get(to));
+
+	if (!to)
+		return ovpn_diff_add(set->removed, name, json_object_get(from));
+
+	if (!json_object_is_type(from, json_type_array) ||
+	    !json_object_is_type(to, json_type_array))
+		return -EINVAL;
+
+	/* Options missing in the table are compared as multiple ones */
+	if (!opt || (opt->flags & OVPN_OPT_FLAG_MULTIPLE))
+		return ovpn_diff_multiple(set, name, from, to);
+
+	from_count = json_object_array_length(from);
+	to_count = json_object_array_length(to);
+
+	if (!from_count || !to_count)
+		return (from_count == to_count) ? 0 : -EINVAL;
+
+	/* Last occurrence of a single-valued option takes effect */
+	from_last = json_object_array_get_idx(from, from_count - 1);
+	to_last = json_object_array_get_idx(to, to_count - 1);
+
+	if (ovpn_args_equal(ovpn_diff_args(from_last), ovpn_diff_args(to_last)))
+		return 0;
+
+	return ovpn_diff_add(set->changed, name, ovpn_diff_change(from_last, to_last));
+}
+
+static int ovpn_diff_inline(
+	ovpn_diff_set_t *set,
+	const ovpn_opt_info_t *opt,
+	const char *name,
+	json_object *from,
+	json_object *to
+)
+{
+	(void)opt;
+
+	if (!from)
+		return ovpn_diff_add(set->added, name, json_object_get(to));
+
+	if (!to)
+		return ovpn_diff_add(set->removed, name, json_object_get(from));
+
+	if (json_object_equal(from, to))
+		return 0;
+
+	return ovpn_diff_add(set->changed, name, ovpn_diff_change(from, to));
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Place entries of options (inlines) object to the slots
+ * indexed by options table position
+ *
+ * @return Count of entries missing in the options table
+ */
+static size_t ovpn_diff_index(json_object *obj, json_object **slots)
+{
+	size_t unknown = 0;
+
+	json_object_object_foreach(obj, name, value)
+	{
+		ssize_t index = ovpn_opt_index(name);
+
+		if (index < 0)
+			unknown++;
+		else
+			slots[index] = value;
+	}
+
+	return unknown;
+}
+
+/**
+ * Compare entries of options (inlines) objects
+ *
+ * Entries are compared in the options table order,
+ * entries missing in the table are matched by name.
+ */
+static int ovpn_diff_entries(
+	ovpn_diff_set_t *set,
+	json_object *from,
+	json_object *to,
+	ovpn_diff_fn_t fn
+)
+{
+	int ret = 0;
+	size_t i;
+	size_t count = ovpn_opt_count();
+	size_t unknown;
+	json_object **slots;
+	json_object *value;
+
+	if (!json_object_is_type(from, json_type_object) ||
+	    !json_object_is_type(to, json_type_object))
+		return -EINVAL;
+
+	/* Slots for both configurations */
+	slots = calloc(count * 2, sizeof(json_object *));
+	if (!slots)
+		return -ENOMEM;
+
+	unknown = ovpn_diff_index(from, slots);
+	unknown += ovpn_diff_index(to, slots + count);
+
+	for (i = 0; !ret && (i < count); i++)
+	{
+		if (slots[i] || slots[count + i])
+		{
+			const ovpn_opt_info_t *opt = ovpn_opt_get(i);
+			ret = fn(set, opt, opt->name, slots[i], slots[count + i]);
+		}
+	}
+
+	free(slots);
+
+	if (ret || !unknown)
+		return ret;
+
+	json_object_object_foreach(from, from_name, from_value)
+	{
+		if (ovpn_opt_index(from_name) >= 0)
+			continue;
+
+		if (!json_object_object_get_ex(to, from_name, &value))
+			value = NULL;
+
+		ret = fn(set, NULL, from_name, from_value, value);
+		if (ret)
+			return ret;
+	}
+
+	json_object_object_foreach(to, to_name, to_value)
+	{
+		if ((ovpn_opt_index(to_name) >= 0) ||
+		    json_object_object_get_ex(from, to_name, NULL))
+			continue;
+
+		ret = fn(set, NULL, to_name, NULL, to_value);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/**
+ * Create result set object
+ *
+ * {
+ *     "added": { ... },
+ *     "removed": { ... },
+ *     "changed": { ... }
+ * }
+ */
+static json_object *ovpn_diff_set_new(ovpn_diff_set_t *set)
+{
+	json_object *obj = json_object_new_object();
+	if (!obj)
+		return NULL;
+
+	set->added = json_object_new_object();
+	set->removed = json_object_new_object();
+	set->changed = json_object_new_object();
+
+	if (!set->added || !set->removed || !set->changed)
+	{
+		json_object_put(set->added);
+		json_object_put(set->removed);
+		json_object_put(set->changed);
+		json_object_put(obj);
+		return NULL;
+	}
+
+	json_object_object_add(obj, "added", set->added);
+	json_object_object_add(obj, "removed", set->removed);
+	json_object_object_add(obj, "changed", set->changed);
+	return obj;
+}
+
+/* ----------------------------------------------------------------------- */
+
+int ovpn_diff(json_object *from, json_object *to, json_object **result)
+{
+	int ret;
+	json_object *diff;
+	json_object *obj;
+	json_object *from_obj;
+	json_object *to_obj;
+	ovpn_diff_set_t options;
+	ovpn_diff_set_t inlines;
+
+	*result = NULL;
+
+	diff = json_object_new_object();
+	if (!diff)
+		return -ENOMEM;
+
+	obj = ovpn_diff_set_new(&options);
+	if (!obj)
+	{
+		json_object_put(diff);
+		return -ENOMEM;
+	}
+
+	json_object_object_add(diff, "options", obj);
+
+	obj = ovpn_diff_set_new(&inlines);
+	if (!obj)
+	{
+		json_object_put(diff);
+		return -ENOMEM;
+	}
+
+	json_object_object_add(diff, "inlines", obj);
+
+	if (!json_object_object_get_ex(from, "options", &from_obj) ||
+	    !json_object_object_get_ex(to, "options", &to_obj))
+		ret = -EINVAL;
+	else
+		ret = ovpn_diff_entries(&options, from_obj, to_obj, ovpn_diff_option);
+
+	if (ret)
+	{
+		json_object_put(diff);
+		return ret;
+	}
+
+	if (!json_object_object_get_ex(from, "inlines", &from_obj) ||
+	    !json_object_object_get_ex(to, "inlines", &to_obj))
+		ret = -EINVAL;
+	else
+		ret = ovpn_diff_entries(&inlines, from_obj, to_obj, ovpn_diff_inline);
+
+	if (ret)
+	{
+		json_object_put(diff);
+		return ret;
+	}
+
+	*result = diff;
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
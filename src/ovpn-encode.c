@@ -0,0 +1,420 @@
+/*
+ * OpenVPN Configuration Files Converter
+ * Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Streaming binary encoders (CBOR and MessagePack)
+ *
+ * Encoders walk the parsed JSON objects tree and write encoded data
+ * directly to the output stream without building intermediate JSON text.
+ * Plain inline data is encoded as byte strings.
+ */
+
+#include <stdint.h>
+#include <ovpn.h>
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Encoded item kinds
+ */
+typedef enum
+{
+	OVPN_ENCODE_MAP,
+	OVPN_ENCODE_ARRAY,
+	OVPN_ENCODE_TEXT,
+	OVPN_ENCODE_BYTES,
+
+} ovpn_encode_kind_t;
+
+/**
+ * Position of the encoded object in the OVPN objects tree
+ */
+typedef enum
+{
+	/** Any object */
+	OVPN_ENCODE_CTX_ANY,
+
+	/** Root object */
+	OVPN_ENCODE_CTX_ROOT,
+
+	/** Object with root objects as values */
+	OVPN_ENCODE_CTX_MAP,
+
+	/** "inlines" object */
+	OVPN_ENCODE_CTX_INLINES,
+
+	/** "inlines" → "<name>" object */
+	OVPN_ENCODE_CTX_INLINE,
+
+	/** "inlines" → "<name>" → "data" array */
+	OVPN_ENCODE_CTX_INLINE_DATA,
+
+} ovpn_encode_ctx_t;
+
+/* ----------------------------------------------------------------------- */
+
+static void ovpn_encode_be(FILE *stream, uint64_t value, unsigned int bytes)
+{
+	while (bytes--)
+		fputc((int)((value >> (bytes * 8)) & 0xffu), stream);
+}
+
+/**
+ * Write CBOR data item head (RFC 8949, section 3)
+ */
+static void ovpn_encode_cbor_head(
+	FILE *stream, unsigned int major, uint64_t value)
+{
+	major <<= 5;
+
+	if (value < 24)
+		fputc((int)(major | value), stream);
+	else if (value <= UINT8_MAX)
+	{
+		fputc((int)(major | 24), stream);
+		ovpn_encode_be(stream, value, 1);
+	}
+	else if (value <= UINT16_MAX)
+	{
+		fputc((int)(major | 25), stream);
+		ovpn_encode_be(stream, value, 2);
+	}
+	else if (value <= UINT32_MAX)
+	{
+		fputc((int)(major | 26), stream);
+		ovpn_encode_be(stream, value, 4);
+	}
+	else
+	{
+		fputc((int)(major | 27), stream);
+		ovpn_encode_be(stream, value, 8);
+	}
+}
+
+/**
+ * Write MessagePack header with 8/16/32-bit length
+ */
+static void ovpn_encode_msgpack_len(
+	FILE *stream, int code8, int code16, int code32, size_t len)
+{
+	if ((code8 >= 0) && (len <= UINT8_MAX))
+	{
+		fputc(code8, stream);
+		ovpn_encode_be(stream, len, 1);
+	}
+	else if (len <= UINT16_MAX)
+	{
+		fputc(code16, stream);
+		ovpn_encode_be(stream, len, 2);
+	}
+	else
+	{
+		fputc(code32, stream);
+		ovpn_encode_be(stream, len, 4);
+	}
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void ovpn_encode_head(
+	ovpn_format_t format, FILE *stream, ovpn_encode_kind_t kind, size_t len)
+{
+	if (format == OVPN_FORMAT_CBOR)
+	{
+		static const unsigned int majors[] = {
+			[OVPN_ENCODE_MAP]   = 5,
+			[OVPN_ENCODE_ARRAY] = 4,
+			[OVPN_ENCODE_TEXT]  = 3,
+			[OVPN_ENCODE_BYTES] = 2,
+		};
+
+		ovpn_encode_cbor_head(stream, majors[kind], len);
+		return;
+	}
+
+	switch (kind)
+	{
+		case OVPN_ENCODE_MAP:
+			if (len < 16)
+				fputc((int)(0x80 | len), stream);
+			else
+				ovpn_encode_msgpack_len(stream, -1, 0xde, 0xdf, len);
+
+			break;
+
+		case OVPN_ENCODE_ARRAY:
+			if (len < 16)
+				fputc((int)(0x90 | len), stream);
+			else
+				ovpn_encode_msgpack_len(stream, -1, 0xdc, 0xdd, len);
+
+			break;
+
+		case OVPN_ENCODE_TEXT:
+			if (len < 32)
+				fputc((int)(0xa0 | len), stream);
+			else
+				ovpn_encode_msgpack_len(stream, 0xd9, 0xda, 0xdb, len);
+
+			break;
+
+		case OVPN_ENCODE_BYTES:
+			ovpn_encode_msgpack_len(stream, 0xc4, 0xc5, 0xc6, len);
+			break;
+	}
+}
+
+static void ovpn_encode_string(
+	ovpn_format_t format,
+	FILE *stream,
+	ovpn_encode_kind_t kind,
+	const char *data,
+	size_t len
+)
+{
+	ovpn_encode_head(format, stream, kind, len);
+	fwrite(data, 1, len, stream);
+}
+
+static void ovpn_encode_int(ovpn_format_t format, FILE *stream, int64_t value)
+{
+	if (format == OVPN_FORMAT_CBOR)
+	{
+		if (value >= 0)
+			ovpn_encode_cbor_head(stream, 0, (uint64_t)value);
+		else
+			ovpn_encode_cbor_head(stream, 1, (uint64_t)(-(value + 1)));
+
+		return;
+	}
+
+	if ((value >= -32) && (value <= 127))
+		fputc((int)(value & 0xff), stream);
+	else if (value >= 0)
+	{
+		/* uint 32 / uint 64 */
+		if (value <= UINT32_MAX)
+		{
+			fputc(0xce, stream);
+			ovpn_encode_be(stream, (uint64_t)value, 4);
+		}
+		else
+		{
+			fputc(0xcf, stream);
+			ovpn_encode_be(stream, (uint64_t)value, 8);
+		}
+	}
+	else
+	{
+		/* int 32 / int 64 */
+		if (value >= INT32_MIN)
+		{
+			fputc(0xd2, stream);
+			ovpn_encode_be(stream, (uint64_t)value, 4);
+		}
+		else
+		{
+			fputc(0xd3, stream);
+			ovpn_encode_be(stream, (uint64_t)value, 8);
+		}
+	}
+}
+
+static void ovpn_encode_simple(ovpn_format_t format, FILE *stream, json_object *obj)
+{
+	if (obj && json_object_get_boolean(obj))
+		fputc((format == OVPN_FORMAT_CBOR) ? 0xf5 : 0xc3, stream);
+	else if (obj)
+		fputc((format == OVPN_FORMAT_CBOR) ? 0xf4 : 0xc2, stream);
+	else
+		fputc((format == OVPN_FORMAT_CBOR) ? 0xf6 : 0xc0, stream);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void ovpn_encode_value(
+	ovpn_format_t format,
+	FILE *stream,
+	json_object *obj,
+	ovpn_encode_ctx_t ctx
+)
+{
+	switch (json_object_get_type(obj))
+	{
+		case json_type_object:
+		{
+			ovpn_encode_head(format, stream, OVPN_ENCODE_MAP,
+				(size_t)json_object_object_length(obj));
+
+			json_object_object_foreach(obj, key, val)
+			{
+				ovpn_encode_ctx_t val_ctx = OVPN_ENCODE_CTX_ANY;
+
+				if (ctx == OVPN_ENCODE_CTX_MAP)
+					val_ctx = OVPN_ENCODE_CTX_ROOT;
+				else if ((ctx == OVPN_ENCODE_CTX_ROOT) && !strcmp(key, "inlines"))
+					val_ctx = OVPN_ENCODE_CTX_INLINES;
+				else if (ctx == OVPN_ENCODE_CTX_INLINES)
+					val_ctx = OVPN_ENCODE_CTX_INLINE;
+				else if ((ctx == OVPN_ENCODE_CTX_INLINE) && !strcmp(key, "data"))
+					val_ctx = OVPN_ENCODE_CTX_INLINE_DATA;
+
+				ovpn_encode_string(format, stream,
+					OVPN_ENCODE_TEXT, key, strlen(key));
+
+				ovpn_encode_value(format, stream, val, val_ctx);
+			}
+
+			break;
+		}
+
+		case json_type_array:
+		{
+			size_t i;
+			size_t len = json_object_array_length(obj);
+
+			ovpn_encode_head(format, stream, OVPN_ENCODE_ARRAY, len);
+
+			for (i = 0; i < len; i++)
+			{
+				ovpn_encode_value(format, stream,
+					json_object_array_get_idx(obj, i),
+					(ctx == OVPN_ENCODE_CTX_INLINE_DATA)
+						? ctx : OVPN_ENCODE_CTX_ANY);
+			}
+
+			break;
+		}
+
+		case json_type_string:
+			ovpn_encode_string(format, stream,
+				(ctx == OVPN_ENCODE_CTX_INLINE_DATA)
+					? OVPN_ENCODE_BYTES : OVPN_ENCODE_TEXT,
+				json_object_get_string(obj),
+				(size_t)json_object_get_string_len(obj));
+
+			break;
+
+		case json_type_int:
+			ovpn_encode_int(format, stream, json_object_get_int64(obj));
+			break;
+
+		case json_type_boolean:
+			ovpn_encode_simple(format, stream, obj);
+			break;
+
+		case json_type_double:
+		{
+			/* Not used in OVPN objects tree, encode as text */
+			const char *str = json_object_to_json_string(obj);
+			ovpn_encode_string(format, stream,
+				OVPN_ENCODE_TEXT, str, strlen(str));
+
+			break;
+		}
+
+		case json_type_null:
+		default:
+			ovpn_encode_simple(format, stream, NULL);
+			break;
+	}
+}
+
+/* ----------------------------------------------------------------------- */
+
+int ovpn_format_by_name(const char *name, ovpn_format_t *format)
+{
+	if (!strcmp(name, "json"))
+		*format = OVPN_FORMAT_JSON;
+	else if (!strcmp(name, "cbor"))
+		*format = OVPN_FORMAT_CBOR;
+	else if (!strcmp(name, "msgpack"))
+		*format = OVPN_FORMAT_MSGPACK;
+	else if (!strcmp(name, "uci"))
+		*format = OVPN_FORMAT_UCI;
+	else if (!strcmp(name, "uci-batch"))
+		*format = OVPN_FORMAT_UCI_BATCH;
+	else if (!strcmp(name, "canonical"))
+		*format = OVPN_FORMAT_CANONICAL;
+	else
+		return -EINVAL;
+
+	return 0;
+}
+
+int ovpn_dump_binary(ovpn_t *ovpn, ovpn_format_t format, FILE *stream)
+{
+	int ret;
+
+	if (!ovpn || !ovpn->json || !OVPN_FORMAT_IS_BINARY(format))
+		return -1;
+
+	ret = ovpn_include_status(ovpn);
+	if (ret)
+		return ret;
+
+	ovpn_encode_value(format, stream, ovpn->json, OVPN_ENCODE_CTX_ROOT);
+	return ferror(stream) ? -EIO : 0;
+}
+
+int ovpn_encode_config(
+	ovpn_format_t format, json_object *json, FILE *stream)
+{
+	if (!json || !OVPN_FORMAT_IS_BINARY(format))
+		return -1;
+
+	ovpn_encode_value(format, stream, json, OVPN_ENCODE_CTX_ROOT);
+	return ferror(stream) ? -EIO : 0;
+}
+
+int ovpn_dump_binary_map(
+	json_object *map, ovpn_format_t format, FILE *stream)
+{
+	if (!map || !OVPN_FORMAT_IS_BINARY(format))
+		return -1;
+
+	ovpn_encode_value(format, stream, map, OVPN_ENCODE_CTX_MAP);
+	return ferror(stream) ? -EIO : 0;
+}
+
+int ovpn_encode_object(
+	ovpn_format_t format, json_object *obj, FILE *stream)
+{
+	if (!OVPN_FORMAT_IS_BINARY(format))
+		return -1;
+
+	ovpn_encode_value(format, stream, obj, OVPN_ENCODE_CTX_ANY);
+	return ferror(stream) ? -EIO : 0;
+}
+
+int ovpn_encode_blob(
+	ovpn_format_t format,
+	const char *digest,
+	const char *data,
+	size_t len,
+	FILE *stream
+)
+{
+	if (!OVPN_FORMAT_IS_BINARY(format))
+		return -1;
+
+	ovpn_encode_head(format, stream, OVPN_ENCODE_MAP, 2);
+
+	ovpn_encode_string(format, stream, OVPN_ENCODE_TEXT, "blob", 4);
+	ovpn_encode_string(format, stream, OVPN_ENCODE_TEXT,
+		digest, strlen(digest));
+
+	ovpn_encode_string(format, stream, OVPN_ENCODE_TEXT, "data", 4);
+	ovpn_encode_string(format, stream, OVPN_ENCODE_BYTES, data, len);
+
+	return ferror(stream) ? -EIO : 0;
+}
+
+/* ----------------------------------------------------------------------- */
@@ -0,0 +1,583 @@
+/*
+ * OpenVPN Configuration Files Converter
+ * Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Client profiles generator
+ *
+ * Template configuration is rendered once into a single text where each
+ * option and inline block has its own segment. Every client profile is
+ * a list of parts: template segments (written as is), client segments
+ * rendered into a per-profile memory stream and inline files data. Parts
+ * are written with scatter-gather writev() calls, adjacent unchanged
+ * template segments are merged into a single part.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h> /* IOV_MAX */
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include <ovpn-generate.h>
+
+/* ----------------------------------------------------------------------- */
+
+/** Initial size of the parts array */
+#define OVPN_GENERATE_INITIAL_PARTS  64u
+
+/**
+ * @brief Template segment (all occurrences of an option or inline block)
+ */
+typedef struct
+{
+	/** Option or inline block name */
+	const char *name;
+
+	/** Segment offset in the template text */
+	size_t offset;
+
+	/** Segment length */
+	size_t len;
+
+} ovpn_generate_segment_t;
+
+/**
+ * @brief Profile part sources
+ */
+typedef enum
+{
+	/** Template text */
+	OVPN_GENERATE_PART_TEMPLATE,
+
+	/** Client segments memory stream */
+	OVPN_GENERATE_PART_CLIENT,
+
+	/** Inline file data (owned by the part) */
+	OVPN_GENERATE_PART_DATA,
+
+} ovpn_generate_part_source_t;
+
+/**
+ * @brief Profile part
+ */
+typedef struct
+{
+	/** Part source */
+	ovpn_generate_part_source_t source;
+
+	/** Part data (offset for the client segments) */
+	char *data;
+	size_t offset;
+
+	/** Part length */
+	size_t len;
+
+} ovpn_generate_part_t;
+
+struct ovpn_generator
+{
+	/** Template configuration (reference) */
+	json_object *json;
+	json_object *json_options;
+	json_object *json_inlines;
+
+	/** Rendered template text */
+	char *text;
+	size_t text_size;
+
+	/** Template segments (options followed by inline blocks) */
+	ovpn_generate_segment_t *segments;
+	size_t options_count;
+	size_t count;
+
+	/** Profile parts (reused for every profile) */
+	ovpn_generate_part_t *parts;
+	size_t parts_count;
+	size_t parts_size;
+
+	/** I/O vectors (reused for every profile) */
+	struct iovec *iov;
+	size_t iov_size;
+};
+
+/* ----------------------------------------------------------------------- */
+
+static int ovpn_generate_add_part(
+	ovpn_generator_t *g,
+	ovpn_generate_part_source_t source,
+	char *data,
+	size_t offset,
+	size_t len
+)
+{
+	ovpn_generate_part_t *last = g->parts_count
+		? &g->parts[g->parts_count - 1] : NULL;
+
+	if (!len)
+	{
+		if (source == OVPN_GENERATE_PART_DATA)
+			free(data);
+
+		return 0;
+	}
+
+	/* Merge adjacent parts */
+	if (last && (source != OVPN_GENERATE_PART_DATA) &&
+	    (last->source == source) &&
+	    (last->data == data) &&
+	    ((last->offset + last->len) == offset))
+	{
+		last->len += len;
+		return 0;
+	}
+
+	if (g->parts_count == g->parts_size)
+	{
+		size_t new_size = g->parts_size
+			? (g->parts_size * 2) : OVPN_GENERATE_INITIAL_PARTS;
+
+		ovpn_generate_part_t *new_parts = realloc(g->parts,
+			new_size * sizeof(ovpn_generate_part_t));
+
+		if (!new_parts)
+		{
+			if (source == OVPN_GENERATE_PART_DATA)
+				free(data);
+
+			return -ENOMEM;
+		}
+
+		g->parts = new_parts;
+		g->parts_size = new_size;
+	}
+
+	g->parts[g->parts_count].source = source;
+	g->parts[g->parts_count].data = data;
+	g->parts[g->parts_count].offset = offset;
+	g->parts[g->parts_count].len = len;
+	g->parts_count++;
+	return 0;
+}
+
+static void ovpn_generate_free_parts(ovpn_generator_t *g)
+{
+	size_t i;
+
+	for (i = 0; i < g->parts_count; i++)
+	{
+		if (g->parts[i].source == OVPN_GENERATE_PART_DATA)
+			free(g->parts[i].data);
+	}
+
+	g->parts_count = 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static int ovpn_generate_add_segment(
+	ovpn_generator_t *g, const char *name, size_t offset, size_t len)
+{
+	ovpn_generate_segment_t *new_segments = realloc(g->segments,
+		(g->count + 1) * sizeof(ovpn_generate_segment_t));
+
+	if (!new_segments)
+		return -ENOMEM;
+
+	g->segments = new_segments;
+	g->segments[g->count].name = name;
+	g->segments[g->count].offset = offset;
+	g->segments[g->count].len = len;
+	g->count++;
+	return 0;
+}
+
+/**
+ * Render template into segments
+ */
+static int ovpn_generate_render(ovpn_generator_t *g)
+{
+	int ret = 0;
+	long offset = 0;
+	FILE *stream = open_memstream(&g->text, &g->text_size);
+
+	if (!stream)
+		return -ENOMEM;
+
+	if (g->json_options)
+	{
+		json_object_object_foreach(g->json_options, name, occurrences)
+		{
+			ret = ovpn_write_option(name, occurrences, stream);
+			if (!ret)
+				ret = ovpn_generate_add_segment(g, name,
+					(size_t)offset, (size_t)(ftell(stream) - offset));
+
+			if (ret)
+				break;
+
+			offset = ftell(stream);
+		}
+	}
+
+	g->options_count = g->count;
+
+	if (!ret && g->json_inlines)
+	{
+		json_object_object_foreach(g->json_inlines, name, json_inline)
+		{
+			ret = ovpn_write_inline(name, json_inline, NULL, stream);
+			if (!ret)
+				ret = ovpn_generate_add_segment(g, name,
+					(size_t)offset, (size_t)(ftell(stream) - offset));
+
+			if (ret)
+				break;
+
+			offset = ftell(stream);
+		}
+	}
+
+	if (fclose(stream) && !ret)
+		ret = -ENOMEM;
+
+	return ret;
+}
+
+ovpn_generator_t *ovpn_generator_new(ovpn_t *ovpn)
+{
+	ovpn_generator_t *g;
+
+	if (!ovpn || !ovpn->json)
+		return NULL;
+
+	g = calloc(1, sizeof(ovpn_generator_t));
+	if (!g)
+		return NULL;
+
+	g->json = json_object_get(ovpn->json);
+	json_object_object_get_ex(g->json, "options", &g->json_options);
+	json_object_object_get_ex(g->json, "inlines", &g->json_inlines);
+
+	if (ovpn_generate_render(g))
+	{
+		ovpn_generator_delete(g);
+		return NULL;
+	}
+
+	return g;
+}
+
+void ovpn_generator_delete(ovpn_generator_t *g)
+{
+	if (!g)
+		return;
+
+	ovpn_generate_free_parts(g);
+
+	free(g->iov);
+	free(g->parts);
+	free(g->segments);
+	free(g->text);
+	json_object_put(g->json);
+	free(g);
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Read whole file into allocated buffer
+ */
+static int ovpn_generate_read_file(const char *path, char **data, size_t *len)
+{
+	int fd;
+	int ret = 0;
+	struct stat st;
+	char *buffer;
+	size_t size = 0;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		fprintf(stderr, "Could not open file '%s'\n", path);
+		return -ENODEV;
+	}
+
+	if (fstat(fd, &st))
+	{
+		ret = -errno;
+		close(fd);
+		return ret;
+	}
+
+	buffer = malloc((size_t)st.st_size + 1);
+	if (!buffer)
+	{
+		close(fd);
+		return -ENOMEM;
+	}
+
+	while (size < (size_t)st.st_size)
+	{
+		ssize_t n = read(fd, buffer + size, (size_t)st.st_size - size);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			ret = -errno;
+			break;
+		}
+
+		if (!n)
+			break;
+
+		size += (size_t)n;
+	}
+
+	close(fd);
+
+	if (ret)
+	{
+		free(buffer);
+		return ret;
+	}
+
+	*data = buffer;
+	*len = size;
+	return 0;
+}
+
+/**
+ * Add client inline block with data from file
+ */
+static int ovpn_generate_inline_file(
+	ovpn_generator_t *g, FILE *stream, const char *name, const char *path)
+{
+	int ret;
+	char *data = NULL;
+	size_t len = 0;
+	long offset = ftell(stream);
+
+	ret = ovpn_generate_read_file(path, &data, &len);
+	if (ret)
+		return ret;
+
+	fprintf(stream, "<%s>\n", name);
+	ret = ovpn_generate_add_part(g, OVPN_GENERATE_PART_CLIENT,
+		NULL, (size_t)offset, (size_t)(ftell(stream) - offset));
+
+	if (ret)
+	{
+		free(data);
+		return ret;
+	}
+
+	ret = ovpn_generate_add_part(g, OVPN_GENERATE_PART_DATA, data, 0, len);
+	if (ret)
+		return ret;
+
+	offset = ftell(stream);
+
+	if (len && (data[len - 1] != '\n'))
+		fputc('\n', stream);
+
+	fprintf(stream, "</%s>\n", name);
+	return ovpn_generate_add_part(g, OVPN_GENERATE_PART_CLIENT,
+		NULL, (size_t)offset, (size_t)(ftell(stream) - offset));
+}
+
+/**
+ * Add client option or inline block
+ */
+static int ovpn_generate_client_segment(
+	ovpn_generator_t *g,
+	FILE *stream,
+	const char *name,
+	json_object *value,
+	int is_inline
+)
+{
+	int ret;
+	long offset;
+
+	/* Removed */
+	if (!value)
+		return 0;
+
+	if (is_inline && json_object_is_type(value, json_type_string))
+		return ovpn_generate_inline_file(g, stream, name,
+			json_object_get_string(value));
+
+	offset = ftell(stream);
+
+	ret = is_inline
+		? ovpn_write_inline(name, value, NULL, stream)
+		: ovpn_write_option(name, value, stream);
+
+	if (ret)
+		return ret;
+
+	return ovpn_generate_add_part(g, OVPN_GENERATE_PART_CLIENT,
+		NULL, (size_t)offset, (size_t)(ftell(stream) - offset));
+}
+
+/**
+ * Add template segments overridden by client segments and
+ * client segments missing in template
+ */
+static int ovpn_generate_segments(
+	ovpn_generator_t *g,
+	FILE *stream,
+	size_t first,
+	size_t last,
+	json_object *json_template,
+	json_object *json_client,
+	int is_inline
+)
+{
+	int ret = 0;
+	size_t i;
+
+	for (i = first; !ret && (i < last); i++)
+	{
+		json_object *value;
+		ovpn_generate_segment_t *segment = &g->segments[i];
+
+		if (json_client &&
+		    json_object_object_get_ex(json_client, segment->name, &value))
+			ret = ovpn_generate_client_segment(g, stream,
+				segment->name, value, is_inline);
+		else
+			ret = ovpn_generate_add_part(g, OVPN_GENERATE_PART_TEMPLATE,
+				g->text, segment->offset, segment->len);
+	}
+
+	if (ret || !json_client)
+		return ret;
+
+	json_object_object_foreach(json_client, name, value)
+	{
+		if (json_template && json_object_object_get_ex(json_template, name, NULL))
+			continue;
+
+		ret = ovpn_generate_client_segment(g, stream, name, value, is_inline);
+		if (ret)
+			break;
+	}
+
+	return ret;
+}
+
+/**
+ * Write all I/O vectors, continuing after partial writes
+ */
+static int ovpn_generate_writev(int fd, struct iovec *iov, size_t count)
+{
+	while (count)
+	{
+		ssize_t written = writev(fd, iov,
+			(int)((count > IOV_MAX) ? IOV_MAX : count));
+
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			return -errno;
+		}
+
+		while (count && ((size_t)written >= iov->iov_len))
+		{
+			written -= (ssize_t)iov->iov_len;
+			iov++;
+			count--;
+		}
+
+		if (count)
+		{
+			iov->iov_base = (char *)iov->iov_base + written;
+			iov->iov_len -= (size_t)written;
+		}
+	}
+
+	return 0;
+}
+
+int ovpn_generator_write(ovpn_generator_t *g, json_object *client, int fd)
+{
+	int ret;
+	size_t i;
+	char *text = NULL;
+	size_t text_size = 0;
+	json_object *client_options = NULL;
+	json_object *client_inlines = NULL;
+	FILE *stream = open_memstream(&text, &text_size);
+
+	if (!stream)
+		return -ENOMEM;
+
+	json_object_object_get_ex(client, "options", &client_options);
+	json_object_object_get_ex(client, "inlines", &client_inlines);
+
+	if ((client_options && !json_object_is_type(client_options, json_type_object)) ||
+	    (client_inlines && !json_object_is_type(client_inlines, json_type_object)))
+	{
+		fclose(stream);
+		free(text);
+		return -EINVAL;
+	}
+
+	ret = ovpn_generate_segments(g, stream, 0, g->options_count,
+		g->json_options, client_options, 0);
+
+	/* Inline blocks are written after all options */
+	if (!ret)
+		ret = ovpn_generate_segments(g, stream, g->options_count, g->count,
+			g->json_inlines, client_inlines, 1);
+
+	if (fclose(stream) && !ret)
+		ret = -ENOMEM;
+
+	if (!ret && (g->iov_size < g->parts_count))
+	{
+		struct iovec *new_iov = realloc(g->iov,
+			g->parts_size * sizeof(struct iovec));
+
+		if (new_iov)
+		{
+			g->iov = new_iov;
+			g->iov_size = g->parts_size;
+		}
+		else
+			ret = -ENOMEM;
+	}
+
+	if (!ret)
+	{
+		/* Client segments stream buffer is final only after closing */
+		for (i = 0; i < g->parts_count; i++)
+		{
+			ovpn_generate_part_t *part = &g->parts[i];
+
+			g->iov[i].iov_base = ((part->source == OVPN_GENERATE_PART_CLIENT)
+				? text : part->data) + part->offset;
+
+			g->iov[i].iov_len = part->len;
+		}
+
+		ret = ovpn_generate_writev(fd, g->iov, g->parts_count);
+	}
+
+	ovpn_generate_free_parts(g);
+	free(text);
+	return ret;
+}
+
+/* ----------------------------------------------------------------------- */
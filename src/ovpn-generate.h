@@ -0,0 +1,63 @@
+/*
+ * OpenVPN Configuration Files Converter
+ * Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+#ifndef OVPN_GENERATE_H
+#define OVPN_GENERATE_H
+
+#include <ovpn.h>
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * @brief Client profiles generator
+ */
+typedef struct ovpn_generator ovpn_generator_t;
+
+/**
+ * Create client profiles generator from parsed template configuration
+ *
+ * Template is rendered once into text segments (one segment for all
+ * occurrences of each option and inline block). Generator keeps
+ * references to the template objects, so @p ovpn can be deleted.
+ *
+ * @return Generator or NULL on error
+ */
+ovpn_generator_t *ovpn_generator_new(ovpn_t *ovpn);
+
+void ovpn_generator_delete(ovpn_generator_t *g);
+
+/**
+ * Write client profile to file descriptor
+ *
+ * Client object has the following format:
+ * {
+ *     "options": {
+ *         "<option-name>": [ { "args": [ ... ] }, ... ] | null,
+ *         ...
+ *     },
+ *     "inlines": {
+ *         "<inline-name>": "<file-path>" | { "type": ..., "data": [ ... ] } | null,
+ *         ...
+ *     }
+ * }
+ *
+ * Options and inline blocks of the client object replace all
+ * occurrences of the same template options and inline blocks
+ * (null removes them), other ones are appended. Unchanged template
+ * segments are written as is with a single writev() call together
+ * with the client segments and inline files data.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int ovpn_generator_write(ovpn_generator_t *g, json_object *client, int fd);
+
+/* ----------------------------------------------------------------------- */
+
+#endif /* OVPN_GENERATE_H */
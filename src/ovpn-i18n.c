@@ -0,0 +1,252 @@
+/*
+ * OpenVPN Configuration Files Converter
+ * Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Lazy translations loading
+ *
+ * Translations are loaded only when the first translated message is
+ * requested, so conversion of files without any status messages does
+ * not pay for locale and message catalog loading.
+ *
+ * With ENABLE_EMBEDDED_CATALOG build option message catalogs are
+ * compiled into the binary and messages are looked up in the sorted
+ * original strings table of the compiled-in catalog without any
+ * filesystem access.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h> /* PATH_MAX */
+#include <pthread.h>
+
+#ifndef OVPN_CONVERT_EMBEDDED_CATALOG
+#include <libintl.h>
+#include <locale.h>
+#endif
+
+#include <ovpn-i18n.h>
+
+/* ----------------------------------------------------------------------- */
+
+/** Base path for locale files */
+static char ovpn_i18n_locale_dir[PATH_MAX];
+
+/** Translations loading control */
+static pthread_once_t ovpn_i18n_once = PTHREAD_ONCE_INIT;
+
+#ifdef OVPN_CONVERT_EMBEDDED_CATALOG
+
+/** Magic number of the mo file */
+#define OVPN_I18N_MO_MAGIC          0x950412deu
+#define OVPN_I18N_MO_MAGIC_SWAPPED  0xde120495u
+
+/**
+ * @brief Active compiled-in catalog
+ */
+static struct
+{
+	/** Catalog (NULL - no translations) */
+	const ovpn_i18n_catalog_t *catalog;
+
+	/** Catalog byte order differs from the host byte order */
+	int swapped;
+
+	/** Count of strings */
+	uint32_t count;
+
+	/** Offset of the original strings table */
+	uint32_t orig_offset;
+
+	/** Offset of the translated strings table */
+	uint32_t trans_offset;
+
+} ovpn_i18n_mo;
+
+static uint32_t ovpn_i18n_mo_u32(size_t offset)
+{
+	uint32_t value;
+
+	memcpy(&value, ovpn_i18n_mo.catalog->data + offset, sizeof(value));
+	return ovpn_i18n_mo.swapped ? __builtin_bswap32(value) : value;
+}
+
+/**
+ * Find compiled-in catalog for language
+ *
+ * @param[in] language  Language in "ll[_CC][.codeset][@modifier]" form
+ */
+static const ovpn_i18n_catalog_t *ovpn_i18n_find_catalog(const char *language)
+{
+	int i;
+	size_t len = strcspn(language, ".@:");
+	size_t lang_len = strcspn(language, "_.@:");
+
+	/* Try "ll_CC" first, then "ll" */
+	for (i = 0; ovpn_i18n_catalogs[i].language; i++)
+	{
+		if ((strlen(ovpn_i18n_catalogs[i].language) == len) &&
+		    !strncmp(ovpn_i18n_catalogs[i].language, language, len))
+			return &ovpn_i18n_catalogs[i];
+	}
+
+	for (i = 0; ovpn_i18n_catalogs[i].language; i++)
+	{
+		if ((strlen(ovpn_i18n_catalogs[i].language) == lang_len) &&
+		    !strncmp(ovpn_i18n_catalogs[i].language, language, lang_len))
+			return &ovpn_i18n_catalogs[i];
+	}
+
+	return NULL;
+}
+
+static void ovpn_i18n_load(void)
+{
+	int i;
+	uint32_t magic;
+	const char *value;
+	const ovpn_i18n_catalog_t *catalog = NULL;
+
+	static const char *envs[] = {
+		"LC_ALL", "LC_MESSAGES", "LANG", NULL
+	};
+
+	/* LANGUAGE is a colon separated list of fallback languages */
+	value = getenv("LANGUAGE");
+	while (value && *value && !catalog)
+	{
+		catalog = ovpn_i18n_find_catalog(value);
+
+		value = strchr(value, ':');
+		if (value)
+			value++;
+	}
+
+	/* Otherwise the first non-empty locale variable is used */
+	for (i = 0; envs[i] && !catalog; i++)
+	{
+		value = getenv(envs[i]);
+		if (value && *value)
+		{
+			catalog = ovpn_i18n_find_catalog(value);
+			break;
+		}
+	}
+
+	if (!catalog || (catalog->size < 28))
+		return;
+
+	memcpy(&magic, catalog->data, sizeof(magic));
+
+	if (magic == OVPN_I18N_MO_MAGIC_SWAPPED)
+		ovpn_i18n_mo.swapped = 1;
+	else if (magic != OVPN_I18N_MO_MAGIC)
+		return;
+
+	ovpn_i18n_mo.catalog = catalog;
+	ovpn_i18n_mo.count = ovpn_i18n_mo_u32(8);
+	ovpn_i18n_mo.orig_offset = ovpn_i18n_mo_u32(12);
+	ovpn_i18n_mo.trans_offset = ovpn_i18n_mo_u32(16);
+
+	/* Both tables must be inside the catalog data */
+	if ((((uint64_t)ovpn_i18n_mo.orig_offset + ovpn_i18n_mo.count * 8ull) > catalog->size) ||
+	    (((uint64_t)ovpn_i18n_mo.trans_offset + ovpn_i18n_mo.count * 8ull) > catalog->size))
+		ovpn_i18n_mo.catalog = NULL;
+}
+
+static const char *ovpn_i18n_lookup(const char *msgid)
+{
+	uint32_t lo = 0;
+	uint32_t hi = ovpn_i18n_mo.count;
+	size_t size;
+
+	if (!ovpn_i18n_mo.catalog)
+		return msgid;
+
+	size = ovpn_i18n_mo.catalog->size;
+
+	/* Original strings in mo file are sorted */
+	while (lo < hi)
+	{
+		int cmp;
+		uint32_t mid = lo + (hi - lo) / 2;
+		uint32_t len = ovpn_i18n_mo_u32(ovpn_i18n_mo.orig_offset + mid * 8u);
+		uint32_t off = ovpn_i18n_mo_u32(ovpn_i18n_mo.orig_offset + mid * 8u + 4u);
+
+		if (((uint64_t)off + len) >= size)
+			return msgid;
+
+		cmp = strcmp(msgid, (const char *)ovpn_i18n_mo.catalog->data + off);
+		if (!cmp)
+		{
+			len = ovpn_i18n_mo_u32(ovpn_i18n_mo.trans_offset + mid * 8u);
+			off = ovpn_i18n_mo_u32(ovpn_i18n_mo.trans_offset + mid * 8u + 4u);
+
+			if (!len || (((uint64_t)off + len) >= size))
+				return msgid;
+
+			return (const char *)ovpn_i18n_mo.catalog->data + off;
+		}
+
+		if (cmp < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return msgid;
+}
+
+#else /* OVPN_CONVERT_EMBEDDED_CATALOG */
+
+static void ovpn_i18n_load(void)
+{
+	bindtextdomain(GETTEXT_PACKAGE, ovpn_i18n_locale_dir);
+	textdomain(GETTEXT_PACKAGE);
+}
+
+static const char *ovpn_i18n_lookup(const char *msgid)
+{
+	return gettext(msgid);
+}
+
+#endif /* OVPN_CONVERT_EMBEDDED_CATALOG */
+
+/* ----------------------------------------------------------------------- */
+
+void ovpn_i18n_setup(const char *locale_dir, const char *language)
+{
+	if (locale_dir)
+	{
+		strncpy(ovpn_i18n_locale_dir, locale_dir, PATH_MAX);
+		ovpn_i18n_locale_dir[PATH_MAX - 1] = '\0';
+	}
+
+	if (language && language[0])
+	{
+		setenv("LANGUAGE", language, 1);
+		setenv("LANG", language, 1);
+	}
+
+#ifndef OVPN_CONVERT_EMBEDDED_CATALOG
+	/* Setting the i18n environment. setlocale() is not thread-safe,
+	 * so it is called here, before any threads are started */
+	setlocale(LC_ALL, "");
+#endif
+}
+
+const char *ovpn_gettext(const char *msgid)
+{
+	pthread_once(&ovpn_i18n_once, ovpn_i18n_load);
+	return ovpn_i18n_lookup(msgid);
+}
+
+/* ----------------------------------------------------------------------- */
@@ -0,0 +1,64 @@
+/*
+ * OpenVPN Configuration Files Converter
+ * Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+#ifndef OVPN_I18N_H
+#define OVPN_I18N_H
+
+#include <stddef.h>
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * @brief Compiled-in message catalog
+ */
+typedef struct
+{
+	/** Language code (e.g. "ru") */
+	const char *language;
+
+	/** Catalog data in GNU gettext mo format */
+	const unsigned char *data;
+
+	/** Catalog data size */
+	size_t size;
+
+} ovpn_i18n_catalog_t;
+
+/**
+ * Compiled-in message catalogs (terminated by an entry with
+ * NULL language). Available only if the project is built with
+ * ENABLE_EMBEDDED_CATALOG option.
+ */
+extern const ovpn_i18n_catalog_t ovpn_i18n_catalogs[];
+
+/**
+ * Set up translations
+ *
+ * Locale is set here, so this function must be called before any
+ * threads are started. Loading of translations is deferred until
+ * the first translated message is requested by @ref ovpn_gettext().
+ *
+ * @param[in] locale_dir  Base path for locale (mo) files
+ *                        (not used with compiled-in catalogs)
+ * @param[in] language    Language (NULL or empty string - from environment)
+ */
+void ovpn_i18n_setup(const char *locale_dir, const char *language);
+
+/**
+ * Get translated message
+ *
+ * @param[in] msgid  Original message
+ *
+ * @return Translated message or @p msgid if there is no translation
+ */
+const char *ovpn_gettext(const char *msgid);
+
+/* ----------------------------------------------------------------------- */
+
+#endif /* OVPN_I18N_H */
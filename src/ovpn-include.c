@@ -0,0 +1,981 @@
+/*
+ * OpenVPN Configuration Files Converter
+ * Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Included configuration files ('config' option)
+ *
+ * Included files are parsed into separate OVPN objects (fragments)
+ * that are kept in the process-wide include cache. Fragment data is
+ * merged into the including configuration by copying, so a fragment
+ * included by many configurations is read and parsed only once.
+ *
+ * Fragment is parsed with the remaining budgets of the including
+ * configuration. Only completely parsed fragments (not aborted, with
+ * all messages stored and without include cycles, as the result of a
+ * cycle depends on the chain of including files) are cached, and a
+ * cached fragment is used only if it fits into the remaining budgets
+ * and none of its files is in the chain of including files, otherwise
+ * the file is parsed again.
+ *
+ * Cache entry records all files included by the fragment (directly
+ * or through nested includes, including missing ones), so the entry
+ * is dropped when any of them is changed. Count of entries is limited,
+ * least recently used entries are evicted.
+ */
+
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include <ovpn.h>
+#include <ovpn-stream.h>
+
+/* ----------------------------------------------------------------------- */
+
+/** Initial count of include cache hash table buckets (power of two) */
+#define OVPN_INCLUDE_CACHE_INITIAL_SIZE  16u
+
+/** Maximum count of include cache entries */
+#define OVPN_INCLUDE_CACHE_MAX_ENTRIES  256u
+
+/** Flags inherited by included files */
+#define OVPN_INCLUDE_FLAGS \
+	(OVPN_FLAG_FOLLOW_INCLUDES | OVPN_FLAG_CCD)
+
+/**
+ * @brief Included file attributes
+ */
+typedef struct
+{
+	/** Resolved file path */
+	char *path;
+
+	/** File device */
+	dev_t dev;
+
+	/** File inode (0 - file is missing) */
+	ino_t ino;
+
+	/** File modification time */
+	struct timespec mtime;
+
+	/** File size */
+	off_t size;
+
+} ovpn_include_file_t;
+
+/**
+ * @brief Include cache entry
+ */
+typedef struct ovpn_include_entry
+{
+	/** Next entry in the hash table chain */
+	struct ovpn_include_entry *chain;
+
+	/** Previous (more recently used) entry in the LRU list */
+	struct ovpn_include_entry *lru_prev;
+
+	/** Next (less recently used) entry in the LRU list */
+	struct ovpn_include_entry *lru_next;
+
+	/** Path hash */
+	uint64_t hash;
+
+	/** Included file */
+	ovpn_include_file_t file;
+
+	/** Files included by the fragment (directly or through nested includes) */
+	ovpn_include_file_t *deps;
+
+	/** Count of files in @ref deps */
+	size_t deps_count;
+
+	/** Entry is in the cache (otherwise it is owned by the includer) */
+	int cached;
+
+	/** Include cycle is detected while the file is parsed */
+	int cycle;
+
+	/** Entry of the including file while the file is parsed */
+	struct ovpn_include_entry *parsing_parent;
+
+	/** Parsed file */
+	ovpn_t *ovpn;
+
+} ovpn_include_entry_t;
+
+/**
+ * @brief Include cache
+ */
+static struct
+{
+	/** Hash table buckets */
+	ovpn_include_entry_t **buckets;
+
+	/** Count of buckets (power of two) */
+	size_t size;
+
+	/** Count of entries */
+	size_t count;
+
+	/** Most recently used entry */
+	ovpn_include_entry_t *lru_first;
+
+	/** Least recently used entry */
+	ovpn_include_entry_t *lru_last;
+
+	/** Entry of the file being parsed (NULL - main configuration) */
+	ovpn_include_entry_t *parsing;
+
+} ovpn_include_cache;
+
+/**
+ * Include cache lock. Lock is recursive as nested includes are
+ * parsed while the lock is held.
+ */
+static pthread_mutex_t ovpn_include_lock =
+	PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * 64-bit FNV-1a hash of the path
+ */
+static uint64_t ovpn_include_hash(const char *path)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+
+	while (*path)
+	{
+		hash ^= (unsigned char)*path++;
+		hash *= 0x100000001b3ull;
+	}
+
+	return hash;
+}
+
+static int ovpn_include_cache_grow(void)
+{
+	size_t i;
+	size_t new_size = ovpn_include_cache.size
+		? (ovpn_include_cache.size * 2)
+		: OVPN_INCLUDE_CACHE_INITIAL_SIZE;
+
+	ovpn_include_entry_t **new_buckets =
+		calloc(new_size, sizeof(ovpn_include_entry_t *));
+
+	if (!new_buckets)
+		return -ENOMEM;
+
+	for (i = 0; i < ovpn_include_cache.size; i++)
+	{
+		ovpn_include_entry_t *entry = ovpn_include_cache.buckets[i];
+
+		while (entry)
+		{
+			ovpn_include_entry_t *next = entry->chain;
+			size_t bucket = (size_t)entry->hash & (new_size - 1);
+
+			entry->chain = new_buckets[bucket];
+			new_buckets[bucket] = entry;
+			entry = next;
+		}
+	}
+
+	free(ovpn_include_cache.buckets);
+
+	ovpn_include_cache.buckets = new_buckets;
+	ovpn_include_cache.size = new_size;
+	return 0;
+}
+
+static void ovpn_include_entry_delete(ovpn_include_entry_t *entry)
+{
+	size_t i;
+
+	for (i = 0; i < entry->deps_count; i++)
+		free(entry->deps[i].path);
+
+	free(entry->deps);
+	ovpn_delete(entry->ovpn);
+	free(entry->file.path);
+	free(entry);
+}
+
+/**
+ * Find cache entry by path
+ *
+ * @return Pointer to the entry link in the hash table chain
+ *         (link points to NULL if entry is not found)
+ */
+static ovpn_include_entry_t **ovpn_include_cache_find(
+	const char *path, uint64_t hash)
+{
+	ovpn_include_entry_t **link;
+
+	if (!ovpn_include_cache.size)
+		return NULL;
+
+	link = &ovpn_include_cache.buckets[(size_t)hash & (ovpn_include_cache.size - 1)];
+
+	while (*link)
+	{
+		if (((*link)->hash == hash) && !strcmp((*link)->file.path, path))
+			break;
+
+		link = &(*link)->chain;
+	}
+
+	return link;
+}
+
+static void ovpn_include_lru_unlink(ovpn_include_entry_t *entry)
+{
+	if (entry->lru_prev)
+		entry->lru_prev->lru_next = entry->lru_next;
+	else
+		ovpn_include_cache.lru_first = entry->lru_next;
+
+	if (entry->lru_next)
+		entry->lru_next->lru_prev = entry->lru_prev;
+	else
+		ovpn_include_cache.lru_last = entry->lru_prev;
+
+	entry->lru_prev = NULL;
+	entry->lru_next = NULL;
+}
+
+static void ovpn_include_lru_push(ovpn_include_entry_t *entry)
+{
+	entry->lru_prev = NULL;
+	entry->lru_next = ovpn_include_cache.lru_first;
+
+	if (ovpn_include_cache.lru_first)
+		ovpn_include_cache.lru_first->lru_prev = entry;
+	else
+		ovpn_include_cache.lru_last = entry;
+
+	ovpn_include_cache.lru_first = entry;
+}
+
+/**
+ * Remove entry from the cache and delete it
+ */
+static void ovpn_include_cache_remove(ovpn_include_entry_t *entry)
+{
+	ovpn_include_entry_t **link =
+		ovpn_include_cache_find(entry->file.path, entry->hash);
+
+	if (link && (*link == entry))
+		*link = entry->chain;
+
+	ovpn_include_lru_unlink(entry);
+	ovpn_include_cache.count--;
+	ovpn_include_entry_delete(entry);
+}
+
+/**
+ * Add entry to the cache (replacing entry with the same path)
+ * and evict least recently used entries above the limit
+ */
+static int ovpn_include_cache_add(ovpn_include_entry_t *entry)
+{
+	size_t bucket;
+	ovpn_include_entry_t **link =
+		ovpn_include_cache_find(entry->file.path, entry->hash);
+
+	if (link && *link)
+		ovpn_include_cache_remove(*link);
+
+	/* Keep average chain length below 1 */
+	if (ovpn_include_cache.count >= ovpn_include_cache.size)
+	{
+		int ret = ovpn_include_cache_grow();
+		if (ret)
+			return ret;
+	}
+
+	bucket = (size_t)entry->hash & (ovpn_include_cache.size - 1);
+
+	entry->chain = ovpn_include_cache.buckets[bucket];
+	ovpn_include_cache.buckets[bucket] = entry;
+	ovpn_include_cache.count++;
+	entry->cached = 1;
+
+	ovpn_include_lru_push(entry);
+
+	while (ovpn_include_cache.count > OVPN_INCLUDE_CACHE_MAX_ENTRIES)
+		ovpn_include_cache_remove(ovpn_include_cache.lru_last);
+
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void ovpn_include_file_set(
+	ovpn_include_file_t *file, const struct stat *st)
+{
+	file->dev = st->st_dev;
+	file->ino = st->st_ino;
+	file->size = st->st_size;
+	file->mtime = st->st_mtim;
+}
+
+/**
+ * Check that file is not changed (or is still missing)
+ */
+static int ovpn_include_file_valid(
+	const ovpn_include_file_t *file, const struct stat *st)
+{
+	if (!st)
+		return !file->ino;
+
+	return (file->dev == st->st_dev) &&
+	       (file->ino == st->st_ino) &&
+	       (file->size == st->st_size) &&
+	       (file->mtime.tv_sec == st->st_mtim.tv_sec) &&
+	       (file->mtime.tv_nsec == st->st_mtim.tv_nsec);
+}
+
+/**
+ * Check that all files included by the fragment are not changed
+ */
+static int ovpn_include_deps_valid(const ovpn_include_entry_t *entry)
+{
+	size_t i;
+
+	for (i = 0; i < entry->deps_count; i++)
+	{
+		struct stat st;
+		int missing = stat(entry->deps[i].path, &st);
+
+		if (!ovpn_include_file_valid(&entry->deps[i], missing ? NULL : &st))
+			return 0;
+	}
+
+	return 1;
+}
+
+/**
+ * Record file included by the fragment of the entry
+ *
+ * @param[in] entry  Entry of the including fragment
+ * @param[in] file   Included file (ino is 0 for missing file)
+ */
+static int ovpn_include_dep_add(
+	ovpn_include_entry_t *entry, const ovpn_include_file_t *file)
+{
+	size_t i;
+	ovpn_include_file_t *deps;
+
+	for (i = 0; i < entry->deps_count; i++)
+	{
+		if (!strcmp(entry->deps[i].path, file->path))
+			return 0;
+	}
+
+	deps = realloc(entry->deps,
+		(entry->deps_count + 1) * sizeof(ovpn_include_file_t));
+
+	if (!deps)
+		return -ENOMEM;
+
+	entry->deps = deps;
+	deps[entry->deps_count] = *file;
+
+	deps[entry->deps_count].path = strdup(file->path);
+	if (!deps[entry->deps_count].path)
+		return -ENOMEM;
+
+	entry->deps_count++;
+	return 0;
+}
+
+/**
+ * Record included file and its own included files as dependencies
+ * of the file being parsed (if any)
+ *
+ * @param[in] ovpn      Including configuration
+ * @param[in] file      Included file
+ * @param[in] included  Entry of the included file (NULL - file is missing)
+ */
+static int ovpn_include_deps_record(
+	const ovpn_t *ovpn,
+	const ovpn_include_file_t *file,
+	const ovpn_include_entry_t *included
+)
+{
+	size_t i;
+	int ret;
+	ovpn_include_entry_t *parsing = ovpn_include_cache.parsing;
+
+	if (!parsing || (parsing->ovpn != ovpn))
+		return 0;
+
+	ret = ovpn_include_dep_add(parsing, file);
+
+	for (i = 0; !ret && included && (i < included->deps_count); i++)
+		ret = ovpn_include_dep_add(parsing, &included->deps[i]);
+
+	return ret;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Check that file is the including configuration or one
+ * of the files in the chain of including files
+ */
+static int ovpn_include_in_chain(const ovpn_t *ovpn, dev_t dev, ino_t ino)
+{
+	const ovpn_t *includer;
+
+	for (includer = ovpn; includer; includer = includer->parent)
+	{
+		if (includer->ino &&
+		    (includer->dev == dev) &&
+		    (includer->ino == ino))
+			return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Check that any of the files included by the fragment
+ * is in the chain of including files
+ */
+static int ovpn_include_deps_in_chain(
+	const ovpn_t *ovpn, const ovpn_include_entry_t *entry)
+{
+	size_t i;
+
+	for (i = 0; i < entry->deps_count; i++)
+	{
+		if (entry->deps[i].ino &&
+		    ovpn_include_in_chain(ovpn, entry->deps[i].dev, entry->deps[i].ino))
+			return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Get remaining budgets of the including configuration
+ *
+ * Zero value means that the budget is not limited, so
+ * an exhausted budget aborts the including configuration.
+ *
+ * @return 0 on success
+ * @return -ECANCELED if a budget is exhausted (abort reason is set)
+ */
+static int ovpn_include_budgets(
+	ovpn_t *ovpn,
+	unsigned int line,
+	ovpn_limits_t *limits,
+	unsigned int *max_messages
+)
+{
+	const char *reason = NULL;
+	const ovpn_limits_t *parent = &ovpn->limits;
+
+	memset(limits, 0, sizeof(ovpn_limits_t));
+
+	if (parent->max_errors)
+	{
+		if (ovpn->errors >= parent->max_errors)
+			reason = "errors";
+
+		limits->max_errors = parent->max_errors - ovpn->errors;
+	}
+
+	if (parent->max_warnings)
+	{
+		if (ovpn->warnings >= parent->max_warnings)
+			reason = "warnings";
+
+		limits->max_warnings = parent->max_warnings - ovpn->warnings;
+	}
+
+	if (parent->max_lines)
+	{
+		if (ovpn->lines >= parent->max_lines)
+			reason = "lines";
+
+		limits->max_lines = parent->max_lines - ovpn->lines;
+	}
+
+	if (parent->max_bytes)
+	{
+		if (ovpn->bytes >= parent->max_bytes)
+			reason = "bytes";
+
+		limits->max_bytes = parent->max_bytes - ovpn->bytes;
+	}
+
+	if (reason)
+	{
+		ovpn->abort_reason = reason;
+		ovpn->abort_line = line;
+		return -ECANCELED;
+	}
+
+	/* Messages above the limit are only counted. If all messages
+	 * are already stored, one is stored to keep the limit */
+	*max_messages = 0;
+
+	if (ovpn->max_messages)
+	{
+		unsigned int stored = ovpn_status_stored(ovpn);
+
+		*max_messages = (stored < ovpn->max_messages)
+			? (ovpn->max_messages - stored) : 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Check that cached fragment is parsed the same way
+ * as it would be parsed with specified budgets
+ */
+static int ovpn_include_fits(
+	const ovpn_t *fragment,
+	const ovpn_limits_t *limits,
+	unsigned int max_messages
+)
+{
+	return (!limits->max_errors || (fragment->errors < limits->max_errors)) &&
+	       (!limits->max_warnings || (fragment->warnings < limits->max_warnings)) &&
+	       (!limits->max_lines || (fragment->lines <= limits->max_lines)) &&
+	       (!limits->max_bytes || (fragment->bytes <= limits->max_bytes)) &&
+	       (!max_messages || (ovpn_status_stored(fragment) <= max_messages));
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Resolve included file path against the directory of the including file
+ *
+ * @return Resolved path (must be freed) or NULL on memory allocation failure
+ */
+static char *ovpn_include_resolve(const ovpn_t *ovpn, const char *path)
+{
+	char *resolved;
+	const char *slash;
+	size_t dir_len;
+
+	if ((path[0] == '/') || !ovpn->path)
+		return strdup(path);
+
+	slash = strrchr(ovpn->path, '/');
+	if (!slash)
+		return strdup(path);
+
+	dir_len = (size_t)(slash - ovpn->path) + 1;
+
+	resolved = malloc(dir_len + strlen(path) + 1);
+	if (!resolved)
+		return NULL;
+
+	memcpy(resolved, ovpn->path, dir_len);
+	strcpy(resolved + dir_len, path);
+	return resolved;
+}
+
+/**
+ * Parse included file into a new fragment
+ *
+ * @param[in]  ovpn          Including configuration
+ * @param[in]  raw_input     Included file stream
+ * @param[in]  limits        Fragment budgets
+ * @param[in]  max_messages  Maximum count of stored fragment messages
+ * @param[out] entry         Cache entry (path and file attributes are set)
+ *
+ * @return 0 if file is completely parsed
+ * @return -1 or -ECANCELED if parsing is stopped by an error in
+ *         configuration or exhausted budget (fragment is still set)
+ * @return <0 on other errors
+ */
+static int ovpn_include_parse(
+	ovpn_t *ovpn,
+	FILE *raw_input,
+	const ovpn_limits_t *limits,
+	unsigned int max_messages,
+	ovpn_include_entry_t *entry
+)
+{
+	int ret;
+	FILE *input;
+	ovpn_t *fragment;
+	ovpn_include_entry_t *parsing;
+
+	fragment = ovpn_new(ovpn->flags & OVPN_INCLUDE_FLAGS);
+	if (!fragment)
+		return -ENOMEM;
+
+	input = ovpn_stream_open_input(raw_input);
+	if (!input)
+	{
+		ovpn_delete(fragment);
+		return -EIO;
+	}
+
+	fragment->limits = *limits;
+	fragment->max_messages = max_messages;
+	fragment->blobs = ovpn->blobs;
+	fragment->version = ovpn->version;
+	fragment->path = entry->file.path;
+	fragment->dev = entry->file.dev;
+	fragment->ino = entry->file.ino;
+	fragment->parent = ovpn;
+
+	entry->ovpn = fragment;
+
+	/* Nested includes are recorded as dependencies of the entry */
+	parsing = ovpn_include_cache.parsing;
+	entry->parsing_parent = parsing;
+	ovpn_include_cache.parsing = entry;
+
+	ret = ovpn_parse(fragment, input);
+
+	ovpn_include_cache.parsing = parsing;
+	entry->parsing_parent = NULL;
+
+	fragment->parent = NULL;
+	ovpn_stream_close(input, raw_input);
+
+	if (ret && (ret != -1) && (ret != -ECANCELED))
+	{
+		ovpn_delete(fragment);
+		entry->ovpn = NULL;
+	}
+
+	return ret;
+}
+
+/**
+ * Get parsed included file from the cache or parse it
+ *
+ * @param[out] ret  0 on success, -1 or -ECANCELED if parsing of the
+ *                  file is stopped (entry is still returned), other
+ *                  negative value on error
+ *
+ * @return Entry (owned by the includer if it is not cached) or NULL if
+ *         file could not be opened (@p ret is 0) or on error
+ */
+static ovpn_include_entry_t *ovpn_include_get(
+	ovpn_t *ovpn,
+	const char *path,
+	unsigned int line,
+	int *ret
+)
+{
+	char *resolved;
+	uint64_t hash;
+	FILE *input;
+	struct stat st;
+	ovpn_limits_t limits;
+	unsigned int max_messages;
+	ovpn_include_entry_t **link;
+	ovpn_include_entry_t *entry;
+
+	*ret = 0;
+
+	resolved = ovpn_include_resolve(ovpn, path);
+	if (!resolved)
+	{
+		*ret = -ENOMEM;
+		return NULL;
+	}
+
+	/* Cached files are not opened at all */
+	if (stat(resolved, &st))
+		goto out_open_error;
+
+	if (ovpn_include_in_chain(ovpn, st.st_dev, st.st_ino))
+	{
+		ovpn_include_entry_t *parsing;
+
+		/* Files being parsed depend on the chain of including
+		 * files now, so they are not cached */
+		for (parsing = ovpn_include_cache.parsing; parsing;
+		     parsing = parsing->parsing_parent)
+			parsing->cycle = 1;
+
+		*ret = ovpn_status_msg(
+			ovpn, OVPN_MSG_TYPE_ERROR, line,
+			N_("Include cycle detected for file '%s'"), path);
+
+		free(resolved);
+		return NULL;
+	}
+
+	*ret = ovpn_include_budgets(ovpn, line, &limits, &max_messages);
+	if (*ret)
+	{
+		free(resolved);
+		return NULL;
+	}
+
+	hash = ovpn_include_hash(resolved);
+	link = ovpn_include_cache_find(resolved, hash);
+
+	if (link && *link)
+	{
+		entry = *link;
+
+		if (!ovpn_include_file_valid(&entry->file, &st) ||
+		    !ovpn_include_deps_valid(entry) ||
+		    (entry->ovpn->flags != (ovpn->flags & OVPN_INCLUDE_FLAGS)) ||
+		    (entry->ovpn->version != ovpn->version))
+		{
+			/* File (or file included by it) is changed or parsed
+			 * with other flags, remove stale entry */
+			ovpn_include_cache_remove(entry);
+		}
+		else if (ovpn_include_fits(entry->ovpn, &limits, max_messages) &&
+		         !ovpn_include_deps_in_chain(ovpn, entry))
+		{
+			ovpn_include_lru_unlink(entry);
+			ovpn_include_lru_push(entry);
+
+			free(resolved);
+			return entry;
+		}
+	}
+
+	input = fopen(resolved, "rb");
+	if (!input)
+		goto out_open_error;
+
+	entry = calloc(1, sizeof(ovpn_include_entry_t));
+	if (!entry)
+	{
+		fclose(input);
+		free(resolved);
+		*ret = -ENOMEM;
+		return NULL;
+	}
+
+	entry->hash = hash;
+	entry->file.path = resolved;
+	ovpn_include_file_set(&entry->file, &st);
+
+	*ret = ovpn_include_parse(ovpn, input, &limits, max_messages, entry);
+	fclose(input);
+
+	/* Only completely parsed fragments are cached */
+	if (!*ret && !entry->cycle && (!max_messages ||
+	    (ovpn_status_stored(entry->ovpn) < max_messages)))
+	{
+		*ret = ovpn_include_cache_add(entry);
+	}
+
+	if (*ret && (*ret != -1) && (*ret != -ECANCELED))
+	{
+		ovpn_include_entry_delete(entry);
+		return NULL;
+	}
+
+	return entry;
+
+out_open_error:
+	{
+		ovpn_include_file_t missing = { .path = resolved };
+
+		*ret = ovpn_status_msg(
+			ovpn, OVPN_MSG_TYPE_ERROR, line,
+			N_("Could not open included file '%s'"), path);
+
+		if (!*ret)
+			*ret = ovpn_include_deps_record(ovpn, &missing, NULL);
+	}
+
+	free(resolved);
+	return NULL;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Append copies of array items
+ */
+static int ovpn_include_append(json_object *dst, json_object *src)
+{
+	size_t i;
+	size_t len = json_object_array_length(src);
+
+	for (i = 0; i < len; i++)
+	{
+		json_object *copy = NULL;
+
+		if (json_object_deep_copy(
+				json_object_array_get_idx(src, i), &copy, NULL))
+			return -ENOMEM;
+
+		json_object_array_add(dst, copy);
+	}
+
+	return 0;
+}
+
+/**
+ * Merge fragment data into the including configuration
+ *
+ * Data is copied as JSON objects reference counters are not atomic
+ * and fragments are shared between threads in watch mode.
+ */
+static int ovpn_include_merge(
+	ovpn_t *fragment,
+	json_object *json_options,
+	json_object *json_inlines
+)
+{
+	int ret;
+
+	json_object_object_foreach(fragment->json_options, name, src_array)
+	{
+		json_object *opt_array;
+
+		if (!json_object_object_get_ex(json_options, name, &opt_array))
+		{
+			opt_array = json_object_new_array();
+			if (!opt_array)
+				return -ENOMEM;
+
+			json_object_object_add(json_options, name, opt_array);
+		}
+
+		ret = ovpn_include_append(opt_array, src_array);
+		if (ret)
+			return ret;
+	}
+
+	json_object_object_foreach(fragment->json_inlines, inline_name, src_obj)
+	{
+		json_object *inline_obj;
+		json_object *data_array;
+		json_object *src_data;
+
+		if (!json_object_object_get_ex(src_obj, "data", &src_data))
+			continue;
+
+		if (!json_object_object_get_ex(json_inlines, inline_name, &inline_obj))
+		{
+			json_object *type;
+
+			inline_obj = json_object_new_object();
+			if (!inline_obj)
+				return -ENOMEM;
+
+			json_object_object_add(json_inlines, inline_name, inline_obj);
+
+			if (json_object_object_get_ex(src_obj, "type", &type))
+			{
+				json_object_object_add(inline_obj, "type",
+					json_object_new_string(json_object_get_string(type)));
+			}
+
+			json_object_object_add(inline_obj, "data",
+				json_object_new_array());
+		}
+
+		if (!json_object_object_get_ex(inline_obj, "data", &data_array))
+			continue;
+
+		ret = ovpn_include_append(data_array, src_data);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+int ovpn_include(
+	ovpn_t *ovpn,
+	json_object *json_options,
+	json_object *json_inlines,
+	const char *path,
+	unsigned int line
+)
+{
+	int ret;
+	int merge_ret;
+	ovpn_t *fragment;
+	ovpn_include_entry_t *entry;
+
+	pthread_mutex_lock(&ovpn_include_lock);
+
+	entry = ovpn_include_get(ovpn, path, line, &ret);
+	if (entry)
+	{
+		fragment = entry->ovpn;
+
+		merge_ret = ovpn_include_merge(fragment, json_options, json_inlines);
+		if (!merge_ret)
+			merge_ret = ovpn_status_merge(ovpn, fragment);
+
+		if (!merge_ret)
+			merge_ret = ovpn_include_deps_record(ovpn, &entry->file, entry);
+
+		/* Usage of the included file is charged to the includer */
+		ovpn->lines += fragment->lines;
+		ovpn->bytes += fragment->bytes;
+
+		if (ret == -ECANCELED)
+		{
+			ovpn->abort_reason = fragment->abort_reason;
+			ovpn->abort_line = line;
+		}
+
+		if (merge_ret)
+			ret = merge_ret;
+
+		if (!entry->cached)
+			ovpn_include_entry_delete(entry);
+	}
+
+	pthread_mutex_unlock(&ovpn_include_lock);
+	return ret;
+}
+
+void ovpn_include_cleanup(void)
+{
+	size_t i;
+
+	pthread_mutex_lock(&ovpn_include_lock);
+
+	for (i = 0; i < ovpn_include_cache.size; i++)
+	{
+		ovpn_include_entry_t *entry = ovpn_include_cache.buckets[i];
+
+		while (entry)
+		{
+			ovpn_include_entry_t *next = entry->chain;
+			ovpn_include_entry_delete(entry);
+			entry = next;
+		}
+	}
+
+	free(ovpn_include_cache.buckets);
+
+	ovpn_include_cache.buckets = NULL;
+	ovpn_include_cache.size = 0;
+	ovpn_include_cache.count = 0;
+	ovpn_include_cache.lru_first = NULL;
+	ovpn_include_cache.lru_last = NULL;
+
+	pthread_mutex_unlock(&ovpn_include_lock);
+}
+
+/* ----------------------------------------------------------------------- */
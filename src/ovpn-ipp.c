@@ -0,0 +1,711 @@
+/*
+ * OpenVPN Configuration Files Converter
+ * Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief ifconfig-pool-persist files and their binary index
+ *
+ * Binary index layout (all integers are little-endian 32-bit):
+ *
+ *     header:   "OVPNIPP1", count, entries offset, IPv4 index offset,
+ *               IPv6 index offset, strings offset, strings size
+ *     entries:  count entries sorted by common name, 32 bytes each:
+ *               CN offset, CN length, flags, IPv4 address (network
+ *               byte order), IPv6 address (16 bytes)
+ *     IPv4 index: entry numbers of entries with IPv4 address
+ *               sorted by address (count of items is the first item)
+ *     IPv6 index: same for IPv6 addresses
+ *     strings:  common names
+ *
+ * Index is used directly from the mapped file, lookups are binary
+ * searches without parsing or allocations.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>
+
+#include <ovpn-ipp.h>
+
+/* ----------------------------------------------------------------------- */
+
+/** Index file magic */
+#define OVPN_IPP_INDEX_MAGIC  "OVPNIPP1"
+
+/** Index header size */
+#define OVPN_IPP_INDEX_HEADER_SIZE  32u
+
+/** Index entry size */
+#define OVPN_IPP_INDEX_ENTRY_SIZE  32u
+
+/** Entry flags */
+#define OVPN_IPP_FLAG_IPV4  0x01u
+#define OVPN_IPP_FLAG_IPV6  0x02u
+
+/** Initial size of the entries array */
+#define OVPN_IPP_INITIAL_SIZE  1024u
+
+/**
+ * @brief Parsed entry
+ */
+typedef struct
+{
+	/** Common name */
+	char *cn;
+
+	/** Entry flags (OVPN_IPP_FLAG_*) */
+	unsigned int flags;
+
+	/** IPv4 address (network byte order) */
+	uint8_t ipv4[4];
+
+	/** IPv6 address */
+	uint8_t ipv6[16];
+
+	/** Entry sequence number (later entries override earlier ones) */
+	size_t seq;
+
+} ovpn_ipp_item_t;
+
+struct ovpn_ipp
+{
+	/** Entries */
+	ovpn_ipp_item_t *items;
+	size_t count;
+	size_t size;
+
+	/** Entries are sorted and deduplicated */
+	int sorted;
+};
+
+struct ovpn_ipp_index
+{
+	/** Mapped file */
+	const uint8_t *data;
+
+	/** Mapped file size */
+	size_t size;
+
+	/** Count of entries */
+	uint32_t count;
+
+	/** Entries */
+	const uint8_t *entries;
+
+	/** IPv4 index */
+	const uint8_t *ipv4_index;
+	uint32_t ipv4_count;
+
+	/** IPv6 index */
+	const uint8_t *ipv6_index;
+	uint32_t ipv6_count;
+
+	/** Strings */
+	const char *strings;
+	uint32_t strings_size;
+};
+
+/* ----------------------------------------------------------------------- */
+
+static uint32_t ovpn_ipp_get_u32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+		((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void ovpn_ipp_put_u32(uint8_t *p, uint32_t value)
+{
+	p[0] = (uint8_t)value;
+	p[1] = (uint8_t)(value >> 8);
+	p[2] = (uint8_t)(value >> 16);
+	p[3] = (uint8_t)(value >> 24);
+}
+
+/* ----------------------------------------------------------------------- */
+
+ovpn_ipp_t *ovpn_ipp_new(void)
+{
+	return calloc(1, sizeof(ovpn_ipp_t));
+}
+
+void ovpn_ipp_delete(ovpn_ipp_t *ipp)
+{
+	size_t i;
+
+	if (!ipp)
+		return;
+
+	for (i = 0; i < ipp->count; i++)
+		free(ipp->items[i].cn);
+
+	free(ipp->items);
+	free(ipp);
+}
+
+static int ovpn_ipp_add(ovpn_ipp_t *ipp, const ovpn_ipp_item_t *item)
+{
+	if (ipp->count == ipp->size)
+	{
+		size_t new_size = ipp->size ? (ipp->size * 2) : OVPN_IPP_INITIAL_SIZE;
+		ovpn_ipp_item_t *new_items = realloc(ipp->items,
+			new_size * sizeof(ovpn_ipp_item_t));
+
+		if (!new_items)
+			return -ENOMEM;
+
+		ipp->items = new_items;
+		ipp->size = new_size;
+	}
+
+	ipp->items[ipp->count] = *item;
+	ipp->items[ipp->count].seq = ipp->count;
+
+	ipp->items[ipp->count].cn = strdup(item->cn);
+	if (!ipp->items[ipp->count].cn)
+		return -ENOMEM;
+
+	ipp->count++;
+	ipp->sorted = 0;
+	return 0;
+}
+
+int ovpn_ipp_parse(ovpn_ipp_t *ipp, FILE *input)
+{
+	int ret = 0;
+	unsigned int line_n = 0;
+	ovpn_line_reader_t reader;
+
+	ret = ovpn_line_reader_init(&reader);
+	if (ret)
+		return ret;
+
+	while (!ret)
+	{
+		char *line;
+		char *ipv4;
+		char *ipv6;
+		ovpn_ipp_item_t item = { 0 };
+		ssize_t line_len = ovpn_line_read(&reader, input, ++line_n);
+
+		if (line_len <= 0) /* EOF or error */
+		{
+			ret = (int)line_len;
+			break;
+		}
+
+		line = reader.buffer;
+
+		/* Trim line ending */
+		while ((line_len > 0) &&
+		       ((line[line_len - 1] == '\n') || (line[line_len - 1] == '\r')))
+			line[--line_len] = '\0';
+
+		if (!line_len)
+			continue;
+
+		ipv4 = strchr(line, ',');
+		if (!ipv4 || (ipv4 == line))
+			goto invalid;
+
+		*ipv4++ = '\0';
+
+		ipv6 = strchr(ipv4, ',');
+		if (ipv6)
+			*ipv6++ = '\0';
+
+		if (*ipv4)
+		{
+			if (inet_pton(AF_INET, ipv4, item.ipv4) != 1)
+				goto invalid;
+
+			item.flags |= OVPN_IPP_FLAG_IPV4;
+		}
+
+		if (ipv6 && *ipv6)
+		{
+			if (inet_pton(AF_INET6, ipv6, item.ipv6) != 1)
+				goto invalid;
+
+			item.flags |= OVPN_IPP_FLAG_IPV6;
+		}
+
+		item.cn = line;
+		ret = ovpn_ipp_add(ipp, &item);
+		continue;
+
+invalid:
+		fprintf(stderr,
+			"line %u: Invalid ifconfig-pool-persist entry\n", line_n);
+	}
+
+	ovpn_line_reader_free(&reader);
+	return ret;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static int ovpn_ipp_compare_cn(const void *a, const void *b)
+{
+	const ovpn_ipp_item_t *ia = a;
+	const ovpn_ipp_item_t *ib = b;
+	int cmp = strcmp(ia->cn, ib->cn);
+
+	if (cmp)
+		return cmp;
+
+	return (ia->seq < ib->seq) ? -1 : (ia->seq > ib->seq);
+}
+
+/**
+ * Sort entries by common name and keep only the last
+ * occurrence of every common name
+ */
+static void ovpn_ipp_sort(ovpn_ipp_t *ipp)
+{
+	size_t i;
+	size_t count = 0;
+
+	if (ipp->sorted)
+		return;
+
+	qsort(ipp->items, ipp->count, sizeof(ovpn_ipp_item_t), ovpn_ipp_compare_cn);
+
+	for (i = 0; i < ipp->count; i++)
+	{
+		if ((i + 1 < ipp->count) && !strcmp(ipp->items[i].cn, ipp->items[i + 1].cn))
+		{
+			free(ipp->items[i].cn);
+			continue;
+		}
+
+		ipp->items[count++] = ipp->items[i];
+	}
+
+	ipp->count = count;
+	ipp->sorted = 1;
+}
+
+json_object *ovpn_ipp_json(ovpn_ipp_t *ipp)
+{
+	size_t i;
+	json_object *json = json_object_new_object();
+
+	if (!json)
+		return NULL;
+
+	ovpn_ipp_sort(ipp);
+
+	/*
+	 * {
+	 *     "<common-name>": {
+	 *         "ip": "<ipv4>",
+	 *         "ipv6": "<ipv6>"
+	 *     },
+	 *     ...
+	 * }
+	 */
+	for (i = 0; i < ipp->count; i++)
+	{
+		char addr[INET6_ADDRSTRLEN];
+		json_object *entry = json_object_new_object();
+
+		if (!entry)
+		{
+			json_object_put(json);
+			return NULL;
+		}
+
+		if (ipp->items[i].flags & OVPN_IPP_FLAG_IPV4)
+		{
+			inet_ntop(AF_INET, ipp->items[i].ipv4, addr, sizeof(addr));
+			json_object_object_add(entry, "ip", json_object_new_string(addr));
+		}
+
+		if (ipp->items[i].flags & OVPN_IPP_FLAG_IPV6)
+		{
+			inet_ntop(AF_INET6, ipp->items[i].ipv6, addr, sizeof(addr));
+			json_object_object_add(entry, "ipv6", json_object_new_string(addr));
+		}
+
+		json_object_object_add(json, ipp->items[i].cn, entry);
+	}
+
+	return json;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/** Items for sorting address indices */
+static const ovpn_ipp_item_t *ovpn_ipp_sort_items;
+
+static int ovpn_ipp_compare_ipv4(const void *a, const void *b)
+{
+	return memcmp(ovpn_ipp_sort_items[*(const uint32_t *)a].ipv4,
+		ovpn_ipp_sort_items[*(const uint32_t *)b].ipv4, 4);
+}
+
+static int ovpn_ipp_compare_ipv6(const void *a, const void *b)
+{
+	return memcmp(ovpn_ipp_sort_items[*(const uint32_t *)a].ipv6,
+		ovpn_ipp_sort_items[*(const uint32_t *)b].ipv6, 16);
+}
+
+/**
+ * Build address index (entry numbers sorted by address)
+ */
+static uint32_t ovpn_ipp_address_index(
+	const ovpn_ipp_t *ipp,
+	unsigned int flag,
+	uint32_t *index,
+	int (*compare)(const void *, const void *)
+)
+{
+	size_t i;
+	uint32_t count = 0;
+
+	for (i = 0; i < ipp->count; i++)
+	{
+		if (ipp->items[i].flags & flag)
+			index[count++] = (uint32_t)i;
+	}
+
+	/* Index is built by a single thread */
+	ovpn_ipp_sort_items = ipp->items;
+	qsort(index, count, sizeof(uint32_t), compare);
+	return count;
+}
+
+int ovpn_ipp_write_index(ovpn_ipp_t *ipp, const char *path)
+{
+	int ret = 0;
+	size_t i;
+	size_t size;
+	size_t strings_size = 0;
+	size_t entries_offset, ipv4_offset, ipv6_offset, strings_offset;
+	uint32_t ipv4_count, ipv6_count;
+	uint32_t *index;
+	uint8_t *data;
+	char *tmp_path;
+	FILE *stream;
+
+	ovpn_ipp_sort(ipp);
+
+	for (i = 0; i < ipp->count; i++)
+		strings_size += strlen(ipp->items[i].cn);
+
+	if ((ipp->count > (UINT32_MAX / 64u)) || (strings_size > UINT32_MAX / 2u))
+		return -EFBIG;
+
+	index = malloc((ipp->count ? ipp->count : 1) * sizeof(uint32_t));
+	if (!index)
+		return -ENOMEM;
+
+	entries_offset = OVPN_IPP_INDEX_HEADER_SIZE;
+	ipv4_offset = entries_offset + ipp->count * OVPN_IPP_INDEX_ENTRY_SIZE;
+	ipv6_offset = ipv4_offset + 4u + ipp->count * 4u;
+	strings_offset = ipv6_offset + 4u + ipp->count * 4u;
+	size = strings_offset + strings_size;
+
+	data = calloc(1, size);
+	if (!data)
+	{
+		free(index);
+		return -ENOMEM;
+	}
+
+	/* Header */
+	memcpy(data, OVPN_IPP_INDEX_MAGIC, 8);
+	ovpn_ipp_put_u32(data + 8, (uint32_t)ipp->count);
+	ovpn_ipp_put_u32(data + 12, (uint32_t)entries_offset);
+	ovpn_ipp_put_u32(data + 16, (uint32_t)ipv4_offset);
+	ovpn_ipp_put_u32(data + 20, (uint32_t)ipv6_offset);
+	ovpn_ipp_put_u32(data + 24, (uint32_t)strings_offset);
+	ovpn_ipp_put_u32(data + 28, (uint32_t)strings_size);
+
+	/* Entries and strings */
+	strings_size = 0;
+	for (i = 0; i < ipp->count; i++)
+	{
+		uint8_t *entry = data + entries_offset + i * OVPN_IPP_INDEX_ENTRY_SIZE;
+		size_t cn_len = strlen(ipp->items[i].cn);
+
+		memcpy(data + strings_offset + strings_size, ipp->items[i].cn, cn_len);
+
+		ovpn_ipp_put_u32(entry, (uint32_t)strings_size);
+		ovpn_ipp_put_u32(entry + 4, (uint32_t)cn_len);
+		ovpn_ipp_put_u32(entry + 8, ipp->items[i].flags);
+		memcpy(entry + 12, ipp->items[i].ipv4, 4);
+		memcpy(entry + 16, ipp->items[i].ipv6, 16);
+
+		strings_size += cn_len;
+	}
+
+	/* Address indices */
+	ipv4_count = ovpn_ipp_address_index(ipp,
+		OVPN_IPP_FLAG_IPV4, index, ovpn_ipp_compare_ipv4);
+
+	ovpn_ipp_put_u32(data + ipv4_offset, ipv4_count);
+	for (i = 0; i < ipv4_count; i++)
+		ovpn_ipp_put_u32(data + ipv4_offset + 4u + i * 4u, index[i]);
+
+	ipv6_count = ovpn_ipp_address_index(ipp,
+		OVPN_IPP_FLAG_IPV6, index, ovpn_ipp_compare_ipv6);
+
+	ovpn_ipp_put_u32(data + ipv6_offset, ipv6_count);
+	for (i = 0; i < ipv6_count; i++)
+		ovpn_ipp_put_u32(data + ipv6_offset + 4u + i * 4u, index[i]);
+
+	free(index);
+
+	/* Write temporary file and replace index atomically */
+	tmp_path = malloc(strlen(path) + sizeof(".tmp"));
+	if (!tmp_path)
+	{
+		free(data);
+		return -ENOMEM;
+	}
+
+	sprintf(tmp_path, "%s.tmp", path);
+
+	stream = fopen(tmp_path, "wb");
+	if (!stream)
+	{
+		fprintf(stderr, "Could not open file '%s'\n", tmp_path);
+		ret = -ENODEV;
+	}
+	else
+	{
+		if (fwrite(data, 1, size, stream) != size)
+			ret = -EIO;
+
+		if (fclose(stream) && !ret)
+			ret = -EIO;
+
+		if (!ret && rename(tmp_path, path))
+			ret = -errno;
+
+		if (ret)
+			unlink(tmp_path);
+	}
+
+	free(tmp_path);
+	free(data);
+	return ret;
+}
+
+/* ----------------------------------------------------------------------- */
+
+ovpn_ipp_index_t *ovpn_ipp_index_open(const char *path)
+{
+	int fd;
+	void *data;
+	struct stat st;
+	ovpn_ipp_index_t *index;
+	uint32_t entries_offset, ipv4_offset, ipv6_offset, strings_offset;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &st) || (st.st_size < OVPN_IPP_INDEX_HEADER_SIZE))
+	{
+		close(fd);
+		errno = EINVAL;
+		return NULL;
+	}
+
+	data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED)
+		return NULL;
+
+	index = calloc(1, sizeof(ovpn_ipp_index_t));
+	if (!index)
+	{
+		munmap(data, (size_t)st.st_size);
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	index->data = data;
+	index->size = (size_t)st.st_size;
+
+	if (memcmp(index->data, OVPN_IPP_INDEX_MAGIC, 8))
+		goto out_invalid;
+
+	index->count = ovpn_ipp_get_u32(index->data + 8);
+	entries_offset = ovpn_ipp_get_u32(index->data + 12);
+	ipv4_offset = ovpn_ipp_get_u32(index->data + 16);
+	ipv6_offset = ovpn_ipp_get_u32(index->data + 20);
+	strings_offset = ovpn_ipp_get_u32(index->data + 24);
+	index->strings_size = ovpn_ipp_get_u32(index->data + 28);
+
+	/* All tables must be inside the file */
+	if ((((uint64_t)entries_offset + (uint64_t)index->count * OVPN_IPP_INDEX_ENTRY_SIZE) > index->size) ||
+	    (((uint64_t)ipv4_offset + 4u) > index->size) ||
+	    (((uint64_t)ipv6_offset + 4u) > index->size) ||
+	    (((uint64_t)strings_offset + index->strings_size) > index->size))
+		goto out_invalid;
+
+	index->entries = index->data + entries_offset;
+	index->strings = (const char *)index->data + strings_offset;
+
+	index->ipv4_count = ovpn_ipp_get_u32(index->data + ipv4_offset);
+	index->ipv4_index = index->data + ipv4_offset + 4u;
+
+	index->ipv6_count = ovpn_ipp_get_u32(index->data + ipv6_offset);
+	index->ipv6_index = index->data + ipv6_offset + 4u;
+
+	if ((((uint64_t)ipv4_offset + 4u + (uint64_t)index->ipv4_count * 4u) > index->size) ||
+	    (((uint64_t)ipv6_offset + 4u + (uint64_t)index->ipv6_count * 4u) > index->size))
+		goto out_invalid;
+
+	return index;
+
+out_invalid:
+	ovpn_ipp_index_close(index);
+	errno = EINVAL;
+	return NULL;
+}
+
+void ovpn_ipp_index_close(ovpn_ipp_index_t *index)
+{
+	if (!index)
+		return;
+
+	munmap((void *)index->data, index->size);
+	free(index);
+}
+
+/**
+ * Get entry by number
+ *
+ * @return 0 on success
+ * @return -EINVAL if entry is invalid
+ */
+static int ovpn_ipp_index_entry(
+	const ovpn_ipp_index_t *index,
+	uint32_t n,
+	ovpn_ipp_entry_t *entry
+)
+{
+	const uint8_t *p;
+	uint32_t cn_offset, cn_len, flags;
+
+	if (n >= index->count)
+		return -EINVAL;
+
+	p = index->entries + (size_t)n * OVPN_IPP_INDEX_ENTRY_SIZE;
+
+	cn_offset = ovpn_ipp_get_u32(p);
+	cn_len = ovpn_ipp_get_u32(p + 4);
+	flags = ovpn_ipp_get_u32(p + 8);
+
+	if (((uint64_t)cn_offset + cn_len) > index->strings_size)
+		return -EINVAL;
+
+	entry->cn = index->strings + cn_offset;
+	entry->cn_len = cn_len;
+	entry->has_ipv4 = !!(flags & OVPN_IPP_FLAG_IPV4);
+	entry->has_ipv6 = !!(flags & OVPN_IPP_FLAG_IPV6);
+
+	memcpy(entry->ipv4, p + 12, 4);
+	memcpy(entry->ipv6, p + 16, 16);
+	return 0;
+}
+
+/**
+ * Binary search in the address index
+ */
+static int ovpn_ipp_index_lookup_address(
+	const ovpn_ipp_index_t *index,
+	const uint8_t *address,
+	int ipv6,
+	ovpn_ipp_entry_t *entry
+)
+{
+	uint32_t lo = 0;
+	uint32_t hi = ipv6 ? index->ipv6_count : index->ipv4_count;
+	const uint8_t *items = ipv6 ? index->ipv6_index : index->ipv4_index;
+
+	while (lo < hi)
+	{
+		int cmp;
+		uint32_t mid = lo + (hi - lo) / 2;
+
+		if (ovpn_ipp_index_entry(index,
+				ovpn_ipp_get_u32(items + (size_t)mid * 4u), entry))
+			return -EINVAL;
+
+		cmp = ipv6
+			? memcmp(address, entry->ipv6, 16)
+			: memcmp(address, entry->ipv4, 4);
+
+		if (!cmp)
+			return 0;
+
+		if (cmp < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return -ENOENT;
+}
+
+int ovpn_ipp_index_lookup(
+	const ovpn_ipp_index_t *index,
+	const char *key,
+	ovpn_ipp_entry_t *entry
+)
+{
+	uint8_t address[16];
+	uint32_t lo = 0;
+	uint32_t hi = index->count;
+	size_t key_len;
+
+	if (inet_pton(AF_INET, key, address) == 1)
+		return ovpn_ipp_index_lookup_address(index, address, 0, entry);
+
+	if (inet_pton(AF_INET6, key, address) == 1)
+		return ovpn_ipp_index_lookup_address(index, address, 1, entry);
+
+	key_len = strlen(key);
+
+	/* Entries are sorted by common name (strcmp order) */
+	while (lo < hi)
+	{
+		int cmp;
+		uint32_t mid = lo + (hi - lo) / 2;
+
+		if (ovpn_ipp_index_entry(index, mid, entry))
+			return -EINVAL;
+
+		cmp = memcmp(key, entry->cn,
+			(key_len < entry->cn_len) ? key_len : entry->cn_len);
+
+		if (!cmp)
+			cmp = (key_len > entry->cn_len) - (key_len < entry->cn_len);
+
+		if (!cmp)
+			return 0;
+
+		if (cmp < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return -ENOENT;
+}
+
+/* ----------------------------------------------------------------------- */
@@ -0,0 +1,117 @@
+/*
+ * OpenVPN Configuration Files Converter
+ * Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+#ifndef OVPN_IPP_H
+#define OVPN_IPP_H
+
+#include <stdint.h>
+#include <ovpn.h>
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * @brief Parsed ifconfig-pool-persist files
+ */
+typedef struct ovpn_ipp ovpn_ipp_t;
+
+ovpn_ipp_t *ovpn_ipp_new(void);
+void ovpn_ipp_delete(ovpn_ipp_t *ipp);
+
+/**
+ * Parse ifconfig-pool-persist file and add its entries
+ *
+ * Every line of the file is "<common-name>,<ipv4>[,<ipv6>]".
+ * Invalid lines are reported to stderr and skipped.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int ovpn_ipp_parse(ovpn_ipp_t *ipp, FILE *input);
+
+/**
+ * Build JSON object keyed by common name
+ *
+ * Entries of common names found several times are taken
+ * from the last occurrence.
+ *
+ * @return JSON object or NULL on memory allocation failure
+ */
+json_object *ovpn_ipp_json(ovpn_ipp_t *ipp);
+
+/**
+ * Write binary index of the entries to @p path
+ *
+ * Index file is replaced atomically, so it can be safely
+ * rebuilt while being used by readers.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int ovpn_ipp_write_index(ovpn_ipp_t *ipp, const char *path);
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * @brief Memory-mapped binary index
+ */
+typedef struct ovpn_ipp_index ovpn_ipp_index_t;
+
+/**
+ * @brief Index lookup result (points into the mapped index)
+ */
+typedef struct
+{
+	/** Common name (not null-terminated) */
+	const char *cn;
+
+	/** Common name length */
+	size_t cn_len;
+
+	/** IPv4 address in network byte order (valid if @ref has_ipv4) */
+	uint8_t ipv4[4];
+
+	/** IPv6 address (valid if @ref has_ipv6) */
+	uint8_t ipv6[16];
+
+	/** Entry has IPv4 address */
+	int has_ipv4;
+
+	/** Entry has IPv6 address */
+	int has_ipv6;
+
+} ovpn_ipp_entry_t;
+
+/**
+ * Open and map binary index file
+ *
+ * @return Index or NULL on error (errno is set)
+ */
+ovpn_ipp_index_t *ovpn_ipp_index_open(const char *path);
+
+void ovpn_ipp_index_close(ovpn_ipp_index_t *index);
+
+/**
+ * Look up entry by common name, IPv4 or IPv6 address
+ *
+ * Keys that are valid IP addresses are looked up by address,
+ * other keys are looked up by common name. Lookup takes
+ * O(log N) comparisons without any allocations.
+ *
+ * @return 0 if entry is found
+ * @return -ENOENT if entry is not found
+ */
+int ovpn_ipp_index_lookup(
+	const ovpn_ipp_index_t *index,
+	const char *key,
+	ovpn_ipp_entry_t *entry
+);
+
+/* ----------------------------------------------------------------------- */
+
+#endif /* OVPN_IPP_H */
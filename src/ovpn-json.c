@@ -0,0 +1,473 @@
+/*
+ * OpenVPN Configuration Files Converter
+ * Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Fast JSON writer
+ *
+ * Writes JSON objects tree to the stream in the same format as
+ * json_object_to_json_string_ext() does, but without building the whole
+ * JSON text in memory. Strings are escaped by copying long runs of
+ * characters that need no escaping in bulk. Runs are found with SIMD
+ * instructions where available.
+ *
+ * Streaming JSON reader parses sequences of JSON values (NDJSON or
+ * concatenated values) from the stream in fixed-size chunks.
+ */
+
+#include <inttypes.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include <ovpn.h>
+
+/* ----------------------------------------------------------------------- */
+
+/** Output buffer size */
+#define OVPN_JSON_BUFFER_SIZE  16384u
+
+/**
+ * @brief JSON writer state
+ */
+typedef struct
+{
+	/** Output stream */
+	FILE *stream;
+
+	/** Dump flags (OVPN_DUMP_FLAG_*) */
+	unsigned int flags;
+
+	/** Output buffer */
+	char buf[OVPN_JSON_BUFFER_SIZE];
+
+	/** Count of bytes in @ref buf */
+	size_t len;
+
+} ovpn_json_writer_t;
+
+/**
+ * Characters that must be escaped:
+ *   0 - no escaping,
+ *   1 - escaped only if slash escaping is enabled,
+ *   'u' - \u00XX form,
+ *   other - two-character escape sequence.
+ */
+static const unsigned char ovpn_json_escape[256] =
+{
+	['\b'] = 'b', ['\t'] = 't', ['\n'] = 'n', ['\f'] = 'f', ['\r'] = 'r',
+	[0x00] = 'u', [0x01] = 'u', [0x02] = 'u', [0x03] = 'u',
+	[0x04] = 'u', [0x05] = 'u', [0x06] = 'u', [0x07] = 'u',
+	[0x0b] = 'u', [0x0e] = 'u', [0x0f] = 'u', [0x10] = 'u',
+	[0x11] = 'u', [0x12] = 'u', [0x13] = 'u', [0x14] = 'u',
+	[0x15] = 'u', [0x16] = 'u', [0x17] = 'u', [0x18] = 'u',
+	[0x19] = 'u', [0x1a] = 'u', [0x1b] = 'u', [0x1c] = 'u',
+	[0x1d] = 'u', [0x1e] = 'u', [0x1f] = 'u',
+	['"']  = '"', ['\\'] = '\\', ['/'] = 1,
+};
+
+/* ----------------------------------------------------------------------- */
+
+static void ovpn_json_flush(ovpn_json_writer_t *w)
+{
+	if (w->len)
+	{
+		fwrite(w->buf, 1, w->len, w->stream);
+		w->len = 0;
+	}
+}
+
+static void ovpn_json_put(ovpn_json_writer_t *w, const char *data, size_t len)
+{
+	if (len > (sizeof(w->buf) - w->len))
+	{
+		ovpn_json_flush(w);
+
+		/* Write long data directly */
+		if (len > sizeof(w->buf))
+		{
+			fwrite(data, 1, len, w->stream);
+			return;
+		}
+	}
+
+	memcpy(w->buf + w->len, data, len);
+	w->len += len;
+}
+
+static void ovpn_json_putc(ovpn_json_writer_t *w, char c)
+{
+	if (w->len == sizeof(w->buf))
+		ovpn_json_flush(w);
+
+	w->buf[w->len++] = c;
+}
+
+#define ovpn_json_puts(w, str) \
+	ovpn_json_put((w), (str), sizeof(str) - 1)
+
+static void ovpn_json_indent(ovpn_json_writer_t *w, int level)
+{
+	int i;
+
+	if (!(w->flags & OVPN_DUMP_FLAG_PRETTY))
+		return;
+
+	for (i = 0; i < level; i++)
+		ovpn_json_putc(w, '\t');
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Find first character in @p str that must be escaped
+ *
+ * @return Offset of the character or @p len if there are
+ *         no such characters
+ */
+static size_t ovpn_json_scan(const char *str, size_t len, int escape_slash)
+{
+	size_t pos = 0;
+
+#if defined(__SSE2__)
+	const __m128i v_ctrl  = _mm_set1_epi8(0x1f);
+	const __m128i v_quote = _mm_set1_epi8('"');
+	const __m128i v_bslash = _mm_set1_epi8('\\');
+	const __m128i v_slash = _mm_set1_epi8(escape_slash ? '/' : '"');
+
+	for (; (pos + 16) <= len; pos += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)(str + pos));
+
+		/* v <= 0x1f (unsigned) */
+		__m128i m = _mm_cmpeq_epi8(_mm_max_epu8(v, v_ctrl), v_ctrl);
+
+		m = _mm_or_si128(m, _mm_cmpeq_epi8(v, v_quote));
+		m = _mm_or_si128(m, _mm_cmpeq_epi8(v, v_bslash));
+		m = _mm_or_si128(m, _mm_cmpeq_epi8(v, v_slash));
+
+		int mask = _mm_movemask_epi8(m);
+		if (mask)
+			return pos + (size_t)__builtin_ctz((unsigned int)mask);
+	}
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+	const uint8x16_t v_ctrl  = vdupq_n_u8(0x1f);
+	const uint8x16_t v_quote = vdupq_n_u8('"');
+	const uint8x16_t v_bslash = vdupq_n_u8('\\');
+	const uint8x16_t v_slash = vdupq_n_u8(escape_slash ? '/' : '"');
+
+	for (; (pos + 16) <= len; pos += 16)
+	{
+		uint8x16_t v = vld1q_u8((const uint8_t *)(str + pos));
+		uint8x16_t m = vcleq_u8(v, v_ctrl);
+
+		m = vorrq_u8(m, vceqq_u8(v, v_quote));
+		m = vorrq_u8(m, vceqq_u8(v, v_bslash));
+		m = vorrq_u8(m, vceqq_u8(v, v_slash));
+
+		/* Exact position is found by the scalar loop below */
+		if (vmaxvq_u8(m))
+			break;
+	}
+#endif
+
+	for (; pos < len; pos++)
+	{
+		unsigned char e = ovpn_json_escape[(unsigned char)str[pos]];
+
+		if (e && ((e != 1) || escape_slash))
+			break;
+	}
+
+	return pos;
+}
+
+static void ovpn_json_string(
+	ovpn_json_writer_t *w, const char *str, size_t len)
+{
+	static const char hex[] = "0123456789abcdef";
+	int escape_slash = !(w->flags & OVPN_DUMP_FLAG_NO_SLASH_ESCAPE);
+
+	ovpn_json_putc(w, '"');
+
+	while (len)
+	{
+		unsigned char c;
+		size_t run = ovpn_json_scan(str, len, escape_slash);
+
+		ovpn_json_put(w, str, run);
+
+		if (run == len)
+			break;
+
+		c = (unsigned char)str[run];
+
+		switch (ovpn_json_escape[c])
+		{
+			case 'u':
+			{
+				char seq[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf] };
+				ovpn_json_put(w, seq, sizeof(seq));
+				break;
+			}
+
+			case 1: /* '/' */
+				ovpn_json_puts(w, "\\/");
+				break;
+
+			default:
+				ovpn_json_putc(w, '\\');
+				ovpn_json_putc(w, (char)ovpn_json_escape[c]);
+				break;
+		}
+
+		str += run + 1;
+		len -= run + 1;
+	}
+
+	ovpn_json_putc(w, '"');
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void ovpn_json_value(ovpn_json_writer_t *w, json_object *obj, int level)
+{
+	int pretty = (w->flags & OVPN_DUMP_FLAG_PRETTY);
+
+	switch (json_object_get_type(obj))
+	{
+		case json_type_object:
+		{
+			int had_children = 0;
+
+			ovpn_json_putc(w, '{');
+			if (pretty)
+				ovpn_json_putc(w, '\n');
+
+			json_object_object_foreach(obj, key, val)
+			{
+				if (had_children)
+				{
+					ovpn_json_putc(w, ',');
+					if (pretty)
+						ovpn_json_putc(w, '\n');
+				}
+
+				had_children = 1;
+
+				ovpn_json_indent(w, level + 1);
+				ovpn_json_string(w, key, strlen(key));
+				ovpn_json_putc(w, ':');
+				ovpn_json_value(w, val, level + 1);
+			}
+
+			if (pretty)
+			{
+				if (had_children)
+					ovpn_json_putc(w, '\n');
+
+				ovpn_json_indent(w, level);
+			}
+
+			ovpn_json_putc(w, '}');
+			break;
+		}
+
+		case json_type_array:
+		{
+			size_t i;
+			size_t len = json_object_array_length(obj);
+
+			ovpn_json_putc(w, '[');
+			if (pretty)
+				ovpn_json_putc(w, '\n');
+
+			for (i = 0; i < len; i++)
+			{
+				if (i)
+				{
+					ovpn_json_putc(w, ',');
+					if (pretty)
+						ovpn_json_putc(w, '\n');
+				}
+
+				ovpn_json_indent(w, level + 1);
+				ovpn_json_value(w, json_object_array_get_idx(obj, i), level + 1);
+			}
+
+			if (pretty)
+			{
+				if (len)
+					ovpn_json_putc(w, '\n');
+
+				ovpn_json_indent(w, level);
+			}
+
+			ovpn_json_putc(w, ']');
+			break;
+		}
+
+		case json_type_string:
+			ovpn_json_string(w, json_object_get_string(obj),
+				(size_t)json_object_get_string_len(obj));
+
+			break;
+
+		case json_type_int:
+		{
+			char num[24];
+			int n = snprintf(num, sizeof(num), "%" PRId64,
+				json_object_get_int64(obj));
+
+			ovpn_json_put(w, num, (size_t)n);
+			break;
+		}
+
+		case json_type_boolean:
+			if (json_object_get_boolean(obj))
+				ovpn_json_puts(w, "true");
+			else
+				ovpn_json_puts(w, "false");
+
+			break;
+
+		case json_type_double:
+		{
+			/* Not used in OVPN objects tree */
+			const char *str = json_object_to_json_string(obj);
+			ovpn_json_put(w, str, strlen(str));
+			break;
+		}
+
+		case json_type_null:
+		default:
+			ovpn_json_puts(w, "null");
+			break;
+	}
+}
+
+/* ----------------------------------------------------------------------- */
+
+int ovpn_json_write(json_object *obj, unsigned int flags, FILE *stream)
+{
+	ovpn_json_writer_t *w = malloc(sizeof(ovpn_json_writer_t));
+	if (!w)
+		return -ENOMEM;
+
+	w->stream = stream;
+	w->flags = flags;
+	w->len = 0;
+
+	ovpn_json_value(w, obj, 0);
+	ovpn_json_putc(w, '\n');
+	ovpn_json_flush(w);
+
+	free(w);
+	return ferror(stream) ? -EIO : 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/** Input buffer size of the JSON reader */
+#define OVPN_JSON_READ_BUFFER_SIZE  65536u
+
+int ovpn_json_read(FILE *input, ovpn_json_read_fn_t fn, void *arg)
+{
+	int ret = 0;
+	int in_value = 0;
+	char *buffer;
+	json_tokener *tok;
+
+	buffer = malloc(OVPN_JSON_READ_BUFFER_SIZE);
+	if (!buffer)
+		return -ENOMEM;
+
+	tok = json_tokener_new();
+	if (!tok)
+	{
+		free(buffer);
+		return -ENOMEM;
+	}
+
+	while (!ret)
+	{
+		char *data = buffer;
+		size_t len = fread(buffer, 1, OVPN_JSON_READ_BUFFER_SIZE, input);
+
+		if (!len)
+		{
+			if (ferror(input))
+				ret = -EIO;
+			else if (in_value)
+			{
+				fprintf(stderr, "Unexpected end of JSON input\n");
+				ret = -EINVAL;
+			}
+
+			break;
+		}
+
+		while (!ret && len)
+		{
+			size_t parsed;
+			json_object *obj;
+			enum json_tokener_error jerr;
+
+			/* Skip whitespaces between values */
+			if (!in_value)
+			{
+				while (len && ((*data == ' ') || (*data == '\t') ||
+				               (*data == '\n') || (*data == '\r')))
+				{
+					data++;
+					len--;
+				}
+
+				if (!len)
+					break;
+
+				in_value = 1;
+			}
+
+			obj = json_tokener_parse_ex(tok, data, (int)len);
+			jerr = json_tokener_get_error(tok);
+
+			if (jerr == json_tokener_continue)
+				break; /* Value continues in the next chunk */
+
+			if (jerr != json_tokener_success)
+			{
+				fprintf(stderr, "Invalid JSON input: %s\n",
+					json_tokener_error_desc(jerr));
+
+				ret = -EINVAL;
+				break;
+			}
+
+			parsed = json_tokener_get_parse_end(tok);
+			data += parsed;
+			len -= parsed;
+
+			json_tokener_reset(tok);
+			in_value = 0;
+
+			ret = fn(obj, arg);
+			json_object_put(obj);
+		}
+	}
+
+	json_tokener_free(tok);
+	free(buffer);
+	return ret;
+}
+
+/* ----------------------------------------------------------------------- */
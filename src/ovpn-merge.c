@@ -0,0 +1,253 @@
+/*
+ * OpenVPN Configuration Files Converter
+ * Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Layered configurations merge
+ *
+ * Merged configuration is built from references to the option
+ * occurrence arrays and inline objects of the base and overlay
+ * configurations, so option values are not copied. However, every
+ * base option and inline key is added to the result, and base
+ * occurrences of an option appended by the overlay are hashed and
+ * referenced by the new array, so merge takes O(base + overlay) time
+ * per overlay, not time linear in the overlay size.
+ */
+
+#include <ovpn.h>
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * @brief Occurrences hash set slot
+ */
+typedef struct
+{
+	/** Hash of occurrence arguments (0 - empty slot) */
+	uint64_t hash;
+
+	/** Occurrence arguments */
+	json_object *args;
+
+} ovpn_merge_slot_t;
+
+/* ----------------------------------------------------------------------- */
+
+static json_object *ovpn_merge_args(json_object *occurrence)
+{
+	json_object *args;
+
+	if (!json_object_object_get_ex(occurrence, "args", &args) ||
+	    !json_object_is_type(args, json_type_array))
+		return NULL;
+
+	return args;
+}
+
+/**
+ * Add occurrence arguments to the hash set
+ *
+ * @return 1 if arguments are added
+ * @return 0 if the same arguments are already in the set
+ */
+static int ovpn_merge_slot_add(
+	ovpn_merge_slot_t *table, size_t size, json_object *args)
+{
+	uint64_t hash = ovpn_args_hash(args);
+	size_t i = (size_t)hash & (size - 1);
+
+	while (table[i].hash)
+	{
+		if ((table[i].hash == hash) && ovpn_args_equal(table[i].args, args))
+			return 0;
+
+		i = (i + 1) & (size - 1);
+	}
+
+	table[i].hash = hash;
+	table[i].args = args;
+	return 1;
+}
+
+/**
+ * Append overlay occurrences of the option that can be specified
+ * several times to the base occurrences
+ *
+ * @return New occurrences array, base array reference if there
+ *         are no new occurrences or NULL on error
+ */
+static json_object *ovpn_merge_multiple(json_object *base, json_object *overlay)
+{
+	size_t i;
+	size_t size = 8;
+	size_t base_count = json_object_array_length(base);
+	size_t overlay_count = json_object_array_length(overlay);
+	ovpn_merge_slot_t *table;
+	json_object *result = NULL;
+
+	while (size < ((base_count + overlay_count) * 2))
+		size <<= 1;
+
+	table = calloc(size, sizeof(ovpn_merge_slot_t));
+	if (!table)
+		return NULL;
+
+	for (i = 0; i < base_count; i++)
+	{
+		ovpn_merge_slot_add(table, size,
+			ovpn_merge_args(json_object_array_get_idx(base, i)));
+	}
+
+	for (i = 0; i < overlay_count; i++)
+	{
+		json_object *occurrence = json_object_array_get_idx(overlay, i);
+
+		if (!ovpn_merge_slot_add(table, size, ovpn_merge_args(occurrence)))
+			continue;
+
+		/* Base array may be shared, so it is copied on first append */
+		if (!result)
+		{
+			size_t j;
+
+			result = json_object_new_array();
+			if (!result)
+				goto out;
+
+			for (j = 0; j < base_count; j++)
+			{
+				json_object_array_add(result,
+					json_object_get(json_object_array_get_idx(base, j)));
+			}
+		}
+
+		json_object_array_add(result, json_object_get(occurrence));
+	}
+
+	if (!result)
+		result = json_object_get(base);
+
+out:
+	free(table);
+	return result;
+}
+
+/**
+ * Merge options objects
+ */
+static int ovpn_merge_options(
+	json_object *result, json_object *base, json_object *overlay)
+{
+	json_object *occurrences;
+
+	json_object_object_foreach(base, base_name, base_value)
+		json_object_object_add(result, base_name, json_object_get(base_value));
+
+	json_object_object_foreach(overlay, name, value)
+	{
+		ssize_t index = ovpn_opt_index(name);
+		const ovpn_opt_info_t *opt =
+			(index < 0) ? NULL : ovpn_opt_get((size_t)index);
+
+		if (!json_object_is_type(value, json_type_array))
+			return -EINVAL;
+
+		if (opt && (opt->flags & OVPN_OPT_FLAG_MULTIPLE) &&
+		    json_object_object_get_ex(base, name, &occurrences))
+		{
+			if (!json_object_is_type(occurrences, json_type_array))
+				return -EINVAL;
+
+			occurrences = ovpn_merge_multiple(occurrences, value);
+			if (!occurrences)
+				return -ENOMEM;
+		}
+		else
+			occurrences = json_object_get(value);
+
+		json_object_object_add(result, name, occurrences);
+	}
+
+	return 0;
+}
+
+/**
+ * Merge inlines objects
+ */
+static int ovpn_merge_inlines(
+	json_object *result, json_object *base, json_object *overlay)
+{
+	json_object_object_foreach(base, base_name, base_value)
+		json_object_object_add(result, base_name, json_object_get(base_value));
+
+	json_object_object_foreach(overlay, name, value)
+		json_object_object_add(result, name, json_object_get(value));
+
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+int ovpn_merge(json_object *base, json_object *overlay, json_object **result)
+{
+	int ret;
+	json_object *merged;
+	json_object *json_inlines;
+	json_object *json_options;
+	json_object *base_obj;
+	json_object *overlay_obj;
+
+	*result = NULL;
+
+	merged = json_object_new_object();
+	json_inlines = json_object_new_object();
+	json_options = json_object_new_object();
+
+	if (!merged || !json_inlines || !json_options)
+	{
+		json_object_put(json_inlines);
+		json_object_put(json_options);
+		json_object_put(merged);
+		return -ENOMEM;
+	}
+
+	/* Same members order as in parsed configurations */
+	json_object_object_add(merged, "inlines", json_inlines);
+	json_object_object_add(merged, "options", json_options);
+
+	if (!json_object_object_get_ex(base, "inlines", &base_obj) ||
+	    !json_object_object_get_ex(overlay, "inlines", &overlay_obj) ||
+	    !json_object_is_type(base_obj, json_type_object) ||
+	    !json_object_is_type(overlay_obj, json_type_object))
+		ret = -EINVAL;
+	else
+		ret = ovpn_merge_inlines(json_inlines, base_obj, overlay_obj);
+
+	if (!ret)
+	{
+		if (!json_object_object_get_ex(base, "options", &base_obj) ||
+		    !json_object_object_get_ex(overlay, "options", &overlay_obj) ||
+		    !json_object_is_type(base_obj, json_type_object) ||
+		    !json_object_is_type(overlay_obj, json_type_object))
+			ret = -EINVAL;
+		else
+			ret = ovpn_merge_options(json_options, base_obj, overlay_obj);
+	}
+
+	if (ret)
+	{
+		json_object_put(merged);
+		return ret;
+	}
+
+	*result = merged;
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
@@ -7,6 +7,8 @@
  * as published by Sam Hocevar. See the COPYING file for more details.
  */
 
+#include <pthread.h>
+
 #include <ovpn.h>
 
 /* ----------------------------------------------------------------------- */
@@ -76,6 +78,12 @@
 /*
  * Based on information from:
  * https://community.openvpn.net/openvpn/wiki/Openvpn24ManPage
+ * https://openvpn.net/community-resources/reference-manual-for-openvpn-2-5/
+ * https://openvpn.net/community-resources/reference-manual-for-openvpn-2-6/
+ *
+ * Options added or removed in later versions have the 'since' and
+ * 'removed' fields set, per-version lookup indices are built from
+ * this single table.
  */
 
 /* ----------------------------------------------------------------------- */
@@ -90,6 +98,29 @@
 
 /* ----------------------------------------------------------------------- */
 
+OVPN_OPT_DEF_ARG_TYPES(allow_compression, 1, OVPN_OPT_ARG_TYPE_LISTVALUE);
+OVPN_OPT_DEF_ARG_LV(allow_compression, 1, "mode", false,
+	"yes", "no", "asym");
+
+OVPN_OPT_DEF_ARGS_BEGIN(allow_compression)
+OVPN_OPT_DEF_ARGS_ARG(allow_compression, 1)
+OVPN_OPT_DEF_ARGS_END()
+
+static const ovpn_opt_info_t ovpn__allow_compression =
+{
+	.name = "allow-compression",
+	.flags = OVPN_OPT_FLAG_NORMAL,
+	.since = OVPN_VERSION_2_5,
+	.args = {
+		/* mode */
+		.min = 1,
+		.max = 1,
+		.info = OVPN_OPT_REF_ARGS(allow_compression)
+	},
+};
+
+/* ----------------------------------------------------------------------- */
+
 OVPN_OPT_DEF_ARG_TYPES(allow_nonadmin, 1, OVPN_OPT_ARG_TYPE_INTERFACE);
 OVPN_OPT_DEF_ARG(allow_nonadmin, 1, "TAP-Adapter", true);
 
@@ -160,7 +191,8 @@ OVPN_OPT_DEF_ARGS_END()
 static const ovpn_opt_info_t ovpn__auth =
 {
 	.name = "auth",
-	.flags = OVPN_OPT_FLAG_NORMAL,
+	.flags = OVPN_OPT_FLAG_NORMAL |
+	         OVPN_OPT_FLAG_PUSHABLE,
 	.args = {
 		/* alg */
 		.min = 1,
@@ -192,6 +224,30 @@ static const ovpn_opt_info_t ovpn__auth_gen_token =
 
 /* ----------------------------------------------------------------------- */
 
+OVPN_OPT_DEF_ARG_TYPES(auth_gen_token_secret, 1, OVPN_OPT_ARG_TYPE_FILEPATH);
+OVPN_OPT_DEF_ARG(auth_gen_token_secret, 1, "file", false);
+
+OVPN_OPT_DEF_ARGS_BEGIN(auth_gen_token_secret)
+OVPN_OPT_DEF_ARGS_ARG(auth_gen_token_secret, 1)
+OVPN_OPT_DEF_ARGS_END()
+
+static const ovpn_opt_info_t ovpn__auth_gen_token_secret =
+{
+	.name = "auth-gen-token-secret",
+	.flags = OVPN_OPT_FLAG_NORMAL |
+	         OVPN_OPT_FLAG_INLINE,
+	.inline_type = OVPN_OPT_INLINE_TYPE_PLAIN,
+	.since = OVPN_VERSION_2_5,
+	.args = {
+		/* file */
+		.min = 1,
+		.max = 1,
+		.info = OVPN_OPT_REF_ARGS(auth_gen_token_secret)
+	},
+};
+
+/* ----------------------------------------------------------------------- */
+
 static const ovpn_opt_info_t ovpn__auth_nocache =
 {
 	.name = "auth-nocache",
@@ -353,11 +409,45 @@ static const ovpn_opt_info_t ovpn__bind =
 
 /* ----------------------------------------------------------------------- */
 
+OVPN_OPT_DEF_ARG_TYPES(bind_dev, 1, OVPN_OPT_ARG_TYPE_INTERFACE);
+OVPN_OPT_DEF_ARG(bind_dev, 1, "device", false);
+
+OVPN_OPT_DEF_ARGS_BEGIN(bind_dev)
+OVPN_OPT_DEF_ARGS_ARG(bind_dev, 1)
+OVPN_OPT_DEF_ARGS_END()
+
+static const ovpn_opt_info_t ovpn__bind_dev =
+{
+	.name = "bind-dev",
+	.flags = OVPN_OPT_FLAG_NORMAL,
+	.since = OVPN_VERSION_2_5,
+	.args = {
+		/* device */
+		.min = 1,
+		.max = 1,
+		.info = OVPN_OPT_REF_ARGS(bind_dev)
+	},
+};
+
+/* ----------------------------------------------------------------------- */
+
+static const ovpn_opt_info_t ovpn__block_ipv6 =
+{
+	.name = "block-ipv6",
+	.flags = OVPN_OPT_FLAG_NORMAL |
+	         OVPN_OPT_FLAG_IPV6 |
+	         OVPN_OPT_FLAG_PUSHABLE,
+	.since = OVPN_VERSION_2_5,
+};
+
+/* ----------------------------------------------------------------------- */
+
 static const ovpn_opt_info_t ovpn__block_outside_dns =
 {
 	.name = "block-outside-dns",
 	.flags = OVPN_OPT_FLAG_NORMAL |
-	         OVPN_OPT_FLAG_WINDOWS,
+	         OVPN_OPT_FLAG_WINDOWS |
+	         OVPN_OPT_FLAG_PUSHABLE,
 };
 
 /* ----------------------------------------------------------------------- */
@@ -501,7 +591,8 @@ OVPN_OPT_DEF_ARGS_END()
 static const ovpn_opt_info_t ovpn__cipher =
 {
 	.name = "cipher",
-	.flags = OVPN_OPT_FLAG_NORMAL,
+	.flags = OVPN_OPT_FLAG_NORMAL |
+	         OVPN_OPT_FLAG_PUSHABLE,
 	.args = {
 		/* alg */
 		.min = 1,
@@ -524,7 +615,8 @@ static const ovpn_opt_info_t ovpn__client_cert_not_required =
 {
 	.name = "client-cert-not-required",
 	.flags = OVPN_OPT_FLAG_NORMAL |
-	         OVPN_OPT_FLAG_DEPRECATED
+	         OVPN_OPT_FLAG_DEPRECATED,
+	.removed = OVPN_VERSION_2_5
 };
 
 /* ----------------------------------------------------------------------- */
@@ -615,7 +707,8 @@ OVPN_OPT_DEF_ARGS_END()
 static const ovpn_opt_info_t ovpn__client_nat =
 {
 	.name = "client-nat",
-	.flags = OVPN_OPT_FLAG_NORMAL,
+	.flags = OVPN_OPT_FLAG_NORMAL |
+	         OVPN_OPT_FLAG_MULTIPLE,
 	.args = {
 		/* snat|dnat network netmask alias */
 		.min = 4,
@@ -646,6 +739,7 @@ static const ovpn_opt_info_t ovpn__compat_names =
 	.name = "compat-names",
 	.flags = OVPN_OPT_FLAG_NORMAL |
 	         OVPN_OPT_FLAG_DEPRECATED,
+	.removed = OVPN_VERSION_2_5,
 	.args = {
 		/* [no-remapping] */
 		.min = 1,
@@ -688,9 +782,31 @@ static const ovpn_opt_info_t ovpn__comp_noadapt =
 
 /* ----------------------------------------------------------------------- */
 
+OVPN_OPT_DEF_ARG_TYPES(compat_mode, 1, OVPN_OPT_ARG_TYPE_STRING);
+OVPN_OPT_DEF_ARG(compat_mode, 1, "version", false);
+
+OVPN_OPT_DEF_ARGS_BEGIN(compat_mode)
+OVPN_OPT_DEF_ARGS_ARG(compat_mode, 1)
+OVPN_OPT_DEF_ARGS_END()
+
+static const ovpn_opt_info_t ovpn__compat_mode =
+{
+	.name = "compat-mode",
+	.flags = OVPN_OPT_FLAG_NORMAL,
+	.since = OVPN_VERSION_2_6,
+	.args = {
+		/* version */
+		.min = 1,
+		.max = 1,
+		.info = OVPN_OPT_REF_ARGS(compat_mode)
+	},
+};
+
+/* ----------------------------------------------------------------------- */
+
 OVPN_OPT_DEF_ARG_TYPES(compress, 1, OVPN_OPT_ARG_TYPE_LISTVALUE);
 OVPN_OPT_DEF_ARG_LV(compress, 1, "algorithm", true,
-	"lzo", "lz4");
+	"lzo", "lz4", "lz4-v2", "stub", "stub-v2", "migrate");
 
 OVPN_OPT_DEF_ARGS_BEGIN(compress)
 OVPN_OPT_DEF_ARGS_ARG(compress, 1)
@@ -699,7 +815,8 @@ OVPN_OPT_DEF_ARGS_END()
 static const ovpn_opt_info_t ovpn__compress =
 {
 	.name = "compress",
-	.flags = OVPN_OPT_FLAG_NORMAL,
+	.flags = OVPN_OPT_FLAG_NORMAL |
+	         OVPN_OPT_FLAG_PUSHABLE,
 	.args = {
 		/* [compress] */
 		.min = 0,
@@ -710,6 +827,29 @@ static const ovpn_opt_info_t ovpn__compress =
 
 /* ----------------------------------------------------------------------- */
 
+OVPN_OPT_DEF_ARG_TYPES(config, 1, OVPN_OPT_ARG_TYPE_FILEPATH);
+OVPN_OPT_DEF_ARG(config, 1, "file", false);
+
+OVPN_OPT_DEF_ARGS_BEGIN(config)
+OVPN_OPT_DEF_ARGS_ARG(config, 1)
+OVPN_OPT_DEF_ARGS_END()
+
+static const ovpn_opt_info_t ovpn__config =
+{
+	.name = "config",
+	.flags = OVPN_OPT_FLAG_NORMAL |
+	         OVPN_OPT_FLAG_MULTIPLE |
+	         OVPN_OPT_FLAG_CCD,
+	.args = {
+		/* file */
+		.min = 1,
+		.max = 1,
+		.info = OVPN_OPT_REF_ARGS(config)
+	},
+};
+
+/* ----------------------------------------------------------------------- */
+
 OVPN_OPT_DEF_ARG_TYPES(connect_freq, 1, OVPN_OPT_ARG_TYPE_UNUMBER);
 OVPN_OPT_DEF_ARG(connect_freq, 1, "n", false);
 
@@ -897,6 +1037,50 @@ static const ovpn_opt_info_t ovpn__daemon =
 
 /* ----------------------------------------------------------------------- */
 
+OVPN_OPT_DEF_ARG_TYPES(data_ciphers, 1, OVPN_OPT_ARG_TYPE_LIST);
+OVPN_OPT_DEF_ARG(data_ciphers, 1, "cipher_list", false);
+
+OVPN_OPT_DEF_ARGS_BEGIN(data_ciphers)
+OVPN_OPT_DEF_ARGS_ARG(data_ciphers, 1)
+OVPN_OPT_DEF_ARGS_END()
+
+static const ovpn_opt_info_t ovpn__data_ciphers =
+{
+	.name = "data-ciphers",
+	.flags = OVPN_OPT_FLAG_NORMAL,
+	.since = OVPN_VERSION_2_5,
+	.args = {
+		/* cipher_list */
+		.min = 1,
+		.max = 1,
+		.info = OVPN_OPT_REF_ARGS(data_ciphers)
+	},
+};
+
+/* ----------------------------------------------------------------------- */
+
+OVPN_OPT_DEF_ARG_TYPES(data_ciphers_fallback, 1, OVPN_OPT_ARG_TYPE_STRING);
+OVPN_OPT_DEF_ARG(data_ciphers_fallback, 1, "alg", false);
+
+OVPN_OPT_DEF_ARGS_BEGIN(data_ciphers_fallback)
+OVPN_OPT_DEF_ARGS_ARG(data_ciphers_fallback, 1)
+OVPN_OPT_DEF_ARGS_END()
+
+static const ovpn_opt_info_t ovpn__data_ciphers_fallback =
+{
+	.name = "data-ciphers-fallback",
+	.flags = OVPN_OPT_FLAG_NORMAL,
+	.since = OVPN_VERSION_2_5,
+	.args = {
+		/* alg */
+		.min = 1,
+		.max = 1,
+		.info = OVPN_OPT_REF_ARGS(data_ciphers_fallback)
+	},
+};
+
+/* ----------------------------------------------------------------------- */
+
 OVPN_OPT_DEF_ARG_TYPES(dev, 1, OVPN_OPT_ARG_TYPE_TUNTAP_DEVICE);
 OVPN_OPT_DEF_ARG(dev, 1, "device", false);
 
@@ -985,7 +1169,8 @@ static const ovpn_opt_info_t ovpn__dh =
 
 OVPN_OPT_DEF_ARG_TYPES(dhcp_option, 1, OVPN_OPT_ARG_TYPE_LISTVALUE);
 OVPN_OPT_DEF_ARG_LV(dhcp_option, 1, "type", false,
-	"DOMAIN", "DNS", "WINS", "NBDD", "NTP", "NBT", "NBS", "DISABLE-NTB");
+	"DOMAIN", "DNS", "DNS6", "WINS", "NBDD", "NTP", "NBT", "NBS",
+	"DISABLE-NBT", "DOMAIN-SEARCH", "PROXY_HTTP", "ADAPTER_DOMAIN_SUFFIX");
 
 OVPN_OPT_DEF_ARG_TYPES(dhcp_option, 2, OVPN_OPT_ARG_TYPE_STRING);
 OVPN_OPT_DEF_ARG(dhcp_option, 2, "parm", true);
@@ -1016,7 +1201,8 @@ static const ovpn_opt_info_t ovpn__dhcp_release =
 {
 	.name = "dhcp-release",
 	.flags = OVPN_OPT_FLAG_NORMAL |
-	         OVPN_OPT_FLAG_WINDOWS
+	         OVPN_OPT_FLAG_WINDOWS |
+	         OVPN_OPT_FLAG_PUSHABLE
 };
 
 /* ----------------------------------------------------------------------- */
@@ -1025,7 +1211,8 @@ static const ovpn_opt_info_t ovpn__dhcp_renew =
 {
 	.name = "dhcp-renew",
 	.flags = OVPN_OPT_FLAG_NORMAL |
-	         OVPN_OPT_FLAG_WINDOWS
+	         OVPN_OPT_FLAG_WINDOWS |
+	         OVPN_OPT_FLAG_PUSHABLE
 };
 
 /* ----------------------------------------------------------------------- */
@@ -1033,7 +1220,17 @@ static const ovpn_opt_info_t ovpn__dhcp_renew =
 static const ovpn_opt_info_t ovpn__disable =
 {
 	.name = "disable",
-	.flags = OVPN_OPT_FLAG_NORMAL
+	.flags = OVPN_OPT_FLAG_NORMAL |
+	         OVPN_OPT_FLAG_CCD
+};
+
+/* ----------------------------------------------------------------------- */
+
+static const ovpn_opt_info_t ovpn__disable_dco =
+{
+	.name = "disable-dco",
+	.flags = OVPN_OPT_FLAG_NORMAL,
+	.since = OVPN_VERSION_2_6,
 };
 
 /* ----------------------------------------------------------------------- */
@@ -1046,6 +1243,35 @@ static const ovpn_opt_info_t ovpn__disable_occ =
 
 /* ----------------------------------------------------------------------- */
 
+OVPN_OPT_DEF_ARG_TYPES(dns, 1, OVPN_OPT_ARG_TYPE_LISTVALUE);
+OVPN_OPT_DEF_ARG_LV(dns, 1, "scope", false,
+	"search-domains", "server");
+
+OVPN_OPT_DEF_ARG_TYPES(dns, 2, OVPN_OPT_ARG_TYPE_STRING);
+OVPN_OPT_DEF_ARG(dns, 2, "parms", false);
+
+OVPN_OPT_DEF_ARGS_BEGIN(dns)
+OVPN_OPT_DEF_ARGS_ARG(dns, 1)
+OVPN_OPT_DEF_ARGS_ARG(dns, 2)
+OVPN_OPT_DEF_ARGS_END()
+
+static const ovpn_opt_info_t ovpn__dns =
+{
+	.name = "dns",
+	.flags = OVPN_OPT_FLAG_NORMAL |
+	         OVPN_OPT_FLAG_MULTIPLE |
+	         OVPN_OPT_FLAG_PUSHABLE,
+	.since = OVPN_VERSION_2_6,
+	.args = {
+		/* search-domains|server [parms...] */
+		.min = 2,
+		.max = OVPN_OPT_ARGS_NOT_LIMITED,
+		.info = OVPN_OPT_REF_ARGS(dns)
+	},
+};
+
+/* ----------------------------------------------------------------------- */
+
 OVPN_OPT_DEF_ARG_TYPES(down, 1, OVPN_OPT_ARG_TYPE_COMMAND);
 OVPN_OPT_DEF_ARG(down, 1, "type", false);
 
@@ -1127,6 +1353,7 @@ static const ovpn_opt_info_t ovpn__echo =
 {
 	.name = "echo",
 	.flags = OVPN_OPT_FLAG_NORMAL |
+	         OVPN_OPT_FLAG_MULTIPLE |
 	         OVPN_OPT_FLAG_PUSHABLE,
 	.args = {
 		/* [parms...] */
@@ -1178,7 +1405,8 @@ static const ovpn_opt_info_t ovpn__explicit_exit_notify =
 {
 	.name = "explicit-exit-notify",
 	.flags = OVPN_OPT_FLAG_NORMAL |
-	         OVPN_OPT_FLAG_CONNECTION,
+	         OVPN_OPT_FLAG_CONNECTION |
+	         OVPN_OPT_FLAG_PUSHABLE,
 	.args = {
 		/* [n] */
 		.min = 0,
@@ -1477,7 +1705,8 @@ OVPN_OPT_DEF_ARGS_END()
 static const ovpn_opt_info_t ovpn__ifconfig =
 {
 	.name = "ifconfig",
-	.flags = OVPN_OPT_FLAG_NORMAL,
+	.flags = OVPN_OPT_FLAG_NORMAL |
+	         OVPN_OPT_FLAG_PUSHABLE,
 	.args = {
 		/* l rn */
 		.min = 2,
@@ -1503,7 +1732,8 @@ static const ovpn_opt_info_t ovpn__ifconfig_ipv6 =
 {
 	.name = "ifconfig-ipv6",
 	.flags = OVPN_OPT_FLAG_NORMAL |
-	         OVPN_OPT_FLAG_IPV6,
+	         OVPN_OPT_FLAG_IPV6 |
+	         OVPN_OPT_FLAG_PUSHABLE,
 	.args = {
 		/* ipv6addr/bits ipv6remote */
 		.min = 2,
@@ -1552,7 +1782,8 @@ static const ovpn_opt_info_t ovpn__ifconfig_ipv6_push =
 {
 	.name = "ifconfig-ipv6-push",
 	.flags = OVPN_OPT_FLAG_NORMAL |
-	         OVPN_OPT_FLAG_IPV6,
+	         OVPN_OPT_FLAG_IPV6 |
+	         OVPN_OPT_FLAG_CCD,
 	.args = {
 		/* ipv6addr/bits ipv6remote */
 		.min = 2,
@@ -1612,7 +1843,8 @@ static const ovpn_opt_info_t ovpn__ifconfig_pool_linear =
 {
 	.name = "ifconfig-pool-linear",
 	.flags = OVPN_OPT_FLAG_NORMAL |
-	         OVPN_OPT_FLAG_DEPRECATED
+	         OVPN_OPT_FLAG_DEPRECATED,
+	.removed = OVPN_VERSION_2_5
 };
 
 /* ----------------------------------------------------------------------- */
@@ -1660,7 +1892,8 @@ OVPN_OPT_DEF_ARGS_END()
 static const ovpn_opt_info_t ovpn__ifconfig_push =
 {
 	.name = "ifconfig-push",
-	.flags = OVPN_OPT_FLAG_NORMAL,
+	.flags = OVPN_OPT_FLAG_NORMAL |
+	         OVPN_OPT_FLAG_CCD,
 	.args = {
 		/* local remote-netmask [alias] */
 		.min = 2,
@@ -1832,7 +2065,9 @@ OVPN_OPT_DEF_ARGS_END()
 static const ovpn_opt_info_t ovpn__iroute =
 {
 	.name = "iroute",
-	.flags = OVPN_OPT_FLAG_NORMAL,
+	.flags = OVPN_OPT_FLAG_NORMAL |
+	         OVPN_OPT_FLAG_MULTIPLE |
+	         OVPN_OPT_FLAG_CCD,
 	.args = {
 		/* network [netmask] */
 		.min = 1,
@@ -1854,7 +2089,9 @@ static const ovpn_opt_info_t ovpn__iroute_ipv6 =
 {
 	.name = "iroute-ipv6",
 	.flags = OVPN_OPT_FLAG_NORMAL |
-	         OVPN_OPT_FLAG_IPV6,
+	         OVPN_OPT_FLAG_MULTIPLE |
+	         OVPN_OPT_FLAG_IPV6 |
+	         OVPN_OPT_FLAG_CCD,
 	.args = {
 		/* ipv6addr/bits */
 		.min = 1,
@@ -1970,6 +2207,7 @@ static const ovpn_opt_info_t ovpn__key_method =
 	.name = "key-method",
 	.flags = OVPN_OPT_FLAG_NORMAL |
 	         OVPN_OPT_FLAG_DEPRECATED,
+	.removed = OVPN_VERSION_2_6,
 	.args = {
 		/* m */
 		.min = 1,
@@ -2017,6 +2255,7 @@ static const ovpn_opt_info_t ovpn__keysize =
 	.name = "keysize",
 	.flags = OVPN_OPT_FLAG_NORMAL |
 	         OVPN_OPT_FLAG_DEPRECATED,
+	.removed = OVPN_VERSION_2_6,
 	.args = {
 		/* n */
 		.min = 1,
@@ -2641,7 +2880,8 @@ static const ovpn_opt_info_t ovpn__ncp_ciphers =
 static const ovpn_opt_info_t ovpn__ncp_disable =
 {
 	.name = "ncp-disable",
-	.flags = OVPN_OPT_FLAG_NORMAL
+	.flags = OVPN_OPT_FLAG_NORMAL,
+	.removed = OVPN_VERSION_2_6
 };
 
 /* ----------------------------------------------------------------------- */
@@ -2671,7 +2911,8 @@ static const ovpn_opt_info_t ovpn__no_iv =
 {
 	.name = "no-iv",
 	.flags = OVPN_OPT_FLAG_NORMAL |
-	         OVPN_OPT_FLAG_DEPRECATED
+	         OVPN_OPT_FLAG_DEPRECATED,
+	.removed = OVPN_VERSION_2_5
 };
 
 /* ----------------------------------------------------------------------- */
@@ -2689,7 +2930,8 @@ static const ovpn_opt_info_t ovpn__no_name_remapping =
 {
 	.name = "no-name-remapping",
 	.flags = OVPN_OPT_FLAG_NORMAL |
-	         OVPN_OPT_FLAG_DEPRECATED
+	         OVPN_OPT_FLAG_DEPRECATED,
+	.removed = OVPN_VERSION_2_5
 };
 
 /* ----------------------------------------------------------------------- */
@@ -2775,6 +3017,31 @@ static const ovpn_opt_info_t ovpn__pause_exit =
 
 /* ----------------------------------------------------------------------- */
 
+OVPN_OPT_DEF_ARG_TYPES(peer_fingerprint, 1, OVPN_OPT_ARG_TYPE_STRING);
+OVPN_OPT_DEF_ARG(peer_fingerprint, 1, "fingerprint", false);
+
+OVPN_OPT_DEF_ARGS_BEGIN(peer_fingerprint)
+OVPN_OPT_DEF_ARGS_ARG(peer_fingerprint, 1)
+OVPN_OPT_DEF_ARGS_END()
+
+static const ovpn_opt_info_t ovpn__peer_fingerprint =
+{
+	.name = "peer-fingerprint",
+	.flags = OVPN_OPT_FLAG_NORMAL |
+	         OVPN_OPT_FLAG_MULTIPLE |
+	         OVPN_OPT_FLAG_INLINE,
+	.inline_type = OVPN_OPT_INLINE_TYPE_PLAIN,
+	.since = OVPN_VERSION_2_6,
+	.args = {
+		/* fingerprint */
+		.min = 1,
+		.max = 1,
+		.info = OVPN_OPT_REF_ARGS(peer_fingerprint)
+	},
+};
+
+/* ----------------------------------------------------------------------- */
+
 static const ovpn_opt_info_t ovpn__persist_key =
 {
 	.name = "persist-key",
@@ -3055,7 +3322,8 @@ OVPN_OPT_DEF_ARGS_END()
 static const ovpn_opt_info_t ovpn__plugin =
 {
 	.name = "plugin",
-	.flags = OVPN_OPT_FLAG_NORMAL,
+	.flags = OVPN_OPT_FLAG_NORMAL |
+	         OVPN_OPT_FLAG_MULTIPLE,
 	.args = {
 		/* module-pathname [init-string] */
 		.min = 1,
@@ -3132,6 +3400,7 @@ static const ovpn_opt_info_t ovpn__prng =
 {
 	.name = "prng",
 	.flags = OVPN_OPT_FLAG_NORMAL,
+	.removed = OVPN_VERSION_2_6,
 	.args = {
 		/* alg [nsl] */
 		.min = 1,
@@ -3187,6 +3456,28 @@ static const ovpn_opt_info_t ovpn__proto_force =
 
 /* ----------------------------------------------------------------------- */
 
+OVPN_OPT_DEF_ARG_TYPES(providers, 1, OVPN_OPT_ARG_TYPE_STRING);
+OVPN_OPT_DEF_ARG(providers, 1, "providers", false);
+
+OVPN_OPT_DEF_ARGS_BEGIN(providers)
+OVPN_OPT_DEF_ARGS_ARG(providers, 1)
+OVPN_OPT_DEF_ARGS_END()
+
+static const ovpn_opt_info_t ovpn__providers =
+{
+	.name = "providers",
+	.flags = OVPN_OPT_FLAG_NORMAL,
+	.since = OVPN_VERSION_2_6,
+	.args = {
+		/* providers... */
+		.min = 1,
+		.max = OVPN_OPT_ARGS_NOT_LIMITED,
+		.info = OVPN_OPT_REF_ARGS(providers)
+	},
+};
+
+/* ----------------------------------------------------------------------- */
+
 static const ovpn_opt_info_t ovpn__pull =
 {
 	.name = "pull",
@@ -3210,7 +3501,8 @@ OVPN_OPT_DEF_ARGS_END()
 static const ovpn_opt_info_t ovpn__pull_filter =
 {
 	.name = "pull-filter",
-	.flags = OVPN_OPT_FLAG_NORMAL,
+	.flags = OVPN_OPT_FLAG_NORMAL |
+	         OVPN_OPT_FLAG_MULTIPLE,
 	.args = {
 		/* accept|ignore|reject text */
 		.min = 2,
@@ -3232,7 +3524,8 @@ static const ovpn_opt_info_t ovpn__push =
 {
 	.name = "push",
 	.flags = OVPN_OPT_FLAG_NORMAL |
-	         OVPN_OPT_FLAG_MULTIPLE,
+	         OVPN_OPT_FLAG_MULTIPLE |
+	         OVPN_OPT_FLAG_CCD,
 	.args = {
 		/* option */
 		.min = 1,
@@ -3262,7 +3555,8 @@ static const ovpn_opt_info_t ovpn__push_remove =
 {
 	.name = "push-remove",
 	.flags = OVPN_OPT_FLAG_NORMAL |
-	         OVPN_OPT_FLAG_MULTIPLE,
+	         OVPN_OPT_FLAG_MULTIPLE |
+	         OVPN_OPT_FLAG_CCD,
 	.args = {
 		/* opt */
 		.min = 1,
@@ -3276,7 +3570,8 @@ static const ovpn_opt_info_t ovpn__push_remove =
 static const ovpn_opt_info_t ovpn__push_reset =
 {
 	.name = "push-reset",
-	.flags = OVPN_OPT_FLAG_NORMAL
+	.flags = OVPN_OPT_FLAG_NORMAL |
+	         OVPN_OPT_FLAG_CCD
 };
 
 /* ----------------------------------------------------------------------- */
@@ -3352,7 +3647,8 @@ static const ovpn_opt_info_t ovpn__redirect_gateway =
 static const ovpn_opt_info_t ovpn__redirect_private =
 {
 	.name = "redirect-private",
-	.flags = OVPN_OPT_FLAG_NORMAL,
+	.flags = OVPN_OPT_FLAG_NORMAL |
+	         OVPN_OPT_FLAG_PUSHABLE,
 	.args = {
 		/* [flags...] */
 		.min = 0,
@@ -3367,7 +3663,8 @@ static const ovpn_opt_info_t ovpn__register_dns =
 {
 	.name = "register-dns",
 	.flags = OVPN_OPT_FLAG_NORMAL |
-	         OVPN_OPT_FLAG_WINDOWS
+	         OVPN_OPT_FLAG_WINDOWS |
+	         OVPN_OPT_FLAG_PUSHABLE
 };
 
 /* ----------------------------------------------------------------------- */
@@ -3676,6 +3973,7 @@ static const ovpn_opt_info_t ovpn__route =
 {
 	.name = "route",
 	.flags = OVPN_OPT_FLAG_NORMAL |
+	         OVPN_OPT_FLAG_MULTIPLE |
 	         OVPN_OPT_FLAG_PUSHABLE,
 	.args = {
 		/* network/IP [netmask] [gateway] [metric] */
@@ -3755,6 +4053,7 @@ static const ovpn_opt_info_t ovpn__route_ipv6 =
 {
 	.name = "route-ipv6",
 	.flags = OVPN_OPT_FLAG_NORMAL |
+	         OVPN_OPT_FLAG_MULTIPLE |
 	         OVPN_OPT_FLAG_IPV6 |
 	         OVPN_OPT_FLAG_PUSHABLE,
 	.args = {
@@ -3800,7 +4099,8 @@ OVPN_OPT_DEF_ARGS_END()
 static const ovpn_opt_info_t ovpn__route_metric =
 {
 	.name = "route-metric",
-	.flags = OVPN_OPT_FLAG_NORMAL,
+	.flags = OVPN_OPT_FLAG_NORMAL |
+	         OVPN_OPT_FLAG_PUSHABLE,
 	.args = {
 		/* m */
 		.min = 1,
@@ -4084,6 +4384,29 @@ static const ovpn_opt_info_t ovpn__service =
 
 /* ----------------------------------------------------------------------- */
 
+OVPN_OPT_DEF_ARG_TYPES(session_timeout, 1, OVPN_OPT_ARG_TYPE_UNUMBER);
+OVPN_OPT_DEF_ARG(session_timeout, 1, "n", false);
+
+OVPN_OPT_DEF_ARGS_BEGIN(session_timeout)
+OVPN_OPT_DEF_ARGS_ARG(session_timeout, 1)
+OVPN_OPT_DEF_ARGS_END()
+
+static const ovpn_opt_info_t ovpn__session_timeout =
+{
+	.name = "session-timeout",
+	.flags = OVPN_OPT_FLAG_NORMAL |
+	         OVPN_OPT_FLAG_PUSHABLE,
+	.since = OVPN_VERSION_2_6,
+	.args = {
+		/* n */
+		.min = 1,
+		.max = 1,
+		.info = OVPN_OPT_REF_ARGS(session_timeout)
+	},
+};
+
+/* ----------------------------------------------------------------------- */
+
 OVPN_OPT_DEF_ARG_TYPES(setcon, 1, OVPN_OPT_ARG_TYPE_STRING);
 OVPN_OPT_DEF_ARG(setcon, 1, "context", false);
 
@@ -4147,7 +4470,8 @@ static const ovpn_opt_info_t ovpn__setenv_safe =
 {
 	.name = "setenv-safe",
 	.flags = OVPN_OPT_FLAG_NORMAL |
-	         OVPN_OPT_FLAG_MULTIPLE,
+	         OVPN_OPT_FLAG_MULTIPLE |
+	         OVPN_OPT_FLAG_PUSHABLE,
 	.args = {
 		/* name value */
 		.min = 2,
@@ -4552,7 +4876,8 @@ static const ovpn_opt_info_t ovpn__tap_sleep =
 {
 	.name = "tap-sleep",
 	.flags = OVPN_OPT_FLAG_NORMAL |
-	         OVPN_OPT_FLAG_WINDOWS,
+	         OVPN_OPT_FLAG_WINDOWS |
+	         OVPN_OPT_FLAG_PUSHABLE,
 	.args = {
 		/* n */
 		.min = 1,
@@ -4713,6 +5038,57 @@ static const ovpn_opt_info_t ovpn__tls_crypt =
 
 /* ----------------------------------------------------------------------- */
 
+OVPN_OPT_DEF_ARG_TYPES(tls_crypt_v2, 1, OVPN_OPT_ARG_TYPE_FILEPATH);
+OVPN_OPT_DEF_ARG(tls_crypt_v2, 1, "keyfile", false);
+
+OVPN_OPT_DEF_ARG_TYPES(tls_crypt_v2, 2, OVPN_OPT_ARG_TYPE_LISTVALUE);
+OVPN_OPT_DEF_ARG_LV(tls_crypt_v2, 2, "mode", true,
+	"force-cookie", "allow-noncookie");
+
+OVPN_OPT_DEF_ARGS_BEGIN(tls_crypt_v2)
+OVPN_OPT_DEF_ARGS_ARG(tls_crypt_v2, 1)
+OVPN_OPT_DEF_ARGS_ARG(tls_crypt_v2, 2)
+OVPN_OPT_DEF_ARGS_END()
+
+static const ovpn_opt_info_t ovpn__tls_crypt_v2 =
+{
+	.name = "tls-crypt-v2",
+	.flags = OVPN_OPT_FLAG_NORMAL |
+	         OVPN_OPT_FLAG_INLINE,
+	.inline_type = OVPN_OPT_INLINE_TYPE_PLAIN,
+	.since = OVPN_VERSION_2_5,
+	.args = {
+		/* keyfile [mode] */
+		.min = 1,
+		.max = 2,
+		.info = OVPN_OPT_REF_ARGS(tls_crypt_v2)
+	},
+};
+
+/* ----------------------------------------------------------------------- */
+
+OVPN_OPT_DEF_ARG_TYPES(tls_crypt_v2_verify, 1, OVPN_OPT_ARG_TYPE_COMMAND);
+OVPN_OPT_DEF_ARG(tls_crypt_v2_verify, 1, "cmd", false);
+
+OVPN_OPT_DEF_ARGS_BEGIN(tls_crypt_v2_verify)
+OVPN_OPT_DEF_ARGS_ARG(tls_crypt_v2_verify, 1)
+OVPN_OPT_DEF_ARGS_END()
+
+static const ovpn_opt_info_t ovpn__tls_crypt_v2_verify =
+{
+	.name = "tls-crypt-v2-verify",
+	.flags = OVPN_OPT_FLAG_NORMAL,
+	.since = OVPN_VERSION_2_5,
+	.args = {
+		/* cmd */
+		.min = 1,
+		.max = 1,
+		.info = OVPN_OPT_REF_ARGS(tls_crypt_v2_verify)
+	},
+};
+
+/* ----------------------------------------------------------------------- */
+
 static const ovpn_opt_info_t ovpn__tls_exit =
 {
 	.name = "tls-exit",
@@ -4742,6 +5118,28 @@ static const ovpn_opt_info_t ovpn__tls_export_cert =
 
 /* ----------------------------------------------------------------------- */
 
+OVPN_OPT_DEF_ARG_TYPES(tls_groups, 1, OVPN_OPT_ARG_TYPE_LIST);
+OVPN_OPT_DEF_ARG(tls_groups, 1, "list", false);
+
+OVPN_OPT_DEF_ARGS_BEGIN(tls_groups)
+OVPN_OPT_DEF_ARGS_ARG(tls_groups, 1)
+OVPN_OPT_DEF_ARGS_END()
+
+static const ovpn_opt_info_t ovpn__tls_groups =
+{
+	.name = "tls-groups",
+	.flags = OVPN_OPT_FLAG_NORMAL,
+	.since = OVPN_VERSION_2_5,
+	.args = {
+		/* list */
+		.min = 1,
+		.max = 1,
+		.info = OVPN_OPT_REF_ARGS(tls_groups)
+	},
+};
+
+/* ----------------------------------------------------------------------- */
+
 static const ovpn_opt_info_t ovpn__tls_server =
 {
 	.name = "tls-server",
@@ -4870,7 +5268,8 @@ OVPN_OPT_DEF_ARGS_END()
 static const ovpn_opt_info_t ovpn__topology =
 {
 	.name = "topology",
-	.flags = OVPN_OPT_FLAG_NORMAL,
+	.flags = OVPN_OPT_FLAG_NORMAL |
+	         OVPN_OPT_FLAG_PUSHABLE,
 	.args = {
 		/* mode */
 		.min = 1,
@@ -4913,7 +5312,8 @@ static const ovpn_opt_info_t ovpn__tun_mtu =
 {
 	.name = "tun-mtu",
 	.flags = OVPN_OPT_FLAG_NORMAL |
-	         OVPN_OPT_FLAG_CONNECTION,
+	         OVPN_OPT_FLAG_CONNECTION |
+	         OVPN_OPT_FLAG_PUSHABLE,
 	.args = {
 		/* n */
 		.min = 1,
@@ -5159,6 +5559,61 @@ static const ovpn_opt_info_t ovpn__verify_x509_name =
 
 /* ----------------------------------------------------------------------- */
 
+OVPN_OPT_DEF_ARG_TYPES(vlan_accept, 1, OVPN_OPT_ARG_TYPE_LISTVALUE);
+OVPN_OPT_DEF_ARG_LV(vlan_accept, 1, "mode", false,
+	"tagged", "untagged", "all");
+
+OVPN_OPT_DEF_ARGS_BEGIN(vlan_accept)
+OVPN_OPT_DEF_ARGS_ARG(vlan_accept, 1)
+OVPN_OPT_DEF_ARGS_END()
+
+static const ovpn_opt_info_t ovpn__vlan_accept =
+{
+	.name = "vlan-accept",
+	.flags = OVPN_OPT_FLAG_NORMAL,
+	.since = OVPN_VERSION_2_5,
+	.args = {
+		/* mode */
+		.min = 1,
+		.max = 1,
+		.info = OVPN_OPT_REF_ARGS(vlan_accept)
+	},
+};
+
+/* ----------------------------------------------------------------------- */
+
+OVPN_OPT_DEF_ARG_TYPES(vlan_pvid, 1, OVPN_OPT_ARG_TYPE_UNUMBER);
+OVPN_OPT_DEF_ARG_RANGE(vlan_pvid, 1, "v", false, 1, 4094);
+
+OVPN_OPT_DEF_ARGS_BEGIN(vlan_pvid)
+OVPN_OPT_DEF_ARGS_ARG(vlan_pvid, 1)
+OVPN_OPT_DEF_ARGS_END()
+
+static const ovpn_opt_info_t ovpn__vlan_pvid =
+{
+	.name = "vlan-pvid",
+	.flags = OVPN_OPT_FLAG_NORMAL |
+	         OVPN_OPT_FLAG_CCD,
+	.since = OVPN_VERSION_2_5,
+	.args = {
+		/* v */
+		.min = 1,
+		.max = 1,
+		.info = OVPN_OPT_REF_ARGS(vlan_pvid)
+	},
+};
+
+/* ----------------------------------------------------------------------- */
+
+static const ovpn_opt_info_t ovpn__vlan_tagging =
+{
+	.name = "vlan-tagging",
+	.flags = OVPN_OPT_FLAG_NORMAL,
+	.since = OVPN_VERSION_2_5,
+};
+
+/* ----------------------------------------------------------------------- */
+
 /*
  * __          __
  * \ \        / /
@@ -5193,6 +5648,30 @@ static const ovpn_opt_info_t ovpn__win_sys =
 
 /* ----------------------------------------------------------------------- */
 
+OVPN_OPT_DEF_ARG_TYPES(windows_driver, 1, OVPN_OPT_ARG_TYPE_LISTVALUE);
+OVPN_OPT_DEF_ARG_LV(windows_driver, 1, "driver", false,
+	"tap-windows6", "wintun", "ovpn-dco");
+
+OVPN_OPT_DEF_ARGS_BEGIN(windows_driver)
+OVPN_OPT_DEF_ARGS_ARG(windows_driver, 1)
+OVPN_OPT_DEF_ARGS_END()
+
+static const ovpn_opt_info_t ovpn__windows_driver =
+{
+	.name = "windows-driver",
+	.flags = OVPN_OPT_FLAG_NORMAL |
+	         OVPN_OPT_FLAG_WINDOWS,
+	.since = OVPN_VERSION_2_5,
+	.args = {
+		/* driver */
+		.min = 1,
+		.max = 1,
+		.info = OVPN_OPT_REF_ARGS(windows_driver)
+	},
+};
+
+/* ----------------------------------------------------------------------- */
+
 OVPN_OPT_DEF_ARG_TYPES(writepid, 1, OVPN_OPT_ARG_TYPE_FILEPATH);
 OVPN_OPT_DEF_ARG(writepid, 1, "file", false);
 
@@ -5277,12 +5756,14 @@ static const ovpn_opt_info_t ovpn__x509_username_field =
 static const ovpn_opt_info_t *ovpn_options[] =
 {
 	/* A */
+	&ovpn__allow_compression,
 	&ovpn__allow_nonadmin,
 	&ovpn__allow_pull_fqdn,
 	&ovpn__allow_recursive_routing,
 	&ovpn__askpass,
 	&ovpn__auth,
 	&ovpn__auth_gen_token,
+	&ovpn__auth_gen_token_secret,
 	&ovpn__auth_nocache,
 	&ovpn__auth_retry,
 	&ovpn__auth_token,
@@ -5293,6 +5774,8 @@ static const ovpn_opt_info_t *ovpn_options[] =
 	/* B */
 	&ovpn__bcast_buffers,
 	&ovpn__bind,
+	&ovpn__bind_dev,
+	&ovpn__block_ipv6,
 	&ovpn__block_outside_dns,
 
 	/* C */
@@ -5313,7 +5796,9 @@ static const ovpn_opt_info_t *ovpn_options[] =
 	&ovpn__compat_names,
 	&ovpn__comp_lzo,
 	&ovpn__comp_noadapt,
+	&ovpn__compat_mode,
 	&ovpn__compress,
+	&ovpn__config,
 	&ovpn__connect_freq,
 	&ovpn__connect_retry,
 	&ovpn__connect_retry_max,
@@ -5324,6 +5809,8 @@ static const ovpn_opt_info_t *ovpn_options[] =
 
 	/* D */
 	&ovpn__daemon,
+	&ovpn__data_ciphers,
+	&ovpn__data_ciphers_fallback,
 	&ovpn__dev,
 	&ovpn__dev_node,
 	&ovpn__dev_type,
@@ -5332,7 +5819,9 @@ static const ovpn_opt_info_t *ovpn_options[] =
 	&ovpn__dhcp_release,
 	&ovpn__dhcp_renew,
 	&ovpn__disable,
+	&ovpn__disable_dco,
 	&ovpn__disable_occ,
+	&ovpn__dns,
 	&ovpn__down,
 	&ovpn__down_pre,
 	&ovpn__duplicate_cn,
@@ -5447,6 +5936,7 @@ static const ovpn_opt_info_t *ovpn_options[] =
 	/* P */
 	&ovpn__passtos,
 	&ovpn__pause_exit,
+	&ovpn__peer_fingerprint,
 	&ovpn__persist_key,
 	&ovpn__persist_local_ip,
 	&ovpn__persist_remote_ip,
@@ -5469,6 +5959,7 @@ static const ovpn_opt_info_t *ovpn_options[] =
 	&ovpn__prng,
 	&ovpn__proto,
 	&ovpn__proto_force,
+	&ovpn__providers,
 	&ovpn__pull,
 	&ovpn__pull_filter,
 	&ovpn__push,
@@ -5517,6 +6008,7 @@ static const ovpn_opt_info_t *ovpn_options[] =
 	&ovpn__server_ipv6,
 	&ovpn__server_poll_timeout,
 	&ovpn__service,
+	&ovpn__session_timeout,
 	&ovpn__setcon,
 	&ovpn__setenv,
 	&ovpn__setenv_safe,
@@ -5555,8 +6047,11 @@ static const ovpn_opt_info_t *ovpn_options[] =
 	&ovpn__tls_ciphersuites,
 	&ovpn__tls_client,
 	&ovpn__tls_crypt,
+	&ovpn__tls_crypt_v2,
+	&ovpn__tls_crypt_v2_verify,
 	&ovpn__tls_exit,
 	&ovpn__tls_export_cert,
+	&ovpn__tls_groups,
 	&ovpn__tls_server,
 	&ovpn__tls_timeout,
 	&ovpn__tls_verify,
@@ -5582,9 +6077,13 @@ static const ovpn_opt_info_t *ovpn_options[] =
 	&ovpn__verify_client_cert,
 	&ovpn__verify_hash,
 	&ovpn__verify_x509_name,
+	&ovpn__vlan_accept,
+	&ovpn__vlan_pvid,
+	&ovpn__vlan_tagging,
 
 	/* W */
 	&ovpn__win_sys,
+	&ovpn__windows_driver,
 	&ovpn__writepid,
 
 	/* X */
@@ -5597,21 +6096,196 @@ static const ovpn_opt_info_t *ovpn_options[] =
 	NULL,
 };
 
+/** Count of options in the built-in table (table is terminated by NULL) */
+#define OVPN_OPTIONS_COUNT \
+	(sizeof(ovpn_options) / sizeof(ovpn_options[0]) - 1)
+
+/** Options table in use (built-in or loaded from schema file) */
+static const ovpn_opt_info_t * const *ovpn_opt_table = ovpn_options;
+
+/** Count of options in the table in use */
+static size_t ovpn_opt_table_count = OVPN_OPTIONS_COUNT;
+
+/** Lookup function of the loaded table (NULL - sorted indices are used) */
+static ovpn_opt_lookup_fn_t ovpn_opt_table_lookup = NULL;
+
+struct ovpn_opt_index
+{
+	/** OpenVPN version of the index */
+	ovpn_version_t version;
+
+	/** Table positions of the available options sorted by option name
+	 *  (only for the built-in table) */
+	unsigned short positions[OVPN_OPTIONS_COUNT];
+
+	/** Count of the available options */
+	size_t count;
+};
+
+/** Options indices of all versions */
+static ovpn_opt_index_t ovpn_opt_indices[OVPN_VERSION_COUNT];
+
+static pthread_once_t ovpn_opt_indices_once = PTHREAD_ONCE_INIT;
+
+static const char *ovpn_version_names[OVPN_VERSION_COUNT] =
+{
+	[OVPN_VERSION_ANY] = "any",
+	[OVPN_VERSION_2_4] = "2.4",
+	[OVPN_VERSION_2_5] = "2.5",
+	[OVPN_VERSION_2_6] = "2.6",
+};
+
 const ovpn_opt_info_t *ovpn_opt_find(const char *name, unsigned int flags, size_t num)
 {
-	int i;
+	size_t i;
 
 	if (!name)
 		return NULL;
 
-	for (i = 0; ovpn_options[i]; i++)
+	for (i = 0; i < ovpn_opt_table_count; i++)
 	{
-		if (strncmp(ovpn_options[i]->name, name, num) == 0)
+		if (strncmp(ovpn_opt_table[i]->name, name, num) == 0)
 		{
-			if ((ovpn_options[i]->flags & flags) == flags)
-				return ovpn_options[i];
+			if ((ovpn_opt_table[i]->flags & flags) == flags)
+				return ovpn_opt_table[i];
 		}
 	}
 
 	return NULL;
 }
+
+static int ovpn_opt_cmp_positions(const void *a, const void *b)
+{
+	return strcmp(
+		ovpn_options[*(const unsigned short *)a]->name,
+		ovpn_options[*(const unsigned short *)b]->name
+	);
+}
+
+static void ovpn_opt_indices_build(void)
+{
+	size_t i;
+	int version;
+	ovpn_opt_index_t *all = &ovpn_opt_indices[OVPN_VERSION_ANY];
+
+	for (version = OVPN_VERSION_ANY; version < OVPN_VERSION_COUNT; version++)
+		ovpn_opt_indices[version].version = (ovpn_version_t)version;
+
+	/* Loaded table has its own lookup function */
+	if (ovpn_opt_table_lookup)
+		return;
+
+	for (i = 0; i < OVPN_OPTIONS_COUNT; i++)
+		all->positions[i] = (unsigned short)i;
+
+	all->count = OVPN_OPTIONS_COUNT;
+
+	qsort(all->positions, all->count,
+		sizeof(all->positions[0]), ovpn_opt_cmp_positions);
+
+	/* Version indices are filtered from the sorted index */
+	for (version = OVPN_VERSION_ANY + 1; version < OVPN_VERSION_COUNT; version++)
+	{
+		ovpn_opt_index_t *index = &ovpn_opt_indices[version];
+
+		for (i = 0; i < all->count; i++)
+		{
+			if (ovpn_opt_available(ovpn_options[all->positions[i]], version))
+				index->positions[index->count++] = all->positions[i];
+		}
+	}
+}
+
+const ovpn_opt_info_t *ovpn_opt_get(size_t index)
+{
+	if (index >= ovpn_opt_table_count)
+		return NULL;
+
+	return ovpn_opt_table[index];
+}
+
+size_t ovpn_opt_count(void)
+{
+	return ovpn_opt_table_count;
+}
+
+void ovpn_opt_table_set(
+	const ovpn_opt_info_t * const *options,
+	size_t count,
+	ovpn_opt_lookup_fn_t lookup
+)
+{
+	ovpn_opt_table = options;
+	ovpn_opt_table_count = count;
+	ovpn_opt_table_lookup = lookup;
+}
+
+const ovpn_opt_index_t *ovpn_opt_index_get(ovpn_version_t version)
+{
+	if ((unsigned int)version >= OVPN_VERSION_COUNT)
+		version = OVPN_VERSION_ANY;
+
+	pthread_once(&ovpn_opt_indices_once, ovpn_opt_indices_build);
+	return &ovpn_opt_indices[version];
+}
+
+ssize_t ovpn_opt_index_find(const ovpn_opt_index_t *index, const char *name)
+{
+	size_t lo = 0;
+	size_t hi = index->count;
+
+	if (!name)
+		return -1;
+
+	if (ovpn_opt_table_lookup)
+	{
+		ssize_t i = ovpn_opt_table_lookup(name);
+
+		if ((i >= 0) && !ovpn_opt_available(ovpn_opt_table[i], index->version))
+			return -1;
+
+		return i;
+	}
+
+	while (lo < hi)
+	{
+		size_t mid = lo + (hi - lo) / 2;
+		int cmp = strcmp(name, ovpn_options[index->positions[mid]]->name);
+
+		if (!cmp)
+			return index->positions[mid];
+
+		if (cmp < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return -1;
+}
+
+ssize_t ovpn_opt_index(const char *name)
+{
+	return ovpn_opt_index_find(ovpn_opt_index_get(OVPN_VERSION_ANY), name);
+}
+
+const char *ovpn_version_name(ovpn_version_t version)
+{
+	if ((unsigned int)version >= OVPN_VERSION_COUNT)
+		version = OVPN_VERSION_ANY;
+
+	return ovpn_version_names[version];
+}
+
+ovpn_version_t ovpn_version_find(const char *name)
+{
+	int version;
+
+	for (version = OVPN_VERSION_ANY + 1; version < OVPN_VERSION_COUNT; version++)
+	{
+		if (!strcmp(ovpn_version_names[version], name))
+			return (ovpn_version_t)version;
+	}
+
+	return OVPN_VERSION_ANY;
+}
@@ -33,6 +33,28 @@ typedef enum
 
 } ovpn_opt_inline_type_t;
 
+/**
+ * OpenVPN versions with different sets of options
+ */
+typedef enum
+{
+	/** Any version (all options of the table) */
+	OVPN_VERSION_ANY = 0,
+
+	/** OpenVPN 2.4 */
+	OVPN_VERSION_2_4,
+
+	/** OpenVPN 2.5 */
+	OVPN_VERSION_2_5,
+
+	/** OpenVPN 2.6 */
+	OVPN_VERSION_2_6,
+
+	/** Count of versions (including @ref OVPN_VERSION_ANY) */
+	OVPN_VERSION_COUNT
+
+} ovpn_version_t;
+
 static inline const char *ovpn_opt_inline_type_asciiz(
 	const ovpn_opt_inline_type_t type)
 {
@@ -52,7 +74,7 @@ static inline const char *ovpn_opt_inline_type_asciiz(
  * @def OVPN_OPT_FLAG_CONNECTION
  *      Option can be used in connection profile
  * @def OVPN_OPT_FLAG_DEPRECATED
- *      Option is deprecated and will be removed in OpenVPN 2.5+
+ *      Option is deprecated and will be removed in future OpenVPN versions
  * @def OVPN_OPT_FLAG_WINDOWS
  *      Windows specific option
  * @def OVPN_OPT_FLAG_IPV6
@@ -67,6 +89,8 @@ static inline const char *ovpn_opt_inline_type_asciiz(
  *      Option can be used in "push" option
  * @def OVPN_OPT_FLAG_NORMAL
  *      Option can be used in normal context
+ * @def OVPN_OPT_FLAG_CCD
+ *      Option can be used in client config file (client-config-dir)
  */
 
 #define OVPN_OPT_FLAG_MULTIPLE    (0x001u)
@@ -79,6 +103,7 @@ static inline const char *ovpn_opt_inline_type_asciiz(
 #define OVPN_OPT_FLAG_STANDALONE  (0x080u)
 #define OVPN_OPT_FLAG_PUSHABLE    (0x100u)
 #define OVPN_OPT_FLAG_NORMAL      (0x200u)
+#define OVPN_OPT_FLAG_CCD         (0x400u)
 
 /** The value that defines that the option number
   * of arguments is not limited. */
@@ -138,6 +163,14 @@ typedef struct
 	  * Actual only with OVPN_OPT_FLAG_INLINE flag */
 	ovpn_opt_inline_type_t inline_type;
 
+	/** Version the option is introduced in
+	  * (OVPN_VERSION_ANY - available in all versions) */
+	ovpn_version_t since;
+
+	/** Version the option is removed in
+	  * (OVPN_VERSION_ANY - not removed) */
+	ovpn_version_t removed;
+
 	struct
 	{
 		/** Minimal number of arguments */
@@ -171,6 +204,113 @@ const ovpn_opt_info_t *ovpn_opt_find(
 	size_t num
 );
 
+/**
+ * Get option information by position in the options table
+ *
+ * @param[in] index Option position in the table
+ *
+ * @return Pointer to option information structure
+ *         (@ref ovpn_opt_t) or NULL if @p index is out of the table
+ */
+const ovpn_opt_info_t *ovpn_opt_get(size_t index);
+
+/**
+ * Get count of options in the options table
+ */
+size_t ovpn_opt_count(void);
+
+/**
+ * Option lookup function of the loaded options table
+ *
+ * @return Option position or -1 if option is not found
+ */
+typedef ssize_t (*ovpn_opt_lookup_fn_t)(const char *name);
+
+/**
+ * Replace built-in options table (e.g. by the table loaded from
+ * schema file)
+ *
+ * Must be called at startup before any options lookups,
+ * @p options must stay valid until the program exits.
+ *
+ * @param[in] options  Options table
+ * @param[in] count    Count of options in the table
+ * @param[in] lookup   Lookup function for options of the table
+ */
+void ovpn_opt_table_set(
+	const ovpn_opt_info_t * const *options,
+	size_t count,
+	ovpn_opt_lookup_fn_t lookup
+);
+
+/**
+ * Get position of option in the options table
+ *
+ * Options are looked up by exact name with binary search
+ * in the index that is built on the first call (with lookup
+ * function of the loaded options table).
+ *
+ * @param[in] name  Option name
+ *
+ * @return Option position or -1 if option is not found
+ */
+ssize_t ovpn_opt_index(const char *name);
+
+/**
+ * @brief Options lookup index of OpenVPN version
+ *
+ * Each version has its own index of the options available in that
+ * version. Indices share the options table entries and are built
+ * from the table on the first use.
+ */
+typedef struct ovpn_opt_index ovpn_opt_index_t;
+
+/**
+ * Get options lookup index of OpenVPN version
+ *
+ * @param[in] version  OpenVPN version (@ref OVPN_VERSION_ANY - index
+ *                     of all options of the table)
+ *
+ * @return Options index (never NULL)
+ */
+const ovpn_opt_index_t *ovpn_opt_index_get(ovpn_version_t version);
+
+/**
+ * Get position of option in the options table using version index
+ *
+ * @param[in] index  Options index
+ * @param[in] name   Option name
+ *
+ * @return Option position or -1 if option is not found
+ *         (or is not available in the index version)
+ */
+ssize_t ovpn_opt_index_find(const ovpn_opt_index_t *index, const char *name);
+
+/**
+ * Check if option is available in OpenVPN version
+ */
+static inline bool ovpn_opt_available(
+	const ovpn_opt_info_t *opt, ovpn_version_t version)
+{
+	if (version == OVPN_VERSION_ANY)
+		return true;
+
+	return (opt->since <= version) &&
+		((opt->removed == OVPN_VERSION_ANY) || (version < opt->removed));
+}
+
+/**
+ * Get OpenVPN version name ("2.4", etc.)
+ */
+const char *ovpn_version_name(ovpn_version_t version);
+
+/**
+ * Get OpenVPN version by name
+ *
+ * @return Version or @ref OVPN_VERSION_ANY if name is unknown
+ */
+ovpn_version_t ovpn_version_find(const char *name);
+
 /* ----------------------------------------------------------------------- */
 
 #endif /* OVPN_OPTIONS_H */
@@ -137,6 +137,9 @@ static int data_buffer_append(data_buffer_t *b, const char *data)
 
 #define OVPN_PARSE_FLAG_INLINE  0x01u
 
+/** Count of bits in the seen options bitmap word */
+#define OVPN_PARSE_SEEN_WORD_BITS  (sizeof(unsigned long) * 8)
+
 /**
  * @brief Parsing state structure
  */
@@ -169,10 +172,77 @@ typedef struct
 	/** Storage data buffer for inline data */
 	data_buffer_t inline_data_buffer;
 
+	/** Bitmap of options seen in the current scope (global or
+	 *  connection block), indexed by options table position */
+	unsigned long *opts_seen;
+
+	/** Bitmap of options seen in the global scope (followed by
+	 *  the bitmap of the current connection block) */
+	unsigned long *opts_seen_global;
+
+	/** Count of words in each seen options bitmap */
+	size_t opts_seen_words;
+
+	/** Options index of the target OpenVPN version */
+	const ovpn_opt_index_t *opts_index;
+
 } ovpn_parse_state_t;
 
 /* ----------------------------------------------------------------------- */
 
+/**
+ * Find option in the options index of the target OpenVPN version
+ *
+ * @param[in]  state  Parsing state
+ * @param[in]  name   Option name
+ * @param[out] index  Option position in the options table (may be NULL)
+ *
+ * @return Option information or NULL if option is not found
+ */
+static const ovpn_opt_info_t *ovpn_parse_opt_find(
+	ovpn_parse_state_t *state,
+	const char *name,
+	ssize_t *index
+)
+{
+	ssize_t i = ovpn_opt_index_find(state->opts_index, name);
+
+	if (index)
+		*index = i;
+
+	return (i < 0) ? NULL : ovpn_opt_get((size_t)i);
+}
+
+/**
+ * Warn about option that is not found in the options index
+ * of the target OpenVPN version, but is known in other versions
+ *
+ * @return 1 if warning is added
+ * @return 0 if option is unknown
+ */
+static int ovpn_parse_opt_unsupported(
+	ovpn_parse_state_t *state,
+	const char *name
+)
+{
+	if ((state->ovpn->version == OVPN_VERSION_ANY) ||
+	    (ovpn_opt_index(name) < 0))
+		return 0;
+
+	ovpn_status_msg(
+		state->ovpn,
+		OVPN_MSG_TYPE_WARNING,
+		state->line_n,
+		N_("Option '%s' is not supported by OpenVPN %s"),
+		name,
+		ovpn_version_name(state->ovpn->version)
+	);
+
+	return 1;
+}
+
+/* ----------------------------------------------------------------------- */
+
 typedef struct
 {
 	const char *tag;
@@ -268,7 +338,7 @@ static ovpn_parse_tag_res_t ovpn_parse_tag(
 				state->ovpn,
 				OVPN_MSG_TYPE_ERROR,
 				state->line_n,
-				_("Unexpected start of inline option")
+				N_("Unexpected start of inline option")
 			);
 
 			return OVPN_PARSE_TAG_RES_ERROR;
@@ -280,7 +350,7 @@ static ovpn_parse_tag_res_t ovpn_parse_tag(
 				state->ovpn,
 				OVPN_MSG_TYPE_ERROR,
 				state->line_n,
-				_("Ending inline option is not match starting inline option")
+				N_("Ending inline option is not match starting inline option")
 			);
 
 			return OVPN_PARSE_TAG_RES_ERROR;
@@ -291,22 +361,26 @@ static ovpn_parse_tag_res_t ovpn_parse_tag(
 	}
 	else
 	{
-		const ovpn_opt_info_t *tag_opt = ovpn_opt_find(
-			tag_data.tag, 0, tag_data.tag_len);
+		const ovpn_opt_info_t *tag_opt;
 
 		state->flags |= OVPN_PARSE_FLAG_INLINE;
 
+		if (tag_data.tag_len >= OVPN_OPT_INLINE_TAG_SIZE)
+			tag_data.tag_len = OVPN_OPT_INLINE_TAG_SIZE - 1;
+
 		strncpy(state->inline_name, tag_data.tag, tag_data.tag_len);
 		state->inline_name[tag_data.tag_len] = '\0';
 		state->inline_opt = NULL;
 
+		tag_opt = ovpn_parse_opt_find(state, state->inline_name, NULL);
+
 		if (tag_data.is_closing)
 		{
 			ovpn_status_msg(
 				state->ovpn,
 				OVPN_MSG_TYPE_ERROR,
 				state->line_n,
-				_("Unexpected end of inline option '%s'"),
+				N_("Unexpected end of inline option '%s'"),
 				state->inline_name
 			);
 
@@ -325,18 +399,18 @@ static ovpn_parse_tag_res_t ovpn_parse_tag(
 					state->ovpn,
 					OVPN_MSG_TYPE_WARNING,
 					state->line_n,
-					_("Option '%s' can not be used in inline form"),
+					N_("Option '%s' can not be used in inline form"),
 					state->inline_name
 				);
 			}
 		}
-		else
+		else if (!ovpn_parse_opt_unsupported(state, state->inline_name))
 		{
  			ovpn_status_msg(
 				state->ovpn,
 				OVPN_MSG_TYPE_WARNING,
 				state->line_n,
-				_("Unknown inline option '%s'"),
+				N_("Unknown inline option '%s'"),
 				state->inline_name
 			);
 		}
@@ -362,12 +436,51 @@ typedef enum
 	OVPN_LINE_PARSER_RES_ERROR,
 
 	/** System error (no memory, etc...) */
-	OVPN_LINE_PARSER_RES_SYS_ERROR
+	OVPN_LINE_PARSER_RES_SYS_ERROR,
+
+	/** Parsing is aborted due to exhausted budget */
+	OVPN_LINE_PARSER_RES_ABORT
 
 } ovpn_line_parser_res_t;
 
 /* ----------------------------------------------------------------------- */
 
+/**
+ * Put collected plain inline data into the blob store
+ *
+ * @return JSON object with blob reference (`{"blob":"<digest>"}`)
+ * @return NULL if deduplication is disabled or failed. In this case
+ *         inline data must be stored as is
+ */
+static json_object *ovpn_parse_inline_blob_ref(
+	ovpn_parse_state_t *state
+)
+{
+	json_object *json_ref;
+	char digest[OVPN_BLOB_DIGEST_SIZE];
+
+	if (!state->ovpn->blobs)
+		return NULL;
+
+	if (ovpn_blobs_put(
+			state->ovpn->blobs,
+			data_buffer_get(&state->inline_data_buffer),
+			state->inline_data_buffer.len,
+			digest))
+		return NULL;
+
+	json_ref = json_object_new_object();
+	if (!json_ref)
+		return NULL;
+
+	json_object_object_add(json_ref, "blob",
+		json_object_new_string(digest));
+
+	return json_ref;
+}
+
+/* ----------------------------------------------------------------------- */
+
 static ovpn_line_parser_res_t ovpn_line_parser_inline_tag(
 	ovpn_parse_state_t *state,
 	char *line
@@ -434,6 +547,13 @@ static ovpn_line_parser_res_t ovpn_line_parser_inline_tag(
 					state->json_inline_data_array,
 					state->json_options
 				);
+
+				/* Each connection block is a separate scope */
+				state->opts_seen =
+					state->opts_seen_global + state->opts_seen_words;
+
+				memset(state->opts_seen, 0,
+					state->opts_seen_words * sizeof(unsigned long));
 			}
 
 			/* Clear data buffer */
@@ -447,18 +567,27 @@ static ovpn_line_parser_res_t ovpn_line_parser_inline_tag(
 			{
 				if (state->inline_opt->inline_type == OVPN_OPT_INLINE_TYPE_PLAIN)
 				{
+					json_object *json_data =
+						ovpn_parse_inline_blob_ref(state);
+
+					if (!json_data)
+					{
+						json_data = json_object_new_string(
+							data_buffer_get(&state->inline_data_buffer)
+						);
+					}
+
 					/* Add plain inline data to data array */
 					json_object_array_add(
 						state->json_inline_data_array,
-						json_object_new_string(
-							data_buffer_get(&state->inline_data_buffer)
-						)
+						json_data
 					);
 				}
 				else if (state->inline_opt->inline_type == OVPN_OPT_INLINE_TYPE_OPTIONS)
 				{
 					/* Restore JSON options object to global */
 					state->json_options = state->ovpn->json_options;
+					state->opts_seen = state->opts_seen_global;
 				}
 			}
 
@@ -565,7 +694,7 @@ int ovpn_parse_validate_opt_basic(
 	{
 		ovpn_status_msg(
 			state->ovpn, OVPN_MSG_TYPE_WARNING, state->line_n,
-			_("Option '%s' is deprecated "
+			N_("Option '%s' is deprecated "
 			  "and can be removed in future OpenVPN versions"),
 			opt->name
 		);
@@ -575,7 +704,7 @@ int ovpn_parse_validate_opt_basic(
 	{
 		ovpn_status_msg(
 			state->ovpn, OVPN_MSG_TYPE_WARNING, state->line_n,
-			_("Option '%s' can be used only in standalone mode"),
+			N_("Option '%s' can be used only in standalone mode"),
 			opt->name
 		);
 	}
@@ -584,7 +713,7 @@ int ovpn_parse_validate_opt_basic(
 	{
 		ovpn_status_msg(
 			state->ovpn, OVPN_MSG_TYPE_WARNING, state->line_n,
-			_("The '%s' option is specific for Windows"),
+			N_("The '%s' option is specific for Windows"),
 			opt->name
 		);
 	}
@@ -603,13 +732,19 @@ int ovpn_parse_validate_opt_arg(
 {
 	int i;
 	int valid = false;
+	int info_count = 0;
 
 	const ovpn_opt_arg_info_t *arg_info;
 
 	const char *arg_data = json_object_get_string(json_arg);
 
-	if ((opt->args.max == OVPN_OPT_ARGS_NOT_LIMITED) && (arg_idx >= opt->args.max))
-		arg_info = opt->args.info[opt->args.max - 1];
+	while (opt->args.info[info_count])
+		info_count++;
+
+	/* Arguments of options with not limited count of arguments
+	 * above the described ones are described by the last one */
+	if (arg_idx >= info_count)
+		arg_info = opt->args.info[info_count - 1];
 	else
 		arg_info = opt->args.info[arg_idx];
 
@@ -695,7 +830,7 @@ int ovpn_parse_validate_opt_arg(
 	{
 		ovpn_status_msg(
 			state->ovpn, OVPN_MSG_TYPE_ERROR, state->line_n,
-			_("Option '%s' has invalid argument #%d (%s) value '%s'"),
+			N_("Option '%s' has invalid argument #%d (%s) value '%s'"),
 			opt->name, arg_idx + 1, arg_info->name, arg_data
 		);
 	}
@@ -717,7 +852,7 @@ int ovpn_parse_validate_opt_args(
 	{
 		ovpn_status_msg(
 			state->ovpn, OVPN_MSG_TYPE_WARNING, state->line_n,
-			_("Too few arguments (%d). "
+			N_("Too few arguments (%d). "
 			  "The minimum number of arguments for the '%s' option is %d"),
 			args_count, opt->name, opt->args.min
 		);
@@ -727,7 +862,7 @@ int ovpn_parse_validate_opt_args(
 	{
 		ovpn_status_msg(
 			state->ovpn, OVPN_MSG_TYPE_WARNING, state->line_n,
-			_("Too many arguments (%d). "
+			N_("Too many arguments (%d). "
 			  "The maximum number of arguments for the '%s' option is %d"),
 			args_count, opt->name, opt->args.max
 		);
@@ -735,9 +870,15 @@ int ovpn_parse_validate_opt_args(
 
 	if (opt->args.info)
 	{
+		int info_count = 0;
+
+		while (opt->args.info[info_count])
+			info_count++;
+
 		for (arg_idx = 0; arg_idx < args_count; arg_idx++)
 		{
-			if (opt->args.info[arg_idx])
+			if ((arg_idx < info_count) ||
+			    ((opt->args.max == OVPN_OPT_ARGS_NOT_LIMITED) && info_count))
 			{
 				ovpn_parse_validate_opt_arg(
 					state, opt, arg_idx, json_object_array_get_idx(json_opt_args, arg_idx)
@@ -771,6 +912,154 @@ int ovpn_parse_validate_opt(
 
 /* ----------------------------------------------------------------------- */
 
+/**
+ * Options that are accepted only when pushed by server
+ * (not known as configuration file options)
+ */
+static const char *const ovpn_parse_push_only[] =
+{
+	"auth-token-user",
+	"key-derivation",
+	"peer-id",
+	"protocol-flags",
+	"tun-ipv6",
+	NULL
+};
+
+static int ovpn_parse_push_only_find(const char *name)
+{
+	int i;
+
+	for (i = 0; ovpn_parse_push_only[i]; i++)
+	{
+		if (!strcmp(ovpn_parse_push_only[i], name))
+			return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Parse option pushed by 'push' option
+ *
+ * Pushed option is tokenized in place in the line buffer reusing
+ * the line tokenizer state and is added to the 'push' option object:
+ * {
+ *     "args": [ "<pushed-option> <arg-1> ... <arg-N>" ],
+ *     "option": {
+ *         "name": "<pushed-option>",
+ *         "args": [ "<arg-1>", ..., "<arg-N>" ]
+ *     }
+ * }
+ *
+ * @param[in] state        Parsing state
+ * @param[in] token_state  Line tokenizer state
+ * @param[in] payload      Pushed option string (modified)
+ * @param[in] opt_obj      JSON object of the 'push' option
+ *
+ * Pushed option arguments are validated and options that can not be
+ * pushed are reported only if @ref OVPN_FLAG_CHECK_PUSH flag is set.
+ * Platform and standalone mode checks are not applied to pushed
+ * options as the server pushes options for clients of any platform.
+ */
+static int ovpn_parse_push(
+	ovpn_parse_state_t *state,
+	token_state_t *token_state,
+	char *payload,
+	json_object *opt_obj
+)
+{
+	const char *name;
+	const ovpn_opt_info_t *opt;
+	json_object *pushed_obj;
+	json_object *args_array;
+	int check = !!(state->ovpn->flags & OVPN_FLAG_CHECK_PUSH);
+	char *token = get_token(token_state, payload, " \t");
+
+	if (!token)
+		return 0;
+
+	name = token;
+	opt = ovpn_parse_opt_find(state, name, NULL);
+
+	if ((!opt || !(opt->flags & OVPN_OPT_FLAG_PUSHABLE)) &&
+	    !ovpn_parse_push_only_find(name))
+	{
+		if (check && (opt || !ovpn_parse_opt_unsupported(state, token)))
+		{
+			ovpn_status_msg(
+				state->ovpn, OVPN_MSG_TYPE_WARNING, state->line_n,
+				opt
+					? N_("Option '%s' can not be pushed")
+					: N_("Unknown pushed option '%s'"),
+				token
+			);
+		}
+
+		return 0;
+	}
+
+	pushed_obj = json_object_new_object();
+	if (!pushed_obj)
+		return -ENOMEM;
+
+	json_object_object_add(opt_obj, "option", pushed_obj);
+	json_object_object_add(pushed_obj, "name",
+		json_object_new_string(name));
+
+	args_array = json_object_new_array();
+	json_object_object_add(pushed_obj, "args", args_array);
+
+	while ((token = get_token(token_state, NULL, " \t")))
+		json_object_array_add(args_array, json_object_new_string(token));
+
+	/* Arguments of push-only options are not described */
+	if (!check || !opt || !(opt->flags & OVPN_OPT_FLAG_PUSHABLE))
+		return 0;
+
+	return ovpn_parse_validate_opt_args(state, opt, args_array);
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Mark option as seen in the current scope and warn if option
+ * that can not be specified several times is repeated
+ *
+ * @param[in] state  Parsing state
+ * @param[in] index  Option position in the options table
+ * @param[in] opt    Option information
+ */
+static void ovpn_parse_check_repeat(
+	ovpn_parse_state_t *state,
+	size_t index,
+	const ovpn_opt_info_t *opt
+)
+{
+	unsigned long *word = &state->opts_seen[index / OVPN_PARSE_SEEN_WORD_BITS];
+	unsigned long bit = 1ul << (index % OVPN_PARSE_SEEN_WORD_BITS);
+
+	if (!(*word & bit))
+	{
+		*word |= bit;
+		return;
+	}
+
+	if (opt->flags & OVPN_OPT_FLAG_MULTIPLE)
+		return;
+
+	ovpn_status_msg(
+		state->ovpn,
+		OVPN_MSG_TYPE_WARNING,
+		state->line_n,
+		N_("Option '%s' is specified more than once, "
+		   "only the last occurrence takes effect"),
+		opt->name
+	);
+}
+
+/* ----------------------------------------------------------------------- */
+
 static ovpn_line_parser_res_t ovpn_line_parser_option(
 	ovpn_parse_state_t *state,
 	char *line
@@ -782,26 +1071,49 @@ static ovpn_line_parser_res_t ovpn_line_parser_option(
 	if (token)
 	{
 		int args_count = 0;
+		char *first_arg = NULL;
 		json_object *opt_array;
 		json_object *args_array;
 		json_object *opt_obj;
 
-		const ovpn_opt_info_t *opt = ovpn_opt_find(
-			token, OVPN_OPT_FLAG_NORMAL, SIZE_MAX
-		);
+		ssize_t index;
+		const ovpn_opt_info_t *opt = ovpn_parse_opt_find(state, token, &index);
+
+		if (opt && !(opt->flags & OVPN_OPT_FLAG_NORMAL))
+			opt = NULL;
 
 		if (!opt)
+		{
+			if (!ovpn_parse_opt_unsupported(state, token))
+			{
+				ovpn_status_msg(
+					state->ovpn,
+					OVPN_MSG_TYPE_WARNING,
+					state->line_n,
+					N_("Unknown option '%s'"), token
+				);
+			}
+
+			return OVPN_LINE_PARSER_RES_PARSED;
+		}
+
+		/* Client config files allow only client instance options */
+		if ((state->ovpn->flags & OVPN_FLAG_CCD) &&
+		    !(opt->flags & OVPN_OPT_FLAG_CCD))
 		{
 			ovpn_status_msg(
 				state->ovpn,
 				OVPN_MSG_TYPE_WARNING,
 				state->line_n,
-				_("Unknown option '%s'"), token
+				N_("Option '%s' can not be used in client config file"),
+				opt->name
 			);
 
 			return OVPN_LINE_PARSER_RES_PARSED;
 		}
 
+		ovpn_parse_check_repeat(state, (size_t)index, opt);
+
 		if (!json_object_object_get_ex(
 			state->json_options,
 			opt->name,
@@ -827,7 +1139,8 @@ static ovpn_line_parser_res_t ovpn_line_parser_option(
 			token = get_token(&token_state, NULL, " \t");
 			if (token)
 			{
-				args_count++;
+				if (!args_count++)
+					first_arg = token;
 
 				json_object_array_add(
 					args_array,
@@ -842,6 +1155,28 @@ static ovpn_line_parser_res_t ovpn_line_parser_option(
 		if (ovpn_parse_validate_opt(state, opt, opt_obj))
 			return OVPN_LINE_PARSER_RES_ERROR;
 
+		/* Included file is parsed in place of the 'config' option */
+		if ((state->ovpn->flags & OVPN_FLAG_FOLLOW_INCLUDES) &&
+		    !strcmp(opt->name, "config") && (args_count == 1))
+		{
+			int ret = ovpn_include(state->ovpn, state->json_options,
+				state->json_inlines, first_arg, state->line_n);
+
+			if (ret == -1)
+				return OVPN_LINE_PARSER_RES_ERROR;
+			else if (ret == -ECANCELED)
+				return OVPN_LINE_PARSER_RES_ABORT;
+			else if (ret)
+				return OVPN_LINE_PARSER_RES_SYS_ERROR;
+		}
+
+		/* Pushed option is validated as a nested option */
+		if (!strcmp(opt->name, "push") && (args_count == 1))
+		{
+			if (ovpn_parse_push(state, &token_state, first_arg, opt_obj))
+				return OVPN_LINE_PARSER_RES_ERROR;
+		}
+
 		return OVPN_LINE_PARSER_RES_PARSED;
 	}
 
@@ -877,10 +1212,13 @@ static int ovpn_line_parse(
 				return 0;
 
 			case OVPN_LINE_PARSER_RES_ERROR:
-				/* fallthrough */
+				return -1;
 
 			case OVPN_LINE_PARSER_RES_SYS_ERROR:
-				return -1;
+				return -ENOMEM;
+
+			case OVPN_LINE_PARSER_RES_ABORT:
+				return -ECANCELED;
 
 			case OVPN_LINE_PARSER_RES_NEXT:
 				/* fallthrough */
@@ -896,17 +1234,156 @@ static int ovpn_line_parse(
 
 /* ----------------------------------------------------------------------- */
 
+/**
+ * Abort parsing due to exhausted budget
+ *
+ * @param[in] state   Parsing state
+ * @param[in] reason  Abort reason (exhausted budget name)
+ *
+ * @return -ECANCELED
+ */
+static int ovpn_parse_abort(ovpn_parse_state_t *state, const char *reason)
+{
+	state->ovpn->abort_reason = reason;
+	state->ovpn->abort_line = state->line_n;
+	return -ECANCELED;
+}
+
+/**
+ * Check input budgets (before the line is parsed)
+ */
+static int ovpn_parse_check_input_limits(ovpn_parse_state_t *state)
+{
+	const ovpn_t *ovpn = state->ovpn;
+
+	if (ovpn->limits.max_lines && (ovpn->lines > ovpn->limits.max_lines))
+		return ovpn_parse_abort(state, "lines");
+
+	if (ovpn->limits.max_bytes && (ovpn->bytes > ovpn->limits.max_bytes))
+		return ovpn_parse_abort(state, "bytes");
+
+	return 0;
+}
+
+/**
+ * Check errors and warnings budgets (after the line is parsed)
+ */
+static int ovpn_parse_check_status_limits(ovpn_parse_state_t *state)
+{
+	const ovpn_t *ovpn = state->ovpn;
+
+	if (ovpn->limits.max_errors && (ovpn->errors >= ovpn->limits.max_errors))
+		return ovpn_parse_abort(state, "errors");
+
+	if (ovpn->limits.max_warnings && (ovpn->warnings >= ovpn->limits.max_warnings))
+		return ovpn_parse_abort(state, "warnings");
+
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+int ovpn_line_reader_init(ovpn_line_reader_t *reader)
+{
+	reader->size = OVPN_PARSE_BUFFER_SIZE;
+	reader->buffer = malloc(reader->size);
+
+	if (!reader->buffer)
+	{
+		fprintf(stderr,
+			"Failed to allocate memory for line buffer\n");
+
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+void ovpn_line_reader_free(ovpn_line_reader_t *reader)
+{
+	free(reader->buffer);
+	reader->buffer = NULL;
+}
+
+ssize_t ovpn_line_read(
+	ovpn_line_reader_t *reader, FILE *input, unsigned int line_n)
+{
+	size_t buffer_offset = 0;
+	size_t line_len = 0;
+
+	while (1)
+	{
+		char *new_buffer;
+		char *line = fgets(reader->buffer + buffer_offset,
+			(int)(reader->size - buffer_offset), input);
+
+		if (!line)
+			break;
+
+		line_len += strnlen(line, reader->size);
+
+		if ((reader->buffer[line_len - 1] == '\r') ||
+		    (reader->buffer[line_len - 1] == '\n'))
+			break;
+
+		/* Increase line buffer size */
+		if ((reader->size + OVPN_PARSE_BUFFER_SIZE) > OVPN_PARSE_MAX_BUFFER_SIZE)
+		{
+			fprintf(stderr,
+				"line %u: Line buffer size limit (%zu) reached\n",
+				line_n,
+				(size_t)OVPN_PARSE_MAX_BUFFER_SIZE
+			);
+
+			return -EINVAL;
+		}
+
+		new_buffer = realloc(reader->buffer,
+			reader->size + OVPN_PARSE_BUFFER_SIZE);
+
+		if (!new_buffer)
+		{
+			fprintf(stderr,
+				"line %u: Failed to reallocate memory for line buffer (%zu -> %zu)\n",
+				line_n,
+				reader->size,
+				reader->size + OVPN_PARSE_BUFFER_SIZE
+			);
+
+			return -ENOMEM;
+		}
+
+		reader->buffer = new_buffer;
+		reader->size += OVPN_PARSE_BUFFER_SIZE;
+		buffer_offset = line_len;
+	}
+
+	if (!line_len && ferror(input)) /* EOF */
+	{
+		fprintf(stderr,
+			"line %u: Failed to read input data\n",
+			line_n);
+
+		return -EIO;
+	}
+
+	return (ssize_t)line_len;
+}
+
+/* ----------------------------------------------------------------------- */
+
 int ovpn_parse(ovpn_t *ovpn, FILE *input)
 {
 	int ret;
 
-	char *buffer = NULL;
-	size_t buffer_size = OVPN_PARSE_BUFFER_SIZE;
+	char *buffer;
+	ovpn_line_reader_t reader;
 
 	ovpn_parse_state_t state = {
 		.ovpn = ovpn,
 		.json_inlines = ovpn->json_inlines,
 		.json_options = ovpn->json_options,
+		.opts_index = ovpn_opt_index_get(ovpn->version),
 	};
 
 	ret = data_buffer_init(&state.inline_data_buffer);
@@ -918,76 +1395,49 @@ int ovpn_parse(ovpn_t *ovpn, FILE *input)
 		return ret;
 	}
 
-	buffer = malloc(buffer_size);
-	if (!buffer)
-	{
-		fprintf(stderr,
-			"Failed to allocate memory for line buffer\n");
+	/* Global scope and connection block bitmaps */
+	state.opts_seen_words = (ovpn_opt_count() +
+		OVPN_PARSE_SEEN_WORD_BITS - 1) / OVPN_PARSE_SEEN_WORD_BITS;
+
+	state.opts_seen_global = calloc(
+		state.opts_seen_words * 2, sizeof(unsigned long));
 
+	if (!state.opts_seen_global)
+	{
 		data_buffer_free(&state.inline_data_buffer);
 		return -ENOMEM;
 	}
 
-	while (1)
+	state.opts_seen = state.opts_seen_global;
+
+	ret = ovpn_line_reader_init(&reader);
+	if (ret)
 	{
-		char *line = NULL;
+		free(state.opts_seen_global);
+		data_buffer_free(&state.inline_data_buffer);
+		return ret;
+	}
 
-		size_t buffer_offset = 0;
-		size_t line_len = 0;
+	while (1)
+	{
+		char *line;
+		ssize_t line_len;
 
 		state.line_n++;
 
-		while (1)
+		line_len = ovpn_line_read(&reader, input, state.line_n);
+		if (line_len <= 0) /* EOF or error */
 		{
-			char *new_buffer;
-
-			line = fgets(buffer + buffer_offset,
-				(int)(buffer_size - buffer_offset), input);
-
-			if (!line)
-				break;
-
-			line_len += strnlen(line, buffer_size);
-
-			if ((buffer[line_len - 1] == '\r') ||
-			    (buffer[line_len - 1] == '\n'))
-				break;
-
-			/* Increase line buffer size */
-			buffer_size += OVPN_PARSE_BUFFER_SIZE;
-			if (buffer_size > OVPN_PARSE_MAX_BUFFER_SIZE)
-			{
-				fprintf(stderr,
-					"line %u: Line buffer size limit (%zu) reached\n",
-					state.line_n,
-					(size_t)OVPN_PARSE_MAX_BUFFER_SIZE
-				);
-
-				free(buffer);
-				data_buffer_free(&state.inline_data_buffer);
-				return -EINVAL;
-			}
-
-			new_buffer = realloc(buffer, buffer_size);
-			if (!new_buffer)
-			{
-				fprintf(stderr,
-					"line %u: Failed to reallocate memory for line buffer (%zu -> %zu)\n",
-					state.line_n,
-					buffer_size - OVPN_PARSE_BUFFER_SIZE,
-					buffer_size
-				);
-
-				free(buffer);
-				data_buffer_free(&state.inline_data_buffer);
-				return -ENOMEM;
-			}
-
-			buffer = new_buffer;
-			buffer_offset = line_len;
+			ret = (int)line_len;
+			break;
 		}
 
-		if (!line_len) /* EOF */
+		buffer = reader.buffer;
+		ovpn->lines++;
+		ovpn->bytes += (size_t)line_len;
+
+		ret = ovpn_parse_check_input_limits(&state);
+		if (ret)
 			break;
 
 		/* Do not trim spaces and comments in inlines */
@@ -1015,9 +1465,20 @@ int ovpn_parse(ovpn_t *ovpn, FILE *input)
 		ret = ovpn_line_parse(&state, line);
 		if (ret)
 			break;
+
+		ret = ovpn_parse_check_status_limits(&state);
+		if (ret)
+			break;
 	}
 
-	free(buffer);
+	if (!ret && ovpn->rules)
+		ret = ovpn_rules_check(ovpn->rules, ovpn);
+
+	if (!ret && (ovpn->flags & OVPN_FLAG_FLATTEN_CONNECTIONS))
+		ret = ovpn_flatten_connections(ovpn);
+
+	ovpn_line_reader_free(&reader);
+	free(state.opts_seen_global);
 	data_buffer_free(&state.inline_data_buffer);
 	return ret;
 }
@@ -0,0 +1,704 @@
+/*
+ * OpenVPN Configuration Files Converter
+ * Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Cross-option semantic rules
+ *
+ * Rules are written one per line:
+ *
+ *     <error|warning> [when <atom>...] [unless <atom>...]
+ *         <require|forbid> <atom>... : <message>
+ *
+ * Atom is an option (inline block) name that is true if the option
+ * is present in the configuration, or `<option>=<value>` (`<value>*`
+ * for a prefix) that is true if the first argument of the last option
+ * occurrence matches the value. Rule is violated if all 'when' atoms
+ * are true, no 'unless' atom is true and no 'require' atom is true
+ * (some 'forbid' atom is true).
+ *
+ * Each rule is compiled into bitmasks over the options table positions
+ * followed by the value atoms, so all rules are evaluated against the
+ * bitmap of present options with a few word operations per rule.
+ */
+
+#include <ctype.h> /* isspace */
+#include <ovpn.h>
+
+/* ----------------------------------------------------------------------- */
+
+/** Maximum count of distinct value atoms in rules */
+#define OVPN_RULES_MAX_VALUES  64
+
+/** Count of bits in the bitmap word */
+#define OVPN_RULES_WORD_BITS  (sizeof(unsigned long) * 8)
+
+/** Masks of the rule */
+enum
+{
+	OVPN_RULE_MASK_WHEN,
+	OVPN_RULE_MASK_UNLESS,
+	OVPN_RULE_MASK_REQUIRE,
+	OVPN_RULE_MASK_FORBID,
+	OVPN_RULE_MASKS
+};
+
+/**
+ * @brief Value atom (`<option>=<value>`)
+ */
+typedef struct
+{
+	/** Option position in the options table */
+	size_t index;
+
+	/** Value (prefix) */
+	char *value;
+
+	/** Value is a prefix */
+	int is_prefix;
+
+} ovpn_rules_value_t;
+
+/**
+ * @brief Compiled rule
+ */
+typedef struct
+{
+	/** Message type */
+	ovpn_msg_type_t type;
+
+	/** Rule has 'require' atoms ('forbid' atoms otherwise) */
+	int is_require;
+
+	/** Message is translated (built-in rules) */
+	int translate;
+
+	/** Bit of the first 'when' atom (SIZE_MAX - no 'when' atoms),
+	 *  checked before the masks to skip not applicable rules */
+	size_t key;
+
+	/** Message text */
+	char *message;
+
+} ovpn_rule_t;
+
+struct ovpn_rules
+{
+	/** Rules */
+	ovpn_rule_t *rules;
+
+	/** Count of rules */
+	size_t count;
+
+	/** Allocated count of rules */
+	size_t size;
+
+	/** Rule masks (OVPN_RULE_MASKS masks of @ref words words per rule) */
+	unsigned long *masks;
+
+	/** Count of words in each mask */
+	size_t words;
+
+	/** Value atoms (bits follow the options table positions) */
+	ovpn_rules_value_t values[OVPN_RULES_MAX_VALUES];
+
+	/** Count of value atoms */
+	size_t values_count;
+};
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * @brief Built-in rule
+ */
+typedef struct
+{
+	const char *rule;
+	const char *message;
+
+} ovpn_rules_builtin_t;
+
+/**
+ * Built-in rules (used if rules file is not specified)
+ */
+static const ovpn_rules_builtin_t ovpn_rules_builtin[] =
+{
+	/* Mode */
+	{
+		"error when client forbid server server-bridge tls-server mode=server",
+		N_("Client and server mode options are used together")
+	},
+	{
+		"error when tls-client forbid tls-server",
+		N_("Options 'tls-client' and 'tls-server' are used together")
+	},
+	{
+		"error when server forbid server-bridge",
+		N_("Options 'server' and 'server-bridge' are used together")
+	},
+	{
+		"warning when push require server server-bridge mode=server",
+		N_("Option 'push' is used not in server mode")
+	},
+	{
+		"warning when client-to-client require server server-bridge mode=server",
+		N_("Option 'client-to-client' is used not in server mode")
+	},
+
+	/* Certificates and keys */
+	{
+		"warning when client unless secret require ca capath pkcs12",
+		N_("Certificate authority ('ca', 'capath' or 'pkcs12') is not specified")
+	},
+	{
+		"warning when tls-client unless secret require ca capath pkcs12",
+		N_("Certificate authority ('ca', 'capath' or 'pkcs12') is not specified")
+	},
+	{
+		"warning when tls-server unless secret require ca capath pkcs12",
+		N_("Certificate authority ('ca', 'capath' or 'pkcs12') is not specified")
+	},
+	{
+		"warning when server unless secret require ca capath pkcs12",
+		N_("Certificate authority ('ca', 'capath' or 'pkcs12') is not specified")
+	},
+	{
+		"warning when server require cert pkcs12 pkcs11-id cryptoapicert "
+		"management-external-cert",
+		N_("Server certificate ('cert' or 'pkcs12') is not specified")
+	},
+	{
+		"warning when server unless pkcs12 require dh",
+		N_("Diffie-Hellman parameters ('dh') are not specified")
+	},
+	{
+		"warning when cert require key pkcs11-id cryptoapicert "
+		"management-external-key",
+		N_("Certificate ('cert') is specified without private key ('key')")
+	},
+	{
+		"warning when key require cert",
+		N_("Private key ('key') is specified without certificate ('cert')")
+	},
+	{
+		"error when tls-auth forbid tls-crypt",
+		N_("Options 'tls-auth' and 'tls-crypt' are used together")
+	},
+	{
+		"warning when key-direction require tls-auth secret",
+		N_("Option 'key-direction' is used without 'tls-auth' or 'secret'")
+	},
+
+	/* Client */
+	{
+		"warning when client require remote connection",
+		N_("Remote server ('remote' or <connection> blocks) is not specified")
+	},
+
+	/* Device and addresses */
+	{
+		"error when server-bridge unless dev-type forbid dev=tun*",
+		N_("Option 'server-bridge' requires TAP device")
+	},
+	{
+		"error when server-bridge forbid dev-type=tun",
+		N_("Option 'server-bridge' requires TAP device")
+	},
+	{
+		"warning when topology unless dev-type forbid dev=tap*",
+		N_("Option 'topology' has no effect for TAP device")
+	},
+	{
+		"warning when topology forbid dev-type=tap",
+		N_("Option 'topology' has no effect for TAP device")
+	},
+	{
+		"error when ifconfig-ipv6-pool require ifconfig-ipv6 server-ipv6",
+		N_("Option 'ifconfig-ipv6-pool' is used without 'ifconfig-ipv6'")
+	},
+
+	/* Server */
+	{
+		"warning when ccd-exclusive require client-config-dir",
+		N_("Option 'ccd-exclusive' is used without 'client-config-dir'")
+	},
+	{
+		"warning when username-as-common-name require auth-user-pass-verify "
+		"plugin management-client-auth",
+		N_("Option 'username-as-common-name' is used without "
+		   "username/password authentication")
+	},
+};
+
+/* ----------------------------------------------------------------------- */
+
+static unsigned long *ovpn_rule_masks(const ovpn_rules_t *rules, size_t i)
+{
+	return &rules->masks[i * OVPN_RULE_MASKS * rules->words];
+}
+
+static void ovpn_rules_set_bit(unsigned long *mask, size_t bit)
+{
+	mask[bit / OVPN_RULES_WORD_BITS] |= 1ul << (bit % OVPN_RULES_WORD_BITS);
+}
+
+static int ovpn_rules_test_bit(const unsigned long *mask, size_t bit)
+{
+	return !!(mask[bit / OVPN_RULES_WORD_BITS] &
+		(1ul << (bit % OVPN_RULES_WORD_BITS)));
+}
+
+/**
+ * Get bit position of the atom (value atoms are added as needed)
+ *
+ * @return Bit position
+ * @return -ENOENT if option is unknown
+ * @return -ENOSPC if there are too many value atoms
+ * @return -ENOMEM on memory allocation failure
+ */
+static ssize_t ovpn_rules_atom(ovpn_rules_t *rules, char *atom)
+{
+	size_t i;
+	size_t len;
+	ssize_t index;
+	int is_prefix = 0;
+	ovpn_rules_value_t *value;
+	char *p = strchr(atom, '=');
+
+	if (p)
+		*(p++) = '\0';
+
+	index = ovpn_opt_index(atom);
+	if (index < 0)
+		return -ENOENT;
+
+	if (!p)
+		return index;
+
+	len = strlen(p);
+	if (len && (p[len - 1] == '*'))
+	{
+		p[--len] = '\0';
+		is_prefix = 1;
+	}
+
+	for (i = 0; i < rules->values_count; i++)
+	{
+		value = &rules->values[i];
+
+		if ((value->index == (size_t)index) &&
+		    (value->is_prefix == is_prefix) &&
+		    !strcmp(value->value, p))
+			return (ssize_t)(ovpn_opt_count() + i);
+	}
+
+	if (rules->values_count >= OVPN_RULES_MAX_VALUES)
+		return -ENOSPC;
+
+	value = &rules->values[rules->values_count];
+
+	value->value = strdup(p);
+	if (!value->value)
+		return -ENOMEM;
+
+	value->index = (size_t)index;
+	value->is_prefix = is_prefix;
+	return (ssize_t)(ovpn_opt_count() + rules->values_count++);
+}
+
+/**
+ * Compile rule text and add it to the rules
+ *
+ * @param[in] rules      Rules
+ * @param[in] text       Rule text without message (modified)
+ * @param[in] message    Message text
+ * @param[in] translate  Message is translated
+ * @param[in] name       Rules source name (for error messages)
+ * @param[in] line_n     Line number (for error messages)
+ */
+static int ovpn_rules_compile(
+	ovpn_rules_t *rules,
+	char *text,
+	const char *message,
+	int translate,
+	const char *name,
+	unsigned int line_n
+)
+{
+	int mask_n = -1;
+	char *saveptr;
+	char *token;
+	ovpn_rule_t *rule;
+	unsigned long *masks;
+	size_t bits[OVPN_RULE_MASKS] = { 0 };
+
+	if (rules->count == rules->size)
+	{
+		size_t size = rules->size ? (rules->size * 2) : 32;
+
+		rule = realloc(rules->rules, size * sizeof(ovpn_rule_t));
+		if (!rule)
+			return -ENOMEM;
+
+		rules->rules = rule;
+
+		masks = realloc(rules->masks,
+			size * OVPN_RULE_MASKS * rules->words * sizeof(unsigned long));
+		if (!masks)
+			return -ENOMEM;
+
+		rules->masks = masks;
+		rules->size = size;
+	}
+
+	rule = &rules->rules[rules->count];
+	rule->key = SIZE_MAX;
+
+	masks = ovpn_rule_masks(rules, rules->count);
+	memset(masks, 0, OVPN_RULE_MASKS * rules->words * sizeof(unsigned long));
+
+	token = strtok_r(text, " \t", &saveptr);
+
+	if (token && !strcmp(token, "error"))
+		rule->type = OVPN_MSG_TYPE_ERROR;
+	else if (token && !strcmp(token, "warning"))
+		rule->type = OVPN_MSG_TYPE_WARNING;
+	else
+	{
+		fprintf(stderr,
+			"%s:%u: Rule must start with 'error' or 'warning'\n",
+			name, line_n);
+
+		return -EINVAL;
+	}
+
+	while ((token = strtok_r(NULL, " \t", &saveptr)))
+	{
+		ssize_t bit;
+
+		if (!strcmp(token, "when") && (mask_n < OVPN_RULE_MASK_WHEN))
+			mask_n = OVPN_RULE_MASK_WHEN;
+		else if (!strcmp(token, "unless") && (mask_n < OVPN_RULE_MASK_UNLESS))
+			mask_n = OVPN_RULE_MASK_UNLESS;
+		else if (!strcmp(token, "require") && (mask_n < OVPN_RULE_MASK_REQUIRE))
+			mask_n = OVPN_RULE_MASK_REQUIRE;
+		else if (!strcmp(token, "forbid") && (mask_n < OVPN_RULE_MASK_REQUIRE))
+			mask_n = OVPN_RULE_MASK_FORBID;
+		else if (mask_n < 0)
+		{
+			fprintf(stderr,
+				"%s:%u: Unexpected '%s' in rule\n",
+				name, line_n, token);
+
+			return -EINVAL;
+		}
+		else
+		{
+			bit = ovpn_rules_atom(rules, token);
+			if (bit < 0)
+			{
+				if (bit == -ENOENT)
+					fprintf(stderr,
+						"%s:%u: Unknown option '%s' in rule\n",
+						name, line_n, token);
+				else if (bit == -ENOSPC)
+					fprintf(stderr,
+						"%s:%u: Too many option values in rules (maximum %u)\n",
+						name, line_n, OVPN_RULES_MAX_VALUES);
+
+				return (int)bit;
+			}
+
+			if ((mask_n == OVPN_RULE_MASK_WHEN) && (rule->key == SIZE_MAX))
+				rule->key = (size_t)bit;
+
+			ovpn_rules_set_bit(&masks[mask_n * rules->words], (size_t)bit);
+			bits[mask_n]++;
+		}
+	}
+
+	if (!bits[OVPN_RULE_MASK_REQUIRE] && !bits[OVPN_RULE_MASK_FORBID])
+	{
+		fprintf(stderr,
+			"%s:%u: Rule has no 'require' or 'forbid' options\n",
+			name, line_n);
+
+		return -EINVAL;
+	}
+
+	rule->message = strdup(message);
+	if (!rule->message)
+		return -ENOMEM;
+
+	rule->is_require = (bits[OVPN_RULE_MASK_REQUIRE] != 0);
+	rule->translate = translate;
+
+	rules->count++;
+	return 0;
+}
+
+/**
+ * Compile rules from stream
+ */
+static int ovpn_rules_read(ovpn_rules_t *rules, FILE *stream, const char *name)
+{
+	int ret = 0;
+	unsigned int line_n = 0;
+	ovpn_line_reader_t reader;
+
+	ret = ovpn_line_reader_init(&reader);
+	if (ret)
+		return ret;
+
+	while (!ret)
+	{
+		char *line;
+		char *message;
+		ssize_t line_len;
+
+		line_n++;
+
+		line_len = ovpn_line_read(&reader, stream, line_n);
+		if (line_len <= 0) /* EOF or error */
+		{
+			ret = (int)line_len;
+			break;
+		}
+
+		line = reader.buffer;
+
+		/* Trim ending spaces */
+		while (line_len && isspace(line[line_len - 1]))
+			line[--line_len] = '\0';
+
+		/* Trim leading spaces */
+		while (isspace(*line))
+			line++;
+
+		/* Skip empty lines and comments */
+		if (!*line || (*line == '#') || (*line == ';'))
+			continue;
+
+		message = strstr(line, " : ");
+		if (!message)
+		{
+			fprintf(stderr,
+				"%s:%u: Rule has no message\n",
+				name, line_n);
+
+			ret = -EINVAL;
+			break;
+		}
+
+		*message = '\0';
+		message += 3;
+
+		while (isspace(*message))
+			message++;
+
+		ret = ovpn_rules_compile(rules, line, message, 0, name, line_n);
+	}
+
+	ovpn_line_reader_free(&reader);
+	return ret;
+}
+
+/**
+ * Compile built-in rules
+ */
+static int ovpn_rules_read_builtin(ovpn_rules_t *rules)
+{
+	size_t i;
+	char text[256];
+
+	for (i = 0; i < sizeof(ovpn_rules_builtin) / sizeof(ovpn_rules_builtin[0]); i++)
+	{
+		int ret;
+
+		snprintf(text, sizeof(text), "%s", ovpn_rules_builtin[i].rule);
+
+		ret = ovpn_rules_compile(rules, text,
+			ovpn_rules_builtin[i].message, 1, "built-in", (unsigned int)i + 1);
+
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+ovpn_rules_t *ovpn_rules_new(FILE *stream, const char *name)
+{
+	int ret;
+	ovpn_rules_t *rules = calloc(1, sizeof(ovpn_rules_t));
+
+	if (!rules)
+		return NULL;
+
+	rules->words = (ovpn_opt_count() + OVPN_RULES_MAX_VALUES +
+		OVPN_RULES_WORD_BITS - 1) / OVPN_RULES_WORD_BITS;
+
+	if (stream)
+		ret = ovpn_rules_read(rules, stream, name);
+	else
+		ret = ovpn_rules_read_builtin(rules);
+
+	if (ret)
+	{
+		ovpn_rules_delete(rules);
+		return NULL;
+	}
+
+	return rules;
+}
+
+void ovpn_rules_delete(ovpn_rules_t *rules)
+{
+	size_t i;
+
+	if (!rules)
+		return;
+
+	for (i = 0; i < rules->count; i++)
+		free(rules->rules[i].message);
+
+	for (i = 0; i < rules->values_count; i++)
+		free(rules->values[i].value);
+
+	free(rules->rules);
+	free(rules->masks);
+	free(rules);
+}
+
+size_t ovpn_rules_count(const ovpn_rules_t *rules)
+{
+	return rules->count;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Check value atom against the last occurrence of the option
+ */
+static int ovpn_rules_value_match(
+	const ovpn_rules_value_t *value, json_object *json_options)
+{
+	size_t count;
+	const char *arg;
+	json_object *occurrences;
+	json_object *args;
+
+	if (!json_object_object_get_ex(json_options,
+			ovpn_opt_get(value->index)->name, &occurrences) ||
+	    !json_object_is_type(occurrences, json_type_array))
+		return 0;
+
+	count = json_object_array_length(occurrences);
+	if (!count)
+		return 0;
+
+	if (!json_object_object_get_ex(
+			json_object_array_get_idx(occurrences, count - 1), "args", &args))
+		return 0;
+
+	arg = json_object_get_string(json_object_array_get_idx(args, 0));
+	if (!arg)
+		return 0;
+
+	if (value->is_prefix)
+		return !strncmp(arg, value->value, strlen(value->value));
+
+	return !strcmp(arg, value->value);
+}
+
+/**
+ * Mark options (inline blocks) of the object in the bitmap
+ */
+static void ovpn_rules_mark(unsigned long *present, json_object *obj)
+{
+	json_object_object_foreach(obj, name, value)
+	{
+		ssize_t index = ovpn_opt_index(name);
+		(void)value;
+
+		if (index >= 0)
+			ovpn_rules_set_bit(present, (size_t)index);
+	}
+}
+
+int ovpn_rules_check(const ovpn_rules_t *rules, ovpn_t *ovpn)
+{
+	size_t i;
+	size_t w;
+	unsigned long *present;
+
+	if (!rules->count)
+		return 0;
+
+	present = calloc(rules->words, sizeof(unsigned long));
+	if (!present)
+		return -ENOMEM;
+
+	ovpn_rules_mark(present, ovpn->json_options);
+	ovpn_rules_mark(present, ovpn->json_inlines);
+
+	for (i = 0; i < rules->values_count; i++)
+	{
+		if (ovpn_rules_value_match(&rules->values[i], ovpn->json_options))
+			ovpn_rules_set_bit(present, ovpn_opt_count() + i);
+	}
+
+	for (i = 0; i < rules->count; i++)
+	{
+		int ret;
+		const ovpn_rule_t *rule = &rules->rules[i];
+		const unsigned long *when = ovpn_rule_masks(rules, i);
+		const unsigned long *unless = when + rules->words;
+		const unsigned long *require = unless + rules->words;
+		const unsigned long *forbid = require + rules->words;
+		unsigned long missing = 0;
+		unsigned long excepted = 0;
+		unsigned long required = 0;
+		unsigned long forbidden = 0;
+
+		/* Most rules are not applicable */
+		if ((rule->key != SIZE_MAX) && !ovpn_rules_test_bit(present, rule->key))
+			continue;
+
+		for (w = 0; w < rules->words; w++)
+		{
+			missing |= when[w] & ~present[w];
+			excepted |= unless[w] & present[w];
+			required |= require[w] & present[w];
+			forbidden |= forbid[w] & present[w];
+		}
+
+		if (missing || excepted)
+			continue;
+
+		if (rule->is_require ? required : !forbidden)
+			continue;
+
+		ret = ovpn_status_msg(ovpn, rule->type, 0, "%s",
+			rule->translate ? _(rule->message) : rule->message);
+
+		if (ret)
+		{
+			free(present);
+			return ret;
+		}
+	}
+
+	free(present);
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
@@ -0,0 +1,1272 @@
+/*
+ * OpenVPN Configuration Files Converter
+ * Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Binary options schema files
+ *
+ * Text options specification has a line for each option followed
+ * by lines for its arguments:
+ *
+ *     option <name> <min> <max|*> [<flag>...] [inline=<type>]
+ *         [since=<version>] [removed=<version>]
+ *     arg <name> <type>[|<type>...] [optional] [range=<min>..<max>]
+ *         [values=<value>[|<value>...]]
+ *
+ * Binary schema layout (all integers are little-endian 32-bit):
+ *
+ *     header:    "OVPNSCH1", then count and offset of each section
+ *                (options, arguments, types, values, hash, strings)
+ *     options:   36 bytes each: name offset, flags, inline type,
+ *                since, removed, min and max count of arguments,
+ *                first argument, count of arguments
+ *     arguments: 32 bytes each: name offset, optional, range min,
+ *                range max, first type, count of types, first value,
+ *                count of values
+ *     types:     argument types
+ *     values:    string offsets of argument listvalues
+ *     hash:      open addressing table of option numbers plus one
+ *                (0 - empty slot) by FNV-1a hash of option name
+ *     strings:   null-terminated names and values
+ *
+ * Loading takes one mapping and one allocation for all option
+ * descriptors. Names and values point into the mapped file and
+ * options are looked up in the prebuilt hash table.
+ */
+
+#include <ctype.h> /* isspace */
+#include <fcntl.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <ovpn-schema.h>
+
+/* ----------------------------------------------------------------------- */
+
+/** Schema file magic */
+#define OVPN_SCHEMA_MAGIC  "OVPNSCH1"
+
+/** Schema header size */
+#define OVPN_SCHEMA_HEADER_SIZE  56u
+
+/** Schema option entry size */
+#define OVPN_SCHEMA_OPTION_SIZE  36u
+
+/** Schema argument entry size */
+#define OVPN_SCHEMA_ARG_SIZE  32u
+
+/** Size of argument information without listvalues */
+#define OVPN_SCHEMA_ARG_INFO_SIZE  offsetof(ovpn_opt_arg_info_t, listvalues)
+
+/** Schema sections */
+enum
+{
+	OVPN_SCHEMA_OPTIONS,
+	OVPN_SCHEMA_ARGS,
+	OVPN_SCHEMA_TYPES,
+	OVPN_SCHEMA_VALUES,
+	OVPN_SCHEMA_HASH,
+	OVPN_SCHEMA_STRINGS,
+	OVPN_SCHEMA_SECTIONS
+};
+
+/** Sizes of the items of the sections */
+static const size_t ovpn_schema_item_size[OVPN_SCHEMA_SECTIONS] =
+{
+	[OVPN_SCHEMA_OPTIONS] = OVPN_SCHEMA_OPTION_SIZE,
+	[OVPN_SCHEMA_ARGS]    = OVPN_SCHEMA_ARG_SIZE,
+	[OVPN_SCHEMA_TYPES]   = 4u,
+	[OVPN_SCHEMA_VALUES]  = 4u,
+	[OVPN_SCHEMA_HASH]    = 4u,
+	[OVPN_SCHEMA_STRINGS] = 1u,
+};
+
+/**
+ * @brief Option flag name
+ */
+typedef struct
+{
+	const char *name;
+	unsigned int flag;
+
+} ovpn_schema_flag_t;
+
+static const ovpn_schema_flag_t ovpn_schema_flags[] =
+{
+	{ "multiple",   OVPN_OPT_FLAG_MULTIPLE   },
+	{ "connection", OVPN_OPT_FLAG_CONNECTION },
+	{ "deprecated", OVPN_OPT_FLAG_DEPRECATED },
+	{ "windows",    OVPN_OPT_FLAG_WINDOWS    },
+	{ "ipv6",       OVPN_OPT_FLAG_IPV6       },
+	{ "inline",     OVPN_OPT_FLAG_INLINE     },
+	{ "debug",      OVPN_OPT_FLAG_DEBUG      },
+	{ "standalone", OVPN_OPT_FLAG_STANDALONE },
+	{ "pushable",   OVPN_OPT_FLAG_PUSHABLE   },
+	{ "normal",     OVPN_OPT_FLAG_NORMAL     },
+	{ "ccd",        OVPN_OPT_FLAG_CCD        },
+};
+
+/** Last valid argument type */
+#define OVPN_SCHEMA_ARG_TYPE_MAX  OVPN_OPT_ARG_TYPE_MACADDRESS
+
+static const char *ovpn_schema_arg_types[OVPN_SCHEMA_ARG_TYPE_MAX + 1] =
+{
+	[OVPN_OPT_ARG_TYPE_LISTVALUE]     = "listvalue",
+	[OVPN_OPT_ARG_TYPE_ADDRESS]       = "address",
+	[OVPN_OPT_ARG_TYPE_PORT]          = "port",
+	[OVPN_OPT_ARG_TYPE_NUMBER]        = "number",
+	[OVPN_OPT_ARG_TYPE_UNUMBER]       = "unumber",
+	[OVPN_OPT_ARG_TYPE_INTERFACE]     = "interface",
+	[OVPN_OPT_ARG_TYPE_FILEPATH]      = "filepath",
+	[OVPN_OPT_ARG_TYPE_STRING]        = "string",
+	[OVPN_OPT_ARG_TYPE_COMMAND]       = "command",
+	[OVPN_OPT_ARG_TYPE_DIR]           = "dir",
+	[OVPN_OPT_ARG_TYPE_NETWORK]       = "network",
+	[OVPN_OPT_ARG_TYPE_NETMASK]       = "netmask",
+	[OVPN_OPT_ARG_TYPE_TUNTAP_DEVICE] = "tuntap-device",
+	[OVPN_OPT_ARG_TYPE_LIST]          = "list",
+	[OVPN_OPT_ARG_TYPE_IPV6ADDR]      = "ipv6addr",
+	[OVPN_OPT_ARG_TYPE_IPADDR]        = "ipaddr",
+	[OVPN_OPT_ARG_TYPE_MACADDRESS]    = "macaddress",
+};
+
+/**
+ * @brief Section of the schema being compiled
+ */
+typedef struct
+{
+	uint8_t *data;
+	size_t size;
+	size_t alloc;
+
+	/** Count of items */
+	size_t count;
+
+} ovpn_schema_buf_t;
+
+/**
+ * @brief Schema being compiled
+ */
+typedef struct
+{
+	ovpn_schema_buf_t sections[OVPN_SCHEMA_SECTIONS];
+
+	/** Offset of the last option entry (SIZE_MAX - no options) */
+	size_t option;
+
+	/** Offset of the last argument entry (SIZE_MAX - no arguments) */
+	size_t arg;
+
+} ovpn_schema_builder_t;
+
+/**
+ * @brief Loaded schema
+ */
+typedef struct
+{
+	/** Mapped file */
+	const uint8_t *data;
+
+	/** Mapped file size */
+	size_t size;
+
+	/** Sections */
+	const uint8_t *sections[OVPN_SCHEMA_SECTIONS];
+	uint32_t counts[OVPN_SCHEMA_SECTIONS];
+
+	/** Options table (terminated by NULL) */
+	const ovpn_opt_info_t **table;
+
+} ovpn_schema_t;
+
+/**
+ * @brief Sizes of the option descriptors of the loaded schema
+ */
+typedef struct
+{
+	/** Count of arguments of all options */
+	uint64_t args;
+
+	/** Count of types of all arguments */
+	uint64_t types;
+
+	/** Count of listvalues of all arguments */
+	uint64_t values;
+
+} ovpn_schema_sizes_t;
+
+/** Loaded schema */
+static ovpn_schema_t ovpn_schema;
+
+/* ----------------------------------------------------------------------- */
+
+static uint32_t ovpn_schema_get_u32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+		((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void ovpn_schema_put_u32(uint8_t *p, uint32_t value)
+{
+	p[0] = (uint8_t)value;
+	p[1] = (uint8_t)(value >> 8);
+	p[2] = (uint8_t)(value >> 16);
+	p[3] = (uint8_t)(value >> 24);
+}
+
+/**
+ * FNV-1a hash of option name (part of the file format)
+ */
+static uint32_t ovpn_schema_hash(const char *name)
+{
+	uint32_t hash = 2166136261u;
+
+	while (*name)
+	{
+		hash ^= (uint8_t)*name++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static int ovpn_schema_buf_put(ovpn_schema_buf_t *buf, const void *data, size_t size)
+{
+	if ((buf->size + size) > buf->alloc)
+	{
+		size_t alloc = buf->alloc ? buf->alloc : 1024;
+		uint8_t *new_data;
+
+		while (alloc < (buf->size + size))
+			alloc *= 2;
+
+		new_data = realloc(buf->data, alloc);
+		if (!new_data)
+			return -ENOMEM;
+
+		buf->data = new_data;
+		buf->alloc = alloc;
+	}
+
+	memcpy(buf->data + buf->size, data, size);
+	buf->size += size;
+	return 0;
+}
+
+static int ovpn_schema_buf_put_u32(ovpn_schema_buf_t *buf, uint32_t value)
+{
+	uint8_t data[4];
+
+	ovpn_schema_put_u32(data, value);
+	return ovpn_schema_buf_put(buf, data, sizeof(data));
+}
+
+/**
+ * Increment counter in the entry of section
+ */
+static void ovpn_schema_buf_inc(ovpn_schema_buf_t *buf, size_t offset)
+{
+	ovpn_schema_put_u32(buf->data + offset,
+		ovpn_schema_get_u32(buf->data + offset) + 1u);
+}
+
+/**
+ * Add string to the strings section
+ *
+ * @return String offset
+ */
+static uint32_t ovpn_schema_add_string(
+	ovpn_schema_builder_t *builder, const char *str, int *ret)
+{
+	ovpn_schema_buf_t *strings = &builder->sections[OVPN_SCHEMA_STRINGS];
+	size_t offset = strings->size;
+
+	if (!*ret)
+		*ret = ovpn_schema_buf_put(strings, str, strlen(str) + 1);
+
+	strings->count = strings->size;
+	return (uint32_t)offset;
+}
+
+static int ovpn_schema_add_option(
+	ovpn_schema_builder_t *builder,
+	const char *name,
+	unsigned int flags,
+	ovpn_opt_inline_type_t inline_type,
+	ovpn_version_t since,
+	ovpn_version_t removed,
+	int args_min,
+	int args_max
+)
+{
+	int ret = 0;
+	uint32_t i;
+	uint32_t entry[OVPN_SCHEMA_OPTION_SIZE / 4];
+	ovpn_schema_buf_t *options = &builder->sections[OVPN_SCHEMA_OPTIONS];
+
+	entry[0] = ovpn_schema_add_string(builder, name, &ret);
+	entry[1] = flags;
+	entry[2] = (uint32_t)inline_type;
+	entry[3] = (uint32_t)since;
+	entry[4] = (uint32_t)removed;
+	entry[5] = (uint32_t)args_min;
+	entry[6] = (uint32_t)args_max;
+	entry[7] = (uint32_t)builder->sections[OVPN_SCHEMA_ARGS].count;
+	entry[8] = 0;
+
+	builder->option = options->size;
+	builder->arg = SIZE_MAX;
+
+	for (i = 0; !ret && (i < OVPN_SCHEMA_OPTION_SIZE / 4); i++)
+		ret = ovpn_schema_buf_put_u32(options, entry[i]);
+
+	options->count++;
+	return ret;
+}
+
+static int ovpn_schema_add_arg(
+	ovpn_schema_builder_t *builder,
+	const char *name,
+	int optional,
+	int range_min,
+	int range_max
+)
+{
+	int ret = 0;
+	uint32_t i;
+	uint32_t entry[OVPN_SCHEMA_ARG_SIZE / 4];
+	ovpn_schema_buf_t *args = &builder->sections[OVPN_SCHEMA_ARGS];
+
+	entry[0] = ovpn_schema_add_string(builder, name, &ret);
+	entry[1] = optional ? 1u : 0u;
+	entry[2] = (uint32_t)range_min;
+	entry[3] = (uint32_t)range_max;
+	entry[4] = (uint32_t)builder->sections[OVPN_SCHEMA_TYPES].count;
+	entry[5] = 0;
+	entry[6] = (uint32_t)builder->sections[OVPN_SCHEMA_VALUES].count;
+	entry[7] = 0;
+
+	builder->arg = args->size;
+
+	for (i = 0; !ret && (i < OVPN_SCHEMA_ARG_SIZE / 4); i++)
+		ret = ovpn_schema_buf_put_u32(args, entry[i]);
+
+	/* Count of arguments of the option */
+	ovpn_schema_buf_inc(&builder->sections[OVPN_SCHEMA_OPTIONS],
+		builder->option + 32u);
+
+	args->count++;
+	return ret;
+}
+
+static int ovpn_schema_add_arg_type(
+	ovpn_schema_builder_t *builder, ovpn_opt_arg_type_t type)
+{
+	ovpn_schema_buf_t *types = &builder->sections[OVPN_SCHEMA_TYPES];
+
+	ovpn_schema_buf_inc(&builder->sections[OVPN_SCHEMA_ARGS],
+		builder->arg + 20u);
+
+	types->count++;
+	return ovpn_schema_buf_put_u32(types, (uint32_t)type);
+}
+
+static int ovpn_schema_add_arg_value(
+	ovpn_schema_builder_t *builder, const char *value)
+{
+	int ret = 0;
+	uint32_t offset = ovpn_schema_add_string(builder, value, &ret);
+	ovpn_schema_buf_t *values = &builder->sections[OVPN_SCHEMA_VALUES];
+
+	if (ret)
+		return ret;
+
+	ovpn_schema_buf_inc(&builder->sections[OVPN_SCHEMA_ARGS],
+		builder->arg + 28u);
+
+	values->count++;
+	return ovpn_schema_buf_put_u32(values, offset);
+}
+
+/**
+ * Add options table in use to the schema
+ */
+static int ovpn_schema_add_table(ovpn_schema_builder_t *builder)
+{
+	int ret = 0;
+	size_t i;
+	size_t j;
+	size_t k;
+
+	for (i = 0; !ret && (i < ovpn_opt_count()); i++)
+	{
+		const ovpn_opt_info_t *opt = ovpn_opt_get(i);
+
+		ret = ovpn_schema_add_option(builder, opt->name, opt->flags,
+			opt->inline_type, opt->since, opt->removed,
+			opt->args.min, opt->args.max);
+
+		for (j = 0; !ret && opt->args.info && opt->args.info[j]; j++)
+		{
+			const ovpn_opt_arg_info_t *arg = opt->args.info[j];
+
+			ret = ovpn_schema_add_arg(builder, arg->name,
+				arg->optional, arg->range_min, arg->range_max);
+
+			for (k = 0; !ret && arg->types[k]; k++)
+				ret = ovpn_schema_add_arg_type(builder, arg->types[k]);
+
+			for (k = 0; !ret && arg->listvalues[k]; k++)
+				ret = ovpn_schema_add_arg_value(builder, arg->listvalues[k]);
+		}
+	}
+
+	return ret;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static int ovpn_schema_parse_int(const char *str, int *value)
+{
+	char *end;
+	long n;
+
+	errno = 0;
+	n = strtol(str, &end, 10);
+
+	if (errno || (end == str) || *end || (n < INT32_MIN) || (n > INT32_MAX))
+		return -EINVAL;
+
+	*value = (int)n;
+	return 0;
+}
+
+/**
+ * Parse 'option' line of the specification
+ */
+static int ovpn_schema_read_option(
+	ovpn_schema_builder_t *builder,
+	char **saveptr,
+	const char *name,
+	unsigned int line_n
+)
+{
+	size_t i;
+	int args_min;
+	int args_max;
+	unsigned int flags = 0;
+	ovpn_opt_inline_type_t inline_type = OVPN_OPT_INLINE_TYPE_INVALID;
+	ovpn_version_t since = OVPN_VERSION_ANY;
+	ovpn_version_t removed = OVPN_VERSION_ANY;
+	char *opt_name = strtok_r(NULL, " \t", saveptr);
+	char *min = strtok_r(NULL, " \t", saveptr);
+	char *max = strtok_r(NULL, " \t", saveptr);
+	char *token;
+
+	if (!opt_name || !min || !max ||
+	    ovpn_schema_parse_int(min, &args_min) || (args_min < 0))
+	{
+		fprintf(stderr,
+			"%s:%u: Option must have name and min and max count of arguments\n",
+			name, line_n);
+
+		return -EINVAL;
+	}
+
+	if (!strcmp(max, "*"))
+		args_max = OVPN_OPT_ARGS_NOT_LIMITED;
+	else if (ovpn_schema_parse_int(max, &args_max) || (args_max < args_min))
+	{
+		fprintf(stderr,
+			"%s:%u: Invalid max count of arguments '%s'\n",
+			name, line_n, max);
+
+		return -EINVAL;
+	}
+
+	while ((token = strtok_r(NULL, " \t", saveptr)))
+	{
+		if (!strncmp(token, "inline=", 7))
+		{
+			if (!strcmp(token + 7, "plain"))
+				inline_type = OVPN_OPT_INLINE_TYPE_PLAIN;
+			else if (!strcmp(token + 7, "options"))
+				inline_type = OVPN_OPT_INLINE_TYPE_OPTIONS;
+			else
+			{
+				fprintf(stderr,
+					"%s:%u: Unknown inline type '%s'\n",
+					name, line_n, token + 7);
+
+				return -EINVAL;
+			}
+		}
+		else if (!strncmp(token, "since=", 6) || !strncmp(token, "removed=", 8))
+		{
+			char *value = strchr(token, '=') + 1;
+			ovpn_version_t version = ovpn_version_find(value);
+
+			if (version == OVPN_VERSION_ANY)
+			{
+				fprintf(stderr,
+					"%s:%u: Unknown OpenVPN version '%s'\n",
+					name, line_n, value);
+
+				return -EINVAL;
+			}
+
+			if (token[0] == 's')
+				since = version;
+			else
+				removed = version;
+		}
+		else
+		{
+			for (i = 0; i < sizeof(ovpn_schema_flags) / sizeof(ovpn_schema_flags[0]); i++)
+			{
+				if (!strcmp(token, ovpn_schema_flags[i].name))
+					break;
+			}
+
+			if (i == sizeof(ovpn_schema_flags) / sizeof(ovpn_schema_flags[0]))
+			{
+				fprintf(stderr,
+					"%s:%u: Unknown option flag '%s'\n",
+					name, line_n, token);
+
+				return -EINVAL;
+			}
+
+			flags |= ovpn_schema_flags[i].flag;
+		}
+	}
+
+	return ovpn_schema_add_option(builder, opt_name, flags,
+		inline_type, since, removed, args_min, args_max);
+}
+
+/**
+ * Parse 'arg' line of the specification
+ */
+static int ovpn_schema_read_arg(
+	ovpn_schema_builder_t *builder,
+	char **saveptr,
+	const char *name,
+	unsigned int line_n
+)
+{
+	int ret;
+	int optional = 0;
+	int range_min = 0;
+	int range_max = 0;
+	char *values = NULL;
+	char *arg_name = strtok_r(NULL, " \t", saveptr);
+	char *types = strtok_r(NULL, " \t", saveptr);
+	char *token;
+	char *item_saveptr;
+
+	if (builder->option == SIZE_MAX)
+	{
+		fprintf(stderr,
+			"%s:%u: Argument is specified before any option\n",
+			name, line_n);
+
+		return -EINVAL;
+	}
+
+	if (!arg_name || !types)
+	{
+		fprintf(stderr,
+			"%s:%u: Argument must have name and type\n",
+			name, line_n);
+
+		return -EINVAL;
+	}
+
+	while ((token = strtok_r(NULL, " \t", saveptr)))
+	{
+		if (!strcmp(token, "optional"))
+			optional = 1;
+		else if (!strncmp(token, "values=", 7))
+			values = token + 7;
+		else if (!strncmp(token, "range=", 6))
+		{
+			char *sep = strstr(token + 6, "..");
+
+			if (sep)
+				*sep = '\0';
+
+			if (!sep ||
+			    ovpn_schema_parse_int(token + 6, &range_min) ||
+			    ovpn_schema_parse_int(sep + 2, &range_max) ||
+			    (range_max < range_min))
+			{
+				fprintf(stderr,
+					"%s:%u: Invalid argument range\n",
+					name, line_n);
+
+				return -EINVAL;
+			}
+		}
+		else
+		{
+			fprintf(stderr,
+				"%s:%u: Unexpected '%s' in argument\n",
+				name, line_n, token);
+
+			return -EINVAL;
+		}
+	}
+
+	ret = ovpn_schema_add_arg(builder, arg_name, optional, range_min, range_max);
+
+	for (token = strtok_r(types, "|", &item_saveptr); !ret && token;
+	     token = strtok_r(NULL, "|", &item_saveptr))
+	{
+		int type;
+
+		for (type = 1; type <= OVPN_SCHEMA_ARG_TYPE_MAX; type++)
+		{
+			if (!strcmp(token, ovpn_schema_arg_types[type]))
+				break;
+		}
+
+		if (type > OVPN_SCHEMA_ARG_TYPE_MAX)
+		{
+			fprintf(stderr,
+				"%s:%u: Unknown argument type '%s'\n",
+				name, line_n, token);
+
+			return -EINVAL;
+		}
+
+		ret = ovpn_schema_add_arg_type(builder, (ovpn_opt_arg_type_t)type);
+	}
+
+	if (!values)
+		return ret;
+
+	for (token = strtok_r(values, "|", &item_saveptr); !ret && token;
+	     token = strtok_r(NULL, "|", &item_saveptr))
+		ret = ovpn_schema_add_arg_value(builder, token);
+
+	return ret;
+}
+
+/**
+ * Compile text specification
+ */
+static int ovpn_schema_read(
+	ovpn_schema_builder_t *builder, FILE *stream, const char *name)
+{
+	int ret = 0;
+	unsigned int line_n = 0;
+	ovpn_line_reader_t reader;
+
+	ret = ovpn_line_reader_init(&reader);
+	if (ret)
+		return ret;
+
+	while (!ret)
+	{
+		char *line;
+		char *token;
+		char *saveptr;
+		ssize_t line_len;
+
+		line_n++;
+
+		line_len = ovpn_line_read(&reader, stream, line_n);
+		if (line_len <= 0) /* EOF or error */
+		{
+			ret = (int)line_len;
+			break;
+		}
+
+		line = reader.buffer;
+
+		/* Trim ending spaces */
+		while (line_len && isspace(line[line_len - 1]))
+			line[--line_len] = '\0';
+
+		/* Trim leading spaces */
+		while (isspace(*line))
+			line++;
+
+		/* Skip empty lines and comments */
+		if (!*line || (*line == '#') || (*line == ';'))
+			continue;
+
+		token = strtok_r(line, " \t", &saveptr);
+
+		if (!strcmp(token, "option"))
+			ret = ovpn_schema_read_option(builder, &saveptr, name, line_n);
+		else if (!strcmp(token, "arg"))
+			ret = ovpn_schema_read_arg(builder, &saveptr, name, line_n);
+		else
+		{
+			fprintf(stderr,
+				"%s:%u: Line must start with 'option' or 'arg'\n",
+				name, line_n);
+
+			ret = -EINVAL;
+		}
+	}
+
+	ovpn_line_reader_free(&reader);
+	return ret;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Build hash index of the options
+ */
+static int ovpn_schema_build_hash(ovpn_schema_builder_t *builder)
+{
+	int ret = 0;
+	size_t i;
+	size_t size = 8;
+	ovpn_schema_buf_t *options = &builder->sections[OVPN_SCHEMA_OPTIONS];
+	ovpn_schema_buf_t *hash = &builder->sections[OVPN_SCHEMA_HASH];
+	const char *strings = (const char *)builder->sections[OVPN_SCHEMA_STRINGS].data;
+
+	while (size < (options->count * 2))
+		size <<= 1;
+
+	hash->data = calloc(size, 4u);
+	if (!hash->data)
+		return -ENOMEM;
+
+	hash->size = hash->alloc = size * 4u;
+	hash->count = size;
+
+	for (i = 0; !ret && (i < options->count); i++)
+	{
+		const char *name = strings +
+			ovpn_schema_get_u32(options->data + i * OVPN_SCHEMA_OPTION_SIZE);
+		size_t slot = ovpn_schema_hash(name) & (size - 1);
+		uint32_t n;
+
+		while ((n = ovpn_schema_get_u32(hash->data + slot * 4u)))
+		{
+			if (!strcmp(name, strings + ovpn_schema_get_u32(
+				options->data + (n - 1) * OVPN_SCHEMA_OPTION_SIZE)))
+			{
+				fprintf(stderr,
+					"Option '%s' is specified more than once\n",
+					name);
+
+				ret = -EINVAL;
+				break;
+			}
+
+			slot = (slot + 1) & (size - 1);
+		}
+
+		ovpn_schema_put_u32(hash->data + slot * 4u, (uint32_t)(i + 1));
+	}
+
+	return ret;
+}
+
+/**
+ * Write schema to file
+ */
+static int ovpn_schema_write(ovpn_schema_builder_t *builder, const char *path)
+{
+	int ret = 0;
+	int i;
+	size_t size = OVPN_SCHEMA_HEADER_SIZE;
+	uint8_t header[OVPN_SCHEMA_HEADER_SIZE];
+	char *tmp_path;
+	FILE *stream;
+
+	memcpy(header, OVPN_SCHEMA_MAGIC, 8);
+
+	for (i = 0; i < OVPN_SCHEMA_SECTIONS; i++)
+	{
+		if ((builder->sections[i].size > (UINT32_MAX / 8u)) ||
+		    (size > (UINT32_MAX / 2u)))
+			return -EFBIG;
+
+		ovpn_schema_put_u32(header + 8 + i * 8,
+			(uint32_t)builder->sections[i].count);
+		ovpn_schema_put_u32(header + 12 + i * 8, (uint32_t)size);
+
+		size += builder->sections[i].size;
+	}
+
+	/* Write temporary file and replace schema atomically */
+	tmp_path = malloc(strlen(path) + sizeof(".tmp"));
+	if (!tmp_path)
+		return -ENOMEM;
+
+	sprintf(tmp_path, "%s.tmp", path);
+
+	stream = fopen(tmp_path, "wb");
+	if (!stream)
+	{
+		fprintf(stderr, "Could not open file '%s'\n", tmp_path);
+		free(tmp_path);
+		return -ENODEV;
+	}
+
+	if (fwrite(header, 1, sizeof(header), stream) != sizeof(header))
+		ret = -EIO;
+
+	for (i = 0; !ret && (i < OVPN_SCHEMA_SECTIONS); i++)
+	{
+		ovpn_schema_buf_t *section = &builder->sections[i];
+
+		if (section->size &&
+		    (fwrite(section->data, 1, section->size, stream) != section->size))
+			ret = -EIO;
+	}
+
+	if (fclose(stream) && !ret)
+		ret = -EIO;
+
+	if (!ret && rename(tmp_path, path))
+		ret = -errno;
+
+	if (ret)
+		unlink(tmp_path);
+
+	free(tmp_path);
+	return ret;
+}
+
+int ovpn_schema_compile(FILE *spec, const char *name, const char *path)
+{
+	int ret;
+	int i;
+	ovpn_schema_builder_t builder;
+
+	memset(&builder, 0, sizeof(builder));
+	builder.option = SIZE_MAX;
+	builder.arg = SIZE_MAX;
+
+	if (spec)
+		ret = ovpn_schema_read(&builder, spec, name);
+	else
+		ret = ovpn_schema_add_table(&builder);
+
+	if (!ret && !builder.sections[OVPN_SCHEMA_OPTIONS].count)
+	{
+		fprintf(stderr, "%s: No options are specified\n", name);
+		ret = -EINVAL;
+	}
+
+	if (!ret)
+		ret = ovpn_schema_build_hash(&builder);
+
+	if (!ret)
+		ret = ovpn_schema_write(&builder, path);
+
+	for (i = 0; i < OVPN_SCHEMA_SECTIONS; i++)
+		free(builder.sections[i].data);
+
+	return ret;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static ssize_t ovpn_schema_lookup(const char *name)
+{
+	const uint8_t *hash = ovpn_schema.sections[OVPN_SCHEMA_HASH];
+	uint32_t mask = ovpn_schema.counts[OVPN_SCHEMA_HASH] - 1u;
+	uint32_t slot = ovpn_schema_hash(name) & mask;
+	uint32_t n;
+
+	while ((n = ovpn_schema_get_u32(hash + slot * 4u)))
+	{
+		if (!strcmp(ovpn_schema.table[n - 1]->name, name))
+			return (ssize_t)(n - 1);
+
+		slot = (slot + 1) & mask;
+	}
+
+	return -1;
+}
+
+/**
+ * Get string of the loaded schema
+ *
+ * @return String or NULL if offset is out of the strings section
+ */
+static const char *ovpn_schema_string(const ovpn_schema_t *schema, uint32_t offset)
+{
+	if (offset >= schema->counts[OVPN_SCHEMA_STRINGS])
+		return NULL;
+
+	return (const char *)schema->sections[OVPN_SCHEMA_STRINGS] + offset;
+}
+
+/**
+ * Check that items range is inside the section
+ */
+static int ovpn_schema_range(
+	const ovpn_schema_t *schema, int section, uint32_t first, uint32_t count)
+{
+	return ((uint64_t)first + count) <= schema->counts[section];
+}
+
+/**
+ * Check the loaded schema and count sizes of the option descriptors
+ *
+ * @return 0 if schema is valid
+ * @return -EINVAL if schema is invalid
+ */
+static int ovpn_schema_check(const ovpn_schema_t *schema, ovpn_schema_sizes_t *sizes)
+{
+	uint32_t i;
+	uint32_t j;
+	uint32_t k;
+	uint32_t used = 0;
+	uint32_t count = schema->counts[OVPN_SCHEMA_OPTIONS];
+	uint32_t hash_size = schema->counts[OVPN_SCHEMA_HASH];
+
+	memset(sizes, 0, sizeof(*sizes));
+
+	/* Strings are null-terminated */
+	if (!schema->counts[OVPN_SCHEMA_STRINGS] ||
+	    schema->sections[OVPN_SCHEMA_STRINGS][schema->counts[OVPN_SCHEMA_STRINGS] - 1])
+		return -EINVAL;
+
+	for (i = 0; i < count; i++)
+	{
+		const uint8_t *opt = schema->sections[OVPN_SCHEMA_OPTIONS] +
+			(size_t)i * OVPN_SCHEMA_OPTION_SIZE;
+		const char *name = ovpn_schema_string(schema, ovpn_schema_get_u32(opt));
+		int32_t args_min = (int32_t)ovpn_schema_get_u32(opt + 20);
+		int32_t args_max = (int32_t)ovpn_schema_get_u32(opt + 24);
+		uint32_t args_first = ovpn_schema_get_u32(opt + 28);
+		uint32_t args_count = ovpn_schema_get_u32(opt + 32);
+
+		if (!name || !*name ||
+		    (ovpn_schema_get_u32(opt + 8) > OVPN_OPT_INLINE_TYPE_OPTIONS) ||
+		    (ovpn_schema_get_u32(opt + 12) >= OVPN_VERSION_COUNT) ||
+		    (ovpn_schema_get_u32(opt + 16) >= OVPN_VERSION_COUNT) ||
+		    (args_min < 0) ||
+		    ((args_max != OVPN_OPT_ARGS_NOT_LIMITED) && (args_max < args_min)) ||
+		    !ovpn_schema_range(schema, OVPN_SCHEMA_ARGS, args_first, args_count))
+			return -EINVAL;
+
+		sizes->args += args_count;
+
+		for (j = 0; j < args_count; j++)
+		{
+			const uint8_t *arg = schema->sections[OVPN_SCHEMA_ARGS] +
+				(size_t)(args_first + j) * OVPN_SCHEMA_ARG_SIZE;
+			uint32_t types_first = ovpn_schema_get_u32(arg + 16);
+			uint32_t types_count = ovpn_schema_get_u32(arg + 20);
+			uint32_t values_first = ovpn_schema_get_u32(arg + 24);
+			uint32_t values_count = ovpn_schema_get_u32(arg + 28);
+
+			if (!ovpn_schema_string(schema, ovpn_schema_get_u32(arg)) ||
+			    !types_count ||
+			    !ovpn_schema_range(schema, OVPN_SCHEMA_TYPES, types_first, types_count) ||
+			    !ovpn_schema_range(schema, OVPN_SCHEMA_VALUES, values_first, values_count))
+				return -EINVAL;
+
+			for (k = 0; k < types_count; k++)
+			{
+				uint32_t type = ovpn_schema_get_u32(
+					schema->sections[OVPN_SCHEMA_TYPES] + (size_t)(types_first + k) * 4u);
+
+				if (!type || (type > OVPN_SCHEMA_ARG_TYPE_MAX))
+					return -EINVAL;
+			}
+
+			for (k = 0; k < values_count; k++)
+			{
+				if (!ovpn_schema_string(schema, ovpn_schema_get_u32(
+					schema->sections[OVPN_SCHEMA_VALUES] + (size_t)(values_first + k) * 4u)))
+					return -EINVAL;
+			}
+
+			sizes->types += types_count;
+			sizes->values += values_count;
+		}
+	}
+
+	/* Each item is used at most once, so descriptors size
+	 * is limited by the file size */
+	if ((sizes->args > schema->counts[OVPN_SCHEMA_ARGS]) ||
+	    (sizes->types > schema->counts[OVPN_SCHEMA_TYPES]) ||
+	    (sizes->values > schema->counts[OVPN_SCHEMA_VALUES]))
+		return -EINVAL;
+
+	/* Hash table has empty slots, so lookups always stop */
+	if ((hash_size <= count) || (hash_size & (hash_size - 1)))
+		return -EINVAL;
+
+	for (i = 0; i < hash_size; i++)
+	{
+		uint32_t n = ovpn_schema_get_u32(
+			schema->sections[OVPN_SCHEMA_HASH] + (size_t)i * 4u);
+
+		if (n > count)
+			return -EINVAL;
+
+		if (n)
+			used++;
+	}
+
+	return (used < hash_size) ? 0 : -EINVAL;
+}
+
+/**
+ * Fill option descriptors of the checked schema
+ */
+static void ovpn_schema_fill(ovpn_schema_t *schema, uint8_t *data, const ovpn_schema_sizes_t *sizes)
+{
+	uint32_t i;
+	uint32_t j;
+	uint32_t k;
+	uint32_t count = schema->counts[OVPN_SCHEMA_OPTIONS];
+	ovpn_opt_info_t *opts = (ovpn_opt_info_t *)data;
+	const ovpn_opt_info_t **table = (const ovpn_opt_info_t **)(opts + count);
+	const ovpn_opt_arg_info_t **arg_ptrs = (const ovpn_opt_arg_info_t **)(table + count + 1);
+	uint8_t *arg_infos = (uint8_t *)(arg_ptrs + sizes->args + count);
+	ovpn_opt_arg_type_t *types = (ovpn_opt_arg_type_t *)(arg_infos +
+		sizes->args * OVPN_SCHEMA_ARG_INFO_SIZE +
+		(sizes->values + sizes->args) * sizeof(const char *));
+
+	for (i = 0; i < count; i++)
+	{
+		const uint8_t *opt = schema->sections[OVPN_SCHEMA_OPTIONS] +
+			(size_t)i * OVPN_SCHEMA_OPTION_SIZE;
+		uint32_t args_first = ovpn_schema_get_u32(opt + 28);
+		uint32_t args_count = ovpn_schema_get_u32(opt + 32);
+
+		opts[i].name = ovpn_schema_string(schema, ovpn_schema_get_u32(opt));
+		opts[i].flags = ovpn_schema_get_u32(opt + 4);
+		opts[i].inline_type = (ovpn_opt_inline_type_t)ovpn_schema_get_u32(opt + 8);
+		opts[i].since = (ovpn_version_t)ovpn_schema_get_u32(opt + 12);
+		opts[i].removed = (ovpn_version_t)ovpn_schema_get_u32(opt + 16);
+		opts[i].args.min = (int32_t)ovpn_schema_get_u32(opt + 20);
+		opts[i].args.max = (int32_t)ovpn_schema_get_u32(opt + 24);
+		opts[i].args.info = args_count ? arg_ptrs : NULL;
+
+		for (j = 0; j < args_count; j++)
+		{
+			const uint8_t *arg = schema->sections[OVPN_SCHEMA_ARGS] +
+				(size_t)(args_first + j) * OVPN_SCHEMA_ARG_SIZE;
+			uint32_t types_first = ovpn_schema_get_u32(arg + 16);
+			uint32_t types_count = ovpn_schema_get_u32(arg + 20);
+			uint32_t values_first = ovpn_schema_get_u32(arg + 24);
+			uint32_t values_count = ovpn_schema_get_u32(arg + 28);
+			ovpn_opt_arg_info_t *info = (ovpn_opt_arg_info_t *)arg_infos;
+
+			info->name = ovpn_schema_string(schema, ovpn_schema_get_u32(arg));
+			info->optional = (int)ovpn_schema_get_u32(arg + 4);
+			info->range_min = (int32_t)ovpn_schema_get_u32(arg + 8);
+			info->range_max = (int32_t)ovpn_schema_get_u32(arg + 12);
+			info->types = types;
+
+			for (k = 0; k < types_count; k++)
+			{
+				*types++ = (ovpn_opt_arg_type_t)ovpn_schema_get_u32(
+					schema->sections[OVPN_SCHEMA_TYPES] + (size_t)(types_first + k) * 4u);
+			}
+
+			*types++ = 0;
+
+			for (k = 0; k < values_count; k++)
+			{
+				info->listvalues[k] = ovpn_schema_string(schema, ovpn_schema_get_u32(
+					schema->sections[OVPN_SCHEMA_VALUES] + (size_t)(values_first + k) * 4u));
+			}
+
+			info->listvalues[values_count] = NULL;
+
+			arg_infos += OVPN_SCHEMA_ARG_INFO_SIZE +
+				(values_count + 1) * sizeof(const char *);
+
+			*arg_ptrs++ = info;
+		}
+
+		if (args_count)
+			*arg_ptrs++ = NULL;
+
+		table[i] = &opts[i];
+	}
+
+	table[count] = NULL;
+	schema->table = table;
+}
+
+/**
+ * Check mapped schema file and build option descriptors
+ */
+static int ovpn_schema_map(ovpn_schema_t *schema)
+{
+	int i;
+	size_t size;
+	uint8_t *data;
+	uint32_t count;
+	ovpn_schema_sizes_t sizes;
+
+	if (memcmp(schema->data, OVPN_SCHEMA_MAGIC, 8))
+		return -EINVAL;
+
+	/* All sections must be inside the file */
+	for (i = 0; i < OVPN_SCHEMA_SECTIONS; i++)
+	{
+		uint32_t offset = ovpn_schema_get_u32(schema->data + 12 + i * 8);
+
+		schema->counts[i] = ovpn_schema_get_u32(schema->data + 8 + i * 8);
+
+		if (((uint64_t)offset + (uint64_t)schema->counts[i] *
+		     ovpn_schema_item_size[i]) > schema->size)
+			return -EINVAL;
+
+		schema->sections[i] = schema->data + offset;
+	}
+
+	if (ovpn_schema_check(schema, &sizes))
+		return -EINVAL;
+
+	count = schema->counts[OVPN_SCHEMA_OPTIONS];
+
+	size = count * sizeof(ovpn_opt_info_t) +
+		(count + 1) * sizeof(ovpn_opt_info_t *) +
+		(sizes.args + count) * sizeof(ovpn_opt_arg_info_t *) +
+		sizes.args * OVPN_SCHEMA_ARG_INFO_SIZE +
+		(sizes.values + sizes.args) * sizeof(const char *) +
+		(sizes.types + sizes.args) * sizeof(ovpn_opt_arg_type_t);
+
+	data = malloc(size);
+	if (!data)
+		return -ENOMEM;
+
+	ovpn_schema_fill(schema, data, &sizes);
+	return 0;
+}
+
+int ovpn_schema_load(const char *path)
+{
+	int fd;
+	int ret;
+	void *data;
+	struct stat st;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+
+	if (fstat(fd, &st) || (st.st_size < OVPN_SCHEMA_HEADER_SIZE))
+	{
+		close(fd);
+		return -EINVAL;
+	}
+
+	data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED)
+		return -errno;
+
+	memset(&ovpn_schema, 0, sizeof(ovpn_schema));
+	ovpn_schema.data = data;
+	ovpn_schema.size = (size_t)st.st_size;
+
+	ret = ovpn_schema_map(&ovpn_schema);
+	if (ret)
+	{
+		munmap(data, (size_t)st.st_size);
+		memset(&ovpn_schema, 0, sizeof(ovpn_schema));
+		return ret;
+	}
+
+	ovpn_opt_table_set(ovpn_schema.table,
+		ovpn_schema.counts[OVPN_SCHEMA_OPTIONS], ovpn_schema_lookup);
+
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+int ovpn_schema_dump(FILE *output)
+{
+	size_t i;
+	size_t j;
+	size_t k;
+
+	fprintf(output,
+		"# option <name> <min> <max|*> [<flag>...] [inline=<type>]\n"
+		"#     [since=<version>] [removed=<version>]\n"
+		"# arg <name> <type>[|<type>...] [optional] [range=<min>..<max>]\n"
+		"#     [values=<value>[|<value>...]]\n");
+
+	for (i = 0; i < ovpn_opt_count(); i++)
+	{
+		const ovpn_opt_info_t *opt = ovpn_opt_get(i);
+
+		fprintf(output, "\noption %s %d ", opt->name, opt->args.min);
+
+		if (opt->args.max == OVPN_OPT_ARGS_NOT_LIMITED)
+			fputc('*', output);
+		else
+			fprintf(output, "%d", opt->args.max);
+
+		for (j = 0; j < sizeof(ovpn_schema_flags) / sizeof(ovpn_schema_flags[0]); j++)
+		{
+			if (opt->flags & ovpn_schema_flags[j].flag)
+				fprintf(output, " %s", ovpn_schema_flags[j].name);
+		}
+
+		if (opt->inline_type != OVPN_OPT_INLINE_TYPE_INVALID)
+			fprintf(output, " inline=%s",
+				ovpn_opt_inline_type_asciiz(opt->inline_type));
+
+		if (opt->since != OVPN_VERSION_ANY)
+			fprintf(output, " since=%s", ovpn_version_name(opt->since));
+
+		if (opt->removed != OVPN_VERSION_ANY)
+			fprintf(output, " removed=%s", ovpn_version_name(opt->removed));
+
+		fputc('\n', output);
+
+		for (j = 0; opt->args.info && opt->args.info[j]; j++)
+		{
+			const ovpn_opt_arg_info_t *arg = opt->args.info[j];
+
+			fprintf(output, "\targ %s ", arg->name);
+
+			for (k = 0; arg->types[k]; k++)
+			{
+				fprintf(output, "%s%s", k ? "|" : "",
+					((unsigned int)arg->types[k] <= OVPN_SCHEMA_ARG_TYPE_MAX)
+						? ovpn_schema_arg_types[arg->types[k]] : "string");
+			}
+
+			if (arg->optional)
+				fprintf(output, " optional");
+
+			if (arg->range_min || arg->range_max)
+				fprintf(output, " range=%d..%d", arg->range_min, arg->range_max);
+
+			for (k = 0; arg->listvalues[k]; k++)
+				fprintf(output, "%s%s", k ? "|" : " values=", arg->listvalues[k]);
+
+			fputc('\n', output);
+		}
+	}
+
+	return ferror(output) ? -EIO : 0;
+}
+
+/* ----------------------------------------------------------------------- */
@@ -0,0 +1,55 @@
+/*
+ * OpenVPN Configuration Files Converter
+ * Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+#ifndef OVPN_SCHEMA_H
+#define OVPN_SCHEMA_H
+
+#include <ovpn.h>
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Load binary options schema file and use it instead of
+ * the built-in options table
+ *
+ * File is mapped and stays mapped until the program exits.
+ * Must be called at startup before any options lookups.
+ *
+ * @return 0 on success
+ * @return <0 on error (errors are reported to stderr)
+ */
+int ovpn_schema_load(const char *path);
+
+/**
+ * Compile binary options schema file
+ *
+ * Schema file is replaced atomically, so it can be safely
+ * rebuilt while being used by readers.
+ *
+ * @param[in] spec  Text options specification
+ *                  (NULL - options table in use)
+ * @param[in] name  Specification name for error messages
+ * @param[in] path  Schema file path
+ *
+ * @return 0 on success
+ * @return <0 on error (errors are reported to stderr)
+ */
+int ovpn_schema_compile(FILE *spec, const char *name, const char *path);
+
+/**
+ * Write options table in use as text options specification
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int ovpn_schema_dump(FILE *output);
+
+/* ----------------------------------------------------------------------- */
+
+#endif /* OVPN_SCHEMA_H */
@@ -0,0 +1,550 @@
+/*
+ * OpenVPN Configuration Files Converter
+ * Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief OpenVPN status files (openvpn-status.log) converter
+ *
+ * Status files of all versions (--status-version 1, 2 and 3) are
+ * converted to the same records stream. Every row is written as
+ * a separate record as soon as it is parsed:
+ * {
+ *     "section": "<section-name>",
+ *     "row": {
+ *         "<column-1-name>": "<column-1-value>",
+ *         ...
+ *     }
+ * }
+ *
+ * Record and row objects are kept per section and only values are
+ * replaced for each row, so memory usage is bounded regardless of the
+ * file size and repeated conversions of the same file do not allocate
+ * column names again.
+ */
+
+#include <signal.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include <ovpn.h>
+
+/* ----------------------------------------------------------------------- */
+
+/** Maximum count of sections */
+#define OVPN_STATUS_LOG_MAX_SECTIONS  16u
+
+/** Maximum count of columns in a row */
+#define OVPN_STATUS_LOG_MAX_FIELDS  64u
+
+/**
+ * @brief Status file section
+ */
+typedef struct
+{
+	/** Section name */
+	char *name;
+
+	/** Record object */
+	json_object *record;
+
+	/** Row object of @ref record */
+	json_object *row;
+
+	/** Column names */
+	char **headers;
+
+	/** Count of column names */
+	unsigned int headers_count;
+
+	/** Count of unnamed columns in @ref row (named by column index) */
+	unsigned int extra_count;
+
+} ovpn_status_log_section_t;
+
+/**
+ * @brief Status file converter
+ */
+struct ovpn_status_log
+{
+	/** Output format */
+	ovpn_format_t format;
+
+	/** JSON dump flags (OVPN_DUMP_FLAG_*) */
+	unsigned int dump_flags;
+
+	/** Line reader */
+	ovpn_line_reader_t reader;
+
+	/** Sections */
+	ovpn_status_log_section_t sections[OVPN_STATUS_LOG_MAX_SECTIONS];
+
+	/** Count of sections */
+	unsigned int sections_count;
+};
+
+/** Status file version 1 section titles */
+static const struct
+{
+	const char *title;
+	const char *section;
+
+} ovpn_status_log_v1_sections[] =
+{
+	{ "OpenVPN CLIENT LIST", "CLIENT_LIST"   },
+	{ "ROUTING TABLE",       "ROUTING_TABLE" },
+	{ "GLOBAL STATS",        "GLOBAL_STATS"  },
+	{ NULL, NULL }
+};
+
+/** Column names of the rows without HEADER record */
+static const char *ovpn_status_log_title_headers[] = { "Title" };
+static const char *ovpn_status_log_time_headers[] = { "Time", "Time (time_t)" };
+static const char *ovpn_status_log_stats_headers[] = { "Name", "Value" };
+
+static volatile sig_atomic_t ovpn_status_log_stop = 0;
+
+/* ----------------------------------------------------------------------- */
+
+static void ovpn_status_log_headers_free(ovpn_status_log_section_t *section)
+{
+	unsigned int i;
+
+	for (i = 0; i < section->headers_count; i++)
+		free(section->headers[i]);
+
+	free(section->headers);
+
+	section->headers = NULL;
+	section->headers_count = 0;
+}
+
+/**
+ * Set column names of the section
+ *
+ * Row object is recreated only if column names are changed.
+ */
+static int ovpn_status_log_set_headers(
+	ovpn_status_log_section_t *section,
+	const char **headers,
+	unsigned int count
+)
+{
+	unsigned int i;
+
+	if (count == section->headers_count)
+	{
+		for (i = 0; i < count; i++)
+		{
+			if (strcmp(section->headers[i], headers[i]))
+				break;
+		}
+
+		if (i == count)
+			return 0;
+	}
+
+	ovpn_status_log_headers_free(section);
+
+	section->headers = calloc(count ? count : 1, sizeof(char *));
+	if (!section->headers)
+		return -ENOMEM;
+
+	for (i = 0; i < count; i++)
+	{
+		section->headers[i] = strdup(headers[i]);
+		if (!section->headers[i])
+			return -ENOMEM;
+
+		section->headers_count++;
+	}
+
+	/* New row object with the new columns */
+	section->row = json_object_new_object();
+	if (!section->row)
+		return -ENOMEM;
+
+	section->extra_count = 0;
+	json_object_object_add(section->record, "row", section->row);
+	return 0;
+}
+
+static ovpn_status_log_section_t *ovpn_status_log_section(
+	ovpn_status_log_t *log, const char *name)
+{
+	unsigned int i;
+	ovpn_status_log_section_t *section;
+
+	for (i = 0; i < log->sections_count; i++)
+	{
+		if (!strcmp(log->sections[i].name, name))
+			return &log->sections[i];
+	}
+
+	/* Rows of the sections above the limit are skipped */
+	if (log->sections_count == OVPN_STATUS_LOG_MAX_SECTIONS)
+		return NULL;
+
+	section = &log->sections[log->sections_count];
+
+	section->name = strdup(name);
+	section->record = json_object_new_object();
+	section->row = json_object_new_object();
+
+	if (!section->name || !section->record || !section->row)
+	{
+		free(section->name);
+		json_object_put(section->record);
+		json_object_put(section->row);
+		memset(section, 0, sizeof(*section));
+		return NULL;
+	}
+
+	json_object_object_add(section->record, "section",
+		json_object_new_string(name));
+
+	json_object_object_add(section->record, "row", section->row);
+
+	/* Columns of the rows without HEADER record */
+	if (!strcmp(name, "TITLE"))
+		ovpn_status_log_set_headers(section, ovpn_status_log_title_headers, 1);
+	else if (!strcmp(name, "TIME"))
+		ovpn_status_log_set_headers(section, ovpn_status_log_time_headers, 2);
+	else if (!strcmp(name, "GLOBAL_STATS"))
+		ovpn_status_log_set_headers(section, ovpn_status_log_stats_headers, 2);
+
+	log->sections_count++;
+	return section;
+}
+
+/**
+ * Write section row record
+ */
+static int ovpn_status_log_row(
+	ovpn_status_log_t *log,
+	FILE *output,
+	const char *name,
+	char **fields,
+	unsigned int count
+)
+{
+	unsigned int i;
+	unsigned int columns;
+	ovpn_status_log_section_t *section = ovpn_status_log_section(log, name);
+
+	if (!section)
+		return 0;
+
+	columns = (count > section->headers_count) ? count : section->headers_count;
+
+	for (i = 0; i < columns; i++)
+	{
+		char index[16];
+		const char *key = index;
+
+		if (i < section->headers_count)
+			key = section->headers[i];
+		else
+			snprintf(index, sizeof(index), "%u", i + 1);
+
+		/* Values of the existing columns are replaced */
+		json_object_object_add(section->row, key,
+			(i < count) ? json_object_new_string(fields[i]) : NULL);
+	}
+
+	/* Remove unnamed columns of the previous rows */
+	for (i = columns; i < section->headers_count + section->extra_count; i++)
+	{
+		char index[16];
+		snprintf(index, sizeof(index), "%u", i + 1);
+		json_object_object_del(section->row, index);
+	}
+
+	section->extra_count = columns - section->headers_count;
+
+	if (log->format == OVPN_FORMAT_JSON)
+		return ovpn_json_write(section->record, log->dump_flags, output);
+
+	return ovpn_encode_object(log->format, section->record, output);
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Split line into fields (in place)
+ *
+ * @return Count of fields
+ */
+static unsigned int ovpn_status_log_split(
+	char *line, char delimiter, char **fields)
+{
+	unsigned int count = 0;
+
+	while (count < OVPN_STATUS_LOG_MAX_FIELDS)
+	{
+		char *end = strchr(line, delimiter);
+
+		fields[count++] = line;
+
+		if (!end)
+			break;
+
+		*end = '\0';
+		line = end + 1;
+	}
+
+	return count;
+}
+
+static int ovpn_status_log_parse_v1(
+	ovpn_status_log_t *log,
+	FILE *output,
+	char *line,
+	const char **section,
+	int *expect_header
+)
+{
+	unsigned int i;
+	unsigned int count;
+	char *fields[OVPN_STATUS_LOG_MAX_FIELDS];
+
+	for (i = 0; ovpn_status_log_v1_sections[i].title; i++)
+	{
+		if (!strcmp(line, ovpn_status_log_v1_sections[i].title))
+		{
+			*section = ovpn_status_log_v1_sections[i].section;
+
+			/* Column names follow the title, except global stats */
+			*expect_header = strcmp(*section, "GLOBAL_STATS");
+			return 0;
+		}
+	}
+
+	count = ovpn_status_log_split(line, ',', fields);
+
+	if (!strcmp(fields[0], "Updated") && (count > 1))
+		return ovpn_status_log_row(log, output, "TIME", fields + 1, count - 1);
+
+	if (*expect_header)
+	{
+		ovpn_status_log_section_t *s = ovpn_status_log_section(log, *section);
+
+		*expect_header = 0;
+
+		if (!s)
+			return 0;
+
+		return ovpn_status_log_set_headers(s, (const char **)fields, count);
+	}
+
+	return ovpn_status_log_row(log, output, *section, fields, count);
+}
+
+static int ovpn_status_log_parse_v2(
+	ovpn_status_log_t *log,
+	FILE *output,
+	char *line,
+	char delimiter
+)
+{
+	unsigned int count;
+	char *fields[OVPN_STATUS_LOG_MAX_FIELDS];
+
+	count = ovpn_status_log_split(line, delimiter, fields);
+
+	if (!strcmp(fields[0], "HEADER"))
+	{
+		ovpn_status_log_section_t *section;
+
+		if (count < 2)
+			return 0;
+
+		section = ovpn_status_log_section(log, fields[1]);
+		if (!section)
+			return 0;
+
+		return ovpn_status_log_set_headers(section,
+			(const char **)fields + 2, count - 2);
+	}
+
+	return ovpn_status_log_row(log, output, fields[0], fields + 1, count - 1);
+}
+
+/* ----------------------------------------------------------------------- */
+
+ovpn_status_log_t *ovpn_status_log_new(
+	ovpn_format_t format, unsigned int dump_flags)
+{
+	ovpn_status_log_t *log = calloc(1, sizeof(ovpn_status_log_t));
+	if (!log)
+		return NULL;
+
+	log->format = format;
+	log->dump_flags = dump_flags;
+
+	if (ovpn_line_reader_init(&log->reader))
+	{
+		free(log);
+		return NULL;
+	}
+
+	return log;
+}
+
+void ovpn_status_log_delete(ovpn_status_log_t *log)
+{
+	unsigned int i;
+
+	if (!log)
+		return;
+
+	for (i = 0; i < log->sections_count; i++)
+	{
+		ovpn_status_log_headers_free(&log->sections[i]);
+		json_object_put(log->sections[i].record);
+		free(log->sections[i].name);
+	}
+
+	ovpn_line_reader_free(&log->reader);
+	free(log);
+}
+
+int ovpn_status_log_convert(ovpn_status_log_t *log, FILE *input, FILE *output)
+{
+	int ret = 0;
+	int version = 0;
+	int expect_header = 0;
+	unsigned int line_n = 0;
+	const char *section = NULL;
+
+	while (!ret)
+	{
+		char *line;
+		ssize_t line_len = ovpn_line_read(&log->reader, input, ++line_n);
+
+		if (line_len <= 0) /* EOF or error */
+			return (int)line_len;
+
+		line = log->reader.buffer;
+
+		/* Trim line ending */
+		while ((line_len > 0) &&
+		       ((line[line_len - 1] == '\n') || (line[line_len - 1] == '\r')))
+			line[--line_len] = '\0';
+
+		if (!version)
+		{
+			/* Version is detected by the first line */
+			if (!strcmp(line, ovpn_status_log_v1_sections[0].title))
+				version = 1;
+			else if (!strncmp(line, "TITLE,", 6))
+				version = 2;
+			else if (!strncmp(line, "TITLE\t", 6))
+				version = 3;
+			else
+			{
+				fprintf(stderr, "Unknown status file format\n");
+				return -EINVAL;
+			}
+		}
+
+		if (!strcmp(line, "END"))
+			break;
+
+		if (!line_len)
+			continue;
+
+		if (version == 1)
+			ret = ovpn_status_log_parse_v1(log, output, line, &section, &expect_header);
+		else
+			ret = ovpn_status_log_parse_v2(log, output, line,
+				(version == 2) ? ',' : '\t');
+	}
+
+	return ret;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void ovpn_status_log_signal(int sig)
+{
+	(void)sig;
+	ovpn_status_log_stop = 1;
+}
+
+int ovpn_status_log_follow(
+	ovpn_status_log_t *log,
+	const char *path,
+	unsigned int interval_ms,
+	FILE *output
+)
+{
+	int ret = 0;
+	FILE *input = NULL;
+	struct sigaction sa;
+	struct stat last = { 0 };
+
+	struct timespec interval = {
+		.tv_sec = interval_ms / 1000u,
+		.tv_nsec = (long)(interval_ms % 1000u) * 1000000L,
+	};
+
+	/* Interrupt sleep on termination signals */
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = ovpn_status_log_signal;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	while (!ret && !ovpn_status_log_stop)
+	{
+		struct stat st;
+
+		/* File is converted only if it is changed */
+		if (!stat(path, &st) &&
+		    ((st.st_dev != last.st_dev) ||
+		     (st.st_ino != last.st_ino) ||
+		     (st.st_size != last.st_size) ||
+		     (st.st_mtim.tv_sec != last.st_mtim.tv_sec) ||
+		     (st.st_mtim.tv_nsec != last.st_mtim.tv_nsec)))
+		{
+			/* OpenVPN rewrites status file in place, so the file is
+			 * reopened only if it is replaced */
+			if (input && ((st.st_dev != last.st_dev) || (st.st_ino != last.st_ino)))
+			{
+				fclose(input);
+				input = NULL;
+			}
+
+			if (!input)
+				input = fopen(path, "rb");
+			else
+				rewind(input);
+
+			if (input)
+			{
+				/* Partially written file is converted on the next change */
+				ret = ovpn_status_log_convert(log, input, output);
+				if (ret == -EINVAL)
+					ret = 0;
+
+				fflush(output);
+				last = st;
+			}
+		}
+
+		if (!ret)
+			nanosleep(&interval, NULL);
+	}
+
+	if (input)
+		fclose(input);
+
+	return ret;
+}
+
+/* ----------------------------------------------------------------------- */
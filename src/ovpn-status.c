@@ -0,0 +1,874 @@
+/*
+ * OpenVPN Configuration Files Converter
+ * Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Status messages store
+ *
+ * Every distinct message (message format, type and arguments) is stored
+ * only once together with the list of lines where it was produced.
+ * Messages are translated and formatted only when the status JSON object
+ * is built. Count of stored messages is limited by
+ * @ref ovpn_t::max_messages, messages above the limit are only counted.
+ *
+ * Messages of included files have the name of the file they refer to.
+ *
+ * If @ref ovpn_t::status_stream is set, messages are not stored at all
+ * and are written to the stream as NDJSON records when they occur.
+ */
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <ovpn.h>
+
+/* ----------------------------------------------------------------------- */
+
+/** Maximum count of message arguments */
+#define OVPN_STATUS_MAX_ARGS  4
+
+/** Initial count of hash table buckets (must be power of two) */
+#define OVPN_STATUS_INITIAL_SIZE  64u
+
+/**
+ * @brief Message argument
+ */
+typedef struct
+{
+	/** Argument is a string */
+	int is_str;
+
+	/** Integer value */
+	long long num;
+
+	/** String value */
+	const char *str;
+
+} ovpn_status_arg_t;
+
+/**
+ * @brief Message without line number
+ */
+typedef struct
+{
+	/** Message type */
+	ovpn_msg_type_t type;
+
+	/** Untranslated message format */
+	const char *format;
+
+	/** Name of the included file the message refers to
+	 *  (NULL - main file) */
+	const char *file;
+
+	/** Count of arguments */
+	unsigned int nargs;
+
+	/** Arguments */
+	ovpn_status_arg_t args[OVPN_STATUS_MAX_ARGS];
+
+} ovpn_status_msg_t;
+
+/**
+ * @brief Stored message
+ */
+typedef struct ovpn_status_record
+{
+	/** Next message in order of appearance */
+	struct ovpn_status_record *next;
+
+	/** Next message in hash table bucket */
+	struct ovpn_status_record *chain;
+
+	/** Message hash */
+	uint64_t hash;
+
+	/** Message (strings point to @ref strings) */
+	ovpn_status_msg_t msg;
+
+	/** Count of message occurrences */
+	unsigned int count;
+
+	/** Stored lines of message occurrences */
+	unsigned int *lines;
+
+	/** Count of stored lines */
+	unsigned int lines_count;
+
+	/** Count of allocated items in @ref lines */
+	unsigned int lines_size;
+
+	/** Storage for file name and string arguments */
+	char strings[];
+
+} ovpn_status_record_t;
+
+struct ovpn_status
+{
+	/** Hash table buckets */
+	ovpn_status_record_t **buckets;
+
+	/** Count of buckets */
+	size_t size;
+
+	/** Count of distinct messages */
+	size_t count;
+
+	/** First message */
+	ovpn_status_record_t *first;
+
+	/** Last message */
+	ovpn_status_record_t *last;
+
+	/** Count of stored message occurrences */
+	unsigned int stored;
+
+	/** Count of dropped messages */
+	unsigned int dropped;
+};
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Skip conversion specification (after '%')
+ *
+ * @param[in]  spec  Conversion specification
+ * @param[out] pos   Argument position (-1 - next argument)
+ * @param[out] conv  Conversion character
+ *
+ * @return Pointer to the character after specification
+ */
+static const char *ovpn_status_spec(const char *spec, int *pos, char *conv)
+{
+	const char *p = spec;
+	int n = 0;
+
+	*pos = -1;
+
+	while ((*p >= '0') && (*p <= '9'))
+		n = n * 10 + (*p++ - '0');
+
+	if ((*p == '$') && (n > 0))
+	{
+		*pos = n - 1;
+		p++;
+	}
+	else
+		p = spec;
+
+	/* Flags, width, precision and length modifiers are ignored */
+	while (*p && strchr("-+ #0123456789.hlzjt", *p))
+		p++;
+
+	*conv = *p;
+	return *p ? p + 1 : p;
+}
+
+/**
+ * Collect message arguments according to the format
+ *
+ * @return Count of arguments or -EINVAL on unsupported format
+ */
+static int ovpn_status_collect(
+	const char *format, va_list va, ovpn_status_arg_t *args)
+{
+	int nargs = 0;
+	const char *p = format;
+
+	while ((p = strchr(p, '%')))
+	{
+		int pos;
+		char conv;
+
+		if (p[1] == '%')
+		{
+			p += 2;
+			continue;
+		}
+
+		p = ovpn_status_spec(p + 1, &pos, &conv);
+
+		if ((pos >= 0) || (nargs >= OVPN_STATUS_MAX_ARGS))
+			return -EINVAL;
+
+		switch (conv)
+		{
+			case 's':
+				args[nargs].is_str = 1;
+				args[nargs].str = va_arg(va, const char *);
+				if (!args[nargs].str)
+					args[nargs].str = "(null)";
+
+				break;
+
+			case 'd':
+			case 'i':
+				args[nargs].is_str = 0;
+				args[nargs].num = va_arg(va, int);
+				break;
+
+			case 'u':
+				args[nargs].is_str = 0;
+				args[nargs].num = va_arg(va, unsigned int);
+				break;
+
+			default:
+				return -EINVAL;
+		}
+
+		nargs++;
+	}
+
+	return nargs;
+}
+
+/**
+ * Format message like snprintf() does
+ *
+ * Arguments are referenced sequentially or by position ("%2$s").
+ * Conversion characters are ignored, arguments are formatted
+ * according to their types.
+ *
+ * @return Length of the formatted message (excluding terminating null
+ *         character) regardless of the buffer size
+ */
+static size_t ovpn_status_format(
+	char *buf,
+	size_t size,
+	const char *format,
+	const ovpn_status_arg_t *args,
+	unsigned int nargs
+)
+{
+	size_t len = 0;
+	unsigned int next = 0;
+	const char *p = format;
+
+	#define OVPN_STATUS_PUT(data, data_len) \
+		do { \
+			size_t n_ = (data_len); \
+			if (len < size) \
+				memcpy(buf + len, (data), \
+					((size - len) > n_) ? n_ : (size - len)); \
+			len += n_; \
+		} while (0)
+
+	while (*p)
+	{
+		int pos;
+		char conv;
+		const char *pct = strchr(p, '%');
+
+		if (!pct)
+		{
+			OVPN_STATUS_PUT(p, strlen(p));
+			break;
+		}
+
+		OVPN_STATUS_PUT(p, (size_t)(pct - p));
+
+		if (pct[1] == '%')
+		{
+			OVPN_STATUS_PUT("%", 1);
+			p = pct + 2;
+			continue;
+		}
+
+		p = ovpn_status_spec(pct + 1, &pos, &conv);
+
+		if (pos < 0)
+			pos = (int)next++;
+
+		if ((unsigned int)pos >= nargs)
+			continue;
+
+		if (args[pos].is_str)
+			OVPN_STATUS_PUT(args[pos].str, strlen(args[pos].str));
+		else
+		{
+			char num[24];
+			int n = snprintf(num, sizeof(num), "%lld", args[pos].num);
+			OVPN_STATUS_PUT(num, (size_t)n);
+		}
+	}
+
+	#undef OVPN_STATUS_PUT
+
+	if (size)
+		buf[(len < size) ? len : (size - 1)] = '\0';
+
+	return len;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static uint64_t ovpn_status_hash_data(uint64_t hash, const void *data, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+	{
+		hash ^= ((const unsigned char *)data)[i];
+		hash *= 0x100000001b3ull;
+	}
+
+	return hash;
+}
+
+/**
+ * 64-bit FNV-1a hash of the message
+ */
+static uint64_t ovpn_status_hash(const ovpn_status_msg_t *msg)
+{
+	unsigned int i;
+	uint64_t hash = 0xcbf29ce484222325ull;
+
+	/* Messages are identified by the address of the format string */
+	hash = ovpn_status_hash_data(hash, &msg->format, sizeof(msg->format));
+	hash = ovpn_status_hash_data(hash, &msg->type, sizeof(msg->type));
+
+	if (msg->file)
+		hash = ovpn_status_hash_data(hash, msg->file, strlen(msg->file) + 1);
+
+	for (i = 0; i < msg->nargs; i++)
+	{
+		if (msg->args[i].is_str)
+		{
+			hash = ovpn_status_hash_data(hash,
+				msg->args[i].str, strlen(msg->args[i].str) + 1);
+		}
+		else
+		{
+			hash = ovpn_status_hash_data(hash,
+				&msg->args[i].num, sizeof(msg->args[i].num));
+		}
+	}
+
+	return hash;
+}
+
+static int ovpn_status_equal(
+	const ovpn_status_msg_t *a,
+	const ovpn_status_msg_t *b
+)
+{
+	unsigned int i;
+
+	if ((a->format != b->format) ||
+	    (a->type != b->type) ||
+	    (a->nargs != b->nargs) ||
+	    (!a->file != !b->file) ||
+	    (a->file && strcmp(a->file, b->file)))
+		return 0;
+
+	for (i = 0; i < a->nargs; i++)
+	{
+		if (a->args[i].is_str)
+		{
+			if (strcmp(a->args[i].str, b->args[i].str))
+				return 0;
+		}
+		else if (a->args[i].num != b->args[i].num)
+			return 0;
+	}
+
+	return 1;
+}
+
+static int ovpn_status_grow(ovpn_status_t *status)
+{
+	size_t new_size = status->size ? status->size * 2 : OVPN_STATUS_INITIAL_SIZE;
+	ovpn_status_record_t *record;
+	ovpn_status_record_t **buckets = calloc(
+		new_size, sizeof(ovpn_status_record_t *));
+
+	if (!buckets)
+		return -ENOMEM;
+
+	for (record = status->first; record; record = record->next)
+	{
+		size_t i = (size_t)record->hash & (new_size - 1);
+
+		record->chain = buckets[i];
+		buckets[i] = record;
+	}
+
+	free(status->buckets);
+
+	status->buckets = buckets;
+	status->size = new_size;
+	return 0;
+}
+
+static int ovpn_status_add_line(ovpn_status_record_t *record, unsigned int line)
+{
+	if (!line)
+		return 0;
+
+	if (record->lines_count == record->lines_size)
+	{
+		unsigned int new_size = record->lines_size ? record->lines_size * 2 : 4;
+		unsigned int *lines = realloc(record->lines,
+			new_size * sizeof(unsigned int));
+
+		if (!lines)
+			return -ENOMEM;
+
+		record->lines = lines;
+		record->lines_size = new_size;
+	}
+
+	record->lines[record->lines_count++] = line;
+	return 0;
+}
+
+/**
+ * Copy string into the record storage
+ */
+static const char *ovpn_status_record_str(char **strings, const char *str)
+{
+	const char *copy = *strings;
+	size_t len = strlen(str) + 1;
+
+	memcpy(*strings, str, len);
+	*strings += len;
+	return copy;
+}
+
+static ovpn_status_record_t *ovpn_status_record_new(
+	const ovpn_status_msg_t *msg, uint64_t hash)
+{
+	unsigned int i;
+	size_t strings_size = msg->file ? (strlen(msg->file) + 1) : 0;
+	char *strings;
+	ovpn_status_record_t *record;
+
+	for (i = 0; i < msg->nargs; i++)
+	{
+		if (msg->args[i].is_str)
+			strings_size += strlen(msg->args[i].str) + 1;
+	}
+
+	record = calloc(1, sizeof(ovpn_status_record_t) + strings_size);
+	if (!record)
+		return NULL;
+
+	record->hash = hash;
+	record->msg = *msg;
+
+	/* Copy strings to the record storage */
+	strings = record->strings;
+
+	if (msg->file)
+		record->msg.file = ovpn_status_record_str(&strings, msg->file);
+
+	for (i = 0; i < msg->nargs; i++)
+	{
+		if (msg->args[i].is_str)
+		{
+			record->msg.args[i].str =
+				ovpn_status_record_str(&strings, msg->args[i].str);
+		}
+	}
+
+	return record;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Create message JSON object with formatted message text
+ */
+static json_object *ovpn_status_json_new(const ovpn_status_msg_t *msg)
+{
+	size_t len;
+	char buf[256];
+	char *message = buf;
+	const char *format = _(msg->format);
+	json_object *json_message;
+
+	len = ovpn_status_format(buf, sizeof(buf),
+		format, msg->args, msg->nargs);
+
+	if (len >= sizeof(buf))
+	{
+		message = malloc(len + 1);
+		if (!message)
+			return NULL;
+
+		ovpn_status_format(message, len + 1,
+			format, msg->args, msg->nargs);
+	}
+
+	json_message = json_object_new_object();
+	if (json_message)
+	{
+		json_object_object_add(json_message, "type",
+			json_object_new_string(
+				(msg->type == OVPN_MSG_TYPE_ERROR) ? "error" :
+				(msg->type == OVPN_MSG_TYPE_WARNING) ? "warning" : "unknown"));
+
+		json_object_object_add(json_message, "message",
+			json_object_new_string_len(message, (int)len));
+
+		if (msg->file)
+			json_object_object_add(json_message, "file",
+				json_object_new_string(msg->file));
+	}
+
+	if (message != buf)
+		free(message);
+
+	return json_message;
+}
+
+/**
+ * Write message record to the status stream
+ */
+static int ovpn_status_stream_msg(
+	ovpn_t *ovpn, const ovpn_status_msg_t *msg, unsigned int line)
+{
+	int ret;
+	json_object *json_message = ovpn_status_json_new(msg);
+
+	if (!json_message)
+		return -ENOMEM;
+
+	if (line > 0)
+		json_object_object_add(json_message, "line",
+			json_object_new_int((int)line));
+
+	ret = ovpn_json_write(json_message,
+		ovpn->status_stream_flags & ~OVPN_DUMP_FLAG_PRETTY,
+		ovpn->status_stream);
+
+	/* Make the record visible immediately */
+	fflush(ovpn->status_stream);
+
+	json_object_put(json_message);
+	return ret;
+}
+
+/**
+ * Store (or stream) message occurrence without counting it in
+ * errors and warnings counters
+ */
+static int ovpn_status_add(
+	ovpn_t *ovpn, const ovpn_status_msg_t *msg, unsigned int line)
+{
+	uint64_t hash;
+	ovpn_status_t *status;
+	ovpn_status_record_t *record;
+
+	/* Streamed messages are not stored */
+	if (ovpn->status_stream)
+		return ovpn_status_stream_msg(ovpn, msg, line);
+
+	if (!ovpn->status)
+	{
+		ovpn->status = calloc(1, sizeof(ovpn_status_t));
+		if (!ovpn->status)
+			return -ENOMEM;
+	}
+
+	status = ovpn->status;
+	hash = ovpn_status_hash(msg);
+
+	if (status->size)
+	{
+		record = status->buckets[(size_t)hash & (status->size - 1)];
+
+		while (record)
+		{
+			if ((record->hash == hash) && ovpn_status_equal(&record->msg, msg))
+				break;
+
+			record = record->chain;
+		}
+
+		if (record)
+		{
+			record->count++;
+
+			/* Occurrence is still counted in the message when
+			 * its line can not be stored */
+			if (ovpn->max_messages && (status->stored >= ovpn->max_messages))
+				return 0;
+
+			status->stored++;
+			return ovpn_status_add_line(record, line);
+		}
+	}
+
+	if (ovpn->max_messages && (status->stored >= ovpn->max_messages))
+	{
+		status->dropped++;
+		return 0;
+	}
+
+	/* Keep average chain length below 1 */
+	if (status->count >= status->size)
+	{
+		int ret = ovpn_status_grow(status);
+		if (ret)
+			return ret;
+	}
+
+	record = ovpn_status_record_new(msg, hash);
+	if (!record)
+		return -ENOMEM;
+
+	record->count = 1;
+
+	if (ovpn_status_add_line(record, line))
+	{
+		free(record);
+		return -ENOMEM;
+	}
+
+	record->chain = status->buckets[(size_t)hash & (status->size - 1)];
+	status->buckets[(size_t)hash & (status->size - 1)] = record;
+
+	if (status->last)
+		status->last->next = record;
+	else
+		status->first = record;
+
+	status->last = record;
+	status->count++;
+	status->stored++;
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+int ovpn_status_msg(
+	ovpn_t *ovpn,
+	ovpn_msg_type_t msg,
+	unsigned int line,
+	const char *format, ...
+)
+{
+	int nargs;
+	va_list va;
+	ovpn_status_msg_t status_msg;
+
+	switch (msg)
+	{
+		case OVPN_MSG_TYPE_ERROR:
+			ovpn->errors++;
+			break;
+
+		case OVPN_MSG_TYPE_WARNING:
+			ovpn->warnings++;
+			break;
+
+		default:
+			break;
+	}
+
+	va_start(va, format);
+	nargs = ovpn_status_collect(format, va, status_msg.args);
+	va_end(va);
+
+	if (nargs < 0)
+		return nargs;
+
+	status_msg.type = msg;
+	status_msg.format = format;
+	status_msg.nargs = (unsigned int)nargs;
+
+	/* Messages of included files are attributed to the file */
+	status_msg.file = ovpn->parent ? ovpn->path : NULL;
+
+	return ovpn_status_add(ovpn, &status_msg, line);
+}
+
+int ovpn_status_merge(ovpn_t *ovpn, const ovpn_t *src)
+{
+	ovpn_status_record_t *record;
+
+	ovpn->errors += src->errors;
+	ovpn->warnings += src->warnings;
+
+	if (!src->status)
+		return 0;
+
+	for (record = src->status->first; record; record = record->next)
+	{
+		unsigned int i;
+
+		/* Occurrences without stored lines are merged without lines */
+		for (i = 0; i < record->count; i++)
+		{
+			int ret = ovpn_status_add(ovpn, &record->msg,
+				(i < record->lines_count) ? record->lines[i] : 0);
+
+			if (ret)
+				return ret;
+		}
+	}
+
+	if (ovpn->status && !ovpn->status_stream)
+		ovpn->status->dropped += src->status->dropped;
+
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static json_object *ovpn_status_json_message(ovpn_status_record_t *record)
+{
+	json_object *json_message = ovpn_status_json_new(&record->msg);
+
+	if (!json_message)
+		return NULL;
+
+	if (record->count == 1)
+	{
+		if (record->lines_count)
+			json_object_object_add(json_message, "line",
+				json_object_new_int((int)record->lines[0]));
+	}
+	else
+	{
+		/*
+		 * Aggregated message:
+		 * {
+		 *     "type": "warning",
+		 *     "message": "xxxxxx",
+		 *     "lines": [ x, y, ... ],
+		 *     "count": n
+		 * }
+		 */
+		if (record->lines_count)
+		{
+			unsigned int i;
+			json_object *json_lines = json_object_new_array();
+
+			for (i = 0; i < record->lines_count; i++)
+				json_object_array_add(json_lines,
+					json_object_new_int((int)record->lines[i]));
+
+			json_object_object_add(json_message, "lines", json_lines);
+		}
+
+		json_object_object_add(json_message, "count",
+			json_object_new_int((int)record->count));
+	}
+
+	return json_message;
+}
+
+json_object *ovpn_status_json(ovpn_t *ovpn)
+{
+	json_object *json_messages;
+	ovpn_status_record_t *record;
+
+	if (ovpn->json_status)
+		return ovpn->json_status;
+
+	/*
+	 * JSON scheme for status object:
+	 * {
+	 *     "errors": 1,
+	 *     "warning": 1
+	 *     "messages": [
+	 *         {
+	 *             "type": "error",
+	 *             "line": x,
+	 *             "message": "xxxxxx"
+	 *         }, {
+	 *             "type": "warning",
+	 *             "line": x,
+	 *             "message": "xxxxxx"
+	 *         }
+	 *     ],
+	 *     "dropped": n
+	 * }
+	 *
+	 * "dropped" is present only if some messages are dropped.
+	 * "aborted" ({"reason": "<budget>", "line": x}) is present only
+	 * if parsing is aborted due to exhausted budget.
+	 * "messages" is not present if messages are streamed.
+	 */
+	ovpn->json_status = json_object_new_object();
+	if (!ovpn->json_status)
+		return NULL;
+
+	json_object_object_add(ovpn->json_status, "errors",
+		json_object_new_int((int)ovpn->errors));
+
+	json_object_object_add(ovpn->json_status, "warnings",
+		json_object_new_int((int)ovpn->warnings));
+
+	if (ovpn->abort_reason)
+	{
+		json_object *json_aborted = json_object_new_object();
+
+		json_object_object_add(json_aborted, "reason",
+			json_object_new_string(ovpn->abort_reason));
+
+		json_object_object_add(json_aborted, "line",
+			json_object_new_int((int)ovpn->abort_line));
+
+		json_object_object_add(ovpn->json_status, "aborted", json_aborted);
+	}
+
+	if (ovpn->status_stream)
+		return ovpn->json_status;
+
+	json_messages = json_object_new_array();
+	json_object_object_add(ovpn->json_status, "messages", json_messages);
+
+	if (!ovpn->status)
+		return ovpn->json_status;
+
+	for (record = ovpn->status->first; record; record = record->next)
+	{
+		json_object *json_message = ovpn_status_json_message(record);
+		if (json_message)
+			json_object_array_add(json_messages, json_message);
+	}
+
+	if (ovpn->status->dropped)
+	{
+		json_object_object_add(ovpn->json_status, "dropped",
+			json_object_new_int((int)ovpn->status->dropped));
+	}
+
+	return ovpn->json_status;
+}
+
+unsigned int ovpn_status_stored(const ovpn_t *ovpn)
+{
+	return ovpn->status ? ovpn->status->stored : 0;
+}
+
+void ovpn_status_delete(ovpn_status_t *status)
+{
+	ovpn_status_record_t *record;
+
+	if (!status)
+		return;
+
+	record = status->first;
+	while (record)
+	{
+		ovpn_status_record_t *next = record->next;
+
+		free(record->lines);
+		free(record);
+		record = next;
+	}
+
+	free(status->buckets);
+	free(status);
+}
+
+/* ----------------------------------------------------------------------- */
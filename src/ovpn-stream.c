@@ -0,0 +1,578 @@
+/*
+ * OpenVPN Configuration Files Converter
+ * Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Transparent compressed input and output streams
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef OVPN_CONVERT_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef OVPN_CONVERT_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#include <ovpn-stream.h>
+
+/* ----------------------------------------------------------------------- */
+
+/** Size of compressed data buffer */
+#define OVPN_STREAM_BUFFER_SIZE  16384u
+
+/** Count of bytes to detect compression type */
+#define OVPN_STREAM_MAGIC_SIZE  4u
+
+/**
+ * @brief Stream state (fopencookie() cookie)
+ */
+typedef struct
+{
+	/** Underlying stream */
+	FILE *raw;
+
+	/** Compression type */
+	ovpn_stream_compress_t type;
+
+	/** Stream is opened for writing */
+	int is_output;
+
+	/** Compressed data buffer */
+	unsigned char buf[OVPN_STREAM_BUFFER_SIZE];
+
+	/** Count of not consumed (input) bytes in @ref buf */
+	size_t buf_len;
+
+	/** Offset of not consumed (input) bytes in @ref buf */
+	size_t buf_pos;
+
+	/** Underlying input stream end reached */
+	int eof;
+
+	/** Compressed input stream end reached */
+	int done;
+
+#ifdef OVPN_CONVERT_WITH_ZLIB
+	z_stream z;
+#endif
+
+#ifdef OVPN_CONVERT_WITH_ZSTD
+	ZSTD_DStream *zstd_d;
+	ZSTD_CStream *zstd_c;
+#endif
+
+} ovpn_stream_t;
+
+/* ----------------------------------------------------------------------- */
+
+int ovpn_stream_compress_by_name(
+	const char *name, ovpn_stream_compress_t *type)
+{
+	if (!strcmp(name, "none"))
+	{
+		*type = OVPN_STREAM_COMPRESS_NONE;
+		return 0;
+	}
+
+	if (!strcmp(name, "gzip"))
+	{
+#ifdef OVPN_CONVERT_WITH_ZLIB
+		*type = OVPN_STREAM_COMPRESS_GZIP;
+		return 0;
+#else
+		return -ENOTSUP;
+#endif
+	}
+
+	if (!strcmp(name, "zstd"))
+	{
+#ifdef OVPN_CONVERT_WITH_ZSTD
+		*type = OVPN_STREAM_COMPRESS_ZSTD;
+		return 0;
+#else
+		return -ENOTSUP;
+#endif
+	}
+
+	return -EINVAL;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Refill input buffer from the underlying stream
+ * if all buffered data is consumed
+ */
+static void ovpn_stream_fill(ovpn_stream_t *s)
+{
+	if ((s->buf_pos < s->buf_len) || s->eof)
+		return;
+
+	s->buf_pos = 0;
+	s->buf_len = fread(s->buf, 1, sizeof(s->buf), s->raw);
+
+	if (!s->buf_len)
+		s->eof = 1;
+}
+
+static ssize_t ovpn_stream_read_plain(ovpn_stream_t *s, char *out, size_t size)
+{
+	size_t n;
+
+	/* Return peeked magic bytes first */
+	if (s->buf_pos < s->buf_len)
+	{
+		n = s->buf_len - s->buf_pos;
+		if (n > size)
+			n = size;
+
+		memcpy(out, s->buf + s->buf_pos, n);
+		s->buf_pos += n;
+		return (ssize_t)n;
+	}
+
+	n = fread(out, 1, size, s->raw);
+	if (!n && ferror(s->raw))
+	{
+		errno = EIO;
+		return -1;
+	}
+
+	return (ssize_t)n;
+}
+
+#ifdef OVPN_CONVERT_WITH_ZLIB
+static ssize_t ovpn_stream_read_gzip(ovpn_stream_t *s, char *out, size_t size)
+{
+	s->z.next_out = (Bytef *)out;
+	s->z.avail_out = (uInt)size;
+
+	while (!s->done && (s->z.avail_out == size))
+	{
+		int ret;
+
+		ovpn_stream_fill(s);
+		if (s->buf_pos >= s->buf_len)
+		{
+			/* Truncated compressed stream */
+			errno = EIO;
+			return -1;
+		}
+
+		s->z.next_in = s->buf + s->buf_pos;
+		s->z.avail_in = (uInt)(s->buf_len - s->buf_pos);
+
+		ret = inflate(&s->z, Z_NO_FLUSH);
+		s->buf_pos = s->buf_len - s->z.avail_in;
+
+		if (ret == Z_STREAM_END)
+		{
+			/* Continue with the next concatenated gzip member if any */
+			ovpn_stream_fill(s);
+			if (s->buf_pos < s->buf_len)
+				inflateReset(&s->z);
+			else
+				s->done = 1;
+		}
+		else if ((ret != Z_OK) && (ret != Z_BUF_ERROR))
+		{
+			errno = EIO;
+			return -1;
+		}
+	}
+
+	return (ssize_t)(size - s->z.avail_out);
+}
+
+static ssize_t ovpn_stream_write_gzip(
+	ovpn_stream_t *s, const char *data, size_t size, int flush)
+{
+	int ret;
+
+	s->z.next_in = (Bytef *)data;
+	s->z.avail_in = (uInt)size;
+
+	do
+	{
+		size_t n;
+
+		s->z.next_out = s->buf;
+		s->z.avail_out = sizeof(s->buf);
+
+		ret = deflate(&s->z, flush);
+		if (ret == Z_STREAM_ERROR)
+		{
+			errno = EIO;
+			return -1;
+		}
+
+		n = sizeof(s->buf) - s->z.avail_out;
+		if (n && (fwrite(s->buf, 1, n, s->raw) != n))
+		{
+			errno = EIO;
+			return -1;
+		}
+	}
+	while ((s->z.avail_in > 0) ||
+	       ((flush == Z_FINISH) && (ret != Z_STREAM_END)));
+
+	return (ssize_t)size;
+}
+#endif
+
+#ifdef OVPN_CONVERT_WITH_ZSTD
+static ssize_t ovpn_stream_read_zstd(ovpn_stream_t *s, char *out, size_t size)
+{
+	ZSTD_outBuffer zout = { .dst = out, .size = size, .pos = 0 };
+
+	while (!zout.pos)
+	{
+		size_t ret;
+		ZSTD_inBuffer zin;
+
+		ovpn_stream_fill(s);
+		if (s->buf_pos >= s->buf_len)
+		{
+			/* All frames must be complete at the end of stream */
+			if (!s->done)
+			{
+				errno = EIO;
+				return -1;
+			}
+
+			break;
+		}
+
+		zin.src = s->buf;
+		zin.size = s->buf_len;
+		zin.pos = s->buf_pos;
+
+		ret = ZSTD_decompressStream(s->zstd_d, &zout, &zin);
+		s->buf_pos = zin.pos;
+
+		if (ZSTD_isError(ret))
+		{
+			errno = EIO;
+			return -1;
+		}
+
+		/* Frame completely decoded and flushed */
+		s->done = (ret == 0);
+	}
+
+	return (ssize_t)zout.pos;
+}
+
+static ssize_t ovpn_stream_write_zstd(
+	ovpn_stream_t *s, const char *data, size_t size, ZSTD_EndDirective end)
+{
+	size_t remaining;
+	ZSTD_inBuffer zin = { .src = data, .size = size, .pos = 0 };
+
+	do
+	{
+		ZSTD_outBuffer zout = { .dst = s->buf, .size = sizeof(s->buf), .pos = 0 };
+
+		remaining = ZSTD_compressStream2(s->zstd_c, &zout, &zin, end);
+		if (ZSTD_isError(remaining))
+		{
+			errno = EIO;
+			return -1;
+		}
+
+		if (zout.pos && (fwrite(s->buf, 1, zout.pos, s->raw) != zout.pos))
+		{
+			errno = EIO;
+			return -1;
+		}
+	}
+	while ((zin.pos < zin.size) || ((end == ZSTD_e_end) && remaining));
+
+	return (ssize_t)size;
+}
+#endif
+
+/* ----------------------------------------------------------------------- */
+
+static ssize_t ovpn_stream_cookie_read(void *cookie, char *buf, size_t size)
+{
+	ovpn_stream_t *s = cookie;
+
+	switch (s->type)
+	{
+#ifdef OVPN_CONVERT_WITH_ZLIB
+		case OVPN_STREAM_COMPRESS_GZIP:
+			return ovpn_stream_read_gzip(s, buf, size);
+#endif
+
+#ifdef OVPN_CONVERT_WITH_ZSTD
+		case OVPN_STREAM_COMPRESS_ZSTD:
+			return ovpn_stream_read_zstd(s, buf, size);
+#endif
+
+		default:
+			return ovpn_stream_read_plain(s, buf, size);
+	}
+}
+
+static ssize_t ovpn_stream_cookie_write(
+	void *cookie, const char *buf, size_t size)
+{
+	ovpn_stream_t *s = cookie;
+
+	switch (s->type)
+	{
+#ifdef OVPN_CONVERT_WITH_ZLIB
+		case OVPN_STREAM_COMPRESS_GZIP:
+			return ovpn_stream_write_gzip(s, buf, size, Z_NO_FLUSH);
+#endif
+
+#ifdef OVPN_CONVERT_WITH_ZSTD
+		case OVPN_STREAM_COMPRESS_ZSTD:
+			return ovpn_stream_write_zstd(s, buf, size, ZSTD_e_continue);
+#endif
+
+		default:
+			errno = EINVAL;
+			return -1;
+	}
+}
+
+static int ovpn_stream_cookie_close(void *cookie)
+{
+	int ret = 0;
+	ovpn_stream_t *s = cookie;
+
+	switch (s->type)
+	{
+#ifdef OVPN_CONVERT_WITH_ZLIB
+		case OVPN_STREAM_COMPRESS_GZIP:
+			if (s->is_output)
+			{
+				/* Writing stream: finish compressed data */
+				if (ovpn_stream_write_gzip(s, NULL, 0, Z_FINISH) < 0)
+					ret = -1;
+
+				deflateEnd(&s->z);
+			}
+			else
+				inflateEnd(&s->z);
+
+			break;
+#endif
+
+#ifdef OVPN_CONVERT_WITH_ZSTD
+		case OVPN_STREAM_COMPRESS_ZSTD:
+			if (s->zstd_c)
+			{
+				if (ovpn_stream_write_zstd(s, NULL, 0, ZSTD_e_end) < 0)
+					ret = -1;
+
+				ZSTD_freeCStream(s->zstd_c);
+			}
+
+			if (s->zstd_d)
+				ZSTD_freeDStream(s->zstd_d);
+
+			break;
+#endif
+
+		default:
+			break;
+	}
+
+	if (fflush(s->raw))
+		ret = -1;
+
+	free(s);
+	return ret;
+}
+
+/* ----------------------------------------------------------------------- */
+
+static ovpn_stream_compress_t ovpn_stream_detect(
+	const unsigned char *magic, size_t len)
+{
+	if ((len >= 2) && (magic[0] == 0x1f) && (magic[1] == 0x8b))
+		return OVPN_STREAM_COMPRESS_GZIP;
+
+	if ((len >= 4) && (magic[0] == 0x28) && (magic[1] == 0xb5) &&
+	    (magic[2] == 0x2f) && (magic[3] == 0xfd))
+		return OVPN_STREAM_COMPRESS_ZSTD;
+
+	return OVPN_STREAM_COMPRESS_NONE;
+}
+
+FILE *ovpn_stream_open_input(FILE *raw)
+{
+	FILE *stream;
+	ovpn_stream_t *s;
+	unsigned char magic[OVPN_STREAM_MAGIC_SIZE];
+	size_t magic_len;
+	ovpn_stream_compress_t type;
+	long pos = ftell(raw);
+
+	cookie_io_functions_t io = {
+		.read  = ovpn_stream_cookie_read,
+		.close = ovpn_stream_cookie_close,
+	};
+
+	magic_len = fread(magic, 1, sizeof(magic), raw);
+	type = ovpn_stream_detect(magic, magic_len);
+
+	if (type == OVPN_STREAM_COMPRESS_NONE)
+	{
+		/* Uncompressed seekable stream can be used directly */
+		if ((pos >= 0) && !fseek(raw, pos, SEEK_SET))
+			return raw;
+	}
+
+#ifndef OVPN_CONVERT_WITH_ZLIB
+	if (type == OVPN_STREAM_COMPRESS_GZIP)
+	{
+		fprintf(stderr, "gzip compressed input is not supported\n");
+		return NULL;
+	}
+#endif
+
+#ifndef OVPN_CONVERT_WITH_ZSTD
+	if (type == OVPN_STREAM_COMPRESS_ZSTD)
+	{
+		fprintf(stderr, "zstd compressed input is not supported\n");
+		return NULL;
+	}
+#endif
+
+	s = calloc(1, sizeof(ovpn_stream_t));
+	if (!s)
+		return NULL;
+
+	s->raw = raw;
+	s->type = type;
+
+	/* Peeked bytes are consumed first */
+	memcpy(s->buf, magic, magic_len);
+	s->buf_len = magic_len;
+
+	switch (type)
+	{
+#ifdef OVPN_CONVERT_WITH_ZLIB
+		case OVPN_STREAM_COMPRESS_GZIP:
+			if (inflateInit2(&s->z, 15 + 16) != Z_OK)
+				goto out_error;
+
+			break;
+#endif
+
+#ifdef OVPN_CONVERT_WITH_ZSTD
+		case OVPN_STREAM_COMPRESS_ZSTD:
+			s->zstd_d = ZSTD_createDStream();
+			if (!s->zstd_d)
+				goto out_error;
+
+			ZSTD_initDStream(s->zstd_d);
+			break;
+#endif
+
+		default:
+			break;
+	}
+
+	stream = fopencookie(s, "r", io);
+	if (!stream)
+	{
+		ovpn_stream_cookie_close(s);
+		return NULL;
+	}
+
+	return stream;
+
+out_error:
+	free(s);
+	return NULL;
+}
+
+FILE *ovpn_stream_open_output(FILE *raw, ovpn_stream_compress_t type)
+{
+	FILE *stream;
+	ovpn_stream_t *s;
+
+	cookie_io_functions_t io = {
+		.write = ovpn_stream_cookie_write,
+		.close = ovpn_stream_cookie_close,
+	};
+
+	if (type == OVPN_STREAM_COMPRESS_NONE)
+		return raw;
+
+	s = calloc(1, sizeof(ovpn_stream_t));
+	if (!s)
+		return NULL;
+
+	s->raw = raw;
+	s->type = type;
+	s->is_output = 1;
+
+	switch (type)
+	{
+#ifdef OVPN_CONVERT_WITH_ZLIB
+		case OVPN_STREAM_COMPRESS_GZIP:
+			if (deflateInit2(&s->z, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+					15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+				goto out_error;
+
+			break;
+#endif
+
+#ifdef OVPN_CONVERT_WITH_ZSTD
+		case OVPN_STREAM_COMPRESS_ZSTD:
+			s->zstd_c = ZSTD_createCStream();
+			if (!s->zstd_c)
+				goto out_error;
+
+			ZSTD_initCStream(s->zstd_c, ZSTD_CLEVEL_DEFAULT);
+			break;
+#endif
+
+		default:
+			goto out_error;
+	}
+
+	stream = fopencookie(s, "w", io);
+	if (!stream)
+	{
+		ovpn_stream_cookie_close(s);
+		return NULL;
+	}
+
+	return stream;
+
+out_error:
+	free(s);
+	return NULL;
+}
+
+int ovpn_stream_close(FILE *stream, FILE *raw)
+{
+	if (!stream)
+		return 0;
+
+	if (stream == raw)
+		return fflush(raw) ? -EIO : 0;
+
+	return fclose(stream) ? -EIO : 0;
+}
+
+/* ----------------------------------------------------------------------- */
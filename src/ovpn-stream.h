@@ -0,0 +1,87 @@
+/*
+ * OpenVPN Configuration Files Converter
+ * Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+#ifndef OVPN_STREAM_H
+#define OVPN_STREAM_H
+
+#include <stdio.h>
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Stream compression types
+ */
+typedef enum
+{
+	/** No compression */
+	OVPN_STREAM_COMPRESS_NONE = 0,
+
+	/** gzip (RFC 1952) */
+	OVPN_STREAM_COMPRESS_GZIP,
+
+	/** Zstandard (RFC 8878) */
+	OVPN_STREAM_COMPRESS_ZSTD,
+
+} ovpn_stream_compress_t;
+
+/**
+ * Get compression type by name ("none", "gzip" or "zstd")
+ *
+ * @return 0 on success
+ * @return -EINVAL if name is unknown
+ * @return -ENOTSUP if compression type is not supported by this build
+ */
+int ovpn_stream_compress_by_name(
+	const char *name, ovpn_stream_compress_t *type);
+
+/**
+ * Open input stream with transparent decompression
+ *
+ * Compression type is detected by magic bytes at the beginning
+ * of @p raw stream. Data is decompressed on the fly with bounded
+ * buffers. Returned stream must be closed with @ref ovpn_stream_close().
+ *
+ * @param[in] raw  Source stream
+ *
+ * @return Stream for reading decompressed data (may be @p raw itself
+ *         for uncompressed seekable streams) or NULL on error
+ */
+FILE *ovpn_stream_open_input(FILE *raw);
+
+/**
+ * Open output stream with compression
+ *
+ * Compressed stream is finished and flushed to @p raw on
+ * @ref ovpn_stream_close().
+ *
+ * @param[in] raw   Destination stream
+ * @param[in] type  Compression type
+ *
+ * @return Stream for writing data (@p raw itself if @p type is
+ *         @ref OVPN_STREAM_COMPRESS_NONE) or NULL on error
+ */
+FILE *ovpn_stream_open_output(FILE *raw, ovpn_stream_compress_t type);
+
+/**
+ * Close stream opened by @ref ovpn_stream_open_input() or
+ * @ref ovpn_stream_open_output()
+ *
+ * The underlying @p raw stream is flushed but not closed.
+ *
+ * @param[in] stream  Stream to close
+ * @param[in] raw     Underlying stream passed to the open function
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int ovpn_stream_close(FILE *stream, FILE *raw);
+
+/* ----------------------------------------------------------------------- */
+
+#endif /* OVPN_STREAM_H */
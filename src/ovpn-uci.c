@@ -0,0 +1,362 @@
+/*
+ * OpenVPN Configuration Files Converter
+ * Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief OpenWrt UCI output (config file and "uci batch" commands)
+ *
+ * Parsed options are written as "openvpn" section options directly
+ * to the output stream in a single pass. Options that can be specified
+ * several times are written as lists, plain inline data is written to
+ * separate files that are referenced by path.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h> /* PATH_MAX */
+
+#include <ovpn.h>
+
+/* ----------------------------------------------------------------------- */
+
+/** UCI package name */
+#define OVPN_UCI_PACKAGE  "openvpn"
+
+/**
+ * @brief UCI writer state
+ */
+typedef struct
+{
+	/** Output format (OVPN_FORMAT_UCI or OVPN_FORMAT_UCI_BATCH) */
+	ovpn_format_t format;
+
+	/** Settings */
+	const ovpn_uci_opts_t *opts;
+
+	/** Output stream */
+	FILE *stream;
+
+} ovpn_uci_t;
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Write UCI name (option and section names can contain
+ * only alphanumeric characters and underscores)
+ */
+static void ovpn_uci_name(FILE *stream, const char *name)
+{
+	for (; *name; name++)
+	{
+		if (((*name >= 'a') && (*name <= 'z')) ||
+		    ((*name >= 'A') && (*name <= 'Z')) ||
+		    ((*name >= '0') && (*name <= '9')))
+			fputc(*name, stream);
+		else
+			fputc('_', stream);
+	}
+}
+
+/**
+ * Write single-quoted UCI value part
+ */
+static void ovpn_uci_quoted(FILE *stream, const char *value, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+	{
+		if (value[i] == '\'')
+			fputs("'\\''", stream);
+		else
+			fputc(value[i], stream);
+	}
+}
+
+/**
+ * Write option argument in OpenVPN configuration syntax
+ *
+ * Arguments with whitespaces, quotes or backslashes are
+ * double-quoted, so the value can be written to OpenVPN
+ * configuration as is.
+ */
+static void ovpn_uci_arg(FILE *stream, const char *arg, size_t len)
+{
+	size_t i;
+
+	if (len && (strcspn(arg, " \t\"'\\") >= len))
+	{
+		ovpn_uci_quoted(stream, arg, len);
+		return;
+	}
+
+	fputc('"', stream);
+
+	for (i = 0; i < len; i++)
+	{
+		if ((arg[i] == '"') || (arg[i] == '\\'))
+			fputc('\\', stream);
+
+		ovpn_uci_quoted(stream, &arg[i], 1);
+	}
+
+	fputc('"', stream);
+}
+
+/**
+ * Write option or list item
+ *
+ * Argument of the "push" option is written as is, as OpenWrt
+ * init script quotes pushed options by itself.
+ *
+ * @param[in] u      UCI writer
+ * @param[in] list   Write list item
+ * @param[in] name   Option name
+ * @param[in] args   Option arguments array (NULL - @p value is used)
+ * @param[in] value  Option value
+ */
+static void ovpn_uci_option(
+	ovpn_uci_t *u,
+	int list,
+	const char *name,
+	json_object *args,
+	const char *value
+)
+{
+	if (u->format == OVPN_FORMAT_UCI_BATCH)
+	{
+		fputs(list ? "add_list " OVPN_UCI_PACKAGE "." : "set " OVPN_UCI_PACKAGE ".",
+			u->stream);
+
+		ovpn_uci_name(u->stream, u->opts->section);
+		fputc('.', u->stream);
+		ovpn_uci_name(u->stream, name);
+		fputs("='", u->stream);
+	}
+	else
+	{
+		fputs(list ? "\tlist " : "\toption ", u->stream);
+		ovpn_uci_name(u->stream, name);
+		fputs(" '", u->stream);
+	}
+
+	if (args)
+	{
+		size_t i;
+		size_t count = json_object_array_length(args);
+
+		if (!count)
+		{
+			/* Flag option */
+			fputc('1', u->stream);
+		}
+
+		for (i = 0; i < count; i++)
+		{
+			json_object *arg = json_object_array_get_idx(args, i);
+
+			if (i)
+				fputc(' ', u->stream);
+
+			if (!strcmp(name, "push"))
+				ovpn_uci_quoted(u->stream, json_object_get_string(arg),
+					(size_t)json_object_get_string_len(arg));
+			else
+				ovpn_uci_arg(u->stream, json_object_get_string(arg),
+					(size_t)json_object_get_string_len(arg));
+		}
+	}
+	else
+		ovpn_uci_quoted(u->stream, value, strlen(value));
+
+	fputs("'\n", u->stream);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static void ovpn_uci_options(ovpn_uci_t *u, json_object *json_options)
+{
+	json_object_object_foreach(json_options, name, occurrences)
+	{
+		size_t i;
+		size_t count = json_object_array_length(occurrences);
+		const ovpn_opt_info_t *opt = ovpn_opt_find(name, 0, SIZE_MAX);
+		int list = opt ? !!(opt->flags & OVPN_OPT_FLAG_MULTIPLE) : (count > 1);
+		json_object *args;
+
+		if (!count)
+			continue;
+
+		/* Last occurrence of a single-valued option takes effect */
+		for (i = list ? 0 : (count - 1); i < count; i++)
+		{
+			if (json_object_object_get_ex(
+					json_object_array_get_idx(occurrences, i), "args", &args))
+				ovpn_uci_option(u, list, name, args, NULL);
+		}
+	}
+}
+
+/**
+ * Write plain inline data to file
+ *
+ * File is replaced atomically and is readable only by owner,
+ * as inline data usually contains private keys.
+ */
+static int ovpn_uci_inline_file(
+	const char *path, const char *data, size_t len)
+{
+	int fd;
+	int ret = 0;
+	char tmp_path[PATH_MAX];
+
+	if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (int)sizeof(tmp_path))
+		return -ENAMETOOLONG;
+
+	fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	if (fd < 0)
+	{
+		fprintf(stderr, "Could not open file '%s'\n", tmp_path);
+		return -ENODEV;
+	}
+
+	while (len)
+	{
+		ssize_t written = write(fd, data, len);
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			ret = -errno;
+			break;
+		}
+
+		data += written;
+		len -= (size_t)written;
+	}
+
+	if (close(fd) && !ret)
+		ret = -EIO;
+
+	if (!ret && rename(tmp_path, path))
+		ret = -errno;
+
+	if (ret)
+		unlink(tmp_path);
+
+	return ret;
+}
+
+static int ovpn_uci_inlines(ovpn_uci_t *u, json_object *json_inlines)
+{
+	char dir[PATH_MAX];
+	char path[PATH_MAX];
+	const char *inline_dir = u->opts->inline_dir ? u->opts->inline_dir : ".";
+
+	/* Referenced paths are absolute */
+	if (inline_dir[0] == '/')
+		snprintf(dir, sizeof(dir), "%s", inline_dir);
+	else if (getcwd(dir, sizeof(dir)))
+	{
+		size_t len = strlen(dir);
+
+		if (strcmp(inline_dir, "."))
+			snprintf(dir + len, sizeof(dir) - len, "/%s", inline_dir);
+	}
+	else
+		return -errno;
+
+	json_object_object_foreach(json_inlines, name, json_inline)
+	{
+		int ret;
+		size_t count;
+		json_object *json_type;
+		json_object *json_data;
+		json_object *data;
+
+		if (!json_object_object_get_ex(json_inline, "type", &json_type) ||
+		    !json_object_object_get_ex(json_inline, "data", &json_data) ||
+		    !(count = json_object_array_length(json_data)))
+			continue;
+
+		if (strcmp(json_object_get_string(json_type), "plain"))
+		{
+			fprintf(stderr,
+				"Inline <%s> blocks can't be represented in UCI and are skipped\n",
+				name);
+
+			continue;
+		}
+
+		/* Last occurrence of inline data takes effect */
+		data = json_object_array_get_idx(json_data, count - 1);
+
+		if (snprintf(path, sizeof(path), "%s/%s.%s",
+				dir, u->opts->section, name) >= (int)sizeof(path))
+			return -ENAMETOOLONG;
+
+		ret = ovpn_uci_inline_file(path, json_object_get_string(data),
+			(size_t)json_object_get_string_len(data));
+
+		if (ret)
+			return ret;
+
+		ovpn_uci_option(u, 0, name, NULL, path);
+	}
+
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+int ovpn_dump_uci(
+	ovpn_t *ovpn,
+	ovpn_format_t format,
+	const ovpn_uci_opts_t *opts,
+	FILE *stream
+)
+{
+	int ret;
+	ovpn_uci_t u = {
+		.format = format,
+		.opts   = opts,
+		.stream = stream,
+	};
+
+	if (!ovpn || !ovpn->json || !OVPN_FORMAT_IS_UCI(format))
+		return -1;
+
+	if (format == OVPN_FORMAT_UCI_BATCH)
+	{
+		fputs("set " OVPN_UCI_PACKAGE ".", stream);
+		ovpn_uci_name(stream, opts->section);
+		fputs("=" OVPN_UCI_PACKAGE "\n", stream);
+	}
+	else
+	{
+		fputs("config " OVPN_UCI_PACKAGE " '", stream);
+		ovpn_uci_name(stream, opts->section);
+		fputs("'\n", stream);
+	}
+
+	ovpn_uci_options(&u, ovpn->json_options);
+
+	/* Inline data references override options with file paths */
+	ret = ovpn_uci_inlines(&u, ovpn->json_inlines);
+	if (ret)
+		return ret;
+
+	if (format == OVPN_FORMAT_UCI)
+		fputc('\n', stream);
+
+	return ferror(stream) ? -EIO : 0;
+}
+
+/* ----------------------------------------------------------------------- */
@@ -0,0 +1,789 @@
+/*
+ * OpenVPN Configuration Files Converter
+ * Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Directory watch mode
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <poll.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+
+#include <ovpn-watch.h>
+#include <ovpn-workers.h>
+
+/* ----------------------------------------------------------------------- */
+
+/** Watched directory events */
+#define OVPN_WATCH_DIR_MASK \
+	(IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | \
+	 IN_CREATE | IN_DELETE | IN_DELETE_SELF | IN_ONLYDIR)
+
+/** Pending action: convert source file */
+#define OVPN_WATCH_ACTION_CONVERT  0
+
+/** Pending action: remove output file */
+#define OVPN_WATCH_ACTION_REMOVE   1
+
+/**
+ * @brief Pending (debounced) source file change
+ */
+typedef struct
+{
+	/** Source file path */
+	char *path;
+
+	/** Time (ms) after which the change is processed */
+	uint64_t deadline;
+
+	/** Action (OVPN_WATCH_ACTION_*) */
+	int action;
+
+} ovpn_watch_pending_t;
+
+/**
+ * @brief Watched directory
+ */
+typedef struct
+{
+	/** Inotify watch descriptor */
+	int wd;
+
+	/** Directory path */
+	char *path;
+
+} ovpn_watch_dir_t;
+
+/**
+ * @brief Watch mode state
+ */
+typedef struct
+{
+	/** Settings */
+	const ovpn_watch_opts_t *opts;
+
+	/** Watched directory tree root */
+	const char *root;
+
+	/** Output files mode (0666 without umask bits) */
+	mode_t mode;
+
+	/** Inotify file descriptor */
+	int fd;
+
+	/** Watched directories */
+	ovpn_watch_dir_t *dirs;
+	size_t dirs_count;
+	size_t dirs_size;
+
+	/** Pending source file changes */
+	ovpn_watch_pending_t *pending;
+	size_t pending_count;
+	size_t pending_size;
+
+	/** Source files collected for the next conversion batch */
+	char **batch;
+	size_t batch_count;
+	size_t batch_size;
+
+} ovpn_watch_t;
+
+static volatile sig_atomic_t ovpn_watch_stop = 0;
+
+/* ----------------------------------------------------------------------- */
+
+static void ovpn_watch_signal(int sig)
+{
+	(void)sig;
+	ovpn_watch_stop = 1;
+}
+
+static uint64_t ovpn_watch_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+static int ovpn_watch_has_suffix(const char *name, const char *suffix)
+{
+	size_t name_len = strlen(name);
+	size_t suffix_len = strlen(suffix);
+
+	return (name_len > suffix_len) &&
+		!strcmp(name + name_len - suffix_len, suffix);
+}
+
+static char *ovpn_watch_join(const char *dir, const char *name)
+{
+	char *path;
+
+	if (asprintf(&path, "%s/%s", dir, name) < 0)
+		return NULL;
+
+	return path;
+}
+
+/**
+ * Grow dynamic array to hold at least @p count + 1 items
+ */
+static int ovpn_watch_reserve(
+	void **items, size_t *size, size_t count, size_t item_size)
+{
+	void *new_items;
+	size_t new_size;
+
+	if (count < *size)
+		return 0;
+
+	new_size = *size ? (*size * 2) : 16;
+	new_items = realloc(*items, new_size * item_size);
+	if (!new_items)
+		return -ENOMEM;
+
+	*items = new_items;
+	*size = new_size;
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Get output file path for source file
+ *
+ * @return Output file path (must be freed) or NULL on error
+ */
+static char *ovpn_watch_dst_path(const char *src_path)
+{
+	char *dst_path;
+	size_t base_len =
+		strlen(src_path) - strlen(OVPN_WATCH_SRC_SUFFIX);
+
+	if (asprintf(&dst_path, "%.*s" OVPN_WATCH_DST_SUFFIX,
+			(int)base_len, src_path) < 0)
+		return NULL;
+
+	return dst_path;
+}
+
+/**
+ * Check that output file is missing or older than source file
+ */
+static int ovpn_watch_outdated(const char *src_path)
+{
+	int ret;
+	char *dst_path;
+	struct stat src_st;
+	struct stat dst_st;
+
+	dst_path = ovpn_watch_dst_path(src_path);
+	if (!dst_path)
+		return 1;
+
+	ret = stat(src_path, &src_st) || stat(dst_path, &dst_st) ||
+		(dst_st.st_mtim.tv_sec < src_st.st_mtim.tv_sec) ||
+		((dst_st.st_mtim.tv_sec == src_st.st_mtim.tv_sec) &&
+		 (dst_st.st_mtim.tv_nsec < src_st.st_mtim.tv_nsec));
+
+	free(dst_path);
+	return ret;
+}
+
+/**
+ * Convert source file and atomically replace output file
+ */
+static int ovpn_watch_convert(const ovpn_watch_t *watch, const char *src_path)
+{
+	int fd;
+	int ret;
+	FILE *stream;
+	char *dst_path;
+	char *tmp_path;
+
+	dst_path = ovpn_watch_dst_path(src_path);
+	if (!dst_path)
+		return -ENOMEM;
+
+	if (asprintf(&tmp_path, "%s.XXXXXX", dst_path) < 0)
+	{
+		free(dst_path);
+		return -ENOMEM;
+	}
+
+	fd = mkstemp(tmp_path);
+	if (fd < 0)
+	{
+		ret = -errno;
+		fprintf(stderr, "Could not create file '%s'\n", tmp_path);
+		goto out;
+	}
+
+	/* Temporary file is created with 0600 mode, output file
+	 * gets the same mode as a file created by fopen() */
+	if (fchmod(fd, watch->mode))
+	{
+		ret = -errno;
+		fprintf(stderr, "Could not set mode of file '%s'\n", tmp_path);
+		close(fd);
+		unlink(tmp_path);
+		goto out;
+	}
+
+	stream = fdopen(fd, "w");
+	if (!stream)
+	{
+		ret = -errno;
+		close(fd);
+		unlink(tmp_path);
+		goto out;
+	}
+
+	ret = watch->opts->convert(src_path, stream);
+
+	if (fclose(stream) && !ret)
+		ret = -EIO;
+
+	if (!ret && rename(tmp_path, dst_path))
+		ret = -errno;
+
+	if (ret)
+	{
+		fprintf(stderr, "Failed to convert file '%s'\n", src_path);
+		unlink(tmp_path);
+	}
+
+out:
+	free(tmp_path);
+	free(dst_path);
+	return ret;
+}
+
+static void ovpn_watch_remove(const char *src_path)
+{
+	char *dst_path = ovpn_watch_dst_path(src_path);
+
+	if (!dst_path)
+		return;
+
+	unlink(dst_path);
+	free(dst_path);
+}
+
+static void ovpn_watch_batch_worker(size_t idx, void *arg)
+{
+	ovpn_watch_t *watch = arg;
+	ovpn_watch_convert(watch, watch->batch[idx]);
+}
+
+/**
+ * Convert all collected batch files in parallel and clear batch
+ */
+static void ovpn_watch_batch_run(ovpn_watch_t *watch)
+{
+	size_t i;
+
+	if (ovpn_workers_run(watch->batch_count, watch->opts->threads,
+			ovpn_watch_batch_worker, watch))
+	{
+		/* Fallback to sequential conversion */
+		for (i = 0; i < watch->batch_count; i++)
+			ovpn_watch_convert(watch, watch->batch[i]);
+	}
+
+	for (i = 0; i < watch->batch_count; i++)
+		free(watch->batch[i]);
+
+	watch->batch_count = 0;
+}
+
+static int ovpn_watch_batch_add(ovpn_watch_t *watch, char *path)
+{
+	int ret = ovpn_watch_reserve((void **)&watch->batch,
+		&watch->batch_size, watch->batch_count, sizeof(char *));
+
+	if (ret)
+	{
+		free(path);
+		return ret;
+	}
+
+	watch->batch[watch->batch_count++] = path;
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Add inotify watches for directory tree @p path and add all
+ * found source files to the conversion batch
+ *
+ * @param[in] watch     Watch mode state
+ * @param[in] path      Directory path
+ * @param[in] outdated  Add only source files with missing or outdated
+ *                      output files
+ */
+static int ovpn_watch_add_tree(
+	ovpn_watch_t *watch, const char *path, int outdated)
+{
+	int wd;
+	int ret = 0;
+	int is_dir;
+	size_t i = 0;
+	char *dir_path;
+	DIR *dir;
+	struct dirent *entry;
+
+	wd = inotify_add_watch(watch->fd, path, OVPN_WATCH_DIR_MASK);
+	if (wd < 0)
+	{
+		fprintf(stderr, "Could not watch directory '%s'\n", path);
+		return -errno;
+	}
+
+	dir_path = strdup(path);
+	if (!dir_path)
+		return -ENOMEM;
+
+	/* Already watched directory (e.g. moved within the tree) has
+	 * the same watch descriptor, only its path is updated */
+	while ((i < watch->dirs_count) && (watch->dirs[i].wd != wd))
+		i++;
+
+	if (i == watch->dirs_count)
+	{
+		ret = ovpn_watch_reserve((void **)&watch->dirs, &watch->dirs_size,
+			watch->dirs_count, sizeof(ovpn_watch_dir_t));
+		if (ret)
+		{
+			free(dir_path);
+			return ret;
+		}
+
+		watch->dirs[i].wd = wd;
+		watch->dirs[i].path = NULL;
+		watch->dirs_count++;
+	}
+
+	free(watch->dirs[i].path);
+	watch->dirs[i].path = dir_path;
+
+	dir = opendir(path);
+	if (!dir)
+		return -errno;
+
+	while ((entry = readdir(dir)))
+	{
+		char *entry_path;
+
+		if (entry->d_name[0] == '.')
+			continue;
+
+		entry_path = ovpn_watch_join(path, entry->d_name);
+		if (!entry_path)
+		{
+			ret = -ENOMEM;
+			break;
+		}
+
+		is_dir = (entry->d_type == DT_DIR);
+		if (entry->d_type == DT_UNKNOWN)
+		{
+			/* Symbolic links to directories are not followed
+			 * (as for DT_LNK entries), so link loops are harmless */
+			struct stat st;
+			is_dir = !lstat(entry_path, &st) && S_ISDIR(st.st_mode);
+		}
+
+		if (!is_dir &&
+		    !ovpn_watch_has_suffix(entry->d_name, OVPN_WATCH_SRC_SUFFIX))
+		{
+			free(entry_path);
+			continue;
+		}
+
+		if (is_dir)
+		{
+			ret = ovpn_watch_add_tree(watch, entry_path, outdated);
+			free(entry_path);
+		}
+		else if (outdated && !ovpn_watch_outdated(entry_path))
+		{
+			free(entry_path);
+			ret = 0;
+		}
+		else
+			ret = ovpn_watch_batch_add(watch, entry_path);
+
+		if (ret)
+			break;
+	}
+
+	closedir(dir);
+	return ret;
+}
+
+static const char *ovpn_watch_dir_path(const ovpn_watch_t *watch, int wd)
+{
+	size_t i;
+
+	for (i = 0; i < watch->dirs_count; i++)
+	{
+		if (watch->dirs[i].wd == wd)
+			return watch->dirs[i].path;
+	}
+
+	return NULL;
+}
+
+static void ovpn_watch_dir_forget(ovpn_watch_t *watch, int wd)
+{
+	size_t i;
+
+	for (i = 0; i < watch->dirs_count; i++)
+	{
+		if (watch->dirs[i].wd == wd)
+		{
+			free(watch->dirs[i].path);
+			watch->dirs[i] = watch->dirs[--watch->dirs_count];
+			return;
+		}
+	}
+}
+
+/**
+ * Stop watching directory @p path and all its subdirectories
+ * (directory is moved out of its place)
+ */
+static void ovpn_watch_dir_forget_tree(ovpn_watch_t *watch, const char *path)
+{
+	size_t i = 0;
+	size_t len = strlen(path);
+
+	while (i < watch->dirs_count)
+	{
+		const char *dir_path = watch->dirs[i].path;
+
+		if (!strncmp(dir_path, path, len) &&
+		    ((dir_path[len] == '\0') || (dir_path[len] == '/')))
+		{
+			inotify_rm_watch(watch->fd, watch->dirs[i].wd);
+			free(watch->dirs[i].path);
+			watch->dirs[i] = watch->dirs[--watch->dirs_count];
+		}
+		else
+			i++;
+	}
+}
+
+/**
+ * Rescan the whole tree after inotify event queue overflow
+ *
+ * Events are lost, so stored directory paths are rebuilt and source
+ * files with missing or outdated output files are converted again.
+ * Output files that are up to date are not rewritten, so events
+ * of the rescan itself can not overflow the queue again and again.
+ */
+static int ovpn_watch_rescan(ovpn_watch_t *watch)
+{
+	int ret;
+	size_t i;
+	ovpn_watch_dir_t *old_dirs = watch->dirs;
+	size_t old_count = watch->dirs_count;
+
+	fprintf(stderr, "Inotify event queue overflowed, rescanning '%s'\n",
+		watch->root);
+
+	watch->dirs = NULL;
+	watch->dirs_count = 0;
+	watch->dirs_size = 0;
+
+	ret = ovpn_watch_add_tree(watch, watch->root, 1);
+
+	for (i = 0; i < old_count; i++)
+	{
+		/* Directories moved out of the tree are not watched anymore */
+		if (!ret && !ovpn_watch_dir_path(watch, old_dirs[i].wd))
+			inotify_rm_watch(watch->fd, old_dirs[i].wd);
+
+		free(old_dirs[i].path);
+	}
+
+	free(old_dirs);
+	return ret;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Add or update pending change for @p path. Repeated changes of the
+ * same file are coalesced and postpone its processing
+ */
+static int ovpn_watch_pending_add(
+	ovpn_watch_t *watch, char *path, int action)
+{
+	int ret;
+	size_t i;
+	uint64_t deadline = ovpn_watch_now() + watch->opts->debounce_ms;
+
+	for (i = 0; i < watch->pending_count; i++)
+	{
+		if (!strcmp(watch->pending[i].path, path))
+		{
+			watch->pending[i].deadline = deadline;
+			watch->pending[i].action = action;
+			free(path);
+			return 0;
+		}
+	}
+
+	ret = ovpn_watch_reserve((void **)&watch->pending,
+		&watch->pending_size, watch->pending_count,
+		sizeof(ovpn_watch_pending_t));
+
+	if (ret)
+	{
+		free(path);
+		return ret;
+	}
+
+	watch->pending[watch->pending_count].path = path;
+	watch->pending[watch->pending_count].deadline = deadline;
+	watch->pending[watch->pending_count].action = action;
+	watch->pending_count++;
+	return 0;
+}
+
+/**
+ * Process all pending changes with expired debounce interval
+ *
+ * @return Timeout (ms) until the next pending change or -1
+ *         if there are no pending changes
+ */
+static int ovpn_watch_pending_process(ovpn_watch_t *watch)
+{
+	size_t i = 0;
+	uint64_t now = ovpn_watch_now();
+	uint64_t next = UINT64_MAX;
+
+	while (i < watch->pending_count)
+	{
+		ovpn_watch_pending_t *p = &watch->pending[i];
+
+		if (p->deadline > now)
+		{
+			if (p->deadline < next)
+				next = p->deadline;
+
+			i++;
+			continue;
+		}
+
+		if (p->action == OVPN_WATCH_ACTION_REMOVE)
+		{
+			ovpn_watch_remove(p->path);
+			free(p->path);
+		}
+		else
+			ovpn_watch_batch_add(watch, p->path);
+
+		*p = watch->pending[--watch->pending_count];
+	}
+
+	ovpn_watch_batch_run(watch);
+
+	return (next == UINT64_MAX) ? -1 : (int)(next - now);
+}
+
+static int ovpn_watch_handle_event(
+	ovpn_watch_t *watch,
+	const struct inotify_event *event
+)
+{
+	char *path;
+	const char *dir_path;
+
+	if (event->mask & (IN_IGNORED | IN_DELETE_SELF))
+	{
+		ovpn_watch_dir_forget(watch, event->wd);
+		return 0;
+	}
+
+	if (!event->len || (event->name[0] == '.'))
+		return 0;
+
+	dir_path = ovpn_watch_dir_path(watch, event->wd);
+	if (!dir_path)
+		return 0;
+
+	if (event->mask & IN_ISDIR)
+	{
+		int ret;
+
+		if (!(event->mask & (IN_CREATE | IN_MOVED_TO | IN_MOVED_FROM)))
+			return 0;
+
+		path = ovpn_watch_join(dir_path, event->name);
+		if (!path)
+			return -ENOMEM;
+
+		if (event->mask & IN_MOVED_FROM)
+		{
+			/* Directory is moved away (or renamed): stored paths are
+			 * stale, directory is watched again if it is moved to
+			 * the tree */
+			ovpn_watch_dir_forget_tree(watch, path);
+			ret = 0;
+		}
+		else
+		{
+			/* New directory: watch it and convert its contents */
+			ret = ovpn_watch_add_tree(watch, path, 0);
+		}
+
+		free(path);
+		return ret;
+	}
+
+	if (!ovpn_watch_has_suffix(event->name, OVPN_WATCH_SRC_SUFFIX))
+		return 0;
+
+	if (!(event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO |
+	                     IN_MOVED_FROM | IN_DELETE)))
+		return 0;
+
+	path = ovpn_watch_join(dir_path, event->name);
+	if (!path)
+		return -ENOMEM;
+
+	return ovpn_watch_pending_add(watch, path,
+		(event->mask & (IN_MOVED_FROM | IN_DELETE))
+			? OVPN_WATCH_ACTION_REMOVE
+			: OVPN_WATCH_ACTION_CONVERT
+	);
+}
+
+static int ovpn_watch_read_events(ovpn_watch_t *watch)
+{
+	char buf[4096]
+		__attribute__((aligned(__alignof__(struct inotify_event))));
+
+	while (1)
+	{
+		char *p;
+		ssize_t len = read(watch->fd, buf, sizeof(buf));
+
+		if (len < 0)
+			return ((errno == EAGAIN) || (errno == EINTR)) ? 0 : -errno;
+
+		for (p = buf; p < buf + len; )
+		{
+			int ret;
+			const struct inotify_event *event =
+				(const struct inotify_event *)p;
+
+			if (event->mask & IN_Q_OVERFLOW)
+				ret = ovpn_watch_rescan(watch);
+			else
+				ret = ovpn_watch_handle_event(watch, event);
+
+			if (ret)
+				return ret;
+
+			p += sizeof(struct inotify_event) + event->len;
+		}
+	}
+}
+
+/* ----------------------------------------------------------------------- */
+
+int ovpn_watch(const char *dir, const ovpn_watch_opts_t *opts)
+{
+	int ret;
+	size_t i;
+	struct sigaction sa;
+	struct pollfd pfd;
+	int timeout = -1;
+	mode_t mask;
+
+	ovpn_watch_t watch = {
+		.opts = opts,
+		.root = dir,
+	};
+
+	/* umask() is not thread-safe, so mode is calculated once here */
+	mask = umask(0);
+	umask(mask);
+	watch.mode = 0666 & ~mask;
+
+	watch.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (watch.fd < 0)
+	{
+		fprintf(stderr, "Failed to initialize inotify\n");
+		return -errno;
+	}
+
+	/* Interrupt poll() on termination signals */
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = ovpn_watch_signal;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	/* Initial conversion of the whole tree */
+	ret = ovpn_watch_add_tree(&watch, dir, 0);
+	if (!ret)
+		ovpn_watch_batch_run(&watch);
+
+	pfd.fd = watch.fd;
+	pfd.events = POLLIN;
+
+	while (!ret && !ovpn_watch_stop)
+	{
+		int res = poll(&pfd, 1, timeout);
+
+		if (res < 0)
+		{
+			if (errno != EINTR)
+				ret = -errno;
+
+			continue;
+		}
+
+		if (res > 0)
+			ret = ovpn_watch_read_events(&watch);
+
+		timeout = ovpn_watch_pending_process(&watch);
+	}
+
+	for (i = 0; i < watch.pending_count; i++)
+		free(watch.pending[i].path);
+
+	for (i = 0; i < watch.dirs_count; i++)
+		free(watch.dirs[i].path);
+
+	for (i = 0; i < watch.batch_count; i++)
+		free(watch.batch[i]);
+
+	free(watch.pending);
+	free(watch.dirs);
+	free(watch.batch);
+	close(watch.fd);
+	return ret;
+}
+
+/* ----------------------------------------------------------------------- */
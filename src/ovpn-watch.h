@@ -0,0 +1,73 @@
+/*
+ * OpenVPN Configuration Files Converter
+ * Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+#ifndef OVPN_WATCH_H
+#define OVPN_WATCH_H
+
+/* ----------------------------------------------------------------------- */
+
+/** Source files suffix */
+#define OVPN_WATCH_SRC_SUFFIX  ".ovpn"
+
+/** Output files suffix */
+#define OVPN_WATCH_DST_SUFFIX  ".json"
+
+/** Default debounce interval in milliseconds */
+#define OVPN_WATCH_DEBOUNCE_MS  200u
+
+/**
+ * Source file conversion handler
+ *
+ * Handler must convert @p src_path file into @p dst_stream.
+ *
+ * @param[in] src_path    Source file path
+ * @param[in] dst_stream  Output stream (temporary file)
+ *
+ * @return 0 on success
+ * @return <0 on error (output file is discarded)
+ */
+typedef int (*ovpn_watch_convert_fn_t)(
+	const char *src_path, FILE *dst_stream);
+
+/**
+ * @brief Watch mode settings
+ */
+typedef struct
+{
+	/** Count of threads for initial conversion (0 - default) */
+	unsigned int threads;
+
+	/** Debounce interval in milliseconds */
+	unsigned int debounce_ms;
+
+	/** Conversion handler */
+	ovpn_watch_convert_fn_t convert;
+
+} ovpn_watch_opts_t;
+
+/**
+ * Convert all source files in directory tree @p dir and then
+ * reconvert only changed source files until SIGINT or SIGTERM
+ * is received
+ *
+ * Output files are written next to source files with
+ * @ref OVPN_WATCH_DST_SUFFIX suffix instead of @ref OVPN_WATCH_SRC_SUFFIX.
+ * Every output file is replaced atomically.
+ *
+ * @param[in] dir   Directory to watch
+ * @param[in] opts  Watch mode settings
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int ovpn_watch(const char *dir, const ovpn_watch_opts_t *opts);
+
+/* ----------------------------------------------------------------------- */
+
+#endif /* OVPN_WATCH_H */
@@ -0,0 +1,121 @@
+/*
+ * OpenVPN Configuration Files Converter
+ * Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief Simple parallel work items processing
+ */
+
+#include <pthread.h>
+#include <unistd.h> /* sysconf */
+#include <errno.h>
+#include <stdlib.h>
+
+#include <ovpn-workers.h>
+
+/* ----------------------------------------------------------------------- */
+
+typedef struct
+{
+	/** Index of the next unprocessed work item */
+	size_t next;
+
+	/** Count of work items */
+	size_t count;
+
+	/** Work item handler */
+	ovpn_workers_fn_t fn;
+
+	/** User argument */
+	void *arg;
+
+} ovpn_workers_t;
+
+static void *ovpn_workers_thread(void *data)
+{
+	ovpn_workers_t *workers = data;
+
+	while (1)
+	{
+		size_t idx = __atomic_fetch_add(
+			&workers->next, 1, __ATOMIC_RELAXED);
+
+		if (idx >= workers->count)
+			break;
+
+		workers->fn(idx, workers->arg);
+	}
+
+	return NULL;
+}
+
+/* ----------------------------------------------------------------------- */
+
+unsigned int ovpn_workers_default_count(void)
+{
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return (n > 0) ? (unsigned int)n : 1;
+}
+
+int ovpn_workers_run(
+	size_t count,
+	unsigned int threads,
+	ovpn_workers_fn_t fn,
+	void *arg
+)
+{
+	unsigned int i;
+	unsigned int started = 0;
+	pthread_t *tids;
+
+	ovpn_workers_t workers = {
+		.next  = 0,
+		.count = count,
+		.fn    = fn,
+		.arg   = arg,
+	};
+
+	if (!threads)
+		threads = ovpn_workers_default_count();
+
+	if (threads > count)
+		threads = (unsigned int)count;
+
+	/* Do not spawn threads for a single work item */
+	if (threads <= 1)
+	{
+		ovpn_workers_thread(&workers);
+		return 0;
+	}
+
+	tids = calloc(threads, sizeof(pthread_t));
+	if (!tids)
+		return -ENOMEM;
+
+	for (i = 0; i < threads; i++)
+	{
+		if (pthread_create(&tids[i], NULL, ovpn_workers_thread, &workers))
+			break;
+
+		started++;
+	}
+
+	/* Process remaining items in the calling thread
+	 * if not all threads are started */
+	if (!started)
+		ovpn_workers_thread(&workers);
+
+	for (i = 0; i < started; i++)
+		pthread_join(tids[i], NULL);
+
+	free(tids);
+	return 0;
+}
+
+/* ----------------------------------------------------------------------- */
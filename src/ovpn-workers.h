@@ -0,0 +1,54 @@
+/*
+ * OpenVPN Configuration Files Converter
+ * Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+#ifndef OVPN_WORKERS_H
+#define OVPN_WORKERS_H
+
+#include <stddef.h>
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Work item handler
+ *
+ * @param[in] idx  Work item index
+ * @param[in] arg  User argument
+ */
+typedef void (*ovpn_workers_fn_t)(size_t idx, void *arg);
+
+/**
+ * Get default count of worker threads (count of online CPUs)
+ */
+unsigned int ovpn_workers_default_count(void);
+
+/**
+ * Process work items [0; @p count) in parallel
+ *
+ * Items are distributed dynamically between threads, so items with
+ * different processing cost are balanced. Function returns when all
+ * items are processed.
+ *
+ * @param[in] count    Count of work items
+ * @param[in] threads  Maximum count of worker threads (0 - default)
+ * @param[in] fn       Work item handler
+ * @param[in] arg      User argument for @p fn
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int ovpn_workers_run(
+	size_t count,
+	unsigned int threads,
+	ovpn_workers_fn_t fn,
+	void *arg
+);
+
+/* ----------------------------------------------------------------------- */
+
+#endif /* OVPN_WORKERS_H */
@@ -0,0 +1,672 @@
+/*
+ * OpenVPN Configuration Files Converter
+ * Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+ *
+ * This work is free. You can redistribute it and/or modify it under the
+ * terms of the Do What The Fuck You Want To Public License, Version 2,
+ * as published by Sam Hocevar. See the COPYING file for more details.
+ */
+
+/**
+ * @file
+ * @brief OVPN configuration writer (reverse conversion)
+ *
+ * Writes configuration objects in the converter JSON format back to
+ * OVPN configuration text. Output is collected in a large buffer that
+ * is written to the stream with a few fwrite() calls.
+ *
+ * In canonical mode options and inline blocks are written in the options
+ * table order, superseded occurrences of single-valued options are
+ * dropped, numeric arguments and inline data whitespaces are normalized.
+ * Fingerprint of the canonical text is computed from the output buffer
+ * on flush, so the text itself is never stored.
+ */
+
+#include <ctype.h>
+#include <inttypes.h>
+
+#include <ovpn.h>
+
+/* ----------------------------------------------------------------------- */
+
+/** Output buffer size */
+#define OVPN_WRITE_BUFFER_SIZE  65536u
+
+/** Write canonical form and compute its fingerprint */
+#define OVPN_WRITE_FLAG_CANONICAL  0x01u
+
+/** 128-bit FNV-1a offset basis */
+#define OVPN_FNV128_OFFSET \
+	(((unsigned __int128)0x6c62272e07bb0142ull << 64) | 0x62b821756295c58dull)
+
+/**
+ * @brief OVPN writer state
+ */
+typedef struct
+{
+	/** Output stream (NULL - output is only fingerprinted) */
+	FILE *stream;
+
+	/** Blob records keyed by digest (may be NULL) */
+	json_object *blobs;
+
+	/** Flags (OVPN_WRITE_FLAG_*) */
+	unsigned int flags;
+
+	/** 128-bit FNV-1a hash of the written canonical text */
+	unsigned __int128 hash;
+
+	/** Output buffer */
+	char buf[OVPN_WRITE_BUFFER_SIZE];
+
+	/** Count of bytes in @ref buf */
+	size_t len;
+
+} ovpn_writer_t;
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Update 128-bit FNV-1a hash
+ *
+ * FNV prime is 2^88 + 0x13b, so multiplication is done
+ * with a shift and a short multiplication.
+ */
+static void ovpn_write_hash(ovpn_writer_t *w, const char *data, size_t len)
+{
+	size_t i;
+	unsigned __int128 hash = w->hash;
+
+	for (i = 0; i < len; i++)
+	{
+		hash ^= (unsigned char)data[i];
+		hash = (hash << 88) + hash * 0x13bu;
+	}
+
+	w->hash = hash;
+}
+
+static void ovpn_write_data(ovpn_writer_t *w, const char *data, size_t len)
+{
+	if (w->flags & OVPN_WRITE_FLAG_CANONICAL)
+		ovpn_write_hash(w, data, len);
+
+	if (w->stream)
+		fwrite(data, 1, len, w->stream);
+}
+
+static void ovpn_write_flush(ovpn_writer_t *w)
+{
+	if (w->len)
+	{
+		ovpn_write_data(w, w->buf, w->len);
+		w->len = 0;
+	}
+}
+
+static void ovpn_write_put(ovpn_writer_t *w, const char *data, size_t len)
+{
+	if (len > (sizeof(w->buf) - w->len))
+	{
+		ovpn_write_flush(w);
+
+		/* Write long data directly */
+		if (len > sizeof(w->buf))
+		{
+			ovpn_write_data(w, data, len);
+			return;
+		}
+	}
+
+	memcpy(w->buf + w->len, data, len);
+	w->len += len;
+}
+
+static void ovpn_write_putc(ovpn_writer_t *w, char c)
+{
+	if (w->len == sizeof(w->buf))
+		ovpn_write_flush(w);
+
+	w->buf[w->len++] = c;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Write option argument
+ *
+ * Empty arguments and arguments with whitespaces or leading
+ * quote are written in double quotes.
+ */
+static void ovpn_write_arg(ovpn_writer_t *w, const char *arg, size_t len)
+{
+	size_t i;
+
+	if (len && (arg[0] != '"') && (strcspn(arg, " \t\r\n") >= len))
+	{
+		ovpn_write_put(w, arg, len);
+		return;
+	}
+
+	ovpn_write_putc(w, '"');
+
+	for (i = 0; i < len; i++)
+	{
+		if (arg[i] == '"')
+			ovpn_write_putc(w, '\\');
+
+		ovpn_write_putc(w, arg[i]);
+	}
+
+	ovpn_write_putc(w, '"');
+}
+
+/**
+ * Get count of leading characters to skip to normalize numeric argument
+ * ("+0080" -> "80"), 0 if argument is not an unsigned decimal number
+ */
+static size_t ovpn_write_number_skip(const char *arg, size_t len)
+{
+	size_t i;
+	size_t start = (len && (arg[0] == '+')) ? 1 : 0;
+
+	if (start == len)
+		return 0;
+
+	for (i = start; i < len; i++)
+	{
+		if ((arg[i] < '0') || (arg[i] > '9'))
+			return 0;
+	}
+
+	for (i = start; (i < (len - 1)) && (arg[i] == '0'); i++);
+	return i;
+}
+
+/**
+ * Check that option argument can be only a number
+ */
+static int ovpn_write_arg_is_number(const ovpn_opt_info_t *opt, size_t arg_idx)
+{
+	int i;
+	size_t info_count = 0;
+	const ovpn_opt_arg_info_t *arg_info;
+
+	if (!opt || !opt->args.info)
+		return 0;
+
+	while (opt->args.info[info_count])
+		info_count++;
+
+	if (!info_count)
+		return 0;
+
+	/* Arguments of options with not limited count of arguments
+	 * above the described ones are described by the last one */
+	arg_info = opt->args.info[
+		(arg_idx < info_count) ? arg_idx : (info_count - 1)];
+
+	for (i = 0; arg_info->types[i]; i++)
+	{
+		if ((arg_info->types[i] != OVPN_OPT_ARG_TYPE_PORT) &&
+		    (arg_info->types[i] != OVPN_OPT_ARG_TYPE_NUMBER) &&
+		    (arg_info->types[i] != OVPN_OPT_ARG_TYPE_UNUMBER))
+			return 0;
+	}
+
+	return (i > 0);
+}
+
+/**
+ * Option (inline block) object entry writer
+ *
+ * @param[in] w      OVPN writer
+ * @param[in] opt    Option information (NULL - unknown or not looked up)
+ * @param[in] name   Option name
+ * @param[in] value  Option occurrences (inline object)
+ */
+typedef int (*ovpn_write_entry_fn_t)(
+	ovpn_writer_t *w,
+	const ovpn_opt_info_t *opt,
+	const char *name,
+	json_object *value
+);
+
+/**
+ * @brief Options (inlines) object entry with options table position
+ */
+typedef struct
+{
+	const char *name;
+	json_object *value;
+
+	/** Position in the options table (-1 - not in the table) */
+	ssize_t index;
+
+} ovpn_write_entry_t;
+
+static int ovpn_write_cmp_entries(const void *a, const void *b)
+{
+	const ovpn_write_entry_t *ea = a;
+	const ovpn_write_entry_t *eb = b;
+
+	/* Entries missing in the table follow in name order */
+	if (ea->index != eb->index)
+	{
+		if ((ea->index < 0) || (eb->index < 0))
+			return (ea->index < 0) ? 1 : -1;
+
+		return (ea->index < eb->index) ? -1 : 1;
+	}
+
+	return strcmp(ea->name, eb->name);
+}
+
+/**
+ * Write entries of options (inlines) object
+ *
+ * In canonical mode entries are written in the options table order.
+ */
+static int ovpn_write_entries(
+	ovpn_writer_t *w, json_object *obj, ovpn_write_entry_fn_t fn)
+{
+	int ret = 0;
+	size_t i;
+	size_t count = 0;
+	size_t length;
+	ovpn_write_entry_t *entries;
+
+	if (!json_object_is_type(obj, json_type_object))
+		return -EINVAL;
+
+	if (!(w->flags & OVPN_WRITE_FLAG_CANONICAL))
+	{
+		json_object_object_foreach(obj, name, value)
+		{
+			ret = fn(w, NULL, name, value);
+			if (ret)
+				return ret;
+		}
+
+		return 0;
+	}
+
+	length = (size_t)json_object_object_length(obj);
+	if (!length)
+		return 0;
+
+	entries = malloc(length * sizeof(*entries));
+	if (!entries)
+		return -ENOMEM;
+
+	json_object_object_foreach(obj, name, value)
+	{
+		entries[count].name = name;
+		entries[count].value = value;
+		entries[count].index = ovpn_opt_index(name);
+		count++;
+	}
+
+	qsort(entries, count, sizeof(*entries), ovpn_write_cmp_entries);
+
+	for (i = 0; !ret && (i < count); i++)
+	{
+		ret = fn(w,
+			(entries[i].index < 0) ? NULL : ovpn_opt_get((size_t)entries[i].index),
+			entries[i].name, entries[i].value);
+	}
+
+	free(entries);
+	return ret;
+}
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * Write all occurrences of the option
+ *
+ * [ { "args": [ ... ] }, ... ]
+ */
+static int ovpn_write_option_occurrences(
+	ovpn_writer_t *w,
+	const ovpn_opt_info_t *opt,
+	const char *name,
+	json_object *occurrences
+)
+{
+	size_t i = 0;
+	size_t count;
+	size_t name_len = strlen(name);
+	int canonical = !!(w->flags & OVPN_WRITE_FLAG_CANONICAL);
+
+	if (!json_object_is_type(occurrences, json_type_array))
+		return -EINVAL;
+
+	count = json_object_array_length(occurrences);
+
+	/* Last occurrence of a single-valued option takes effect */
+	if (canonical && count && opt && !(opt->flags & OVPN_OPT_FLAG_MULTIPLE))
+		i = count - 1;
+
+	for (; i < count; i++)
+	{
+		size_t j;
+		size_t args_count;
+		json_object *args;
+
+		if (!json_object_object_get_ex(
+				json_object_array_get_idx(occurrences, i), "args", &args) ||
+		    !json_object_is_type(args, json_type_array))
+			return -EINVAL;
+
+		ovpn_write_put(w, name, name_len);
+
+		args_count = json_object_array_length(args);
+		for (j = 0; j < args_count; j++)
+		{
+			json_object *arg = json_object_array_get_idx(args, j);
+			const char *data = json_object_get_string(arg);
+			size_t len = (size_t)json_object_get_string_len(arg);
+
+			if (canonical && ovpn_write_arg_is_number(opt, j))
+			{
+				size_t skip = ovpn_write_number_skip(data, len);
+
+				data += skip;
+				len -= skip;
+			}
+
+			ovpn_write_putc(w, ' ');
+			ovpn_write_arg(w, data, len);
+		}
+
+		ovpn_write_putc(w, '\n');
+	}
+
+	return 0;
+}
+
+/**
+ * Write options object
+ *
+ * {
+ *     "<option-name>": [ { "args": [ ... ] }, ... ],
+ *     ...
+ * }
+ */
+static int ovpn_write_options(ovpn_writer_t *w, json_object *json_options)
+{
+	return ovpn_write_entries(w, json_options, ovpn_write_option_occurrences);
+}
+
+/**
+ * Get plain inline data, resolving blob references
+ */
+static json_object *ovpn_write_inline_data(ovpn_writer_t *w, json_object *data)
+{
+	json_object *digest;
+	json_object *blob;
+
+	if (json_object_is_type(data, json_type_string))
+		return data;
+
+	/* {"blob":"<digest>"} */
+	if (!json_object_object_get_ex(data, "blob", &digest))
+		return NULL;
+
+	if (!w->blobs ||
+	    !json_object_object_get_ex(w->blobs, json_object_get_string(digest), &blob))
+	{
+		fprintf(stderr, "Unresolved blob reference '%s'\n",
+			json_object_get_string(digest));
+
+		return NULL;
+	}
+
+	return blob;
+}
+
+/**
+ * Write plain inline data
+ *
+ * In canonical mode leading and trailing whitespaces of every line
+ * (including CR of CRLF line endings) and empty lines are dropped.
+ */
+static void ovpn_write_plain(ovpn_writer_t *w, const char *data, size_t len)
+{
+	const char *end = data + len;
+
+	if (!(w->flags & OVPN_WRITE_FLAG_CANONICAL))
+	{
+		ovpn_write_put(w, data, len);
+
+		if (len && (data[len - 1] != '\n'))
+			ovpn_write_putc(w, '\n');
+
+		return;
+	}
+
+	while (data < end)
+	{
+		const char *eol = memchr(data, '\n', (size_t)(end - data));
+		const char *next = eol ? (eol + 1) : end;
+
+		if (!eol)
+			eol = end;
+
+		while ((data < eol) && isspace((unsigned char)*data))
+			data++;
+
+		while ((eol > data) && isspace((unsigned char)eol[-1]))
+			eol--;
+
+		if (eol > data)
+		{
+			ovpn_write_put(w, data, (size_t)(eol - data));
+			ovpn_write_putc(w, '\n');
+		}
+
+		data = next;
+	}
+}
+
+/**
+ * Write all occurrences of the inline block
+ *
+ * {
+ *     "type": "plain" | "options",
+ *     "data": [ <data>, ... ]
+ * }
+ */
+static int ovpn_write_inline_blocks(
+	ovpn_writer_t *w,
+	const ovpn_opt_info_t *opt,
+	const char *name,
+	json_object *json_inline
+)
+{
+	size_t i = 0;
+	size_t count;
+	size_t name_len = strlen(name);
+	int is_options;
+	json_object *json_type;
+	json_object *json_data;
+
+	if (!json_object_object_get_ex(json_inline, "type", &json_type) ||
+	    !json_object_object_get_ex(json_inline, "data", &json_data) ||
+	    !json_object_is_type(json_data, json_type_array))
+		return -EINVAL;
+
+	is_options = !strcmp(json_object_get_string(json_type), "options");
+	count = json_object_array_length(json_data);
+
+	/* Last plain data block of a single-valued option takes effect */
+	if ((w->flags & OVPN_WRITE_FLAG_CANONICAL) && count && !is_options &&
+	    opt && !(opt->flags & OVPN_OPT_FLAG_MULTIPLE))
+		i = count - 1;
+
+	for (; i < count; i++)
+	{
+		json_object *data = json_object_array_get_idx(json_data, i);
+
+		if (!is_options)
+		{
+			data = ovpn_write_inline_data(w, data);
+			if (!data)
+				return -ENOENT;
+		}
+
+		ovpn_write_putc(w, '<');
+		ovpn_write_put(w, name, name_len);
+		ovpn_write_put(w, ">\n", 2);
+
+		if (is_options)
+		{
+			int ret = ovpn_write_options(w, data);
+			if (ret)
+				return ret;
+		}
+		else
+		{
+			ovpn_write_plain(w, json_object_get_string(data),
+				(size_t)json_object_get_string_len(data));
+		}
+
+		ovpn_write_put(w, "</", 2);
+		ovpn_write_put(w, name, name_len);
+		ovpn_write_put(w, ">\n", 2);
+	}
+
+	return 0;
+}
+
+/**
+ * Write inlines object
+ *
+ * {
+ *     "<inline-name>": { ... },
+ *     ...
+ * }
+ */
+static int ovpn_write_inlines(ovpn_writer_t *w, json_object *json_inlines)
+{
+	return ovpn_write_entries(w, json_inlines, ovpn_write_inline_blocks);
+}
+
+/* ----------------------------------------------------------------------- */
+
+static ovpn_writer_t *ovpn_writer_new(
+	json_object *blobs, unsigned int flags, FILE *stream)
+{
+	ovpn_writer_t *w = malloc(sizeof(ovpn_writer_t));
+	if (!w)
+		return NULL;
+
+	w->stream = stream;
+	w->blobs = blobs;
+	w->flags = flags;
+	w->hash = OVPN_FNV128_OFFSET;
+	w->len = 0;
+	return w;
+}
+
+/**
+ * Flush and free writer
+ */
+static int ovpn_writer_delete(ovpn_writer_t *w, int ret)
+{
+	FILE *stream = w->stream;
+
+	ovpn_write_flush(w);
+	free(w);
+
+	if (!ret && stream && ferror(stream))
+		ret = -EIO;
+
+	return ret;
+}
+
+int ovpn_write_option(
+	const char *name, json_object *occurrences, FILE *stream)
+{
+	ovpn_writer_t *w = ovpn_writer_new(NULL, 0, stream);
+	if (!w)
+		return -ENOMEM;
+
+	return ovpn_writer_delete(w,
+		ovpn_write_option_occurrences(w, NULL, name, occurrences));
+}
+
+int ovpn_write_inline(
+	const char *name, json_object *json_inline, json_object *blobs, FILE *stream)
+{
+	ovpn_writer_t *w = ovpn_writer_new(blobs, 0, stream);
+	if (!w)
+		return -ENOMEM;
+
+	return ovpn_writer_delete(w,
+		ovpn_write_inline_blocks(w, NULL, name, json_inline));
+}
+
+/**
+ * Write options and inline blocks of the configuration object
+ */
+static int ovpn_write_config(ovpn_writer_t *w, json_object *json)
+{
+	int ret = 0;
+	json_object *json_options;
+	json_object *json_inlines;
+
+	if (json_object_object_get_ex(json, "options", &json_options))
+		ret = ovpn_write_options(w, json_options);
+
+	/* Inline blocks are written after all options */
+	if (!ret && json_object_object_get_ex(json, "inlines", &json_inlines))
+		ret = ovpn_write_inlines(w, json_inlines);
+
+	return ret;
+}
+
+int ovpn_write(json_object *json, json_object *blobs, FILE *stream)
+{
+	ovpn_writer_t *w = ovpn_writer_new(blobs, 0, stream);
+	if (!w)
+		return -ENOMEM;
+
+	return ovpn_writer_delete(w, ovpn_write_config(w, json));
+}
+
+int ovpn_write_canonical(
+	json_object *json,
+	json_object *blobs,
+	FILE *stream,
+	char fingerprint[OVPN_FINGERPRINT_SIZE]
+)
+{
+	int ret;
+	unsigned __int128 hash;
+	ovpn_writer_t *w = ovpn_writer_new(blobs,
+		OVPN_WRITE_FLAG_CANONICAL, stream);
+
+	if (!w)
+		return -ENOMEM;
+
+	ret = ovpn_write_config(w, json);
+
+	/* Hash is final only after the last flush */
+	ovpn_write_flush(w);
+	hash = w->hash;
+
+	ret = ovpn_writer_delete(w, ret);
+
+	if (!ret && fingerprint)
+	{
+		snprintf(fingerprint, OVPN_FINGERPRINT_SIZE,
+			"fnv1a128:%016" PRIx64 "%016" PRIx64,
+			(uint64_t)(hash >> 64), (uint64_t)hash);
+	}
+
+	return ret;
+}
+
+/* ----------------------------------------------------------------------- */
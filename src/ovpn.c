@@ -7,7 +7,6 @@
  * as published by Sam Hocevar. See the COPYING file for more details.
  */
 
-#include <stdarg.h>
 #include <ovpn.h>
 
 /* ----------------------------------------------------------------------- */
@@ -49,34 +48,8 @@ ovpn_t *ovpn_new(unsigned int flags)
 	json_object_object_add(ovpn->json, "options",
 		ovpn->json_options);
 
-	/*
-	 * JSON scheme for status object:
-	 * {
-	 *     "errors": 1,
-	 *     "warning": 1
-	 *     "messages": [
-	 *         {
-	 *             "type": "error",
-	 *             "line": x,
-	 *             "message": "xxxxxx"
-	 *         }, {
-	 *             "type": "warning",
-	 *             "line": x,
-	 *             "message": "xxxxxx"
-	 *         }
-	 *     ],
-	 * }
-	 */
-	ovpn->json_status = json_object_new_object();
-	if (!ovpn->json_status)
-		goto out_error;
-
-	json_object_object_add(ovpn->json_status, "errors", json_object_new_int(0));
-	json_object_object_add(ovpn->json_status, "warnings", json_object_new_int(0));
-	json_object_object_add(ovpn->json_status, "messages", json_object_new_array());
-
-	if (ovpn->flags & OVPN_FLAG_INCLUDE_STATUS)
-		json_object_object_add(ovpn->json, "status", ovpn->json_status);
+	/* Status JSON object is built on dump */
+	ovpn->max_messages = OVPN_STATUS_MAX_MESSAGES;
 
 	return ovpn;
 
@@ -84,9 +57,6 @@ out_error:
 	if (ovpn->json)
 		json_object_put(ovpn->json);
 
-	if (ovpn->json_status)
-		json_object_put(ovpn->json_status);
-
 	free(ovpn);
 	return NULL;
 }
@@ -99,113 +69,189 @@ void ovpn_delete(ovpn_t *ovpn)
 	if (ovpn->json)
 		json_object_put(ovpn->json);
 
-	if (ovpn->json_status && !(ovpn->flags & OVPN_FLAG_INCLUDE_STATUS))
+	if (ovpn->json_status)
 		json_object_put(ovpn->json_status);
 
+	ovpn_status_delete(ovpn->status);
+
 	free(ovpn);
 }
 
+int ovpn_include_status(ovpn_t *ovpn)
+{
+	json_object *json_status;
+
+	if (!(ovpn->flags & OVPN_FLAG_INCLUDE_STATUS) ||
+	    json_object_object_get_ex(ovpn->json, "status", NULL))
+		return 0;
+
+	json_status = ovpn_status_json(ovpn);
+	if (!json_status)
+		return -ENOMEM;
+
+	json_object_object_add(ovpn->json, "status",
+		json_object_get(json_status));
+
+	return 0;
+}
+
 int ovpn_dump_json(ovpn_t *ovpn, unsigned int flags, FILE *stream)
 {
+	int ret;
+
 	if (!ovpn || !ovpn->json)
 		return -1;
 
-	fprintf(stream, "%s\n", json_object_to_json_string_ext(
-		ovpn->json,
-		(flags & OVPN_DUMP_FLAG_PRETTY)
-		? (JSON_C_TO_STRING_PRETTY | JSON_C_TO_STRING_PRETTY_TAB) /* NOLINT(hicpp-signed-bitwise) */
-		: 0
-	));
+	ret = ovpn_include_status(ovpn);
+	if (ret)
+		return ret;
 
-	return 0;
+	return ovpn_json_write(ovpn->json, flags, stream);
 }
 
 int ovpn_dump_json_status(ovpn_t *ovpn, unsigned int flags, FILE *stream)
 {
-	if (!ovpn || !ovpn->json_status)
+	json_object *json_status;
+
+	if (!ovpn)
 		return -1;
 
 	if (ovpn->flags & OVPN_FLAG_INCLUDE_STATUS)
 		return 0;
 
-	fprintf(stream, "%s\n", json_object_to_json_string_ext(
-		ovpn->json_status,
-		(flags & OVPN_DUMP_FLAG_PRETTY)
-		? (JSON_C_TO_STRING_PRETTY | JSON_C_TO_STRING_PRETTY_TAB) /* NOLINT(hicpp-signed-bitwise) */
-		: 0
-	));
+	json_status = ovpn_status_json(ovpn);
+	if (!json_status)
+		return -ENOMEM;
 
-	return 0;
+	return ovpn_json_write(json_status, flags, stream);
 }
 
 /* ----------------------------------------------------------------------- */
 
-int ovpn_status_msg(
-	ovpn_t *ovpn,
-	ovpn_msg_type_t msg,
-	unsigned int line,
-	const char *format, ...
-)
+/**
+ * Create effective option set: copy of the global options object
+ * with keys of the connection block options replaced
+ *
+ * Every key of the global options is added to the profile, so cost
+ * is O(globals) per profile. Option value arrays are not copied,
+ * they are shared with the global and block objects by reference.
+ */
+static json_object *ovpn_connection_profile(
+	json_object *json_options, json_object *json_block)
 {
-	int res;
-	char buf[256] = { 0 };
-
-	json_object *obj;
+	json_object *profile = json_object_new_object();
+	if (!profile)
+		return NULL;
 
-	const char *type;
+	json_object_object_foreach(json_options, key, val)
+		json_object_object_add(profile, key, json_object_get(val));
 
-	switch (msg)
+	if (json_block)
 	{
-		case OVPN_MSG_TYPE_ERROR: type = "error";
-			ovpn->errors++;
+		/* Overridden options keep their position */
+		json_object_object_foreach(json_block, block_key, block_val)
+			json_object_object_add(profile, block_key,
+				json_object_get(block_val));
+	}
+
+	return profile;
+}
 
-			if (json_object_object_get_ex(ovpn->json_status, "errors", &obj))
-				json_object_set_int(obj, (int) ovpn->errors);
+int ovpn_flatten_connections(ovpn_t *ovpn)
+{
+	size_t i;
+	size_t count = 0;
+	json_object *json_connection;
+	json_object *json_blocks = NULL;
+	json_object *json_profiles;
 
-			break;
+	/*
+	 * Flattened connection profiles:
+	 * {
+	 *     "connections": [
+	 *         {
+	 *             "<option-name>": [ { "args": [ ... ] }, ... ],
+	 *             ...
+	 *         },
+	 *         ...
+	 *     ]
+	 * }
+	 */
+	if (json_object_object_get_ex(ovpn->json_inlines,
+			"connection", &json_connection) &&
+	    json_object_object_get_ex(json_connection, "data", &json_blocks))
+		count = json_object_array_length(json_blocks);
 
-		case OVPN_MSG_TYPE_WARNING: type = "warning";
-			ovpn->warnings++;
+	json_profiles = json_object_new_array();
+	if (!json_profiles)
+		return -ENOMEM;
 
-			if (json_object_object_get_ex(ovpn->json_status, "warnings", &obj))
-				json_object_set_int(obj, (int) ovpn->warnings);
+	for (i = 0; i < (count ? count : 1); i++)
+	{
+		json_object *profile = ovpn_connection_profile(ovpn->json_options,
+			count ? json_object_array_get_idx(json_blocks, i) : NULL);
 
-			break;
+		if (!profile)
+		{
+			json_object_put(json_profiles);
+			return -ENOMEM;
+		}
 
-		default: type = "unknown";
-			break;
+		json_object_array_add(json_profiles, profile);
 	}
 
-	va_list va;
-	va_start(va, format);
+	json_object_object_add(ovpn->json, "connections", json_profiles);
+	return 0;
+}
 
-	res = vsnprintf(buf, sizeof(buf), format, va);
-	if (res < 0)
-		return -1;
+/* ----------------------------------------------------------------------- */
 
-	va_end(va);
+uint64_t ovpn_args_hash(json_object *args)
+{
+	size_t i;
+	size_t j;
+	size_t count = args ? json_object_array_length(args) : 0;
+	uint64_t hash = 0xcbf29ce484222325ull;
 
-	if (json_object_object_get_ex(ovpn->json_status, "messages", &obj))
+	for (i = 0; i < count; i++)
 	{
-		json_object *json_message = json_object_new_object();
-
-		if (!json_message)
-			return -ENOMEM;
+		json_object *arg = json_object_array_get_idx(args, i);
+		const char *data = json_object_get_string(arg);
+		size_t len = (size_t)json_object_get_string_len(arg);
+
+		/* Each argument is terminated by '\0' */
+		for (j = 0; j <= len; j++)
+		{
+			hash ^= (unsigned char)((j < len) ? data[j] : '\0');
+			hash *= 0x100000001b3ull;
+		}
+	}
 
-		json_object_object_add(json_message, "type",
-			json_object_new_string(type));
+	/* Zero hash is reserved for empty hash table slots */
+	return hash ? hash : 1;
+}
 
-		json_object_object_add(json_message, "message",
-			json_object_new_string(buf));
+int ovpn_args_equal(json_object *a, json_object *b)
+{
+	size_t i;
+	size_t count = a ? json_object_array_length(a) : 0;
 
-		if (line > 0)
-			json_object_object_add(json_message, "line",
-				json_object_new_int((int)line));
+	if (count != (b ? json_object_array_length(b) : 0))
+		return 0;
 
-		json_object_array_add(obj, json_message);
+	for (i = 0; i < count; i++)
+	{
+		json_object *arg_a = json_object_array_get_idx(a, i);
+		json_object *arg_b = json_object_array_get_idx(b, i);
+		int len = json_object_get_string_len(arg_a);
+
+		if ((len != json_object_get_string_len(arg_b)) ||
+		    memcmp(json_object_get_string(arg_a),
+		           json_object_get_string(arg_b), (size_t)len))
+			return 0;
 	}
 
-	return 0;
+	return 1;
 }
 
 /* ----------------------------------------------------------------------- */
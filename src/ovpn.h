@@ -13,20 +13,172 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 #include <errno.h>
 #include <assert.h>
+#include <sys/types.h>
 
-#include <libintl.h>
-#include <locale.h>
+#include <ovpn-i18n.h>
 
-#define _(STRING) gettext(STRING) /* NOLINT(bugprone-reserved-identifier) */
+#define _(STRING) ovpn_gettext(STRING) /* NOLINT(bugprone-reserved-identifier) */
+
+/** Mark string for translation, translated later with _() */
+#define N_(STRING) (STRING)
 
 #include <json-c/json.h>
 #include <ovpn-options.h>
 
 /* ----------------------------------------------------------------------- */
 
+/**
+ * @brief Output formats
+ */
+typedef enum
+{
+	/** JSON text */
+	OVPN_FORMAT_JSON = 0,
+
+	/** CBOR (RFC 8949) */
+	OVPN_FORMAT_CBOR,
+
+	/** MessagePack */
+	OVPN_FORMAT_MSGPACK,
+
+	/** OpenWrt UCI configuration file */
+	OVPN_FORMAT_UCI,
+
+	/** OpenWrt "uci batch" commands */
+	OVPN_FORMAT_UCI_BATCH,
+
+	/** Canonical OVPN configuration text */
+	OVPN_FORMAT_CANONICAL,
+
+} ovpn_format_t;
+
+/** Output format is one of the UCI formats */
+#define OVPN_FORMAT_IS_UCI(format) \
+	(((format) == OVPN_FORMAT_UCI) || ((format) == OVPN_FORMAT_UCI_BATCH))
+
+/** Output format is one of the binary encodings */
+#define OVPN_FORMAT_IS_BINARY(format) \
+	(((format) == OVPN_FORMAT_CBOR) || ((format) == OVPN_FORMAT_MSGPACK))
+
+/**
+ * Get output format by name ("json", "cbor", "msgpack", "uci",
+ * "uci-batch" or "canonical")
+ *
+ * @return 0 on success
+ * @return -EINVAL if name is unknown
+ */
+int ovpn_format_by_name(const char *name, ovpn_format_t *format);
+
+/* ----------------------------------------------------------------------- */
+
+/** Size of the blob digest string (including '\0') */
+#define OVPN_BLOB_DIGEST_SIZE  32
+
+/**
+ * @brief Deduplicating inline data (blob) store
+ */
+typedef struct ovpn_blobs ovpn_blobs_t;
+
+ovpn_blobs_t *ovpn_blobs_new(
+	FILE *stream, ovpn_format_t format, unsigned int dump_flags);
+void ovpn_blobs_delete(ovpn_blobs_t *blobs);
+
+/**
+ * Put inline payload into the blob store
+ *
+ * New payloads are emitted to the blob store stream as
+ * `{"blob":"<digest>","data":"<payload>"}` records encoded in
+ * the blob store format.
+ *
+ * @param[in]  blobs  Blob store
+ * @param[in]  data   Payload data
+ * @param[in]  len    Payload length
+ * @param[out] digest Payload digest string
+ *
+ * @return 0 on success
+ * @return -EEXIST if digest collides with different payload
+ * @return -ENOMEM on memory allocation failure
+ */
+int ovpn_blobs_put(
+	ovpn_blobs_t *blobs,
+	const char *data,
+	size_t len,
+	char digest[OVPN_BLOB_DIGEST_SIZE]
+);
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * @brief Compiled cross-option semantic rules
+ *
+ * Rules are compiled into bitmasks over the options table positions
+ * and checked against the set of options present in the configuration
+ * at the end of parsing (see src/ovpn-rules.c for the rules syntax).
+ */
+typedef struct ovpn_rules ovpn_rules_t;
+
+/**
+ * Compile rules
+ *
+ * Compilation errors are written to stderr.
+ *
+ * @param[in] stream  Rules text stream (NULL - built-in rules)
+ * @param[in] name    Rules source name for error messages
+ *
+ * @return Compiled rules or NULL on error
+ */
+ovpn_rules_t *ovpn_rules_new(FILE *stream, const char *name);
+void ovpn_rules_delete(ovpn_rules_t *rules);
+
+/**
+ * Get count of compiled rules
+ */
+size_t ovpn_rules_count(const ovpn_rules_t *rules);
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * @brief Status messages store
+ *
+ * Messages are stored in structured form (message format, line and
+ * arguments) and are formatted only when status is dumped. Repeated
+ * identical messages are aggregated into one message with a list of lines.
+ */
+typedef struct ovpn_status ovpn_status_t;
+
+/** Default maximum count of stored status messages (0 - not limited) */
+#define OVPN_STATUS_MAX_MESSAGES  0u
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * @brief Parsing budgets
+ *
+ * Parsing is aborted as soon as any budget is exhausted.
+ * Zero value means that the budget is not limited.
+ */
+typedef struct
+{
+	/** Maximum count of errors */
+	unsigned int max_errors;
+
+	/** Maximum count of warnings */
+	unsigned int max_warnings;
+
+	/** Maximum count of input lines */
+	unsigned int max_lines;
+
+	/** Maximum count of input bytes */
+	size_t max_bytes;
+
+} ovpn_limits_t;
+
+/* ----------------------------------------------------------------------- */
+
 /**
  * @brief OpenVPN configuration file data
  */
@@ -50,27 +202,544 @@ typedef struct ovpn
 	/** JSON object for inlines data */
 	json_object *json_inlines;
 
-	/** JSON object for status */
+	/** JSON object for status (built on dump from @ref status) */
 	json_object *json_status;
 
+	/** Status messages store (NULL - no messages) */
+	ovpn_status_t *status;
+
+	/** Maximum count of stored status messages (0 - not limited) */
+	unsigned int max_messages;
+
+	/** Stream for writing status messages as they occur
+	 *  (NULL - messages are stored and dumped with status) */
+	FILE *status_stream;
+
+	/** Dump flags (OVPN_DUMP_FLAG_*) for @ref status_stream records */
+	unsigned int status_stream_flags;
+
+	/** Parsing budgets */
+	ovpn_limits_t limits;
+
+	/** Count of parsed input lines (including included files) */
+	unsigned int lines;
+
+	/** Count of parsed input bytes (including included files) */
+	size_t bytes;
+
+	/** Exhausted budget name if parsing is aborted (NULL - not aborted) */
+	const char *abort_reason;
+
+	/** Line number where parsing is aborted */
+	unsigned int abort_line;
+
+	/** Blob store for inline data deduplication (optional) */
+	ovpn_blobs_t *blobs;
+
+	/** Cross-option rules checked after parsing (optional) */
+	const ovpn_rules_t *rules;
+
+	/** Target OpenVPN version (OVPN_VERSION_ANY - options
+	 *  of all versions are accepted) */
+	ovpn_version_t version;
+
+	/** Configuration file path (NULL - unknown, e.g. stdin) */
+	const char *path;
+
+	/** Device of the configuration file (for include cycle detection) */
+	dev_t dev;
+
+	/** Inode of the configuration file (0 - unknown) */
+	ino_t ino;
+
+	/** Including configuration while included file is parsed
+	 *  (NULL - main configuration file) */
+	struct ovpn *parent;
+
 } ovpn_t;
 
 /** Include status object in main JSON */
 #define OVPN_FLAG_INCLUDE_STATUS  0x01u
 
+/** Add effective option sets of connection profiles to main JSON */
+#define OVPN_FLAG_FLATTEN_CONNECTIONS  0x02u
+
+/** Parse files included with 'config' option */
+#define OVPN_FLAG_FOLLOW_INCLUDES  0x04u
+
+/** Configuration is a client config file (client-config-dir),
+ *  only client instance options are allowed */
+#define OVPN_FLAG_CCD  0x08u
+
+/** Validate options pushed with 'push' option */
+#define OVPN_FLAG_CHECK_PUSH  0x10u
+
 ovpn_t *ovpn_new(unsigned int flags);
 void ovpn_delete(ovpn_t *ovpn);
 
+/**
+ * Parse OpenVPN configuration
+ *
+ * @return 0 on success
+ * @return -ECANCELED if parsing is aborted due to exhausted budget
+ *         (see @ref ovpn_t::limits), parsed data and status are still
+ *         available for dumping
+ * @return -1 if parsing is stopped by an error in configuration,
+ *         parsed data and status are still available
+ * @return <0 on other (system) errors
+ */
 int ovpn_parse(ovpn_t *ovpn, FILE *input);
 
+/**
+ * @brief Line reader
+ */
+typedef struct
+{
+	/** Line buffer */
+	char *buffer;
+
+	/** Line buffer size */
+	size_t size;
+
+} ovpn_line_reader_t;
+
+int ovpn_line_reader_init(ovpn_line_reader_t *reader);
+void ovpn_line_reader_free(ovpn_line_reader_t *reader);
+
+/**
+ * Read next line into the reader buffer
+ *
+ * Line is read with the line ending. Line buffer grows up
+ * to the maximum line size.
+ *
+ * @param[in] reader  Line reader
+ * @param[in] input   Input stream
+ * @param[in] line_n  Line number (for error messages)
+ *
+ * @return Line length
+ * @return 0 on end of input
+ * @return <0 on error
+ */
+ssize_t ovpn_line_read(
+	ovpn_line_reader_t *reader, FILE *input, unsigned int line_n);
+
+/**
+ * Resolve connection profiles into effective option sets
+ *
+ * Adds "connections" array to the main JSON object. Each item is
+ * the global "options" object overridden by the options of the
+ * corresponding <connection> block (or the global options only if
+ * there are no <connection> blocks). Each profile is a separate object
+ * with all global option keys, so time and memory are
+ * O(globals x connections). Option value arrays are shared with
+ * the global and <connection> objects, not copied.
+ *
+ * Called by @ref ovpn_parse() if @ref OVPN_FLAG_FLATTEN_CONNECTIONS
+ * flag is set.
+ *
+ * @return 0 on success
+ * @return -ENOMEM on memory allocation failure
+ */
+int ovpn_flatten_connections(ovpn_t *ovpn);
+
+/**
+ * Check configuration against cross-option rules
+ *
+ * Violated rules are added to the status messages (without line
+ * numbers). Called by @ref ovpn_parse() if @ref ovpn_t::rules is set.
+ *
+ * @return 0 on success
+ * @return -ENOMEM on memory allocation failure
+ */
+int ovpn_rules_check(const ovpn_rules_t *rules, ovpn_t *ovpn);
+
+/**
+ * Parse included configuration file and merge it into configuration
+ *
+ * Relative @p path is resolved against the directory of the including
+ * file. Options and inline data of the included file are appended to
+ * @p json_options and @p json_inlines, status messages are merged with
+ * the name of the included file.
+ *
+ * Parsed files are cached by path, device, inode and modification
+ * time, so a file included by many configurations is read and parsed
+ * only once. Cached file is parsed again if it or any file included by
+ * it is changed. Count of cached files is limited.
+ *
+ * @param[in] ovpn          Including configuration
+ * @param[in] json_options  JSON object for included options
+ * @param[in] json_inlines  JSON object for included inlines
+ * @param[in] path          Included file path ('config' option argument)
+ * @param[in] line          Line number of the 'config' option
+ *
+ * Included file is parsed with the remaining budgets of the including
+ * configuration (see @ref ovpn_t::limits and @ref ovpn_t::max_messages),
+ * its usage is charged to the including configuration.
+ *
+ * @return 0 on success (including missing files and include cycles,
+ *         which are reported as status errors)
+ * @return -1 on error in the included file (data parsed before
+ *         the error is merged)
+ * @return -ECANCELED if a budget is exhausted (data parsed before
+ *         aborting is merged, abort reason is set)
+ * @return <0 on other errors
+ */
+int ovpn_include(
+	ovpn_t *ovpn,
+	json_object *json_options,
+	json_object *json_inlines,
+	const char *path,
+	unsigned int line
+);
+
+/**
+ * Free include cache
+ */
+void ovpn_include_cleanup(void);
+
+/** Formatted output with tab-indentation */
 #define OVPN_DUMP_FLAG_PRETTY  0x01u
 
+/** Do not escape '/' characters in JSON strings */
+#define OVPN_DUMP_FLAG_NO_SLASH_ESCAPE  0x02u
+
 int ovpn_dump_json(
 	ovpn_t *ovpn, unsigned int flags, FILE *stream);
 
 int ovpn_dump_json_status(
 	ovpn_t *ovpn, unsigned int flags, FILE *stream);
 
+/**
+ * Write JSON object to the stream followed by a new line
+ *
+ * Output is the same as of json_object_to_json_string_ext() with
+ * the corresponding flags.
+ *
+ * @param[in] obj     JSON object
+ * @param[in] flags   Dump flags (OVPN_DUMP_FLAG_*)
+ * @param[in] stream  Output stream
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int ovpn_json_write(
+	json_object *obj, unsigned int flags, FILE *stream);
+
+/**
+ * JSON value handler of @ref ovpn_json_read()
+ *
+ * @param[in] obj  Parsed JSON value (released after the call)
+ * @param[in] arg  Handler argument
+ *
+ * @return 0 to continue reading
+ * @return <0 to stop reading with error
+ */
+typedef int (*ovpn_json_read_fn_t)(json_object *obj, void *arg);
+
+/**
+ * Read sequence of JSON values (NDJSON or concatenated values)
+ *
+ * Input is parsed in fixed-size chunks, every parsed value is passed
+ * to the handler @p fn as soon as it is complete, so memory usage does
+ * not depend on the count of values.
+ *
+ * @return 0 on success
+ * @return -EINVAL on invalid JSON input
+ * @return <0 on other errors or handler error
+ */
+int ovpn_json_read(FILE *input, ovpn_json_read_fn_t fn, void *arg);
+
+/**
+ * Dump OVPN objects tree in binary (CBOR or MessagePack) format
+ *
+ * Structure is the same as for @ref ovpn_dump_json(). Plain inline
+ * data is encoded as byte strings.
+ */
+int ovpn_dump_binary(
+	ovpn_t *ovpn, ovpn_format_t format, FILE *stream);
+
+/**
+ * Encode configuration object in binary (CBOR or MessagePack) format
+ *
+ * Object must have the main JSON structure, plain inline
+ * data is encoded as byte strings.
+ */
+int ovpn_encode_config(
+	ovpn_format_t format, json_object *json, FILE *stream);
+
+/**
+ * Dump object with OVPN objects trees as values (e.g. client
+ * configurations keyed by common name) in binary format
+ */
+int ovpn_dump_binary_map(
+	json_object *map, ovpn_format_t format, FILE *stream);
+
+/**
+ * Write configuration in OVPN format (reverse conversion)
+ *
+ * Options of the "options" object are written first, followed by
+ * inline blocks of the "inlines" object (including "options" type
+ * blocks such as <connection>). Other members of @p json are ignored.
+ *
+ * @param[in] json    Configuration object in the converter JSON format
+ * @param[in] blobs   Blob records data keyed by digest for deduplicated
+ *                    inline data references (may be NULL)
+ * @param[in] stream  Output stream
+ *
+ * @return 0 on success
+ * @return -EINVAL if configuration object has invalid structure
+ * @return -ENOENT if blob reference can not be resolved
+ * @return <0 on other errors
+ */
+int ovpn_write(json_object *json, json_object *blobs, FILE *stream);
+
+/** Size of the configuration fingerprint string (including '\0') */
+#define OVPN_FINGERPRINT_SIZE  48
+
+/**
+ * Write configuration in canonical OVPN format and compute its fingerprint
+ *
+ * Canonical form does not depend on options order, comments, quoting
+ * and whitespaces of the source configuration:
+ * - options and inline blocks are written in the options table order
+ *   (options missing in the table follow in name order), occurrences
+ *   of the same option keep their order;
+ * - only the last occurrence of a single-valued option (plain inline
+ *   block) is written;
+ * - arguments are quoted only when required, leading zeros and plus
+ *   sign are removed from numeric arguments;
+ * - leading and trailing whitespaces of plain inline data lines and
+ *   empty lines are removed (line endings are LF).
+ *
+ * Fingerprint is a 128-bit FNV-1a hash of the canonical text computed
+ * while the text is written ("fnv1a128:<32 hex digits>").
+ *
+ * @param[in]  json         Configuration object in the converter JSON format
+ * @param[in]  blobs        Blob records data keyed by digest (may be NULL)
+ * @param[in]  stream       Output stream (NULL - compute fingerprint only)
+ * @param[out] fingerprint  Fingerprint string (may be NULL)
+ *
+ * @return 0 on success
+ * @return <0 on error (see @ref ovpn_write())
+ */
+int ovpn_write_canonical(
+	json_object *json,
+	json_object *blobs,
+	FILE *stream,
+	char fingerprint[OVPN_FINGERPRINT_SIZE]
+);
+
+/**
+ * Write all occurrences of the option in OVPN format
+ *
+ * @param[in] name         Option name
+ * @param[in] occurrences  Option occurrences ([ { "args": [ ... ] }, ... ])
+ * @param[in] stream       Output stream
+ *
+ * @return 0 on success
+ * @return <0 on error (see @ref ovpn_write())
+ */
+int ovpn_write_option(
+	const char *name, json_object *occurrences, FILE *stream);
+
+/**
+ * Write all occurrences of the inline block in OVPN format
+ *
+ * @param[in] name         Inline block name
+ * @param[in] json_inline  Inline object ({ "type": ..., "data": [ ... ] })
+ * @param[in] blobs        Blob records data keyed by digest (may be NULL)
+ * @param[in] stream       Output stream
+ *
+ * @return 0 on success
+ * @return <0 on error (see @ref ovpn_write())
+ */
+int ovpn_write_inline(
+	const char *name,
+	json_object *json_inline,
+	json_object *blobs,
+	FILE *stream
+);
+
+/**
+ * Hash option arguments array
+ *
+ * @return 64-bit FNV-1a hash of the arguments (each one is terminated
+ *         by '\0'), never 0
+ */
+uint64_t ovpn_args_hash(json_object *args);
+
+/**
+ * Compare option arguments arrays (NULL is the same as empty array)
+ *
+ * @return 1 if arrays are equal, 0 otherwise
+ */
+int ovpn_args_equal(json_object *a, json_object *b);
+
+/**
+ * Compare two configurations
+ *
+ * Options and inline blocks are matched by options table position.
+ * Occurrences of options that can be specified several times are
+ * compared as multisets of argument lists (order is not compared),
+ * for other options only the last (effective) occurrences are compared.
+ * Result object has the following format:
+ * {
+ *     "options": {
+ *         "added":   { "<name>": [ <occurrence>, ... ], ... },
+ *         "removed": { "<name>": [ <occurrence>, ... ], ... },
+ *         "changed": { "<name>": { "from": <occurrence>, "to": <occurrence> }, ... }
+ *     },
+ *     "inlines": {
+ *         "added":   { "<name>": <inline>, ... },
+ *         "removed": { "<name>": <inline>, ... },
+ *         "changed": { "<name>": { "from": <inline>, "to": <inline> }, ... }
+ *     }
+ * }
+ *
+ * @param[in]  from    First configuration object (converter JSON format)
+ * @param[in]  to      Second configuration object
+ * @param[out] result  Difference object (must be released by caller)
+ *
+ * @return 0 on success
+ * @return -EINVAL if configuration object has invalid structure
+ * @return -ENOMEM on memory allocation failure
+ */
+int ovpn_diff(json_object *from, json_object *to, json_object **result);
+
+/**
+ * Merge overlay configuration into configuration
+ *
+ * Result configuration object contains options and inline blocks of
+ * @p base overridden by the ones of @p overlay:
+ * - options that can be specified several times are appended, occurrences
+ *   with the same arguments as the existing ones are skipped;
+ * - occurrences of other options (including options missing in the
+ *   options table) replace all occurrences of the base option;
+ * - inline blocks replace base inline blocks of the same name.
+ *
+ * Values of @p base and @p overlay are shared with the result object
+ * (they are never modified). Every base key is added to the result,
+ * so merge takes O(base + overlay) time: count of base and overlay
+ * options and inline blocks plus base occurrences of the options
+ * appended by the overlay.
+ *
+ * @param[in]  base     Base configuration object (converter JSON format)
+ * @param[in]  overlay  Overlay configuration object
+ * @param[out] result   Merged configuration object (must be released
+ *                      by caller)
+ *
+ * @return 0 on success
+ * @return -EINVAL if configuration object has invalid structure
+ * @return -ENOMEM on memory allocation failure
+ */
+int ovpn_merge(json_object *base, json_object *overlay, json_object **result);
+
+/**
+ * @brief UCI output settings
+ */
+typedef struct
+{
+	/** "openvpn" section name */
+	const char *section;
+
+	/** Directory for plain inline data files (NULL - current directory) */
+	const char *inline_dir;
+
+} ovpn_uci_opts_t;
+
+/**
+ * Dump OVPN configuration as OpenWrt UCI "openvpn" section
+ *
+ * Options are written as UCI options (dashes in names are replaced
+ * with underscores), options without arguments have value "1". Options
+ * that can be specified several times are written as lists. Plain
+ * inline data is written to "<inline_dir>/<section>.<name>" files
+ * referenced by the options of the same name.
+ *
+ * @param[in] ovpn    OVPN configuration
+ * @param[in] format  OVPN_FORMAT_UCI or OVPN_FORMAT_UCI_BATCH
+ * @param[in] opts    UCI output settings
+ * @param[in] stream  Output stream
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int ovpn_dump_uci(
+	ovpn_t *ovpn,
+	ovpn_format_t format,
+	const ovpn_uci_opts_t *opts,
+	FILE *stream
+);
+
+/**
+ * Encode JSON object in binary (CBOR or MessagePack) format
+ *
+ * All strings are encoded as text strings.
+ */
+int ovpn_encode_object(
+	ovpn_format_t format, json_object *obj, FILE *stream);
+
+/**
+ * Encode blob record in binary (CBOR or MessagePack) format
+ */
+int ovpn_encode_blob(
+	ovpn_format_t format,
+	const char *digest,
+	const char *data,
+	size_t len,
+	FILE *stream
+);
+
+/* ----------------------------------------------------------------------- */
+
+/**
+ * @brief OpenVPN status files (openvpn-status.log) converter
+ */
+typedef struct ovpn_status_log ovpn_status_log_t;
+
+/**
+ * Create status files converter
+ *
+ * Converter keeps line buffer, sections and column names between
+ * conversions, so it should be reused for repeated conversions.
+ *
+ * @param[in] format      Output format
+ * @param[in] dump_flags  JSON dump flags (OVPN_DUMP_FLAG_*)
+ */
+ovpn_status_log_t *ovpn_status_log_new(
+	ovpn_format_t format, unsigned int dump_flags);
+
+void ovpn_status_log_delete(ovpn_status_log_t *log);
+
+/**
+ * Convert status file (--status-version 1, 2 or 3)
+ *
+ * Every row of the file is written to @p output as a separate
+ * record as soon as it is parsed.
+ *
+ * @return 0 on success
+ * @return -EINVAL on unknown file format
+ * @return <0 on other errors
+ */
+int ovpn_status_log_convert(
+	ovpn_status_log_t *log, FILE *input, FILE *output);
+
+/**
+ * Convert status file each time it is changed
+ *
+ * File is checked for changes every @p interval_ms milliseconds
+ * until SIGINT or SIGTERM is received.
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int ovpn_status_log_follow(
+	ovpn_status_log_t *log,
+	const char *path,
+	unsigned int interval_ms,
+	FILE *output
+);
+
 /* ----------------------------------------------------------------------- */
 
 typedef enum
@@ -80,6 +749,25 @@ typedef enum
 
 } ovpn_msg_type_t;
 
+/**
+ * Add status message
+ *
+ * Message is not formatted here, @p format and arguments are stored
+ * and formatted only when status is dumped. Identical messages
+ * (same format and arguments) are aggregated.
+ *
+ * @param[in] ovpn    OVPN object
+ * @param[in] msg     Message type
+ * @param[in] line    Line number (0 - no line)
+ * @param[in] format  Untranslated message format marked with N_().
+ *                    Only %s, %d, %i, %u and %% conversions are
+ *                    supported. Format string must not be freed
+ *                    until the OVPN object is deleted.
+ *
+ * @return 0 on success
+ * @return -EINVAL on unsupported format
+ * @return -ENOMEM on memory allocation failure
+ */
 __attribute__((format(printf, 4, 5)))
 int ovpn_status_msg(
 	ovpn_t *ovpn,
@@ -88,6 +776,39 @@ int ovpn_status_msg(
 	const char *format, ...
 );
 
+/**
+ * Get status JSON object
+ *
+ * Object is built from the stored messages on the first call.
+ *
+ * @return Status JSON object owned by the OVPN object or NULL on error
+ */
+json_object *ovpn_status_json(ovpn_t *ovpn);
+
+/**
+ * Add status JSON object to the main JSON object
+ * if @ref OVPN_FLAG_INCLUDE_STATUS flag is set
+ */
+int ovpn_include_status(ovpn_t *ovpn);
+
+/**
+ * Merge status messages and counters of included configuration
+ *
+ * @param[in] ovpn  Including configuration
+ * @param[in] src   Included configuration
+ *
+ * @return 0 on success
+ * @return <0 on error
+ */
+int ovpn_status_merge(ovpn_t *ovpn, const ovpn_t *src);
+
+/**
+ * Get count of stored status message occurrences
+ */
+unsigned int ovpn_status_stored(const ovpn_t *ovpn);
+
+void ovpn_status_delete(ovpn_status_t *status);
+
 /* ----------------------------------------------------------------------- */
 
 #endif /* OVPN_H */
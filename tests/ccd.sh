@@ -0,0 +1,43 @@
+#!/bin/sh
+#
+# OpenVPN Configuration Files Converter
+# Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+#
+# This work is free. You can redistribute it and/or modify it under the
+# terms of the Do What The Fuck You Want To Public License, Version 2,
+# as published by Sam Hocevar. See the COPYING file for more details.
+#
+# Client config directory with one valid and one broken client file.
+# Broken file must not stop conversion of the valid one.
+#
+# Usage: ccd.sh <ovpn-convert> <tests-dir>
+#
+
+CONVERT="$1"
+DIR="$2/ccd"
+
+OUT=$("${CONVERT}" --ccd "${DIR}" 2>/dev/null)
+RET=$?
+STATUS=$("${CONVERT}" --ccd "${DIR}" 2>&1 >/dev/null)
+
+fail()
+{
+	echo "FAIL: $1" >&2
+	exit 1
+}
+
+[ ${RET} -eq 0 ] || fail "exit code ${RET}"
+
+echo "${OUT}" | grep -q '"good":{"inlines":{},"options":{"iroute":\[{"args":\["10.1.0.0","255.255.0.0"\]}\],"vlan-pvid":\[{"args":\["5"\]}\]}}' ||
+	fail "valid client is not converted"
+
+echo "${OUT}" | grep -q '"bad":{"inlines":{},"options":{"iroute":\[{"args":\["10.2.0.0"\]}\]}}' ||
+	fail "data of broken client parsed before error is not converted"
+
+echo "${STATUS}" | grep -q '"bad":{"errors":1,' ||
+	fail "error of broken client is not reported"
+
+echo "${STATUS}" | grep -q '"good"' &&
+	fail "status is reported for valid client"
+
+exit 0
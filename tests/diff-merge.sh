@@ -0,0 +1,60 @@
+#!/bin/sh
+#
+# OpenVPN Configuration Files Converter
+# Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+#
+# This work is free. You can redistribute it and/or modify it under the
+# terms of the Do What The Fuck You Want To Public License, Version 2,
+# as published by Sam Hocevar. See the COPYING file for more details.
+#
+# Differences of two configurations (--diff) and configuration merged on
+# top of two layers (--merge, --merge-dir).
+#
+# Usage: diff-merge.sh <ovpn-convert> <tests-dir>
+#
+
+CONVERT="$1"
+DIR="$2/diff-merge"
+TMP=$(mktemp -d) || exit 1
+
+trap 'rm -rf "${TMP}"' EXIT
+
+fail()
+{
+	echo "FAIL: $1" >&2
+	exit 1
+}
+
+OUT=$("${CONVERT}" --diff "${DIR}/base.ovpn" "${DIR}/site.ovpn" 2>/dev/null) ||
+	fail "configurations are not compared"
+
+[ "${OUT}" = '{"options":{"added":{"remote":[{"args":["b.example","1194"]}]},"removed":{"verb":[{"args":["3"]}]},"changed":{"proto":{"from":{"args":["udp"]},"to":{"args":["tcp"]}}}},"inlines":{"added":{},"removed":{},"changed":{}}}' ] ||
+	fail "unexpected diff: ${OUT}"
+
+OUT=$("${CONVERT}" --merge "${DIR}/base.ovpn" --merge "${DIR}/site.ovpn" \
+	"${DIR}/dev1.ovpn" 2>/dev/null) ||
+	fail "configuration is not merged"
+
+[ "${OUT}" = '{"inlines":{"ca":{"type":"plain","data":["X\n"]}},"options":{"dev":[{"args":["tun"]}],"proto":[{"args":["tcp"]}],"remote":[{"args":["a.example","1194"]},{"args":["b.example","1194"]}],"verb":[{"args":["4"]}]}}' ] ||
+	fail "unexpected merged configuration: ${OUT}"
+
+"${CONVERT}" --merge "${DIR}/base.ovpn" --merge "${DIR}/site.ovpn" \
+	--merge-dir "${TMP}" "${DIR}/dev1.ovpn" 2>/dev/null ||
+	fail "configuration is not merged into directory"
+
+EXPECTED='dev tun
+proto tcp
+remote a.example 1194
+remote b.example 1194
+verb 4
+<ca>
+X
+</ca>'
+
+[ "$(cat "${TMP}/dev1.ovpn")" = "${EXPECTED}" ] ||
+	fail "unexpected merged file: $(cat "${TMP}/dev1.ovpn")"
+
+[ -z "$(find "${TMP}/dev1.ovpn" -perm /077)" ] ||
+	fail "merged file is accessible by others"
+
+exit 0
@@ -0,0 +1,43 @@
+#!/bin/sh
+#
+# OpenVPN Configuration Files Converter
+# Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+#
+# This work is free. You can redistribute it and/or modify it under the
+# terms of the Do What The Fuck You Want To Public License, Version 2,
+# as published by Sam Hocevar. See the COPYING file for more details.
+#
+# Include cycle a.ovpn -> sub/b.conf -> ../a.ovpn. Fragment of b.conf
+# cut short by the cycle must not be cached, so a2.ovpn (that includes
+# b.conf too) is converted the same way in a batch and alone.
+#
+# Usage: include-cycle.sh <ovpn-convert> <tests-dir>
+#
+
+CONVERT="$1"
+DIR="$2/include-cycle"
+
+fail()
+{
+	echo "FAIL: $1" >&2
+	exit 1
+}
+
+BATCH_OUT=$("${CONVERT}" --follow-includes "${DIR}/a.ovpn" "${DIR}/a2.ovpn" 2>/dev/null | sed -n 2p)
+BATCH_STATUS=$("${CONVERT}" --follow-includes "${DIR}/a.ovpn" "${DIR}/a2.ovpn" 2>&1 >/dev/null | sed -n 2p)
+
+ALONE_OUT=$("${CONVERT}" --follow-includes "${DIR}/a2.ovpn" 2>/dev/null)
+ALONE_STATUS=$("${CONVERT}" --follow-includes "${DIR}/a2.ovpn" 2>&1 >/dev/null)
+
+[ -n "${ALONE_OUT}" ] || fail "a2.ovpn is not converted"
+
+[ "${BATCH_OUT}" = "${ALONE_OUT}" ] ||
+	fail "a2.ovpn data differs in batch: ${BATCH_OUT}"
+
+[ "${BATCH_STATUS}" = "${ALONE_STATUS}" ] ||
+	fail "a2.ovpn status differs in batch: ${BATCH_STATUS}"
+
+echo "${ALONE_STATUS}" | grep -q '"errors":1,' ||
+	fail "include cycle is not reported"
+
+exit 0
@@ -0,0 +1,48 @@
+#!/bin/sh
+#
+# OpenVPN Configuration Files Converter
+# Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+#
+# This work is free. You can redistribute it and/or modify it under the
+# terms of the Do What The Fuck You Want To Public License, Version 2,
+# as published by Sam Hocevar. See the COPYING file for more details.
+#
+# Binary index of ifconfig-pool-persist entries (--ipp-index) looked up
+# by common name, IPv4 and IPv6 address (--ipp-lookup).
+#
+# Usage: ipp.sh <ovpn-convert> <tests-dir>
+#
+
+CONVERT="$1"
+DIR="$2/ipp"
+TMP=$(mktemp -d) || exit 1
+
+trap 'rm -rf "${TMP}"' EXIT
+
+fail()
+{
+	echo "FAIL: $1" >&2
+	exit 1
+}
+
+"${CONVERT}" --ipp-index "${TMP}/ipp.idx" "${DIR}/ipp.txt" 2>/dev/null ||
+	fail "index is not built"
+
+OUT=$("${CONVERT}" --ipp-lookup "${TMP}/ipp.idx" \
+	client2 10.8.0.12 fd00::8 nobody 10.8.0.99) ||
+	fail "keys are not looked up"
+
+EXPECTED='{"key":"client2","cn":"client2","ip":"10.8.0.8","ipv6":"fd00::8"}
+{"key":"10.8.0.12","cn":"client3","ip":"10.8.0.12"}
+{"key":"fd00::8","cn":"client2","ip":"10.8.0.8","ipv6":"fd00::8"}
+{"key":"nobody"}
+{"key":"10.8.0.99"}'
+
+[ "${OUT}" = "${EXPECTED}" ] ||
+	fail "unexpected lookup result: ${OUT}"
+
+[ "$(echo client1 | "${CONVERT}" --ipp-lookup "${TMP}/ipp.idx" -s)" = \
+	'{"key":"client1","cn":"client1","ip":"10.8.0.4"}' ] ||
+	fail "keys from stdin are not looked up"
+
+exit 0
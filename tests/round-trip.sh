@@ -0,0 +1,52 @@
+#!/bin/sh
+#
+# OpenVPN Configuration Files Converter
+# Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+#
+# This work is free. You can redistribute it and/or modify it under the
+# terms of the Do What The Fuck You Want To Public License, Version 2,
+# as published by Sam Hocevar. See the COPYING file for more details.
+#
+# Configuration converted to JSON and back to OVPN format (--to-ovpn)
+# must be parsed into the same data. Canonical form (-f canonical) must
+# not change on the round trip and when canonical output is parsed again.
+#
+# Usage: round-trip.sh <ovpn-convert> <tests-dir>
+#
+
+CONVERT="$1"
+DIR="$2/round-trip"
+
+fail()
+{
+	echo "FAIL: $1" >&2
+	exit 1
+}
+
+JSON=$("${CONVERT}" "${DIR}/client.ovpn" 2>/dev/null)
+
+[ -n "${JSON}" ] ||
+	fail "configuration is not converted"
+
+OVPN=$(printf "%s\n" "${JSON}" | "${CONVERT}" --to-ovpn -s 2>/dev/null) ||
+	fail "configuration is not converted back to OVPN format"
+
+[ "$(printf "%s\n" "${OVPN}" | "${CONVERT}" -s 2>/dev/null)" = "${JSON}" ] ||
+	fail "data differs after --to-ovpn round trip"
+
+CANONICAL=$("${CONVERT}" -f canonical "${DIR}/client.ovpn" 2>/dev/null) ||
+	fail "configuration is not converted to canonical form"
+
+[ "$(printf "%s\n" "${OVPN}" | "${CONVERT}" -f canonical -s 2>/dev/null)" = "${CANONICAL}" ] ||
+	fail "canonical form differs after --to-ovpn round trip"
+
+[ "$(printf "%s\n" "${CANONICAL}" | "${CONVERT}" -f canonical -s 2>/dev/null)" = "${CANONICAL}" ] ||
+	fail "canonical form changes when parsed again"
+
+printf "%s\n" "${CANONICAL}" | grep -qx 'verb 3' ||
+	fail "leading zeros are not removed in canonical form"
+
+printf "%s\n" "${CANONICAL}" | grep -qx 'auth-user-pass "login file.txt"' ||
+	fail "argument with whitespaces is not quoted in canonical form"
+
+exit 0
@@ -0,0 +1,63 @@
+#!/bin/sh
+#
+# OpenVPN Configuration Files Converter
+# Copyright © 2020 Anton Kikin <a.kikin@tano-systems.com>
+#
+# This work is free. You can redistribute it and/or modify it under the
+# terms of the Do What The Fuck You Want To Public License, Version 2,
+# as published by Sam Hocevar. See the COPYING file for more details.
+#
+# Options schema compiled from the specification written by --schema-dump
+# with an additional vendor option. Loaded schema must dump the same
+# specification and accept the vendor option, built-in table must not.
+#
+# Usage: schema.sh <ovpn-convert> <tests-dir>
+#
+
+CONVERT="$1"
+DIR="$2/schema"
+TMP=$(mktemp -d) || exit 1
+
+trap 'rm -rf "${TMP}"' EXIT
+
+fail()
+{
+	echo "FAIL: $1" >&2
+	exit 1
+}
+
+"${CONVERT}" --schema-dump > "${TMP}/builtin.spec"
+
+[ -s "${TMP}/builtin.spec" ] ||
+	fail "built-in table is not dumped"
+
+"${CONVERT}" --schema-compile "${TMP}/builtin.bin" 2>/dev/null ||
+	fail "built-in table is not compiled"
+
+"${CONVERT}" --schema "${TMP}/builtin.bin" --schema-dump |
+	cmp -s - "${TMP}/builtin.spec" ||
+	fail "compiled built-in table dump differs"
+
+cat "${TMP}/builtin.spec" "${DIR}/vendor.spec" > "${TMP}/vendor.spec"
+
+"${CONVERT}" --schema-compile "${TMP}/vendor.bin" "${TMP}/vendor.spec" 2>/dev/null ||
+	fail "specification is not compiled"
+
+"${CONVERT}" --schema "${TMP}/vendor.bin" --schema-dump |
+	cmp -s - "${TMP}/vendor.spec" ||
+	fail "compiled specification dump differs"
+
+OUT=$("${CONVERT}" --schema "${TMP}/vendor.bin" "${DIR}/vendor.ovpn" 2>/dev/null)
+STATUS=$("${CONVERT}" --schema "${TMP}/vendor.bin" "${DIR}/vendor.ovpn" 2>&1 >/dev/null)
+
+printf "%s\n" "${OUT}" | grep -q '"vendor-opt":\[{"args":\["5"\]}\]' ||
+	fail "vendor option is not converted with schema"
+
+printf "%s\n" "${STATUS}" | grep -q '"warnings":0,' ||
+	fail "vendor option is reported with schema"
+
+"${CONVERT}" "${DIR}/vendor.ovpn" 2>&1 >/dev/null |
+	grep -q "Unknown option 'vendor-opt'" ||
+	fail "vendor option is accepted by built-in table"
+
+exit 0
@@ -0,0 +1,3 @@
+
+option vendor-opt 1 1 normal
+	arg value string